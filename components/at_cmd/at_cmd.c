@@ -0,0 +1,510 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : AT_CMD.c
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+#if !defined(CONFIG_AT_CMD_MOCK)
+#include <nrf_modem_at.h>
+#endif
+#include "at_cmd.h"
+#include "metrics.h"
+
+#define AT_CMD_RESPONSE_LEN 128
+
+LOG_MODULE_REGISTER(AT_CMD);
+
+typedef int (*at_cmd_parser_t)(const char *response, char *value, size_t len);
+
+struct at_cmd_desc
+{
+	const char *name;
+	const char *cmd;
+	at_cmd_parser_t parse;
+#if defined(CONFIG_AT_CMD_MOCK)
+	const char *mock_response;
+#endif
+};
+
+struct at_cmd_req
+{
+	enum at_cmd_id id;
+	at_cmd_cb_t cb;
+	void *user_data;
+};
+
+static int parse_digits(const char *response, char *value, size_t len);
+static int parse_after_colon(const char *response, char *value, size_t len);
+static int parse_line(const char *response, char *value, size_t len);
+
+#if defined(CONFIG_AT_CMD_MOCK)
+#define AT_CMD_MOCK(resp) .mock_response = resp,
+#else
+#define AT_CMD_MOCK(resp)
+#endif
+
+static const struct at_cmd_desc at_cmd_table[AT_CMD_COUNT] = {
+	[AT_CMD_IMEI] = {
+		.name = "imei",
+		.cmd = "AT+CGSN",
+		.parse = parse_digits,
+		AT_CMD_MOCK("352656100000001\r\nOK\r\n")},
+	[AT_CMD_ICCID] = {
+		.name = "iccid",
+		.cmd = "AT%XICCID",
+		.parse = parse_after_colon,
+		AT_CMD_MOCK("%XICCID: 89882280666027595366\r\nOK\r\n")},
+	[AT_CMD_FW_VERSION] = {
+		.name = "fw_version",
+		.cmd = "AT+CGMR",
+		.parse = parse_line,
+		AT_CMD_MOCK("mfw_nrf9160_1.3.5\r\nOK\r\n")},
+	[AT_CMD_FUNC_MODE] = {
+		.name = "func_mode",
+		.cmd = "AT+CFUN?",
+		.parse = parse_after_colon,
+		AT_CMD_MOCK("+CFUN: 0\r\nOK\r\n")},
+};
+
+K_MSGQ_DEFINE(at_cmd_queue, sizeof(struct at_cmd_req), CONFIG_AT_CMD_QUEUE_SIZE, 4);
+
+static K_MUTEX_DEFINE(stats_lock);
+static struct at_cmd_stats stats[AT_CMD_COUNT];
+
+#if defined(CONFIG_AT_CMD_MOCK)
+static const char *mock_override[AT_CMD_COUNT];
+static int mock_error[AT_CMD_COUNT];
+#endif
+
+/* Synchronous callers share one context. The generation counter makes a late
+ * completion of a timed out request harmless: the completion checks it and
+ * copies the value under sync_ctx_lock, which at_cmd_exec() also takes to
+ * invalidate the context before it returns.
+ */
+static K_MUTEX_DEFINE(sync_lock);
+static K_SEM_DEFINE(sync_done, 0, 1);
+static struct k_spinlock sync_ctx_lock;
+static struct
+{
+	uint32_t gen;
+	uint32_t done_gen;
+	int err;
+	char *value;
+	size_t len;
+} sync_ctx;
+
+static int parse_digits(const char *response, char *value, size_t len)
+{
+	size_t n = strspn(response, "0123456789");
+
+	if (n == 0 || n >= len)
+	{
+		return -EBADMSG;
+	}
+
+	memcpy(value, response, n);
+	value[n] = '\0';
+	return 0;
+}
+
+static int parse_after_colon(const char *response, char *value, size_t len)
+{
+	const char *start = strchr(response, ':');
+	size_t n;
+
+	if (!start)
+	{
+		return -EBADMSG;
+	}
+
+	start++;
+	while (*start == ' ')
+	{
+		start++;
+	}
+
+	n = strcspn(start, "\r\n");
+	if (n == 0 || n >= len)
+	{
+		return -EBADMSG;
+	}
+
+	memcpy(value, start, n);
+	value[n] = '\0';
+	return 0;
+}
+
+static int parse_line(const char *response, char *value, size_t len)
+{
+	size_t n = strcspn(response, "\r\n");
+
+	if (n == 0 || n >= len)
+	{
+		return -EBADMSG;
+	}
+
+	memcpy(value, response, n);
+	value[n] = '\0';
+	return 0;
+}
+
+/*
+Function : at_backend_exec
+
+Description : Sends one AT command to the modem, or returns the canned response of
+			  the mock backend after CONFIG_AT_CMD_MOCK_LATENCY_MS.
+
+Parameter :
+- desc : Command descriptor.
+- response : Response buffer.
+- len : Size of the response buffer.
+
+Return :
+0 on success, negative errno or positive modem error on failure.
+
+Example Call :
+				at_backend_exec(&at_cmd_table[AT_CMD_IMEI], buf, sizeof(buf));
+*/
+static int at_backend_exec(const struct at_cmd_desc *desc, char *response, size_t len)
+{
+#if defined(CONFIG_AT_CMD_MOCK)
+	int id = desc - at_cmd_table;
+
+	k_msleep(CONFIG_AT_CMD_MOCK_LATENCY_MS);
+	if (mock_error[id])
+	{
+		return mock_error[id];
+	}
+	strncpy(response, mock_override[id] ? mock_override[id] : desc->mock_response, len - 1);
+	response[len - 1] = '\0';
+	return 0;
+#else
+	return nrf_modem_at_cmd(response, len, "%s", desc->cmd);
+#endif
+}
+
+static void at_cmd_record(enum at_cmd_id id, int err, uint32_t us)
+{
+	uint32_t ms = us / 1000;
+	int bucket = 0;
+
+	while (ms > 1 && bucket < AT_CMD_HIST_BUCKETS - 1)
+	{
+		ms >>= 1;
+		bucket++;
+	}
+
+	k_mutex_lock(&stats_lock, K_FOREVER);
+	stats[id].count++;
+	stats[id].errors += (err != 0);
+	stats[id].total_us += us;
+	stats[id].max_us = MAX(stats[id].max_us, us);
+	stats[id].hist[bucket]++;
+	k_mutex_unlock(&stats_lock);
+
+	/* All commands together in the metrics registry, per command in at_cmd_stats_get(). */
+	metrics_hist_record(METRIC_HIST_AT_CMD_MS, us / 1000);
+	if (err)
+	{
+		metrics_inc(METRIC_AT_CMD_ERROR);
+	}
+}
+
+static void at_cmd_thread(void)
+{
+	static char response[AT_CMD_RESPONSE_LEN];
+	char value[AT_CMD_VALUE_MAX_LEN];
+	struct at_cmd_req req;
+	const struct at_cmd_desc *desc;
+	uint32_t start;
+	uint32_t us;
+	int err;
+
+	while (1)
+	{
+		k_msgq_get(&at_cmd_queue, &req, K_FOREVER);
+		desc = &at_cmd_table[req.id];
+
+		start = k_cycle_get_32();
+		err = at_backend_exec(desc, response, sizeof(response));
+		us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+		if (err == 0)
+		{
+			err = desc->parse(response, value, sizeof(value));
+		}
+		else if (err > 0)
+		{
+			LOG_WRN("%s: modem error %d", desc->cmd, err);
+			err = -EIO;
+		}
+
+		at_cmd_record(req.id, err, us);
+		LOG_DBG("%s done in %u us, err %d", desc->cmd, us, err);
+
+		if (req.cb)
+		{
+			req.cb(req.id, err, err ? NULL : value, req.user_data);
+		}
+	}
+}
+
+K_THREAD_DEFINE(at_cmd_tid, CONFIG_AT_CMD_THREAD_STACK_SIZE, at_cmd_thread,
+				NULL, NULL, NULL, CONFIG_AT_CMD_THREAD_PRIORITY, 0, 0);
+
+/*
+Function : at_cmd_submit
+
+Description : Queues an AT command and returns without waiting for the modem. The
+			  parsed value is delivered to the callback on the AT command thread.
+
+Parameter :
+- id : Command to run.
+- cb : Completion callback, may be NULL.
+- user_data : Passed to the callback.
+
+Return :
+0 on success, -EINVAL for an unknown command, -ENOBUFS if the queue is full.
+
+Example Call :
+				at_cmd_submit(AT_CMD_ICCID, iccid_done, NULL);
+*/
+int at_cmd_submit(enum at_cmd_id id, at_cmd_cb_t cb, void *user_data)
+{
+	struct at_cmd_req req = {
+		.id = id,
+		.cb = cb,
+		.user_data = user_data,
+	};
+
+	if (id >= AT_CMD_COUNT)
+	{
+		return -EINVAL;
+	}
+
+	if (k_msgq_put(&at_cmd_queue, &req, K_NO_WAIT))
+	{
+		LOG_WRN("AT command queue full, dropping %s", at_cmd_table[id].cmd);
+		return -ENOBUFS;
+	}
+
+	return 0;
+}
+
+static void at_cmd_sync_cb(enum at_cmd_id id, int err, const char *value,
+						   void *user_data)
+{
+	k_spinlock_key_t key = k_spin_lock(&sync_ctx_lock);
+	bool current = ((uint32_t)(uintptr_t)user_data == sync_ctx.gen);
+
+	/* A stale completion belongs to a caller that already timed out and
+	 * returned, its buffer must not be touched.
+	 */
+	if (current)
+	{
+		sync_ctx.err = err;
+		sync_ctx.done_gen = sync_ctx.gen;
+		if (!err)
+		{
+			strncpy(sync_ctx.value, value, sync_ctx.len - 1);
+			sync_ctx.value[sync_ctx.len - 1] = '\0';
+		}
+	}
+
+	k_spin_unlock(&sync_ctx_lock, key);
+
+	/* Given outside the lock, the waiter checks done_gen. */
+	if (current)
+	{
+		k_sem_give(&sync_done);
+	}
+}
+
+/*
+Function : at_cmd_exec
+
+Description : Runs an AT command through the queue and waits for its parsed value.
+
+Parameter :
+- id : Command to run.
+- value : Buffer receiving the parsed value.
+- len : Size of the value buffer.
+- timeout : Maximum time to wait for completion.
+
+Return :
+0 on success, -ETIMEDOUT, or the negative error of the command.
+
+Example Call :
+				at_cmd_exec(AT_CMD_IMEI, imei, sizeof(imei), K_SECONDS(2));
+*/
+int at_cmd_exec(enum at_cmd_id id, char *value, size_t len, k_timeout_t timeout)
+{
+	k_spinlock_key_t key;
+	uint32_t gen;
+	int err;
+
+	if (!value || len == 0)
+	{
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&sync_lock, K_FOREVER);
+
+	k_sem_reset(&sync_done);
+
+	key = k_spin_lock(&sync_ctx_lock);
+	gen = ++sync_ctx.gen;
+	sync_ctx.value = value;
+	sync_ctx.len = len;
+	k_spin_unlock(&sync_ctx_lock, key);
+
+	err = at_cmd_submit(id, at_cmd_sync_cb, (void *)(uintptr_t)gen);
+	if (!err)
+	{
+		bool done = false;
+
+		/* A completion of a timed out predecessor can still give the semaphore
+		 * after the reset above. It is told apart by its generation.
+		 */
+		while (!done)
+		{
+			if (k_sem_take(&sync_done, timeout))
+			{
+				err = -ETIMEDOUT;
+				break;
+			}
+
+			key = k_spin_lock(&sync_ctx_lock);
+			done = (sync_ctx.done_gen == gen);
+			err = sync_ctx.err;
+			k_spin_unlock(&sync_ctx_lock, key);
+		}
+	}
+
+	/* Invalidate the context so a late completion cannot write to value. Once
+	 * the lock is taken here, no completion is copying into it either.
+	 */
+	key = k_spin_lock(&sync_ctx_lock);
+	sync_ctx.gen++;
+	sync_ctx.value = NULL;
+	k_spin_unlock(&sync_ctx_lock, key);
+
+	k_mutex_unlock(&sync_lock);
+	return err;
+}
+
+const char *at_cmd_name(enum at_cmd_id id)
+{
+	return (id < AT_CMD_COUNT) ? at_cmd_table[id].name : "unknown";
+}
+
+void at_cmd_stats_get(enum at_cmd_id id, struct at_cmd_stats *out)
+{
+	if (id >= AT_CMD_COUNT)
+	{
+		return;
+	}
+
+	k_mutex_lock(&stats_lock, K_FOREVER);
+	*out = stats[id];
+	k_mutex_unlock(&stats_lock);
+}
+
+#if defined(CONFIG_AT_CMD_MOCK)
+/*
+Function : at_cmd_mock_set
+
+Description : Replaces the canned response of one command in the mock backend, so
+			  parsers and error paths can be exercised on native_sim.
+
+Parameter :
+- id : Command.
+- response : Raw modem response, NULL restores the built-in one.
+- err : Positive modem error (or negative errno) returned instead of a response,
+		0 for none.
+
+Return : void
+
+Example Call :
+				at_cmd_mock_set(AT_CMD_ICCID, "+CME ERROR: 10\r\n", 0);
+*/
+void at_cmd_mock_set(enum at_cmd_id id, const char *response, int err)
+{
+	if (id >= AT_CMD_COUNT)
+	{
+		return;
+	}
+
+	mock_override[id] = response;
+	mock_error[id] = err;
+}
+#endif
+
+#if defined(CONFIG_SHELL)
+static int cmd_at_cmd_stats(const struct shell *sh, size_t argc, char **argv)
+{
+	struct at_cmd_stats s;
+
+	for (int id = 0; id < AT_CMD_COUNT; id++)
+	{
+		char hist[AT_CMD_HIST_BUCKETS * 6];
+		size_t pos = 0;
+
+		at_cmd_stats_get(id, &s);
+
+		for (int b = 0; b < AT_CMD_HIST_BUCKETS && pos < sizeof(hist); b++)
+		{
+			pos += snprintf(&hist[pos], sizeof(hist) - pos, "%u ", s.hist[b]);
+		}
+
+		shell_print(sh, "%-10s n %u err %u mean %u us max %u us hist[ms log2] %s",
+					at_cmd_table[id].name, s.count, s.errors,
+					s.count ? (uint32_t)(s.total_us / s.count) : 0, s.max_us, hist);
+	}
+
+	return 0;
+}
+
+static int cmd_at_cmd_get(const struct shell *sh, size_t argc, char **argv)
+{
+	char value[AT_CMD_VALUE_MAX_LEN];
+	int err;
+
+	for (int id = 0; id < AT_CMD_COUNT; id++)
+	{
+		if (strcmp(argv[1], at_cmd_table[id].name) != 0)
+		{
+			continue;
+		}
+
+		err = at_cmd_exec(id, value, sizeof(value), K_MSEC(CONFIG_AT_CMD_TIMEOUT_MS));
+		if (err)
+		{
+			shell_error(sh, "%s failed: %d", at_cmd_table[id].cmd, err);
+			return err;
+		}
+
+		shell_print(sh, "%s", value);
+		return 0;
+	}
+
+	shell_error(sh, "Unknown command %s", argv[1]);
+	return -EINVAL;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_at_cmd,
+							   SHELL_CMD(stats, NULL, "Count, errors and latency per command", cmd_at_cmd_stats),
+							   SHELL_CMD_ARG(get, NULL, "<imei|iccid|fw_version|func_mode>", cmd_at_cmd_get, 2, 0),
+							   SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(at_cmd, &sub_at_cmd, "AT command service", NULL);
+#endif
\ No newline at end of file
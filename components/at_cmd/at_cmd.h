@@ -0,0 +1,54 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : AT_CMD.h
+*/
+
+#ifndef _AT_CMD_H_
+#define _AT_CMD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+#define AT_CMD_VALUE_MAX_LEN 48
+#define AT_CMD_HIST_BUCKETS 12
+
+enum at_cmd_id
+{
+	AT_CMD_IMEI,
+	AT_CMD_ICCID,
+	AT_CMD_FW_VERSION,
+	AT_CMD_FUNC_MODE,
+	AT_CMD_COUNT
+};
+
+/* Completion callback, runs on the AT command thread. value is only valid
+ * during the call and is NULL when err is non-zero.
+ */
+typedef void (*at_cmd_cb_t)(enum at_cmd_id id, int err, const char *value,
+							void *user_data);
+
+struct at_cmd_stats
+{
+	uint32_t count;
+	uint32_t errors;
+	uint32_t max_us;
+	uint64_t total_us;
+	/* Bucket b counts latencies in [2^b, 2^(b+1)) ms, bucket 0 also holds < 1 ms. */
+	uint32_t hist[AT_CMD_HIST_BUCKETS];
+};
+
+int at_cmd_submit(enum at_cmd_id id, at_cmd_cb_t cb, void *user_data);
+int at_cmd_exec(enum at_cmd_id id, char *value, size_t len, k_timeout_t timeout);
+
+const char *at_cmd_name(enum at_cmd_id id);
+void at_cmd_stats_get(enum at_cmd_id id, struct at_cmd_stats *stats);
+
+#if defined(CONFIG_AT_CMD_MOCK)
+void at_cmd_mock_set(enum at_cmd_id id, const char *response, int err);
+#endif
+
+#endif
\ No newline at end of file
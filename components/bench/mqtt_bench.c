@@ -0,0 +1,356 @@
+/*
+Name        : mqtt_bench.c
+
+Description : Implementation of the MQTT publish benchmark. A dedicated thread waits
+              for the broker connection, sweeps QoS 0..2 and payload sizes up to
+              CONFIG_MQTT_PAYLOAD_BUFFER_SIZE and prints one line per run:
+
+              BENCH {"qos":1,"size":256,"msg_buf":4096,"n":200,"msgs_per_s":850,
+                     "p50_us":1100,"p99_us":2400,"errors":0}
+
+              followed by "BENCH DONE". CI matches these lines on the console.
+
+Developer   : Engr. Akbar Shah
+
+Date        : May 13, 2025
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "mqtt_bench.h"
+#include "mqtt.h"
+
+LOG_MODULE_REGISTER(MQTT_BENCH);
+
+#define BENCH_TOPIC_SIZE 64
+#define BENCH_MIN_PAYLOAD 16
+
+struct bench_slot
+{
+    uint16_t message_id;
+    uint32_t start_cycles;
+    bool in_use;
+};
+
+static K_SEM_DEFINE(window_sem, CONFIG_MQTT_BENCH_WINDOW, CONFIG_MQTT_BENCH_WINDOW);
+static struct k_spinlock bench_lock;
+
+static struct bench_slot slots[CONFIG_MQTT_BENCH_WINDOW];
+static uint32_t latencies_us[CONFIG_MQTT_BENCH_MESSAGES];
+static uint32_t latency_count;
+static uint32_t ack_errors;
+
+static uint8_t bench_payload[CONFIG_MQTT_PAYLOAD_BUFFER_SIZE];
+static char bench_topic[BENCH_TOPIC_SIZE];
+
+/* Called with bench_lock held, from the acknowledgment or right after a QoS 0 send. */
+static void record_latency(uint32_t start_cycles)
+{
+    if (latency_count < ARRAY_SIZE(latencies_us))
+    {
+        latencies_us[latency_count++] = k_cyc_to_us_floor32(k_cycle_get_32() - start_cycles);
+    }
+}
+
+/* Runs on the MQTT thread for every PUBACK/PUBCOMP. */
+static void bench_ack_handler(uint16_t message_id, int result)
+{
+    bool matched = false;
+    k_spinlock_key_t key = k_spin_lock(&bench_lock);
+
+    for (int i = 0; i < ARRAY_SIZE(slots); i++)
+    {
+        if (slots[i].in_use && slots[i].message_id == message_id)
+        {
+            if (result == 0)
+            {
+                record_latency(slots[i].start_cycles);
+            }
+            else
+            {
+                ack_errors++;
+            }
+
+            slots[i].in_use = false;
+            matched = true;
+            break;
+        }
+    }
+
+    k_spin_unlock(&bench_lock, key);
+
+    if (matched)
+    {
+        k_sem_give(&window_sem);
+    }
+}
+
+static struct bench_slot *slot_claim(void)
+{
+    struct bench_slot *slot = NULL;
+    k_spinlock_key_t key = k_spin_lock(&bench_lock);
+
+    for (int i = 0; i < ARRAY_SIZE(slots); i++)
+    {
+        if (!slots[i].in_use)
+        {
+            slot = &slots[i];
+            slot->in_use = true;
+            slot->message_id = mqtt_next_message_id();
+            slot->start_cycles = k_cycle_get_32();
+            break;
+        }
+    }
+
+    k_spin_unlock(&bench_lock, key);
+
+    return slot;
+}
+
+/* Frees a slot whose publish was not sent, the window slot is kept by the caller. */
+static void slot_release_keep(struct bench_slot *slot)
+{
+    k_spinlock_key_t key = k_spin_lock(&bench_lock);
+
+    slot->in_use = false;
+
+    k_spin_unlock(&bench_lock, key);
+}
+
+/* Records the latency of a QoS 0 publish and frees its slot and window entry. */
+static void slot_record_release(struct bench_slot *slot)
+{
+    k_spinlock_key_t key = k_spin_lock(&bench_lock);
+
+    if (slot->in_use)
+    {
+        record_latency(slot->start_cycles);
+        slot->in_use = false;
+    }
+
+    k_spin_unlock(&bench_lock, key);
+
+    k_sem_give(&window_sem);
+}
+
+/* Waits for every in-flight message, counting the ones never acknowledged as errors. */
+static uint32_t drain_window(void)
+{
+    uint32_t lost = 0;
+
+    for (int i = 0; i < CONFIG_MQTT_BENCH_WINDOW; i++)
+    {
+        if (k_sem_take(&window_sem, K_MSEC(CONFIG_MQTT_BENCH_ACK_TIMEOUT_MS)) != 0)
+        {
+            break;
+        }
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&bench_lock);
+
+    for (int i = 0; i < ARRAY_SIZE(slots); i++)
+    {
+        if (slots[i].in_use)
+        {
+            slots[i].in_use = false;
+            lost++;
+        }
+    }
+
+    k_spin_unlock(&bench_lock, key);
+
+    k_sem_reset(&window_sem);
+    for (int i = 0; i < CONFIG_MQTT_BENCH_WINDOW; i++)
+    {
+        k_sem_give(&window_sem);
+    }
+
+    return lost;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(uint32_t pct)
+{
+    if (latency_count == 0)
+    {
+        return 0;
+    }
+
+    return latencies_us[((latency_count - 1) * pct) / 100];
+}
+
+int mqtt_bench_run(uint8_t qos, uint32_t payload_len, struct mqtt_bench_result *result)
+{
+    uint32_t errors = 0;
+    uint32_t sent = 0;
+    int64_t start_ticks;
+    int64_t elapsed_us;
+
+    if (!mqtt_is_connected())
+    {
+        return -ENOTCONN;
+    }
+
+    payload_len = MIN(payload_len, sizeof(bench_payload));
+
+    latency_count = 0;
+    ack_errors = 0;
+
+    start_ticks = k_uptime_ticks();
+
+    for (uint32_t i = 0; i < CONFIG_MQTT_BENCH_MESSAGES; i++)
+    {
+        struct bench_slot *slot;
+        uint16_t message_id;
+        int err;
+
+        if (k_sem_take(&window_sem, K_MSEC(CONFIG_MQTT_BENCH_ACK_TIMEOUT_MS)) != 0)
+        {
+            LOG_WRN("No acknowledgment within %d ms", CONFIG_MQTT_BENCH_ACK_TIMEOUT_MS);
+            errors++;
+            break;
+        }
+
+        /* Stamp the payload so the broker sees distinct messages. */
+        memcpy(bench_payload, &i, MIN(sizeof(i), payload_len));
+
+        for (;;)
+        {
+            /* Pace to the rate limiter before the slot is stamped, so the time
+             * spent waiting for tokens is not counted as latency.
+             */
+            k_msleep(mqtt_rate_wait_ms(strlen(bench_topic) + payload_len));
+
+            /* The slot holds the id and enqueue time before the publish, so an
+             * acknowledgment arriving on the MQTT thread always finds it.
+             */
+            slot = slot_claim();
+            if (slot == NULL)
+            {
+                err = -ENOBUFS;
+                break;
+            }
+
+            message_id = slot->message_id;
+
+            err = mqtt_publish_topic_id(bench_topic, (enum mqtt_qos)qos, bench_payload,
+                                        payload_len, &message_id);
+            if (err == 0)
+            {
+                break;
+            }
+
+            slot_release_keep(slot);
+            if (err != -EAGAIN)
+            {
+                break;
+            }
+        }
+
+        if (err)
+        {
+            LOG_WRN("Publish failed: %d", err);
+            k_sem_give(&window_sem);
+            errors++;
+            continue;
+        }
+
+        sent++;
+
+        if (qos == MQTT_QOS_0_AT_MOST_ONCE)
+        {
+            /* Nothing is acknowledged, the latency is the time to hand the
+             * message to the socket.
+             */
+            slot_record_release(slot);
+        }
+    }
+
+    errors += drain_window();
+    elapsed_us = k_ticks_to_us_floor64(k_uptime_ticks() - start_ticks);
+
+    qsort(latencies_us, latency_count, sizeof(latencies_us[0]), cmp_u32);
+
+    result->qos = qos;
+    result->payload_len = payload_len;
+    result->messages = sent;
+    result->errors = errors + ack_errors;
+    result->msgs_per_s = elapsed_us > 0 ? (uint32_t)((latency_count * 1000000LL) / elapsed_us) : 0;
+    result->p50_us = percentile(50);
+    result->p99_us = percentile(99);
+
+    return 0;
+}
+
+static void bench_print(const struct mqtt_bench_result *r)
+{
+    printk("BENCH {\"qos\":%u,\"size\":%u,\"msg_buf\":%u,\"n\":%u,\"msgs_per_s\":%u,"
+           "\"p50_us\":%u,\"p99_us\":%u,\"errors\":%u}\n",
+           r->qos, r->payload_len, CONFIG_MQTT_MESSAGE_BUFFER_SIZE, r->messages,
+           r->msgs_per_s, r->p50_us, r->p99_us, r->errors);
+}
+
+static void mqtt_bench_thread(void)
+{
+    struct mqtt_bench_result result;
+    int err;
+
+    while (!mqtt_is_connected())
+    {
+        k_sleep(K_MSEC(500));
+    }
+
+    /* Let the subscriptions settle before measuring. */
+    k_sleep(K_MSEC(CONFIG_MQTT_BENCH_START_DELAY_MS));
+
+    snprintf(bench_topic, sizeof(bench_topic), "mqtt/%s/bench", DEVICE_ID);
+
+    err = mqtt_ack_handler_register(bench_ack_handler);
+    if (err)
+    {
+        LOG_ERR("Failed to register ack handler: %d", err);
+        return;
+    }
+
+    for (uint8_t qos = MQTT_QOS_0_AT_MOST_ONCE; qos <= MQTT_QOS_2_EXACTLY_ONCE; qos++)
+    {
+        uint32_t size = BENCH_MIN_PAYLOAD;
+
+        while (true)
+        {
+            size = MIN(size, sizeof(bench_payload));
+
+            err = mqtt_bench_run(qos, size, &result);
+            if (err)
+            {
+                LOG_ERR("Benchmark run failed: %d", err);
+                printk("BENCH FAILED\n");
+                return;
+            }
+
+            bench_print(&result);
+
+            if (size == sizeof(bench_payload))
+            {
+                break;
+            }
+
+            size *= 4;
+        }
+    }
+
+    printk("BENCH DONE\n");
+}
+
+K_THREAD_DEFINE(mqtt_bench_tid, CONFIG_MQTT_BENCH_THREAD_STACK_SIZE, mqtt_bench_thread,
+                NULL, NULL, NULL, CONFIG_MQTT_BENCH_THREAD_PRIORITY, 0, 0);
\ No newline at end of file
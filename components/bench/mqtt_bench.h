@@ -0,0 +1,47 @@
+/*
+Name        : mqtt_bench.h
+
+Description : Publish throughput and latency benchmark for the MQTT component. Runs
+              against a live broker (the native_sim host build with a local broker in
+              CI) and prints one machine readable BENCH line per run.
+
+Developer   : Engr. Akbar Shah
+
+Date        : May 13, 2025
+*/
+
+#ifndef _MQTT_BENCH_H
+#define _MQTT_BENCH_H
+
+#include <stdint.h>
+
+struct mqtt_bench_result
+{
+    uint8_t qos;
+    uint32_t payload_len;
+    uint32_t messages;
+    uint32_t errors;
+    uint32_t msgs_per_s;
+    uint32_t p50_us;
+    uint32_t p99_us;
+};
+
+/*
+Function    : mqtt_bench_run
+
+Description : Publishes CONFIG_MQTT_BENCH_MESSAGES messages of payload_len bytes at the
+              given QoS with up to CONFIG_MQTT_BENCH_WINDOW messages in flight and
+              measures publish-to-PUBACK (QoS 1) or publish-to-PUBCOMP (QoS 2)
+              latency. For QoS 0 the latency is the time spent in mqtt_publish().
+
+Parameter   : uint8_t qos - MQTT QoS level 0..2.
+              uint32_t payload_len - Payload size in bytes.
+              struct mqtt_bench_result *result - Destination.
+
+Return      : int - 0 on success, -ENOTCONN if the client is not connected.
+
+Example Call: mqtt_bench_run(1, 256, &result);
+*/
+int mqtt_bench_run(uint8_t qos, uint32_t payload_len, struct mqtt_bench_result *result);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,240 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : BOOT.c
+*/
+
+#include <stdio.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "boot.h"
+#include "certs.h"
+#include "lte.h"
+
+LOG_MODULE_REGISTER(BOOT);
+
+static const char *const boot_stage_names[BOOT_STAGE_COUNT] = {
+	[BOOT_STAGE_MODEM_INIT] = "modem_init",
+	[BOOT_STAGE_CERTS] = "certs",
+	[BOOT_STAGE_LTE_START] = "lte_start",
+	[BOOT_STAGE_MQTT_PREPARE] = "mqtt_prepare",
+	[BOOT_STAGE_LTE_ATTACH] = "lte_attach",
+	[BOOT_STAGE_MQTT_CONNECT] = "mqtt_connect",
+};
+
+static struct boot_stage_record boot_profile[BOOT_STAGE_COUNT];
+
+/*
+Function : boot_stage_begin
+
+Description : Marks the start of a boot stage. Stages may run on different threads
+			  and overlap, every stage keeps its own start timestamp. Only the first
+			  call per stage is recorded.
+
+Parameter :
+- stage : Boot stage being started.
+
+Return : void
+
+Example Call :
+				boot_stage_begin(BOOT_STAGE_LTE_ATTACH);
+*/
+void boot_stage_begin(enum boot_stage stage)
+{
+	if (stage >= BOOT_STAGE_COUNT || boot_profile[stage].started)
+	{
+		return;
+	}
+
+	boot_profile[stage].start_ms = k_uptime_get();
+	boot_profile[stage].started = true;
+}
+
+/*
+Function : boot_stage_end
+
+Description : Marks the end of a boot stage and records its duration and result.
+			  When the last stage (MQTT connect) completes the profile is logged.
+
+Parameter :
+- stage : Boot stage being finished.
+- err : Result of the stage, 0 on success.
+
+Return : void
+
+Example Call :
+				boot_stage_end(BOOT_STAGE_LTE_ATTACH, err);
+*/
+void boot_stage_end(enum boot_stage stage, int err)
+{
+	if (stage >= BOOT_STAGE_COUNT || !boot_profile[stage].started ||
+		boot_profile[stage].done)
+	{
+		return;
+	}
+
+	boot_profile[stage].duration_ms = k_uptime_get() - boot_profile[stage].start_ms;
+	boot_profile[stage].err = err;
+	boot_profile[stage].done = true;
+
+	if (stage == BOOT_STAGE_MQTT_CONNECT && IS_ENABLED(CONFIG_BOOT_PROFILE))
+	{
+		boot_profile_log();
+	}
+}
+
+/*
+Function : boot_profile_get
+
+Description : Returns the recorded timing of a boot stage.
+
+Parameter :
+- stage : Boot stage to query.
+
+Return :
+Pointer to the stage record, or NULL for an invalid stage.
+
+Example Call :
+				boot_profile_get(BOOT_STAGE_CERTS)->duration_ms;
+*/
+const struct boot_stage_record *boot_profile_get(enum boot_stage stage)
+{
+	if (stage >= BOOT_STAGE_COUNT)
+	{
+		return NULL;
+	}
+
+	return &boot_profile[stage];
+}
+
+/*
+Function : boot_profile_log
+
+Description : Logs start offset and duration of every boot stage, followed by the
+			  time from reset until the MQTT client was connected.
+
+Parameter : void
+
+Return : void
+
+Example Call :
+				boot_profile_log();
+*/
+void boot_profile_log(void)
+{
+	for (int i = 0; i < BOOT_STAGE_COUNT; i++)
+	{
+		const struct boot_stage_record *r = &boot_profile[i];
+
+		if (!r->started)
+		{
+			LOG_INF("boot %-13s : not run", boot_stage_names[i]);
+			continue;
+		}
+
+		if (!r->done)
+		{
+			LOG_INF("boot %-13s : @%6lld ms  running", boot_stage_names[i],
+					r->start_ms);
+			continue;
+		}
+
+		LOG_INF("boot %-13s : @%6lld ms  %6lld ms  err %d", boot_stage_names[i],
+				r->start_ms, r->duration_ms, r->err);
+	}
+
+	if (boot_profile[BOOT_STAGE_MQTT_CONNECT].done)
+	{
+		LOG_INF("boot time to MQTT connected: %lld ms",
+				boot_profile[BOOT_STAGE_MQTT_CONNECT].start_ms +
+					boot_profile[BOOT_STAGE_MQTT_CONNECT].duration_ms);
+	}
+}
+
+/*
+Function : boot_run
+
+Description : Runs the sequential part of the boot pipeline: modem initialization,
+			  credential provisioning (while the modem is still offline) and the start
+			  of the LTE attach. It returns as soon
+			  as the attach is started so the caller can prepare MQTT while the modem
+			  searches for a network.
+
+Parameter : void
+
+Return :
+0 on success, or the first negative error code of a failing stage.
+
+Example Call :
+				boot_run();
+*/
+int boot_run(void)
+{
+	int err;
+	int ret = 0;
+
+	boot_stage_begin(BOOT_STAGE_MODEM_INIT);
+	err = modem_init();
+	boot_stage_end(BOOT_STAGE_MODEM_INIT, err);
+	if (err != 0)
+	{
+		LOG_ERR("Failed to init modem err [%d]", err);
+		ret = err;
+	}
+
+	boot_stage_begin(BOOT_STAGE_CERTS);
+	err = write_device_certs_to_modem();
+	boot_stage_end(BOOT_STAGE_CERTS, err);
+	if (err != 0)
+	{
+		LOG_ERR("Failed to write certs to modem err [%d]", err);
+		ret = ret ? ret : err;
+	}
+
+	boot_stage_begin(BOOT_STAGE_LTE_START);
+	err = lte_connect_start();
+	boot_stage_end(BOOT_STAGE_LTE_START, err);
+	if (err != 0)
+	{
+		LOG_ERR("Failed to start LTE err [%d]", err);
+		return err;
+	}
+
+	/* Attach time is measured from here, it completes in boot_wait_network()
+	 * while the rest of the application keeps initializing.
+	 */
+	boot_stage_begin(BOOT_STAGE_LTE_ATTACH);
+
+	return ret;
+}
+
+/*
+Function : boot_wait_network
+
+Description : Waits up to CONFIG_LTE_ATTACH_TIMEOUT_S for the LTE attach started by
+			  boot_run() and records the attach stage.
+
+Parameter : void
+
+Return :
+0 when registered, -ETIMEDOUT otherwise.
+
+Example Call :
+				boot_wait_network();
+*/
+int boot_wait_network(void)
+{
+	int err;
+
+	err = lte_wait_connected(K_SECONDS(CONFIG_LTE_ATTACH_TIMEOUT_S));
+	boot_stage_end(BOOT_STAGE_LTE_ATTACH, err);
+	if (err)
+	{
+		LOG_WRN("LTE not registered within %d s, MQTT keeps waiting",
+				CONFIG_LTE_ATTACH_TIMEOUT_S);
+	}
+
+	return err;
+}
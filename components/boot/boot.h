@@ -0,0 +1,44 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : BOOT.h
+*/
+
+#ifndef _BOOT_H_
+#define _BOOT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+enum boot_stage
+{
+	BOOT_STAGE_MODEM_INIT,
+	BOOT_STAGE_CERTS,
+	BOOT_STAGE_LTE_START,
+	BOOT_STAGE_MQTT_PREPARE,
+	BOOT_STAGE_LTE_ATTACH,
+	BOOT_STAGE_MQTT_CONNECT,
+	BOOT_STAGE_COUNT
+};
+
+struct boot_stage_record
+{
+	int64_t start_ms;
+	int64_t duration_ms;
+	int err;
+	bool started;
+	bool done;
+};
+
+int boot_run(void);
+int boot_wait_network(void);
+
+void boot_stage_begin(enum boot_stage stage);
+void boot_stage_end(enum boot_stage stage, int err);
+
+const struct boot_stage_record *boot_profile_get(enum boot_stage stage);
+void boot_profile_log(void);
+
+#endif
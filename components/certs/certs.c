@@ -1,14 +1,34 @@
 #include "certs.h"
+#include "cred_bundle.h"
 #include <stdio.h>
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
-#include <modem/nrf_modem_lib.h>
 #include <modem/modem_key_mgmt.h>
+#include <modem/lte_lc.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/base64.h>
+#include <stdlib.h>
+#include <string.h>
+#include "at_cmd.h"
+
+#if defined(CONFIG_PARTITION_MANAGER_ENABLED)
+#include <pm_config.h>
+#define CRED_BUNDLE_AREA_ID PM_CRED_BUNDLE_ID
+#elif FIXED_PARTITION_EXISTS(cred_bundle_partition)
+#define CRED_BUNDLE_AREA_ID FIXED_PARTITION_ID(cred_bundle_partition)
+#else
+#define CRED_BUNDLE_AREA_ID -1 /* e.g. host build */
+#endif
 
 LOG_MODULE_REGISTER(CERTS);
 
-#define MQTT_SEC_TAG 30
+#define CERTS_MAX_DIGESTS 8
+#define CERTS_READY_POLL_MS 50
+
+/* 48 DER bytes encode to one 64 character PEM line. */
+#define PEM_LINE_RAW 48
 
 const char *modem_key_mgmt_cred_type_str(enum modem_key_mgmt_cred_type key)
 {
@@ -25,69 +45,419 @@ const char *modem_key_mgmt_cred_type_str(enum modem_key_mgmt_cred_type key)
     }
 }
 
-static int write_certificates_to_modem(uint32_t TAG, enum modem_key_mgmt_cred_type key, const void *buf, size_t len)
+struct cred_digest
+{
+    uint32_t tag;
+    enum modem_key_mgmt_cred_type type;
+    uint8_t digest[CRED_BUNDLE_DIGEST_LEN];
+    bool valid;
+};
+
+/* Digests of the bundle entries last written to (or verified in) the modem. */
+static struct cred_digest cred_digests[CERTS_MAX_DIGESTS];
+
+static struct certs_provision_report provision_report;
+
+static const char *const pem_labels[] = {
+    [CRED_PEM_CERTIFICATE] = "CERTIFICATE",
+    [CRED_PEM_RSA_PRIVATE_KEY] = "RSA PRIVATE KEY",
+    [CRED_PEM_PRIVATE_KEY] = "PRIVATE KEY",
+    [CRED_PEM_EC_PRIVATE_KEY] = "EC PRIVATE KEY",
+};
+
+static struct cred_digest *cred_digest_find(uint32_t tag, enum modem_key_mgmt_cred_type key,
+                                            bool create)
+{
+    struct cred_digest *free_slot = NULL;
+
+    for (int i = 0; i < ARRAY_SIZE(cred_digests); i++)
+    {
+        if (cred_digests[i].valid && cred_digests[i].tag == tag && cred_digests[i].type == key)
+        {
+            return &cred_digests[i];
+        }
+        if (!cred_digests[i].valid && !free_slot)
+        {
+            free_slot = &cred_digests[i];
+        }
+    }
+
+    if (create && free_slot)
+    {
+        free_slot->tag = tag;
+        free_slot->type = key;
+        free_slot->valid = true;
+        return free_slot;
+    }
+    return NULL;
+}
+
+static int certs_settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    unsigned int tag;
+    unsigned int type;
+    struct cred_digest *d;
+    uint8_t digest[CRED_BUNDLE_DIGEST_LEN];
+
+    if (sscanf(name, "%u/%u", &tag, &type) != 2 || len != sizeof(digest))
+    {
+        /* Unknown key or a digest format from an older firmware: verify again. */
+        return 0;
+    }
+
+    if (read_cb(cb_arg, digest, sizeof(digest)) != sizeof(digest))
+    {
+        return -EIO;
+    }
+
+    d = cred_digest_find(tag, type, true);
+    if (d)
+    {
+        memcpy(d->digest, digest, sizeof(digest));
+    }
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(certs, "certs", NULL, certs_settings_set, NULL, NULL);
+
+static void cred_digest_store(const struct cred_bundle_entry *e)
+{
+    char path[24];
+    struct cred_digest *d = cred_digest_find(e->sec_tag, e->type, true);
+
+    if (d)
+    {
+        memcpy(d->digest, e->digest, sizeof(d->digest));
+    }
+
+    snprintf(path, sizeof(path), "certs/%u/%u", e->sec_tag, (unsigned int)e->type);
+    if (settings_save_one(path, e->digest, sizeof(e->digest)))
+    {
+        LOG_WRN("Failed to store digest of [ %s ]", modem_key_mgmt_cred_type_str(e->type));
+    }
+}
+
+/*
+ * Reads one bundle entry from flash and converts it to the PEM text expected by
+ * the modem. The buffer is allocated from the heap and must be freed by the caller.
+ */
+static int bundle_entry_to_pem(const struct flash_area *fa, const struct cred_bundle_entry *e,
+                               char **pem, size_t *pem_len)
+{
+    const char *label = pem_labels[e->pem_label];
+    uint8_t raw[PEM_LINE_RAW];
+    size_t lines = DIV_ROUND_UP(e->length, PEM_LINE_RAW);
+    size_t size;
+    size_t pos;
+    size_t olen;
+    int err;
+
+    size = 2 * (sizeof("-----BEGIN -----\n") + strlen(label)) +
+           4 * DIV_ROUND_UP(e->length, 3) + lines + 1;
+
+    *pem = k_malloc(size);
+    if (!*pem)
+    {
+        return -ENOMEM;
+    }
+
+    pos = snprintf(*pem, size, "-----BEGIN %s-----\n", label);
+
+    for (size_t off = 0; off < e->length; off += PEM_LINE_RAW)
+    {
+        size_t chunk = MIN(PEM_LINE_RAW, e->length - off);
+
+        err = flash_area_read(fa, e->offset + off, raw, chunk);
+        if (!err)
+        {
+            err = base64_encode((uint8_t *)*pem + pos, size - pos, &olen, raw, chunk);
+        }
+        if (err)
+        {
+            k_free(*pem);
+            *pem = NULL;
+            return err;
+        }
+        pos += olen;
+        (*pem)[pos++] = '\n';
+    }
+
+    pos += snprintf(*pem + pos, size - pos, "-----END %s-----\n", label);
+    *pem_len = pos;
+    return 0;
+}
+
+/*
+ * Returns 0 if the credential stored in the modem already matches the bundle
+ * entry, 1 if it is missing or different, negative on error. The entry body is
+ * only read from flash (into *pem) when the digests cannot decide.
+ */
+static int certificate_needs_update(const struct flash_area *fa, const struct cred_bundle_entry *e,
+                                    char **pem, size_t *pem_len)
 {
     int err;
     bool exists;
+    struct cred_digest *d;
 
-    err = modem_key_mgmt_exists(TAG, key, &exists);
+    err = modem_key_mgmt_exists(e->sec_tag, e->type, &exists);
     if (err)
     {
-        LOG_ERR("Failed to check for certificates [ %s ] err %d\n", modem_key_mgmt_cred_type_str(key), err);
+        LOG_ERR("Failed to check for certificates [ %s ] err %d\n", modem_key_mgmt_cred_type_str(e->type), err);
         return err;
     }
 
-    if (exists)
+    if (!exists)
+    {
+        return 1;
+    }
+
+    d = cred_digest_find(e->sec_tag, e->type, false);
+    if (d)
+    {
+        return memcmp(d->digest, e->digest, sizeof(d->digest)) ? 1 : 0;
+    }
+
+    if (e->type == MODEM_KEY_MGMT_CRED_TYPE_PRIVATE_CERT)
+    {
+        /* Private keys cannot be read back and no digest is known. */
+        return 1;
+    }
+
+    err = bundle_entry_to_pem(fa, e, pem, pem_len);
+    if (err)
+    {
+        return err;
+    }
+
+    err = modem_key_mgmt_cmp(e->sec_tag, e->type, *pem, *pem_len);
+    if (err == 0)
+    {
+        /* Same content, remember it so the next boot skips the comparison. */
+        cred_digest_store(e);
+        return 0;
+    }
+    if (err < 0)
+    {
+        LOG_WRN("Failed to compare [ %s ] err %d, rewriting", modem_key_mgmt_cred_type_str(e->type), err);
+    }
+    return 1;
+}
+
+static int write_certificates_to_modem(const struct flash_area *fa, const struct cred_bundle_entry *e)
+{
+    int err;
+    char *pem = NULL;
+    size_t pem_len = 0;
+
+    err = certificate_needs_update(fa, e, &pem, &pem_len);
+    if (err < 0)
+    {
+        provision_report.errors++;
+        goto out;
+    }
+
+    if (err == 0)
+    {
+        LOG_INF("CERT [%s] tag %u up to date\n\r", modem_key_mgmt_cred_type_str(e->type), e->sec_tag);
+        provision_report.skipped++;
+        goto out;
+    }
+
+    if (!pem)
     {
-        /* For the sake of simplicity we delete what is provisioned
-         * with our security tag and reprovision our certificate.
-         */
-        err = modem_key_mgmt_delete(TAG, key);
+        err = bundle_entry_to_pem(fa, e, &pem, &pem_len);
         if (err)
         {
-            LOG_ERR("Failed to delete existing certificate [ %s ], err [%d]\n",
-                    modem_key_mgmt_cred_type_str(key), err);
+            LOG_ERR("Failed to read [ %s ] from bundle, err %d", modem_key_mgmt_cred_type_str(e->type), err);
+            provision_report.errors++;
+            goto out;
         }
     }
 
-    err = modem_key_mgmt_write(TAG, key, buf, len);
+    /* modem_key_mgmt_write() overwrites an existing credential, no delete needed. */
+    err = modem_key_mgmt_write(e->sec_tag, e->type, pem, pem_len);
     if (err)
     {
-        LOG_ERR("Failed to write certificate [ %s ]to modem\n", modem_key_mgmt_cred_type_str(key));
-        return err;
+        LOG_ERR("Failed to write certificate [ %s ]to modem\n", modem_key_mgmt_cred_type_str(e->type));
+        provision_report.errors++;
+        goto out;
     }
-    LOG_INF("Updated CERT [%s]\n\r", modem_key_mgmt_cred_type_str(key));
+    LOG_INF("Updated CERT [%s] tag %u\n\r", modem_key_mgmt_cred_type_str(e->type), e->sec_tag);
+    provision_report.written++;
+    cred_digest_store(e);
 
+out:
+    k_free(pem);
     return err;
 }
 
-int write_device_certs_to_modem(void)
+/*
+ * Credentials can only be written while the modem is offline (CFUN=0 or 4).
+ * Poll the functional mode instead of sleeping for a fixed time.
+ */
+static int wait_modem_offline(void)
 {
+    char mode[8];
+    int64_t deadline = k_uptime_get() + CONFIG_CERTS_READY_TIMEOUT_MS;
     int err;
-    err = nrf_modem_lib_init();
+
+    do
+    {
+        err = at_cmd_exec(AT_CMD_FUNC_MODE, mode, sizeof(mode), K_MSEC(CONFIG_AT_CMD_TIMEOUT_MS));
+        if (!err && (atoi(mode) == 0 || atoi(mode) == 4))
+        {
+            return 0;
+        }
+        k_msleep(CERTS_READY_POLL_MS);
+    } while (k_uptime_get() < deadline);
+
+    LOG_ERR("Modem not offline after %d ms", CONFIG_CERTS_READY_TIMEOUT_MS);
+    return -ETIMEDOUT;
+}
+
+struct bundle_ctx
+{
+    const struct flash_area *fa;
+    const struct cred_bundle_header *hdr;
+};
+
+static int write_bundle_entries(void *ctx)
+{
+    const struct bundle_ctx *bundle = ctx;
+    struct cred_bundle_entry entry;
+    int err;
+
+    for (uint16_t i = 0; i < bundle->hdr->count; i++)
+    {
+        err = flash_area_read(bundle->fa, sizeof(*bundle->hdr) + i * sizeof(entry), &entry,
+                              sizeof(entry));
+        if (err || entry.pem_label >= ARRAY_SIZE(pem_labels) ||
+            entry.offset + entry.length > bundle->hdr->total_len)
+        {
+            LOG_ERR("Invalid credential bundle entry %u", i);
+            provision_report.errors++;
+            continue;
+        }
+
+        write_certificates_to_modem(bundle->fa, &entry);
+    }
+
+    return 0;
+}
+
+/*
+ * Shared by boot provisioning and credential rotation: the modem rejects key
+ * writes while it is active, so an active modem is taken offline (CFUN=4)
+ * around the writes and set back to normal mode (CFUN=1) afterwards, which
+ * re-attaches LTE. At boot the modem is still offline and is left that way.
+ */
+int certs_modem_offline_run(certs_write_fn_t write, void *ctx)
+{
+    enum lte_lc_func_mode mode;
+    bool restore = false;
+    int err;
+
+    err = lte_lc_func_mode_get(&mode);
     if (err)
     {
-        // LOG_ERR("Modem info initialization failed, error: %d", err);
+        LOG_ERR("Failed to read the modem functional mode, err %d", err);
         return err;
     }
 
-    write_certificates_to_modem(MQTT_SEC_TAG, MODEM_KEY_MGMT_CRED_TYPE_CA_CHAIN, (const void *)root_ca, sizeof(root_ca));
+    if (mode != LTE_LC_FUNC_MODE_POWER_OFF && mode != LTE_LC_FUNC_MODE_OFFLINE)
+    {
+        LOG_INF("Taking the modem offline for credential writes");
+        err = lte_lc_offline();
+        if (err)
+        {
+            LOG_ERR("Failed to set the modem offline, err %d", err);
+            return err;
+        }
+        restore = true;
+    }
+
+    err = wait_modem_offline();
+    if (!err)
+    {
+        err = write(ctx);
+    }
+
+    if (restore)
+    {
+        int ret = lte_lc_normal();
+
+        if (ret)
+        {
+            LOG_ERR("Failed to set the modem back online, err %d", ret);
+            err = err ? err : ret;
+        }
+    }
+
+    return err;
+}
 
-    write_certificates_to_modem(MQTT_SEC_TAG, MODEM_KEY_MGMT_CRED_TYPE_PUBLIC_CERT, (const void *)device_cert, sizeof(device_cert));
+int write_device_certs_to_modem(void)
+{
+    int err;
+    int64_t start = k_uptime_get();
+    const struct flash_area *fa;
+    struct cred_bundle_header hdr;
+    struct bundle_ctx bundle;
 
-    write_certificates_to_modem(MQTT_SEC_TAG, MODEM_KEY_MGMT_CRED_TYPE_PRIVATE_CERT, (const void *)private_key, sizeof(private_key));
+    memset(&provision_report, 0, sizeof(provision_report));
 
-    k_msleep(2000);
+    if (CRED_BUNDLE_AREA_ID < 0)
+    {
+        LOG_INF("No credential bundle partition, skipping provisioning");
+        return 0;
+    }
 
-    err = nrf_modem_lib_shutdown();
+    err = flash_area_open(CRED_BUNDLE_AREA_ID, &fa);
     if (err)
     {
-        LOG_ERR("Modem library shutdown failed, error: %d", err);
+        LOG_ERR("Failed to open credential bundle partition, err %d", err);
+        return err;
     }
-    else
+
+    err = flash_area_read(fa, 0, &hdr, sizeof(hdr));
+    if (err || hdr.magic != CRED_BUNDLE_MAGIC || hdr.version != CRED_BUNDLE_VERSION ||
+        hdr.total_len > fa->fa_size)
     {
-        LOG_INF("Modem library successfully shut down");
+        LOG_ERR("No valid credential bundle in flash");
+        flash_area_close(fa);
+        return -ENOENT;
     }
-    k_msleep(4000);
-    return err;
+    provision_report.bundle_len = hdr.total_len;
+
+    err = settings_subsys_init();
+    if (!err)
+    {
+        err = settings_load_subtree("certs");
+    }
+    if (err)
+    {
+        LOG_WRN("Credential digests unavailable, err %d", err);
+    }
+
+    bundle.fa = fa;
+    bundle.hdr = &hdr;
+    err = certs_modem_offline_run(write_bundle_entries, &bundle);
+    flash_area_close(fa);
+    if (err)
+    {
+        return err;
+    }
+
+    provision_report.duration_ms = k_uptime_get() - start;
+    LOG_INF("Credentials: %u written, %u unchanged, %u errors in %u ms (bundle %u bytes)",
+            provision_report.written, provision_report.skipped,
+            provision_report.errors, provision_report.duration_ms,
+            provision_report.bundle_len);
+
+    return provision_report.errors ? -EIO : 0;
+}
+
+const struct certs_provision_report *certs_provision_report_get(void)
+{
+    return &provision_report;
 }
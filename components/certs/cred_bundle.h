@@ -0,0 +1,43 @@
+#ifndef _CRED_BUNDLE_H
+#define _CRED_BUNDLE_H
+
+#include <stdint.h>
+
+/*
+ * Layout of the credential bundle generated by update_certs.py and stored in the
+ * cred_bundle flash partition. All fields are little endian.
+ *
+ *   struct cred_bundle_header
+ *   struct cred_bundle_entry [count]
+ *   DER data of every entry, at entry.offset from the start of the bundle
+ */
+
+#define CRED_BUNDLE_MAGIC 0x42445243 /* "CRDB" */
+#define CRED_BUNDLE_VERSION 1
+#define CRED_BUNDLE_DIGEST_LEN 32 /* SHA-256 of the DER data */
+
+enum cred_bundle_pem_label {
+    CRED_PEM_CERTIFICATE = 0,
+    CRED_PEM_RSA_PRIVATE_KEY = 1,
+    CRED_PEM_PRIVATE_KEY = 2,
+    CRED_PEM_EC_PRIVATE_KEY = 3,
+};
+
+struct cred_bundle_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t total_len;
+} __packed;
+
+struct cred_bundle_entry {
+    uint32_t sec_tag;
+    uint8_t type;      /* enum modem_key_mgmt_cred_type */
+    uint8_t pem_label; /* enum cred_bundle_pem_label */
+    uint16_t reserved;
+    uint32_t offset;
+    uint32_t length;
+    uint8_t digest[CRED_BUNDLE_DIGEST_LEN];
+} __packed;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,525 @@
+#include "cred_rotate.h"
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/base64.h>
+#include <zephyr/sys/byteorder.h>
+#include <modem/modem_key_mgmt.h>
+#include <psa/crypto.h>
+#include <cJSON.h>
+#include "certs.h"
+#include "mqtt.h"
+
+LOG_MODULE_REGISTER(CRED_ROTATE);
+
+#define ROTATE_TOPIC_LEN 96
+#define ROTATE_ID_LEN 40
+#define ROTATE_RESULT_LEN 96
+
+/* Uncompressed P-256 point and raw r || s signature */
+#define ROTATE_PUBKEY_LEN 65
+#define ROTATE_SIG_LEN 64
+
+struct stage_ctx
+{
+    int from; /* Active tag, source of the CA when the request has none */
+    int to;
+};
+
+/* Covered by the signature, in this order after the device ID */
+static const char *const signed_fields[] = {"id", "ca", "cert", "key"};
+
+enum rotate_state
+{
+    ROTATE_IDLE,    /* Using active_tag */
+    ROTATE_STAGING, /* Writing new credentials to the alternate tag */
+    ROTATE_STAGED,  /* Written, waiting for the reconnect */
+    ROTATE_TRIAL,   /* Connecting with the alternate tag */
+};
+
+/* The MQTT thread and the system work queue both move the rotation along:
+ * rotate_lock guards everything below. It is not held over the signature check
+ * or the key writes, staged_doc belongs to stage_work while ROTATE_STAGING.
+ */
+static K_MUTEX_DEFINE(rotate_lock);
+
+static enum rotate_state state;
+static int active_tag = CONFIG_MQTT_TLS_SEC_TAG;
+static int trial_tag;
+
+static char rotate_topic[ROTATE_TOPIC_LEN];
+static char result_topic[ROTATE_TOPIC_LEN + 8];
+static char rotation_id[ROTATE_ID_LEN];
+static char result_msg[ROTATE_RESULT_LEN];
+static bool result_pending;
+
+static cJSON *staged_doc;
+
+static uint8_t rotate_pubkey[ROTATE_PUBKEY_LEN];
+
+static int alternate_tag(void)
+{
+    return (active_tag == CONFIG_MQTT_TLS_SEC_TAG) ? CONFIG_CERTS_ROTATE_ALT_SEC_TAG
+                                                   : CONFIG_MQTT_TLS_SEC_TAG;
+}
+
+static int rotate_settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    int tag;
+
+    if (strcmp(name, "active") || len != sizeof(tag))
+    {
+        return 0;
+    }
+
+    if (read_cb(cb_arg, &tag, sizeof(tag)) != sizeof(tag))
+    {
+        return -EIO;
+    }
+
+    if (tag == CONFIG_MQTT_TLS_SEC_TAG || tag == CONFIG_CERTS_ROTATE_ALT_SEC_TAG)
+    {
+        active_tag = tag;
+    }
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(cred_rot, "cred_rot", NULL, rotate_settings_set, NULL, NULL);
+
+static void result_work_fn(struct k_work *work)
+{
+    int err;
+
+    k_mutex_lock(&rotate_lock, K_FOREVER);
+
+    if (!result_pending)
+    {
+        k_mutex_unlock(&rotate_lock);
+        return;
+    }
+
+    err = mqtt_outbox_publish(MQTT_PRIO_CRITICAL, result_topic, MQTT_QOS_1_AT_LEAST_ONCE,
+                              (const uint8_t *)result_msg, strlen(result_msg));
+    if (err)
+    {
+        /* Retried after the next successful connect. */
+        LOG_WRN("Failed to publish rotation result, err %d", err);
+    }
+    else
+    {
+        result_pending = false;
+    }
+
+    k_mutex_unlock(&rotate_lock);
+}
+
+static K_WORK_DEFINE(result_work, result_work_fn);
+
+/* Called with rotate_lock held. */
+static void rotate_report(const char *status, int err)
+{
+    snprintf(result_msg, sizeof(result_msg),
+             "{\"id\":\"%s\",\"status\":\"%s\",\"sec_tag\":%d,\"err\":%d}",
+             rotation_id, status, active_tag, err);
+    result_pending = true;
+    LOG_INF("Credential rotation %s: %s (err %d)", rotation_id, status, err);
+    k_work_submit(&result_work);
+}
+
+static int write_cred(int tag, enum modem_key_mgmt_cred_type type, const char *pem)
+{
+    int err = modem_key_mgmt_write(tag, type, pem, strlen(pem));
+
+    if (err)
+    {
+        LOG_ERR("Failed to write credential type %d to tag %d, err %d", type, tag, err);
+    }
+    return err;
+}
+
+/* The CA is optional in a rotation request: copy it from the active tag. */
+static int copy_ca(int from, int to)
+{
+    size_t len = CONFIG_CERTS_ROTATE_MAX_CRED_LEN;
+    char *buf = k_malloc(len);
+    int err;
+
+    if (!buf)
+    {
+        return -ENOMEM;
+    }
+
+    err = modem_key_mgmt_read(from, MODEM_KEY_MGMT_CRED_TYPE_CA_CHAIN, buf, &len);
+    if (!err)
+    {
+        err = modem_key_mgmt_write(to, MODEM_KEY_MGMT_CRED_TYPE_CA_CHAIN, buf, len);
+    }
+
+    k_free(buf);
+    return err;
+}
+
+/* Length-prefixed field of the signed digest, absent fields count as empty. */
+static psa_status_t hash_field(psa_hash_operation_t *op, const char *value)
+{
+    size_t len = value ? strlen(value) : 0;
+    uint8_t prefix[4];
+    psa_status_t status;
+
+    sys_put_be32(len, prefix);
+
+    status = psa_hash_update(op, prefix, sizeof(prefix));
+    if (status == PSA_SUCCESS && len)
+    {
+        status = psa_hash_update(op, (const uint8_t *)value, len);
+    }
+    return status;
+}
+
+static const char *string_or_null(const cJSON *doc, const char *name)
+{
+    const cJSON *item = cJSON_GetObjectItem(doc, name);
+
+    return cJSON_IsString(item) ? item->valuestring : NULL;
+}
+
+/*
+Function : verify_request
+
+Description : Checks the ECDSA P-256 signature of a rotation request against
+              CONFIG_CERTS_ROTATE_PUBKEY. The signed digest is SHA-256 over the
+              device ID and the id, ca, cert and key fields, each preceded by its
+              length as a big-endian uint32, so a request cannot be replayed to
+              another device or have a field swapped. rotate_request.py builds it.
+
+Parameter :
+- doc : Parsed request holding "sig", the base64 raw r || s signature.
+
+Return :
+0 if the signature is valid, -EBADMSG if missing or malformed, -EACCES if it
+does not verify, or -EIO on a crypto error.
+
+Example Call :
+                err = verify_request(staged_doc);
+*/
+static int verify_request(const cJSON *doc)
+{
+    const char *sig_b64 = string_or_null(doc, "sig");
+    psa_key_attributes_t attr = PSA_KEY_ATTRIBUTES_INIT;
+    psa_hash_operation_t op = PSA_HASH_OPERATION_INIT;
+    psa_key_id_t key_id;
+    psa_status_t status;
+    uint8_t sig[ROTATE_SIG_LEN];
+    uint8_t hash[PSA_HASH_LENGTH(PSA_ALG_SHA_256)];
+    size_t hash_len;
+    size_t sig_len;
+
+    if (!sig_b64 ||
+        base64_decode(sig, sizeof(sig), &sig_len, (const uint8_t *)sig_b64, strlen(sig_b64)) ||
+        sig_len != sizeof(sig))
+    {
+        return -EBADMSG;
+    }
+
+    status = psa_hash_setup(&op, PSA_ALG_SHA_256);
+    if (status == PSA_SUCCESS)
+    {
+        status = hash_field(&op, DEVICE_ID);
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(signed_fields) && status == PSA_SUCCESS; i++)
+    {
+        status = hash_field(&op, string_or_null(doc, signed_fields[i]));
+    }
+    if (status == PSA_SUCCESS)
+    {
+        status = psa_hash_finish(&op, hash, sizeof(hash), &hash_len);
+    }
+    if (status != PSA_SUCCESS)
+    {
+        psa_hash_abort(&op);
+        LOG_ERR("Rotation request digest failed, status %d", status);
+        return -EIO;
+    }
+
+    psa_set_key_usage_flags(&attr, PSA_KEY_USAGE_VERIFY_HASH);
+    psa_set_key_algorithm(&attr, PSA_ALG_ECDSA(PSA_ALG_SHA_256));
+    psa_set_key_type(&attr, PSA_KEY_TYPE_ECC_PUBLIC_KEY(PSA_ECC_FAMILY_SECP_R1));
+    psa_set_key_bits(&attr, 256);
+
+    status = psa_import_key(&attr, rotate_pubkey, sizeof(rotate_pubkey), &key_id);
+    if (status != PSA_SUCCESS)
+    {
+        LOG_ERR("Rotation public key import failed, status %d", status);
+        return -EIO;
+    }
+
+    status = psa_verify_hash(key_id, PSA_ALG_ECDSA(PSA_ALG_SHA_256), hash, hash_len,
+                             sig, sizeof(sig));
+    psa_destroy_key(key_id);
+
+    return (status == PSA_SUCCESS) ? 0 : -EACCES;
+}
+
+static int stage_creds(void *arg)
+{
+    const struct stage_ctx *ctx = arg;
+    const cJSON *ca = cJSON_GetObjectItem(staged_doc, "ca");
+    const cJSON *cert = cJSON_GetObjectItem(staged_doc, "cert");
+    const cJSON *key = cJSON_GetObjectItem(staged_doc, "key");
+    int err;
+
+    if (cJSON_IsString(ca))
+    {
+        err = write_cred(ctx->to, MODEM_KEY_MGMT_CRED_TYPE_CA_CHAIN, ca->valuestring);
+    }
+    else
+    {
+        err = copy_ca(ctx->from, ctx->to);
+    }
+
+    if (!err)
+    {
+        err = write_cred(ctx->to, MODEM_KEY_MGMT_CRED_TYPE_PUBLIC_CERT, cert->valuestring);
+    }
+    if (!err)
+    {
+        err = write_cred(ctx->to, MODEM_KEY_MGMT_CRED_TYPE_PRIVATE_CERT, key->valuestring);
+    }
+
+    return err;
+}
+
+static void stage_work_fn(struct k_work *work)
+{
+    struct stage_ctx ctx;
+    int err;
+
+    /* Checked before the modem goes offline, a forged request costs no re-attach. */
+    err = verify_request(staged_doc);
+    if (err)
+    {
+        LOG_ERR("Rotation request not authenticated, err %d", err);
+        cJSON_Delete(staged_doc);
+
+        k_mutex_lock(&rotate_lock, K_FOREVER);
+        staged_doc = NULL;
+        state = ROTATE_IDLE;
+        rotate_report("unauthenticated", err);
+        k_mutex_unlock(&rotate_lock);
+        return;
+    }
+
+    k_mutex_lock(&rotate_lock, K_FOREVER);
+    ctx.from = active_tag;
+    ctx.to = alternate_tag();
+    k_mutex_unlock(&rotate_lock);
+
+    /* The modem only accepts key writes offline: the link drops for the
+     * writes and the reconnect afterwards already uses the new tag.
+     */
+    err = certs_modem_offline_run(stage_creds, &ctx);
+
+    k_mutex_lock(&rotate_lock, K_FOREVER);
+
+    cJSON_Delete(staged_doc);
+    staged_doc = NULL;
+
+    if (err)
+    {
+        state = ROTATE_IDLE;
+        rotate_report("stage_failed", err);
+    }
+    else
+    {
+        LOG_INF("New credentials staged in tag %d, reconnecting", ctx.to);
+        state = ROTATE_STAGED;
+    }
+
+    k_mutex_unlock(&rotate_lock);
+    mqtt_request_reconnect();
+}
+
+static K_WORK_DEFINE(stage_work, stage_work_fn);
+
+static void on_rotate_message(const char *topic, const uint8_t *data, size_t len)
+{
+    const cJSON *id;
+    const cJSON *cert;
+    const cJSON *key;
+    cJSON *doc;
+
+    doc = cJSON_ParseWithLength((const char *)data, len);
+    if (!doc)
+    {
+        LOG_ERR("Malformed rotation request");
+        return;
+    }
+
+    id = cJSON_GetObjectItem(doc, "id");
+    cert = cJSON_GetObjectItem(doc, "cert");
+    key = cJSON_GetObjectItem(doc, "key");
+
+    k_mutex_lock(&rotate_lock, K_FOREVER);
+
+    if (state != ROTATE_IDLE)
+    {
+        k_mutex_unlock(&rotate_lock);
+        cJSON_Delete(doc);
+        LOG_WRN("Credential rotation already in progress, ignoring request");
+        return;
+    }
+
+    snprintf(rotation_id, sizeof(rotation_id), "%s",
+             cJSON_IsString(id) ? id->valuestring : "");
+
+    if (!cJSON_IsString(cert) || !cJSON_IsString(key))
+    {
+        cJSON_Delete(doc);
+        rotate_report("invalid", -EINVAL);
+        k_mutex_unlock(&rotate_lock);
+        return;
+    }
+
+    /* The signature check and the key writes take a while, do them off the MQTT thread. */
+    staged_doc = doc;
+    state = ROTATE_STAGING;
+    k_mutex_unlock(&rotate_lock);
+
+    k_work_submit(&stage_work);
+}
+
+int cred_rotate_sec_tag_for_connect(void)
+{
+    int tag;
+
+    k_mutex_lock(&rotate_lock, K_FOREVER);
+
+    if (state == ROTATE_STAGED)
+    {
+        state = ROTATE_TRIAL;
+        trial_tag = alternate_tag();
+    }
+
+    tag = (state == ROTATE_TRIAL) ? trial_tag : active_tag;
+
+    k_mutex_unlock(&rotate_lock);
+
+    return tag;
+}
+
+/*
+ * Failures the credentials can cause: the TLS handshake refused or the
+ * connection closed before CONNACK (negative errno), or a CONNACK refusing
+ * the identity. Other failures, e.g. no network, say nothing about them.
+ */
+static bool is_auth_failure(int result)
+{
+    switch (result)
+    {
+    case -ECONNREFUSED:
+    case -ECONNRESET:
+    case -ECONNABORTED:
+    case -EACCES:
+    case -EPERM:
+#if defined(EKEYEXPIRED)
+    case -EKEYEXPIRED:
+#endif
+    case MQTT_IDENTIFIER_REJECTED:
+    case MQTT_BAD_USER_NAME_OR_PASSWORD:
+    case MQTT_NOT_AUTHORIZED:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void cred_rotate_on_connect_result(int result)
+{
+    bool report_pending;
+    int err;
+
+    k_mutex_lock(&rotate_lock, K_FOREVER);
+
+    if (state != ROTATE_TRIAL)
+    {
+        report_pending = (result == 0 && result_pending);
+        k_mutex_unlock(&rotate_lock);
+
+        if (report_pending)
+        {
+            k_work_submit(&result_work);
+        }
+        return;
+    }
+
+    if (result != 0 && !is_auth_failure(result))
+    {
+        /* Keep the trial tag, the next connect tells whether the credentials work. */
+        LOG_WRN("Connect with tag %d failed (%d), not a TLS or auth failure, retrying it",
+                trial_tag, result);
+        k_mutex_unlock(&rotate_lock);
+        return;
+    }
+
+    state = ROTATE_IDLE;
+
+    if (result != 0)
+    {
+        /* Handshake or CONNACK rejected the new credentials: roll back. */
+        LOG_ERR("Connect with tag %d rejected (%d), rolling back to tag %d",
+                trial_tag, result, active_tag);
+        rotate_report("rolled_back", result);
+        k_mutex_unlock(&rotate_lock);
+        mqtt_request_reconnect();
+        return;
+    }
+
+    active_tag = trial_tag;
+    err = settings_save_one("cred_rot/active", &active_tag, sizeof(active_tag));
+    if (err)
+    {
+        LOG_WRN("Failed to persist active sec tag, err %d", err);
+    }
+    rotate_report("committed", 0);
+
+    k_mutex_unlock(&rotate_lock);
+}
+
+int cred_rotate_init(void)
+{
+    int err;
+
+    if (hex2bin(CONFIG_CERTS_ROTATE_PUBKEY, strlen(CONFIG_CERTS_ROTATE_PUBKEY), rotate_pubkey,
+                sizeof(rotate_pubkey)) != sizeof(rotate_pubkey) ||
+        rotate_pubkey[0] != 0x04)
+    {
+        LOG_ERR("CONFIG_CERTS_ROTATE_PUBKEY is not an uncompressed P-256 key, rotation disabled");
+        return -EINVAL;
+    }
+
+    if (psa_crypto_init() != PSA_SUCCESS)
+    {
+        LOG_ERR("PSA crypto init failed, rotation disabled");
+        return -EIO;
+    }
+
+    err = settings_subsys_init();
+    if (!err)
+    {
+        err = settings_load_subtree("cred_rot");
+    }
+    if (err)
+    {
+        LOG_WRN("Active sec tag not restored, err %d", err);
+    }
+
+    snprintf(rotate_topic, sizeof(rotate_topic), CONFIG_CERTS_ROTATE_TOPIC, DEVICE_ID);
+    snprintf(result_topic, sizeof(result_topic), "%s/result", rotate_topic);
+
+    mqtt_create_topic_subscribe(NULL, "%s", rotate_topic);
+
+    LOG_INF("Credential rotation on %s, active sec tag %d", rotate_topic, active_tag);
+    return mqtt_rx_handler_register(rotate_topic, on_rotate_message);
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef _CRED_ROTATE_H
+#define _CRED_ROTATE_H
+
+/*
+ * Over-the-air credential rotation.
+ *
+ * New credentials arrive on the rotate topic, signed with the key of
+ * CONFIG_CERTS_ROTATE_PUBKEY, and are written to the security tag not
+ * currently in use. The modem only accepts key writes while offline, so it is
+ * set to CFUN=4 for the writes and back to normal mode afterwards (see
+ * certs_modem_offline_run()), without a reboot or a modem library restart.
+ * CFUN=4 detaches from LTE: every rotation pays a network re-attach and a full
+ * TLS handshake. The reconnect that follows uses the new tag; if the TLS
+ * handshake or CONNACK rejects it the client falls back to the previous tag,
+ * other connect failures retry the new tag. The outcome is published on the
+ * result topic.
+ */
+
+#if defined(CONFIG_CERTS_ROTATE)
+
+/* Registers the rotate topic subscription and restores the active tag. */
+int cred_rotate_init(void);
+
+/* Security tag to use for the next connect. Called by the MQTT thread. */
+int cred_rotate_sec_tag_for_connect(void);
+
+/* Result of the connect attempt started with the last returned tag, 0 on CONNACK. */
+void cred_rotate_on_connect_result(int result);
+
+#else
+
+static inline int cred_rotate_init(void)
+{
+    return 0;
+}
+
+static inline int cred_rotate_sec_tag_for_connect(void)
+{
+    return CONFIG_MQTT_TLS_SEC_TAG;
+}
+
+static inline void cred_rotate_on_connect_result(int result)
+{
+}
+
+#endif
+
+#endif
\ No newline at end of file
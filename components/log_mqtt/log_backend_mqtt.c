@@ -0,0 +1,349 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : LOG_BACKEND_MQTT.c
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/ring_buffer.h>
+#include <zephyr/logging/log_backend.h>
+#include <zephyr/logging/log_output.h>
+#include <zephyr/logging/log_output_dict.h>
+#include "log_backend_mqtt.h"
+#include "mqtt.h"
+
+#define LOG_MQTT_FORMAT_VERSION 1
+#define LOG_MQTT_HEADER_LEN 3  // Version and uint16 lost count
+#define LOG_MQTT_LEN_PREFIX 2  // Record length in the ring
+#define LOG_MQTT_TOPIC_LENGTH 64
+
+BUILD_ASSERT(CONFIG_LOG_BACKEND_MQTT_BATCH_SIZE <= CONFIG_MQTT_OUTBOX_CHUNK_SIZE,
+			 "Larger bulk messages are split into chunks by the outbox");
+BUILD_ASSERT(CONFIG_LOG_BACKEND_MQTT_RECORD_MAX + LOG_MQTT_HEADER_LEN <=
+			 CONFIG_LOG_BACKEND_MQTT_BATCH_SIZE);
+
+/* No LOG_MODULE_REGISTER here, messages of this module would be streamed as well. */
+
+static uint8_t output_buf[32];
+static uint8_t record[CONFIG_LOG_BACKEND_MQTT_RECORD_MAX];
+static size_t record_len;
+static bool record_overflow;
+static bool panic_mode;
+
+RING_BUF_DECLARE(log_ring, CONFIG_LOG_BACKEND_MQTT_RING_SIZE);
+static struct k_spinlock ring_lock;
+static uint32_t lost_pending; /* Lost since the last batch, under ring_lock */
+
+static uint8_t batch[CONFIG_LOG_BACKEND_MQTT_BATCH_SIZE];
+static size_t batch_len; /* Filled batch waiting to be sent, 0 when none */
+static char topic[LOG_MQTT_TOPIC_LENGTH];
+static uint32_t tokens = CONFIG_LOG_BACKEND_MQTT_BATCH_SIZE;
+static int64_t refill_ms;
+static struct log_backend_mqtt_stats stats;
+
+static void send_work_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(send_work, send_work_fn);
+
+/* Collects the dictionary output of one message into record. */
+static int output_func(uint8_t *data, size_t length, void *ctx)
+{
+	ARG_UNUSED(ctx);
+
+	if (record_len + length > sizeof(record))
+	{
+		record_overflow = true;
+	}
+	else
+	{
+		memcpy(&record[record_len], data, length);
+		record_len += length;
+	}
+
+	return (int)length;
+}
+
+LOG_OUTPUT_DEFINE(log_output_mqtt, output_func, output_buf, sizeof(output_buf));
+
+static void lost_add(uint32_t cnt)
+{
+	k_spinlock_key_t key = k_spin_lock(&ring_lock);
+
+	lost_pending += cnt;
+	stats.lost += cnt;
+
+	k_spin_unlock(&ring_lock, key);
+}
+
+/*
+Function : record_commit
+
+Description : Puts the formatted record into the ring behind its length. Whole records
+			  are overwritten from the oldest on when there is no space, so the ring
+			  always holds complete records.
+
+Parameter : void
+
+Return : void
+
+Example Call :
+				record_commit();
+*/
+static void record_commit(void)
+{
+	uint16_t len = (uint16_t)record_len;
+	k_spinlock_key_t key = k_spin_lock(&ring_lock);
+	uint32_t used;
+
+	while (ring_buf_space_get(&log_ring) < LOG_MQTT_LEN_PREFIX + len)
+	{
+		uint16_t old;
+
+		if (ring_buf_get(&log_ring, (uint8_t *)&old, sizeof(old)) != sizeof(old))
+		{
+			break;
+		}
+		ring_buf_get(&log_ring, NULL, old);
+		lost_pending++;
+		stats.lost++;
+	}
+
+	ring_buf_put(&log_ring, (const uint8_t *)&len, sizeof(len));
+	ring_buf_put(&log_ring, record, len);
+	stats.records++;
+	used = ring_buf_size_get(&log_ring);
+
+	k_spin_unlock(&ring_lock, key);
+
+	if (used >= CONFIG_LOG_BACKEND_MQTT_BATCH_SIZE)
+	{
+		k_work_reschedule(&send_work, K_NO_WAIT);
+	}
+	else
+	{
+		k_work_schedule(&send_work, K_SECONDS(CONFIG_LOG_BACKEND_MQTT_INTERVAL_S));
+	}
+}
+
+/*
+Function : batch_fill
+
+Description : Moves as many whole records from the ring into the batch as fit, behind
+			  the header with the number of records lost since the previous batch.
+
+Parameter : void
+
+Return : void
+
+Example Call :
+				batch_fill();
+*/
+static void batch_fill(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&ring_lock);
+	uint16_t lost = (uint16_t)MIN(lost_pending, UINT16_MAX);
+	size_t len = LOG_MQTT_HEADER_LEN;
+
+	for (;;)
+	{
+		uint16_t rec_len;
+
+		if (ring_buf_peek(&log_ring, (uint8_t *)&rec_len, sizeof(rec_len)) != sizeof(rec_len) ||
+			len + rec_len > sizeof(batch))
+		{
+			break;
+		}
+
+		ring_buf_get(&log_ring, NULL, sizeof(rec_len));
+		ring_buf_get(&log_ring, &batch[len], rec_len);
+		len += rec_len;
+	}
+
+	if (len > LOG_MQTT_HEADER_LEN || lost > 0)
+	{
+		lost_pending -= lost;
+		batch[0] = LOG_MQTT_FORMAT_VERSION;
+		sys_put_le16(lost, &batch[1]);
+		batch_len = len;
+	}
+
+	k_spin_unlock(&ring_lock, key);
+}
+
+/* Token bucket of CONFIG_LOG_BACKEND_MQTT_RATE_BYTES_PER_S, one batch deep. */
+static void tokens_refill(int64_t now)
+{
+	uint32_t add = (uint32_t)((now - refill_ms) * CONFIG_LOG_BACKEND_MQTT_RATE_BYTES_PER_S /
+							  MSEC_PER_SEC);
+
+	if (add > 0)
+	{
+		tokens = MIN(tokens + add, CONFIG_LOG_BACKEND_MQTT_BATCH_SIZE);
+		refill_ms = now;
+	}
+}
+
+/*
+Function : send_work_fn
+
+Description : Publishes the pending batch, or fills one from the ring. While offline
+			  or over the byte rate the batch is kept and the ring keeps collecting.
+
+Parameter :
+- work : Work item.
+
+Return : void
+
+Example Call :
+				Runs on the system work queue.
+*/
+static void send_work_fn(struct k_work *work)
+{
+	int64_t now = k_uptime_get();
+	int err;
+
+	if (topic[0] == '\0')
+	{
+		if (DEVICE_ID[0] == '\0')
+		{
+			k_work_schedule(&send_work, K_SECONDS(CONFIG_LOG_BACKEND_MQTT_INTERVAL_S));
+			return;
+		}
+		snprintf(topic, sizeof(topic), CONFIG_LOG_BACKEND_MQTT_TOPIC, DEVICE_ID);
+	}
+
+	if (batch_len == 0)
+	{
+		batch_fill();
+		if (batch_len == 0)
+		{
+			return;
+		}
+	}
+
+	if (!mqtt_is_connected())
+	{
+		k_work_schedule(&send_work, K_SECONDS(CONFIG_LOG_BACKEND_MQTT_INTERVAL_S));
+		return;
+	}
+
+	tokens_refill(now);
+	if (tokens < batch_len)
+	{
+		k_work_schedule(&send_work, K_MSEC((batch_len - tokens) * MSEC_PER_SEC /
+										   CONFIG_LOG_BACKEND_MQTT_RATE_BYTES_PER_S + 1));
+		return;
+	}
+
+	err = mqtt_outbox_publish(MQTT_PRIO_BULK, topic, MQTT_QOS_1_AT_LEAST_ONCE, batch, batch_len);
+	if (err)
+	{
+		/* Outbox full or over the data budget, the batch is tried again. */
+		k_work_schedule(&send_work, K_SECONDS(CONFIG_LOG_BACKEND_MQTT_INTERVAL_S));
+		return;
+	}
+
+	tokens -= batch_len;
+	stats.batches++;
+	stats.bytes += batch_len;
+	batch_len = 0;
+
+	if (ring_buf_size_get(&log_ring) >= CONFIG_LOG_BACKEND_MQTT_BATCH_SIZE)
+	{
+		k_work_reschedule(&send_work, K_NO_WAIT);
+	}
+	else if (!ring_buf_is_empty(&log_ring))
+	{
+		k_work_schedule(&send_work, K_SECONDS(CONFIG_LOG_BACKEND_MQTT_INTERVAL_S));
+	}
+}
+
+static void process(const struct log_backend *const backend, union log_msg_generic *msg)
+{
+	uint8_t level = log_msg_get_level(&msg->log);
+
+	/* printk messages (level none) and verbose levels stay local. */
+	if (panic_mode || level == LOG_LEVEL_NONE || level > CONFIG_LOG_BACKEND_MQTT_LEVEL)
+	{
+		return;
+	}
+
+	record_len = 0;
+	record_overflow = false;
+
+	log_dict_output_msg_process(&log_output_mqtt, &msg->log, 0);
+	log_output_flush(&log_output_mqtt);
+
+	if (record_overflow || record_len == 0)
+	{
+		lost_add(1);
+		return;
+	}
+
+	record_commit();
+}
+
+static void dropped(const struct log_backend *const backend, uint32_t cnt)
+{
+	lost_add(cnt);
+}
+
+static void panic(const struct log_backend *const backend)
+{
+	/* Nothing can be published from here, buffered records are left as they are. */
+	panic_mode = true;
+}
+
+static const struct log_backend_api log_backend_mqtt_api = {
+	.process = process,
+	.dropped = dropped,
+	.panic = panic,
+};
+
+LOG_BACKEND_DEFINE(log_backend_mqtt, log_backend_mqtt_api, true);
+
+/*
+Function : log_backend_mqtt_flush
+
+Description : Sends the buffered records now instead of after
+			  CONFIG_LOG_BACKEND_MQTT_INTERVAL_S, e.g. after an error the backend should
+			  see quickly. The byte rate limit still applies.
+
+Parameter : void
+
+Return : void
+
+Example Call :
+				log_backend_mqtt_flush();
+*/
+void log_backend_mqtt_flush(void)
+{
+	k_work_reschedule(&send_work, K_NO_WAIT);
+}
+
+/*
+Function : log_backend_mqtt_stats_get
+
+Description : Returns the record and batch counters since boot.
+
+Parameter :
+- out : Output statistics.
+
+Return : void
+
+Example Call :
+				log_backend_mqtt_stats_get(&stats);
+*/
+void log_backend_mqtt_stats_get(struct log_backend_mqtt_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&ring_lock);
+
+	*out = stats;
+
+	k_spin_unlock(&ring_lock, key);
+}
\ No newline at end of file
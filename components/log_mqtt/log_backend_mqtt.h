@@ -0,0 +1,56 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : LOG_BACKEND_MQTT.h
+*/
+
+#ifndef _LOG_BACKEND_MQTT_H_
+#define _LOG_BACKEND_MQTT_H_
+
+#include <stdint.h>
+
+/*
+ * Log backend that streams dictionary-based binary log records over MQTT.
+ * Messages at CONFIG_LOG_BACKEND_MQTT_LEVEL or more severe are formatted by
+ * the dictionary output (format string addresses and raw arguments instead
+ * of text) and kept as whole records in a CONFIG_LOG_BACKEND_MQTT_RING_SIZE
+ * ring, which holds them while offline and overwrites the oldest when full.
+ * Records are published in batches of up to CONFIG_LOG_BACKEND_MQTT_BATCH_SIZE
+ * bytes through the outbox (bulk class), no faster than
+ * CONFIG_LOG_BACKEND_MQTT_RATE_BYTES_PER_S on average.
+ *
+ * Batch format: version (1 byte), records lost since the previous batch
+ * (uint16 little endian, saturated), then the dictionary records back to back.
+ * log_decoder.py turns batches into text with the build's log_dictionary.json.
+ */
+
+struct log_backend_mqtt_stats
+{
+	uint32_t records; /* Records put in the ring */
+	uint32_t lost;	  /* Records overwritten, too large or dropped by the logging core */
+	uint32_t batches; /* Batches queued in the outbox */
+	uint32_t bytes;	  /* Batch bytes queued */
+};
+
+#if defined(CONFIG_LOG_BACKEND_MQTT)
+
+/* Sends what is buffered now, still subject to the rate limit. */
+void log_backend_mqtt_flush(void);
+void log_backend_mqtt_stats_get(struct log_backend_mqtt_stats *stats);
+
+#else
+
+static inline void log_backend_mqtt_flush(void)
+{
+}
+
+static inline void log_backend_mqtt_stats_get(struct log_backend_mqtt_stats *stats)
+{
+	*stats = (struct log_backend_mqtt_stats){0};
+}
+
+#endif
+
+#endif
\ No newline at end of file
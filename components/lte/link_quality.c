@@ -0,0 +1,150 @@
+/*
+Name        : link_quality.c
+
+Description : Implementation of link quality sampling and bulk upload gating.
+              Samples are taken with lte_lc_conn_eval_params_get() (AT%CONEVAL) on
+              every cell update and periodically while registered.
+
+Developer   : Engr. Akbar Shah
+
+Date        : May 13, 2025
+*/
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <modem/lte_lc.h>
+#include "link_quality.h"
+#include "lte.h"
+#include "metrics.h"
+
+LOG_MODULE_REGISTER(LINK_QUALITY);
+
+static K_MUTEX_DEFINE(lq_lock);
+
+static struct link_quality_sample last_sample;
+static struct link_quality_stats stats;
+
+/* Uptime at which bulk traffic was first deferred, 0 when not deferring. */
+static int64_t deferral_start_ms;
+
+static void link_quality_sample_work_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(sample_work, link_quality_sample_work_fn);
+
+static void link_quality_sample_work_fn(struct k_work *work)
+{
+    struct lte_lc_conn_eval_params params = {0};
+    int err;
+
+    if (!lte_is_connected())
+    {
+        return;
+    }
+
+    err = lte_lc_conn_eval_params_get(&params);
+
+    k_mutex_lock(&lq_lock, K_FOREVER);
+    if (err)
+    {
+        /* Positive values are %CONEVAL result codes (no cell, barred, ...). */
+        stats.sample_errors++;
+        metrics_inc(METRIC_LTE_LQ_SAMPLE_ERROR);
+        last_sample.valid = false;
+        LOG_WRN("Connection evaluation failed: %d", err);
+    }
+    else
+    {
+        stats.samples++;
+        last_sample.timestamp_ms = k_uptime_get();
+        last_sample.rsrp_dbm = params.rsrp;
+        last_sample.rsrq_db = params.rsrq;
+        last_sample.energy_estimate = params.energy_estimate;
+        last_sample.valid = true;
+        LOG_INF("Link quality: RSRP %d dBm, RSRQ %d dB, energy estimate %d",
+                params.rsrp, params.rsrq, params.energy_estimate);
+    }
+    k_mutex_unlock(&lq_lock);
+
+    k_work_reschedule(&sample_work, K_SECONDS(CONFIG_LINK_QUALITY_SAMPLE_INTERVAL_S));
+}
+
+void link_quality_request_sample(void)
+{
+    k_work_reschedule(&sample_work, K_NO_WAIT);
+}
+
+static bool link_quality_is_poor(const struct link_quality_sample *s)
+{
+    if (!s->valid)
+    {
+        /* No data is not a reason to hold traffic back. */
+        return false;
+    }
+
+    return (s->energy_estimate < CONFIG_LINK_QUALITY_MIN_ENERGY_ESTIMATE) ||
+           (s->rsrp_dbm < CONFIG_LINK_QUALITY_MIN_RSRP_DBM);
+}
+
+bool link_quality_bulk_allowed(void)
+{
+    bool allowed;
+    int64_t now = k_uptime_get();
+
+    k_mutex_lock(&lq_lock, K_FOREVER);
+
+    if (!link_quality_is_poor(&last_sample))
+    {
+        if (deferral_start_ms != 0)
+        {
+            LOG_INF("Link quality recovered, releasing bulk traffic after %lld ms",
+                    now - deferral_start_ms);
+            metrics_hist_record(METRIC_HIST_LTE_BULK_DEFERRAL_MS,
+                                (uint32_t)(now - deferral_start_ms));
+        }
+        deferral_start_ms = 0;
+        stats.bulk_allowed++;
+        allowed = true;
+    }
+    else if (deferral_start_ms == 0)
+    {
+        deferral_start_ms = now;
+        stats.bulk_deferred++;
+        metrics_inc(METRIC_LTE_BULK_DEFERRED);
+        LOG_INF("Link quality poor, deferring bulk traffic");
+        allowed = false;
+    }
+    else if ((now - deferral_start_ms) >= (CONFIG_LINK_QUALITY_MAX_DEFERRAL_S * 1000LL))
+    {
+        /* Deferral bound reached: send anyway and start a new window. */
+        metrics_hist_record(METRIC_HIST_LTE_BULK_DEFERRAL_MS, (uint32_t)(now - deferral_start_ms));
+        deferral_start_ms = 0;
+        stats.bulk_forced++;
+        metrics_inc(METRIC_LTE_BULK_FORCED);
+        LOG_WRN("Bulk traffic deferred for %d s, sending on poor link",
+                CONFIG_LINK_QUALITY_MAX_DEFERRAL_S);
+        allowed = true;
+    }
+    else
+    {
+        /* Still inside the window counted when it started. */
+        allowed = false;
+    }
+
+    k_mutex_unlock(&lq_lock);
+
+    return allowed;
+}
+
+void link_quality_last(struct link_quality_sample *sample)
+{
+    k_mutex_lock(&lq_lock, K_FOREVER);
+    *sample = last_sample;
+    k_mutex_unlock(&lq_lock);
+}
+
+void link_quality_stats_get(struct link_quality_stats *out)
+{
+    k_mutex_lock(&lq_lock, K_FOREVER);
+    *out = stats;
+    k_mutex_unlock(&lq_lock);
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+/*
+Name        : link_quality.h
+
+Description : Link quality sampling (RSRP, RSRQ and the modem connection energy
+              estimate from AT%CONEVAL) and gating of bulk uploads while the link
+              is poor.
+
+Developer   : Engr. Akbar Shah
+
+Date        : May 13, 2025
+*/
+
+#ifndef _LINK_QUALITY_H
+#define _LINK_QUALITY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct link_quality_sample
+{
+    int64_t timestamp_ms;
+    int16_t rsrp_dbm;
+    int16_t rsrq_db;
+    uint8_t energy_estimate; /* enum lte_lc_energy_estimate, 5 (excessive) .. 9 (efficient) */
+    bool valid;
+};
+
+struct link_quality_stats
+{
+    uint32_t samples;
+    uint32_t sample_errors;
+    uint32_t bulk_allowed;
+    uint32_t bulk_deferred;     /* Deferral windows started, not polls refused */
+    uint32_t bulk_forced;
+};
+
+/*
+Function    : link_quality_request_sample
+
+Description : Schedules a link quality sample on the system workqueue. Safe to call
+              from the LTE event handler.
+
+Parameter   : void
+
+Return      : void
+
+Example Call: link_quality_request_sample();
+*/
+void link_quality_request_sample(void);
+
+/*
+Function    : link_quality_bulk_allowed
+
+Description : Decides whether a bulk (deferrable) upload may be sent now. Returns false
+              while the last sample is below the configured thresholds, until the bulk
+              traffic has been deferred for CONFIG_LINK_QUALITY_MAX_DEFERRAL_S.
+
+Parameter   : void
+
+Return      : bool - true if the bulk upload may proceed.
+
+Example Call: if (link_quality_bulk_allowed()) { ... }
+*/
+bool link_quality_bulk_allowed(void);
+
+/*
+Function    : link_quality_last
+
+Description : Copies the most recent link quality sample.
+
+Parameter   : struct link_quality_sample *sample - Destination.
+
+Return      : void
+
+Example Call: link_quality_last(&sample);
+*/
+void link_quality_last(struct link_quality_sample *sample);
+
+/*
+Function    : link_quality_stats_get
+
+Description : Copies the sampling and gating decision counters.
+
+Parameter   : struct link_quality_stats *stats - Destination.
+
+Return      : void
+
+Example Call: link_quality_stats_get(&stats);
+*/
+void link_quality_stats_get(struct link_quality_stats *stats);
+
+#endif
\ No newline at end of file
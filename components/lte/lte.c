@@ -16,19 +16,25 @@ Date        : May 13, 2025
 #include <zephyr/logging/log.h>
 #include <modem/nrf_modem_lib.h>
 #include <modem/modem_info.h>
-#include <nrf_modem_at.h>
 #include <modem/lte_lc.h>
 #include "lte.h"
+#include "modem_identity.h"
+#include "link_quality.h"
+#include "at_cmd.h"
+#include "metrics.h"
+#include "airtime.h"
 
 #define LTE_POWER_OFF_RETRIES 10
 
-#define MAX_MODEM_INFO_LEN 30
+#define LTE_EVT_CONNECTED BIT(0)
 
-char MODEM_FW_VERSION[MAX_MODEM_INFO_LEN];
-char MODEM_IMEI[MAX_MODEM_INFO_LEN];
-char MODEM_ICCID[MAX_MODEM_INFO_LEN];
+/* Event object instead of a semaphore so that several threads (boot, MQTT)
+ * can wait for the same registration without consuming it.
+ */
+static K_EVENT_DEFINE(lte_events);
 
-static K_SEM_DEFINE(lte_connected, 0, 1);
+/* Uptime when the RRC connection was set up, 0 while idle. */
+static int64_t rrc_connected_ms;
 
 struct modem_param_info mdm_param;
 
@@ -56,17 +62,23 @@ static void lte_handler(const struct lte_lc_evt *const evt)
         {
         case LTE_LC_NW_REG_NOT_REGISTERED:
             LOG_INF("Network status: Not registered");
+            k_event_clear(&lte_events, LTE_EVT_CONNECTED);
             break;
         case LTE_LC_NW_REG_REGISTERED_HOME:
             LOG_INF("Network status: Registered (home)");
-            k_sem_give(&lte_connected);
+            k_event_post(&lte_events, LTE_EVT_CONNECTED);
+            modem_identity_refresh_iccid();
+            link_quality_request_sample();
             break;
         case LTE_LC_NW_REG_REGISTERED_ROAMING:
             LOG_INF("Network status: Registered (roaming)");
-            k_sem_give(&lte_connected);
+            k_event_post(&lte_events, LTE_EVT_CONNECTED);
+            modem_identity_refresh_iccid();
+            link_quality_request_sample();
             break;
         case LTE_LC_NW_REG_SEARCHING:
             LOG_INF("Network status: Searching");
+            k_event_clear(&lte_events, LTE_EVT_CONNECTED);
             break;
         case LTE_LC_NW_REG_REGISTRATION_DENIED:
             LOG_INF("Network status: Registration denied");
@@ -76,6 +88,8 @@ static void lte_handler(const struct lte_lc_evt *const evt)
             break;
         case LTE_LC_NW_REG_UICC_FAIL:
             LOG_INF("Network status: UICC failure");
+            /* SIM removed or failed: the next registration may be on another one. */
+            modem_identity_sim_changed();
             break;
         }
         break;
@@ -83,11 +97,25 @@ static void lte_handler(const struct lte_lc_evt *const evt)
     case LTE_LC_EVT_RRC_UPDATE:
         LOG_INF("RRC mode: %s",
                 evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED ? "Connected" : "Idle");
+        airtime_rrc_update(evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED);
+        if (evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED)
+        {
+            rrc_connected_ms = k_uptime_get();
+            metrics_inc(METRIC_LTE_RRC_CONNECTED);
+        }
+        else if (rrc_connected_ms != 0)
+        {
+            metrics_hist_record(METRIC_HIST_LTE_RRC_CONNECTED_MS,
+                                (uint32_t)(k_uptime_get() - rrc_connected_ms));
+            rrc_connected_ms = 0;
+        }
         break;
 
     case LTE_LC_EVT_CELL_UPDATE:
         LOG_INF("Cell update: cell ID %d, TAC %d",
                 evt->cell.id, evt->cell.tac);
+        metrics_inc(METRIC_LTE_CELL_UPDATE);
+        link_quality_request_sample();
         break;
 #if CONFIG_LTE_LC_PSM_MODULE
     case LTE_LC_EVT_PSM_UPDATE:
@@ -129,10 +157,12 @@ int get_modem_info_fw_version(char *fw_version, size_t len)
         return -EINVAL;
     }
 
-    if (modem_info_string_get(MODEM_INFO_FW_VERSION, fw_version, len) <= 0)
+    int err = at_cmd_exec(AT_CMD_FW_VERSION, fw_version, len,
+                          K_MSEC(CONFIG_AT_CMD_TIMEOUT_MS));
+    if (err)
     {
-        LOG_WRN("Failed to get modem FW version");
-        return -EIO;
+        LOG_WRN("Failed to get modem FW version, error: %d", err);
+        return err;
     }
 
     LOG_INF("Modem FW version: %s", fw_version);
@@ -146,29 +176,13 @@ int get_modem_info_imei(char *imei, size_t len)
         return -EINVAL;
     }
 
-    char response[128];
-    int err = nrf_modem_at_cmd(response, sizeof(response), "AT+CGSN=1");
+    int err = at_cmd_exec(AT_CMD_IMEI, imei, len, K_MSEC(CONFIG_AT_CMD_TIMEOUT_MS));
     if (err)
     {
         LOG_ERR("Couldn't get IMEI, error: %d", err);
         return err;
     }
 
-    char *start = strchr(response, '"');
-    char *end = start ? strchr(start + 1, '"') : NULL;
-    if (!start || !end)
-    {
-        LOG_ERR("Failed to parse IMEI.");
-        return -EBADMSG;
-    }
-
-    size_t imei_len = end - (start + 1);
-    if (imei_len >= len)
-        imei_len = len - 1;
-
-    strncpy(imei, start + 1, imei_len);
-    imei[imei_len] = '\0';
-
     return 0;
 }
 
@@ -179,42 +193,14 @@ int get_modem_info_iccid(char *iccid, size_t len)
         return -EINVAL;
     }
 
-    char response[128];
-    int err;
-
-    // Set modem to full functionality
-    err = nrf_modem_at_cmd(response, sizeof(response), "AT+CFUN=1");
-    if (err)
-    {
-        LOG_ERR("Couldn't set modem to full functionality, error: %d", err);
-        return err;
-    }
-
-    // Read ICCID
-    err = nrf_modem_at_cmd(response, sizeof(response), "AT%%XICCID");
+    // The SIM must already be active (no CFUN change here)
+    int err = at_cmd_exec(AT_CMD_ICCID, iccid, len, K_MSEC(CONFIG_AT_CMD_TIMEOUT_MS));
     if (err)
     {
         LOG_ERR("Couldn't get ICCID, error: %d", err);
         return err;
     }
 
-    char *ccid = strchr(response, ':');
-    if (!ccid)
-    {
-        LOG_ERR("Failed to parse ICCID.");
-        return -EBADMSG;
-    }
-
-    ccid += 1;
-    while (*ccid == ' ')
-        ccid++; // skip whitespace
-
-    size_t iccid_len = strcspn(ccid, "\r\n");
-    if (iccid_len >= len)
-        iccid_len = len - 1;
-
-    strncpy(iccid, ccid, iccid_len);
-    iccid[iccid_len] = '\0';
     return 0;
 }
 
@@ -260,22 +246,10 @@ int modem_init(void)
         return err;
     }
 
-    err = get_modem_info_imei(MODEM_IMEI, sizeof(MODEM_IMEI));
-    if (!err)
-    {
-        LOG_INF("IMEI: [ %s ]", MODEM_IMEI);
-    }
-
-    err = get_modem_info_iccid(MODEM_ICCID, sizeof(MODEM_ICCID));
-    if (!err)
-    {
-        LOG_INF("ICCID: [ %s ]", MODEM_ICCID);
-    }
-
-    err = get_modem_info_fw_version(MODEM_FW_VERSION, sizeof(MODEM_FW_VERSION));
-    if (!err)
+    err = modem_identity_load();
+    if (err)
     {
-        LOG_INF("Modem FW version: %s", MODEM_FW_VERSION);
+        LOG_ERR("Failed to load modem identity, error: %d", err);
     }
     return err;
 }
@@ -324,7 +298,7 @@ int lte_deinit(void)
     return err;
 }
 
-int lte_init(void)
+int lte_connect_start(void)
 {
     int err;
 /* lte_lc_init deprecated in >= v2.6.0 */
@@ -344,6 +318,37 @@ int lte_init(void)
         LOG_ERR("Error in lte_lc_connect_async, error: %d", err);
         return err;
     }
-    k_sem_take(&lte_connected, K_FOREVER);
     return 0;
+}
+
+int lte_wait_connected(k_timeout_t timeout)
+{
+    if (k_event_wait(&lte_events, LTE_EVT_CONNECTED, false, timeout) == 0)
+    {
+        return -ETIMEDOUT;
+    }
+    return 0;
+}
+
+bool lte_is_connected(void)
+{
+    return (k_event_test(&lte_events, LTE_EVT_CONNECTED) != 0);
+}
+
+int lte_init(void)
+{
+    int err;
+
+    err = lte_connect_start();
+    if (err)
+    {
+        return err;
+    }
+
+    err = lte_wait_connected(K_SECONDS(CONFIG_LTE_ATTACH_TIMEOUT_S));
+    if (err)
+    {
+        LOG_ERR("LTE not registered within %d s", CONFIG_LTE_ATTACH_TIMEOUT_S);
+    }
+    return err;
 }
\ No newline at end of file
@@ -13,10 +13,13 @@ Date        : May 13, 2025
 #ifndef _LTE_H
 #define _LTE_H
 
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+
 /*
 Function    : get_modem_info_fw_version
 
-Description : Retrieves the firmware version of the modem and stores it in the provided buffer.
+Description : Retrieves the modem firmware version (AT+CGMR) through the AT command service.
 
 Parameter   : char *fw_version - Destination buffer for the firmware version string.
               size_t len       - Length of the buffer.
@@ -30,7 +33,8 @@ int get_modem_info_fw_version(char *fw_version, size_t len);
 /*
 Function    : get_modem_info_imei
 
-Description : Retrieves the modem IMEI using the AT+CGSN=1 command and parses the response.
+Description : Retrieves the modem IMEI (AT+CGSN) through the AT command service.
+              Prefer modem_identity_get(), which caches the value.
 
 Parameter   : char *imei - Destination buffer for the IMEI string.
               size_t len - Length of the buffer.
@@ -44,7 +48,9 @@ int get_modem_info_imei(char *imei, size_t len);
 /*
 Function    : get_modem_info_iccid
 
-Description : Retrieves the SIM card ICCID using the AT+CCID command and parses the response.
+Description : Retrieves the SIM card ICCID (AT%XICCID) through the AT command service.
+              The SIM must be active (modem registered), the functional mode is not changed.
+              Prefer modem_identity_get(), which caches the value.
 
 Parameter   : char *iccid - Destination buffer for the ICCID string.
               size_t len  - Length of the buffer.
@@ -71,7 +77,8 @@ int modem_deinit(void);
 /*
 Function    : modem_init
 
-Description : Initializes the modem library and retrieves IMEI, ICCID, and FW version.
+Description : Initializes the modem library and loads the cached modem identity
+              (IMEI, FW version; the ICCID follows after LTE registration).
 
 Parameter   : void
 
@@ -95,10 +102,52 @@ Example Call: lte_deinit();
 
 int lte_deinit(void);
 
+/*
+Function    : lte_connect_start
+
+Description : Starts the LTE attach and returns immediately. Registration is
+              reported through lte_wait_connected() / lte_is_connected().
+
+Parameter   : void
+
+Return      : int - 0 on success, negative error code on failure.
+
+Example Call: lte_connect_start();
+*/
+int lte_connect_start(void);
+
+/*
+Function    : lte_wait_connected
+
+Description : Blocks until the modem is registered (home or roaming) or the
+              timeout expires. Any number of threads may wait concurrently.
+
+Parameter   : k_timeout_t timeout - Maximum time to wait.
+
+Return      : int - 0 when registered, -ETIMEDOUT otherwise.
+
+Example Call: lte_wait_connected(K_SECONDS(30));
+*/
+int lte_wait_connected(k_timeout_t timeout);
+
+/*
+Function    : lte_is_connected
+
+Description : Returns the current network registration state without blocking.
+
+Parameter   : void
+
+Return      : bool - true when registered.
+
+Example Call: if (lte_is_connected()) { ... }
+*/
+bool lte_is_connected(void);
+
 /*
 Function    : lte_init
 
-Description : Initializes and connects to the LTE network asynchronously.
+Description : Starts the LTE attach and waits up to CONFIG_LTE_ATTACH_TIMEOUT_S
+              for network registration.
 
 Parameter   : void
 
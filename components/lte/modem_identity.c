@@ -0,0 +1,252 @@
+/*
+Name        : modem_identity.c
+
+Description : Implementation of the modem identity cache. IMEI, ICCID and modem
+              firmware version are persisted under the "modem_id" settings subtree.
+              A normal boot and every registration are served from the cache
+              without an AT command. A field is read from the modem only when it
+              is missing or the modem reported a change: a modem DFU for the FW
+              version, a UICC failure (SIM removed or replaced) for the ICCID.
+
+Developer   : Engr. Akbar Shah
+
+Date        : May 13, 2025
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <ncs_version.h>
+#include <modem/nrf_modem_lib.h>
+#include "modem_identity.h"
+#include "at_cmd.h"
+
+#define MODEM_ID_SETTINGS_ROOT "modem_id"
+
+LOG_MODULE_REGISTER(MODEM_ID);
+
+static struct modem_identity identity;
+static struct modem_identity cached;
+
+static atomic_t iccid_stale; /* ICCID unknown or SIM event since the last read */
+
+#if NCS_VERSION_NUMBER >= 0x20500
+static bool fw_updated; /* A modem DFU ran during this modem library init */
+
+/* Runs in nrf_modem_lib_init() when the modem applied (or failed) a DFU, before
+ * modem_identity_load().
+ */
+static void on_modem_dfu(int dfu_res, void *ctx)
+{
+    LOG_INF("Modem DFU result %d, FW version will be read again", dfu_res);
+    fw_updated = true;
+}
+
+NRF_MODEM_LIB_ON_DFU_RES(modem_id_dfu_hook, on_modem_dfu, NULL);
+#else
+/* No DFU hook before NCS 2.5: read the FW version on every boot. */
+static bool fw_updated = true;
+#endif
+
+/*
+Function    : modem_id_settings_set
+
+Description : Settings handler restoring the cached identity fields.
+
+Parameter   : const char *name         - Key relative to the "modem_id" subtree.
+              size_t len               - Length of the stored value.
+              settings_read_cb read_cb - Callback reading the value.
+              void *cb_arg             - Argument for read_cb.
+
+Return      : int - 0 on success, negative error code on failure.
+
+Example Call: Called by settings_load_subtree().
+*/
+static int modem_id_settings_set(const char *name, size_t len,
+                                 settings_read_cb read_cb, void *cb_arg)
+{
+    char *dst;
+    size_t size;
+    ssize_t rc;
+
+    if (!strcmp(name, "imei"))
+    {
+        dst = cached.imei;
+        size = sizeof(cached.imei);
+    }
+    else if (!strcmp(name, "iccid"))
+    {
+        dst = cached.iccid;
+        size = sizeof(cached.iccid);
+    }
+    else if (!strcmp(name, "fw"))
+    {
+        dst = cached.fw_version;
+        size = sizeof(cached.fw_version);
+    }
+    else
+    {
+        return -ENOENT;
+    }
+
+    if (len >= size)
+    {
+        return -EINVAL;
+    }
+
+    rc = read_cb(cb_arg, dst, len);
+    if (rc < 0)
+    {
+        return rc;
+    }
+    dst[rc] = '\0';
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(modem_id, MODEM_ID_SETTINGS_ROOT, NULL,
+                               modem_id_settings_set, NULL, NULL);
+
+static void modem_id_save(const char *key, const char *value)
+{
+    char path[sizeof(MODEM_ID_SETTINGS_ROOT) + 8];
+    int err;
+
+    if (!IS_ENABLED(CONFIG_MODEM_IDENTITY_CACHE))
+    {
+        return;
+    }
+
+    snprintf(path, sizeof(path), MODEM_ID_SETTINGS_ROOT "/%s", key);
+    err = settings_save_one(path, value, strlen(value));
+    if (err)
+    {
+        LOG_WRN("Failed to persist %s, error: %d", path, err);
+    }
+}
+
+int modem_identity_load(void)
+{
+    int err;
+
+    if (IS_ENABLED(CONFIG_MODEM_IDENTITY_CACHE))
+    {
+        err = settings_subsys_init();
+        if (!err)
+        {
+            err = settings_load_subtree(MODEM_ID_SETTINGS_ROOT);
+        }
+        if (err)
+        {
+            LOG_WRN("Modem identity cache unavailable, error: %d", err);
+        }
+    }
+
+    identity = cached;
+
+    /* The cache lives in this device's flash and belongs to its modem. */
+    if (identity.imei[0] == '\0')
+    {
+        LOG_INF("Modem identity cache empty, reading IMEI");
+        err = at_cmd_exec(AT_CMD_IMEI, identity.imei, sizeof(identity.imei),
+                          K_MSEC(CONFIG_AT_CMD_TIMEOUT_MS));
+        if (err)
+        {
+            LOG_ERR("Couldn't get IMEI, error: %d", err);
+            return err;
+        }
+        modem_id_save("imei", identity.imei);
+    }
+
+    if (identity.fw_version[0] == '\0' || fw_updated)
+    {
+        err = at_cmd_exec(AT_CMD_FW_VERSION, identity.fw_version, sizeof(identity.fw_version),
+                          K_MSEC(CONFIG_AT_CMD_TIMEOUT_MS));
+        if (err)
+        {
+            LOG_WRN("Couldn't get modem FW version, error: %d", err);
+            identity.fw_version[0] = '\0';
+        }
+        else if (strcmp(identity.fw_version, cached.fw_version) != 0)
+        {
+            modem_id_save("fw", identity.fw_version);
+        }
+        fw_updated = false;
+    }
+
+    atomic_set(&iccid_stale, identity.iccid[0] == '\0');
+
+    LOG_INF("IMEI: [ %s ]", identity.imei);
+    LOG_INF("ICCID: [ %s ]", identity.iccid[0] ? identity.iccid : "pending");
+    LOG_INF("Modem FW version: %s", identity.fw_version);
+    return 0;
+}
+
+static void iccid_save_work_fn(struct k_work *work)
+{
+    modem_id_save("iccid", identity.iccid);
+}
+
+/* Settings writes go through flash, keep them off the AT command thread. */
+static K_WORK_DEFINE(iccid_save_work, iccid_save_work_fn);
+
+/*
+Function    : iccid_done
+
+Description : Completion of the AT%XICCID request, runs on the AT command thread.
+              Stores a changed ICCID and persists it from the system workqueue.
+
+Parameter   : enum at_cmd_id id    - AT_CMD_ICCID.
+              int err              - 0 on success, negative error code on failure.
+              const char *value    - Parsed ICCID, NULL on failure.
+              void *user_data      - Unused.
+
+Return      : void
+
+Example Call: Passed to at_cmd_submit().
+*/
+static void iccid_done(enum at_cmd_id id, int err, const char *value, void *user_data)
+{
+    if (err)
+    {
+        /* Tried again on the next registration. */
+        LOG_WRN("Couldn't get ICCID, error: %d", err);
+        atomic_set(&iccid_stale, true);
+        return;
+    }
+
+    if (strcmp(value, identity.iccid) != 0)
+    {
+        snprintf(identity.iccid, sizeof(identity.iccid), "%s", value);
+        LOG_INF("ICCID: [ %s ]", identity.iccid);
+        k_work_submit(&iccid_save_work);
+    }
+}
+
+int modem_identity_refresh_iccid(void)
+{
+    int err;
+
+    if (!atomic_cas(&iccid_stale, true, false))
+    {
+        return 0;
+    }
+
+    err = at_cmd_submit(AT_CMD_ICCID, iccid_done, NULL);
+    if (err)
+    {
+        atomic_set(&iccid_stale, true);
+    }
+    return err;
+}
+
+void modem_identity_sim_changed(void)
+{
+    atomic_set(&iccid_stale, true);
+}
+
+const struct modem_identity *modem_identity_get(void)
+{
+    return &identity;
+}
\ No newline at end of file
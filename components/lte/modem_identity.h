@@ -0,0 +1,96 @@
+/*
+Name        : modem_identity.h
+
+Description : Cached modem identity (IMEI, ICCID, modem firmware version).
+              The identity is read from the modem once, persisted through the
+              settings subsystem and served from RAM to every consumer. A field
+              is only read again when the modem reports a change.
+
+Developer   : Engr. Akbar Shah
+
+Date        : May 13, 2025
+*/
+
+#ifndef _MODEM_IDENTITY_H
+#define _MODEM_IDENTITY_H
+
+#define MODEM_IMEI_LEN 16
+#define MODEM_ICCID_LEN 24
+#define MODEM_FW_VERSION_LEN 40
+
+struct modem_identity
+{
+    char imei[MODEM_IMEI_LEN];
+    char iccid[MODEM_ICCID_LEN];
+    char fw_version[MODEM_FW_VERSION_LEN];
+};
+
+/*
+Function    : modem_identity_load
+
+Description : Loads the cached identity from settings. Only missing fields are read
+              from the modem (AT+CGSN, AT+CGMR) and persisted, plus the FW version
+              after the modem library reported a modem DFU. A boot with a full
+              cache sends no AT command. The ICCID is never read here because the
+              SIM is not powered yet, see modem_identity_refresh_iccid().
+              Requires an initialized modem library.
+
+Parameter   : void
+
+Return      : int - 0 on success, negative error code on failure.
+
+Example Call: modem_identity_load();
+*/
+int modem_identity_load(void);
+
+/*
+Function    : modem_identity_refresh_iccid
+
+Description : Queues an AT%XICCID read if the ICCID is not known or a SIM event was
+              reported since the last read (modem_identity_sim_changed()), and
+              returns without waiting for the modem. Otherwise nothing is sent. A
+              changed ICCID is stored and persisted when the response arrives.
+              Must be called while the SIM is active (after LTE registration), it
+              does not change the modem functional mode. Safe to call from the LTE
+              event handler.
+
+Parameter   : void
+
+Return      : int - 0 if the read was queued or not needed, negative error code on
+              failure.
+
+Example Call: modem_identity_refresh_iccid();
+*/
+int modem_identity_refresh_iccid(void);
+
+/*
+Function    : modem_identity_sim_changed
+
+Description : Marks the cached ICCID as stale after a SIM event (UICC failure, SIM
+              removed or replaced), so the next modem_identity_refresh_iccid()
+              reads it again. A SIM swapped while the device is off raises no
+              event and keeps the cached ICCID.
+
+Parameter   : void
+
+Return      : void
+
+Example Call: modem_identity_sim_changed();
+*/
+void modem_identity_sim_changed(void);
+
+/*
+Function    : modem_identity_get
+
+Description : Returns the cached modem identity. Fields that are not known yet are
+              empty strings.
+
+Parameter   : void
+
+Return      : const struct modem_identity * - Pointer to the cached identity.
+
+Example Call: modem_identity_get()->imei;
+*/
+const struct modem_identity *modem_identity_get(void);
+
+#endif
\ No newline at end of file
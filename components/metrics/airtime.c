@@ -0,0 +1,370 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : AIRTIME.c
+*/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "airtime.h"
+#include "mqtt.h"
+#include "mqtt_arena.h"
+#include "data_usage.h"
+
+/* Estimated bytes on the air per message besides topic and payload: MQTT fixed
+ * header and packet id, TLS record header and MAC, TCP/IP headers.
+ */
+#define AIRTIME_MSG_OVERHEAD 80
+#define AIRTIME_JSON_MAX_LEN 2048
+#define AIRTIME_TOPIC_MAX_LEN 64
+#define AIRTIME_NO_ENTRY -1
+
+LOG_MODULE_REGISTER(AIRTIME);
+
+struct airtime_entry
+{
+	char *topic; /* Arena copy at exact length, NULL for the overflow entry */
+	uint32_t tx_msgs;
+	uint32_t tx_bytes;
+	uint32_t rx_msgs;
+	uint32_t rx_bytes;
+	uint32_t radio_ms;
+	uint32_t wakeups;
+	uint32_t interval_bytes; /* Bytes in the current RRC interval */
+};
+
+/* The last entry collects the topics that did not fit. */
+static struct airtime_entry entries[CONFIG_AIRTIME_MAX_TOPICS + 1];
+static K_MUTEX_DEFINE(airtime_lock);
+
+static bool rrc_connected;
+static int64_t rrc_start_ms;
+static int wake_entry = AIRTIME_NO_ENTRY;
+static uint32_t rrc_intervals;
+static uint32_t rrc_total_ms;
+static uint32_t unattributed_ms;
+
+static void airtime_publish_work_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(publish_work, airtime_publish_work_fn);
+
+static struct airtime_entry *entry_get(const char *topic, size_t topic_len)
+{
+	struct airtime_entry *overflow = &entries[CONFIG_AIRTIME_MAX_TOPICS];
+
+	for (int i = 0; i < CONFIG_AIRTIME_MAX_TOPICS; i++)
+	{
+		struct airtime_entry *e = &entries[i];
+
+		if (e->topic == NULL)
+		{
+			e->topic = mqtt_arena_alloc(topic_len + 1);
+			if (e->topic == NULL)
+			{
+				return overflow;
+			}
+
+			memcpy(e->topic, topic, topic_len);
+			e->topic[topic_len] = '\0';
+			return e;
+		}
+
+		if (strlen(e->topic) == topic_len && memcmp(e->topic, topic, topic_len) == 0)
+		{
+			return e;
+		}
+	}
+
+	return overflow;
+}
+
+static void record(const char *topic, size_t topic_len, size_t payload_len, bool tx)
+{
+	uint32_t bytes = payload_len + topic_len + AIRTIME_MSG_OVERHEAD;
+	struct airtime_entry *e;
+
+	k_mutex_lock(&airtime_lock, K_FOREVER);
+
+	e = entry_get(topic, topic_len);
+
+	if (tx)
+	{
+		e->tx_msgs++;
+		e->tx_bytes += bytes;
+	}
+	else
+	{
+		e->rx_msgs++;
+		e->rx_bytes += bytes;
+	}
+
+	/* Traffic while idle is what brings up the next RRC connection. */
+	if (!rrc_connected && wake_entry == AIRTIME_NO_ENTRY)
+	{
+		wake_entry = e - entries;
+	}
+
+	e->interval_bytes += bytes;
+
+	k_mutex_unlock(&airtime_lock);
+}
+
+/*
+Function : airtime_tx
+
+Description : Records an outgoing publish. Called by the MQTT component.
+
+Parameter :
+- topic : Topic, not necessarily NUL terminated.
+- topic_len : Topic length.
+- payload_len : Payload length.
+
+Return : void
+
+Example Call :
+				airtime_tx(topic, strlen(topic), len);
+*/
+void airtime_tx(const char *topic, size_t topic_len, size_t payload_len)
+{
+	record(topic, topic_len, payload_len, true);
+}
+
+/*
+Function : airtime_rx
+
+Description : Records a received publish. Called by the MQTT component.
+
+Parameter :
+- topic : Topic, not necessarily NUL terminated.
+- topic_len : Topic length.
+- payload_len : Payload length.
+
+Return : void
+
+Example Call :
+				airtime_rx(p->message.topic.topic.utf8, p->message.topic.topic.size, len);
+*/
+void airtime_rx(const char *topic, size_t topic_len, size_t payload_len)
+{
+	record(topic, topic_len, payload_len, false);
+}
+
+/*
+Function : airtime_rrc_update
+
+Description : Opens or closes an RRC connected interval. On close the interval length
+			  is split across the topics with traffic in it, by estimated bytes.
+
+Parameter :
+- connected : true on RRC connected, false on RRC idle.
+
+Return : void
+
+Example Call :
+				airtime_rrc_update(evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED);
+*/
+void airtime_rrc_update(bool connected)
+{
+	uint32_t interval_ms;
+	uint64_t total_bytes = 0;
+
+	k_mutex_lock(&airtime_lock, K_FOREVER);
+
+	if (connected)
+	{
+		if (!rrc_connected)
+		{
+			rrc_connected = true;
+			rrc_start_ms = k_uptime_get();
+		}
+		k_mutex_unlock(&airtime_lock);
+		return;
+	}
+
+	if (!rrc_connected)
+	{
+		k_mutex_unlock(&airtime_lock);
+		return;
+	}
+
+	rrc_connected = false;
+	interval_ms = (uint32_t)(k_uptime_get() - rrc_start_ms);
+	rrc_intervals++;
+	rrc_total_ms += interval_ms;
+
+	for (int i = 0; i < ARRAY_SIZE(entries); i++)
+	{
+		total_bytes += entries[i].interval_bytes;
+	}
+
+	if (total_bytes == 0)
+	{
+		/* Keepalive pings, TAU, network paging. */
+		unattributed_ms += interval_ms;
+	}
+	else
+	{
+		for (int i = 0; i < ARRAY_SIZE(entries); i++)
+		{
+			entries[i].radio_ms +=
+				(uint32_t)(((uint64_t)interval_ms * entries[i].interval_bytes) / total_bytes);
+			entries[i].interval_bytes = 0;
+		}
+	}
+
+	if (wake_entry != AIRTIME_NO_ENTRY)
+	{
+		entries[wake_entry].wakeups++;
+		wake_entry = AIRTIME_NO_ENTRY;
+	}
+
+	k_mutex_unlock(&airtime_lock);
+}
+
+static int json_append(char *buf, size_t *pos, const char *format, ...)
+{
+	va_list args;
+	int n;
+
+	va_start(args, format);
+	n = vsnprintf(&buf[*pos], AIRTIME_JSON_MAX_LEN - *pos, format, args);
+	va_end(args);
+
+	if (n < 0 || (size_t)n >= AIRTIME_JSON_MAX_LEN - *pos)
+	{
+		return -ENOMEM;
+	}
+
+	*pos += n;
+	return 0;
+}
+
+/*
+Function : airtime_encode
+
+Description : Encodes the statistics as JSON. Topics are
+			  [tx msgs, tx bytes, rx msgs, rx bytes, radio ms, wakeups, charge mC],
+			  "rrc" is [intervals, total ms] and "unattr_ms" the radio time without
+			  any topic traffic.
+
+			  {"up":3600,"rrc":[12,98000],"unattr_ms":21000,
+			   "t":{"mqtt/123/telemetry":[60,9000,0,0,52000,10,2340],...,"other":[...]}}
+
+Parameter :
+- buf : Output buffer of AIRTIME_JSON_MAX_LEN bytes.
+
+Return :
+Length of the encoded string, or -ENOMEM if it does not fit.
+
+Example Call :
+				len = airtime_encode(json);
+*/
+static int airtime_encode(char *buf)
+{
+	size_t pos = 0;
+	bool first = true;
+	int err;
+
+	k_mutex_lock(&airtime_lock, K_FOREVER);
+
+	err = json_append(buf, &pos, "{\"up\":%u,\"rrc\":[%u,%u],\"unattr_ms\":%u,\"t\":{",
+					  (uint32_t)(k_uptime_get() / MSEC_PER_SEC), rrc_intervals,
+					  rrc_total_ms, unattributed_ms);
+
+	for (int i = 0; i < ARRAY_SIZE(entries) && !err; i++)
+	{
+		const struct airtime_entry *e = &entries[i];
+
+		if (e->tx_msgs == 0 && e->rx_msgs == 0)
+		{
+			continue;
+		}
+
+		err = json_append(buf, &pos, "%s\"%s\":[%u,%u,%u,%u,%u,%u,%u]", first ? "" : ",",
+						  e->topic ? e->topic : "other", e->tx_msgs, e->tx_bytes,
+						  e->rx_msgs, e->rx_bytes, e->radio_ms, e->wakeups,
+						  (uint32_t)(((uint64_t)e->radio_ms * CONFIG_AIRTIME_RRC_CURRENT_MA) /
+									 MSEC_PER_SEC));
+		first = false;
+	}
+
+	k_mutex_unlock(&airtime_lock);
+
+	if (!err)
+	{
+		err = json_append(buf, &pos, "}}");
+	}
+
+	return err ? err : (int)pos;
+}
+
+static void airtime_publish_work_fn(struct k_work *work)
+{
+	char topic[AIRTIME_TOPIC_MAX_LEN];
+	char *json;
+	int len;
+	int err;
+
+	k_work_schedule(&publish_work,
+					K_SECONDS(data_usage_interval_s(CONFIG_AIRTIME_PUBLISH_INTERVAL_S)));
+
+	if (!mqtt_is_connected())
+	{
+		return;
+	}
+
+	json = mqtt_arena_alloc(AIRTIME_JSON_MAX_LEN);
+	if (json == NULL)
+	{
+		return;
+	}
+
+	len = airtime_encode(json);
+	if (len < 0)
+	{
+		LOG_ERR("Failed to encode airtime statistics: %d", len);
+	}
+	else
+	{
+		snprintf(topic, sizeof(topic), CONFIG_AIRTIME_TOPIC, DEVICE_ID);
+
+		err = mqtt_outbox_publish(MQTT_PRIO_BULK, topic, MQTT_QOS_0_AT_MOST_ONCE,
+								  (const uint8_t *)json, len);
+		if (err)
+		{
+			LOG_DBG("Airtime publish skipped: %d", err);
+		}
+	}
+
+	mqtt_arena_free(json);
+}
+
+/*
+Function : airtime_init
+
+Description : Starts the periodic airtime statistics publish. Disabled when
+			  CONFIG_AIRTIME_PUBLISH_INTERVAL_S is 0.
+
+Parameter : void
+
+Return :
+0 on success.
+
+Example Call :
+				airtime_init();
+*/
+int airtime_init(void)
+{
+	if (CONFIG_AIRTIME_PUBLISH_INTERVAL_S > 0)
+	{
+		k_work_schedule(&publish_work,
+						K_SECONDS(data_usage_interval_s(CONFIG_AIRTIME_PUBLISH_INTERVAL_S)));
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : AIRTIME.h
+*/
+
+#ifndef _AIRTIME_H_
+#define _AIRTIME_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Radio time and bytes per MQTT topic.
+ *
+ * Every RRC connected interval reported by the LTE handler is split across
+ * the topics that sent or received data during it, in proportion to their
+ * estimated bytes on the air. This includes the inactivity tail the network
+ * keeps the radio on after the last packet. The topic whose traffic falls
+ * first in an interval is counted as having woken the radio.
+ */
+
+#if defined(CONFIG_AIRTIME)
+
+void airtime_tx(const char *topic, size_t topic_len, size_t payload_len);
+void airtime_rx(const char *topic, size_t topic_len, size_t payload_len);
+void airtime_rrc_update(bool connected);
+int airtime_init(void);
+
+#else
+
+static inline void airtime_tx(const char *topic, size_t topic_len, size_t payload_len)
+{
+}
+
+static inline void airtime_rx(const char *topic, size_t topic_len, size_t payload_len)
+{
+}
+
+static inline void airtime_rrc_update(bool connected)
+{
+}
+
+static inline int airtime_init(void)
+{
+	return 0;
+}
+
+#endif
+
+#endif
\ No newline at end of file
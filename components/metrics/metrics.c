@@ -0,0 +1,402 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : METRICS.c
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+#include "metrics.h"
+#include "mqtt.h"
+#include "mqtt_arena.h"
+#include "data_usage.h"
+
+#define METRICS_TOPIC_MAX_LEN 64
+
+/* Longest counter or histogram key, enforced by the size of the name tables. */
+#define METRICS_KEY_MAX_LEN 10
+#define METRICS_U32_MAX_LEN 10
+#define METRICS_U64_MAX_LEN 20
+
+/* ,"key":N */
+#define METRICS_COUNTER_MAX_LEN (4 + METRICS_KEY_MAX_LEN + METRICS_U32_MAX_LEN)
+
+/* ,"key":[count,sum,max,b0,...,b15] */
+#define METRICS_HIST_MAX_LEN                                                       \
+	(8 + METRICS_KEY_MAX_LEN + 2 * METRICS_U32_MAX_LEN + METRICS_U64_MAX_LEN +     \
+	 METRICS_HIST_BUCKETS * (1 + METRICS_U32_MAX_LEN))
+
+/* Every counter and every bucket of every histogram at its widest, about 2 KB. */
+#define METRICS_JSON_MAX_LEN                                                       \
+	(sizeof("{\"up\":,\"c\":{},\"h\":{},\"arena\":[,,]}") + 4 * METRICS_U32_MAX_LEN + \
+	 METRIC_COUNTER_COUNT * METRICS_COUNTER_MAX_LEN + METRIC_HIST_COUNT * METRICS_HIST_MAX_LEN)
+
+LOG_MODULE_REGISTER(METRICS);
+
+/* Short keys keep the periodic publish small. A longer key does not fit its table. */
+static const char counter_names[METRIC_COUNTER_COUNT][METRICS_KEY_MAX_LEN + 1] = {
+	[METRIC_MQTT_PUBLISH] = "pub",
+	[METRIC_MQTT_PUBLISH_ERROR] = "pub_err",
+	[METRIC_MQTT_ACK] = "ack",
+	[METRIC_MQTT_RECONNECT] = "reconn",
+	[METRIC_MQTT_POLL_ERROR] = "poll_err",
+	[METRIC_MQTT_RX_TRUNCATED] = "rx_trunc",
+	[METRIC_MQTT_RATE_LIMITED] = "rate_lim",
+	[METRIC_MQTT_COALESCED] = "coalesced",
+	[METRIC_LTE_RRC_CONNECTED] = "rrc_conn",
+	[METRIC_LTE_CELL_UPDATE] = "cell_upd",
+	[METRIC_LTE_LQ_SAMPLE_ERROR] = "lq_err",
+	[METRIC_LTE_BULK_DEFERRED] = "bulk_defer",
+	[METRIC_LTE_BULK_FORCED] = "bulk_force",
+	[METRIC_AT_CMD_ERROR] = "at_err",
+};
+
+static const char hist_names[METRIC_HIST_COUNT][METRICS_KEY_MAX_LEN + 1] = {
+	[METRIC_HIST_MQTT_CONNECT_MS] = "conn_ms",
+	[METRIC_HIST_MQTT_ACK_RTT_MS] = "ack_ms",
+	[METRIC_HIST_MQTT_POLL_WAKE_US] = "wake_us",
+	[METRIC_HIST_LTE_RRC_CONNECTED_MS] = "rrc_ms",
+	[METRIC_HIST_MQTT_OUTBOX_CMD_MS] = "cmd_ms",
+	[METRIC_HIST_LTE_BULK_DEFERRAL_MS] = "defer_ms",
+	[METRIC_HIST_AT_CMD_MS] = "at_ms",
+};
+
+static atomic_t counters[METRIC_COUNTER_COUNT];
+static struct metrics_hist hists[METRIC_HIST_COUNT];
+static struct k_spinlock hist_lock;
+
+static void metrics_publish_work_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(publish_work, metrics_publish_work_fn);
+
+/*
+Function : metrics_inc
+
+Description : Increments a counter. Lock free, safe from any thread.
+
+Parameter :
+- id : Counter to increment.
+
+Return : void
+
+Example Call :
+				metrics_inc(METRIC_MQTT_PUBLISH);
+*/
+void metrics_inc(enum metric_counter id)
+{
+	atomic_inc(&counters[id]);
+}
+
+/*
+Function : metrics_hist_record
+
+Description : Adds a value to a log2 bucket histogram. The unit is given by the
+			  histogram (see enum metric_hist).
+
+Parameter :
+- id : Histogram to update.
+- value : Sample value.
+
+Return : void
+
+Example Call :
+				metrics_hist_record(METRIC_HIST_MQTT_CONNECT_MS, ms);
+*/
+void metrics_hist_record(enum metric_hist id, uint32_t value)
+{
+	int bucket = 0;
+	uint32_t v = value;
+
+	while (v > 1 && bucket < METRICS_HIST_BUCKETS - 1)
+	{
+		v >>= 1;
+		bucket++;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&hist_lock);
+
+	hists[id].count++;
+	hists[id].sum += value;
+	hists[id].max = MAX(hists[id].max, value);
+	hists[id].buckets[bucket]++;
+
+	k_spin_unlock(&hist_lock, key);
+}
+
+uint32_t metrics_counter_get(enum metric_counter id)
+{
+	return (uint32_t)atomic_get(&counters[id]);
+}
+
+void metrics_hist_get(enum metric_hist id, struct metrics_hist *hist)
+{
+	k_spinlock_key_t key = k_spin_lock(&hist_lock);
+
+	*hist = hists[id];
+
+	k_spin_unlock(&hist_lock, key);
+}
+
+const char *metrics_counter_name(enum metric_counter id)
+{
+	return counter_names[id];
+}
+
+const char *metrics_hist_name(enum metric_hist id)
+{
+	return hist_names[id];
+}
+
+/*
+Function : metrics_encode
+
+Description : Encodes all metrics as compact JSON. Histograms are encoded as
+			  [count, sum, max, bucket0, bucket1, ...] with trailing empty buckets
+			  dropped, the MQTT arena as [peak, size, failed allocations].
+
+			  {"up":3600,"c":{"pub":120,...},"h":{"conn_ms":[3,2950,1210,0,...],...},
+			   "arena":[9810,12288,0]}
+
+Parameter :
+- buf : Output buffer.
+- len : Size of the output buffer.
+
+Return :
+Length of the encoded string, or -ENOMEM if the buffer is too small.
+
+Example Call :
+				len = metrics_encode(buf, sizeof(buf));
+*/
+int metrics_encode(char *buf, size_t len)
+{
+	struct metrics_hist h;
+	struct mqtt_arena_stats arena;
+	size_t pos = 0;
+
+#define METRICS_APPEND(...)                                                 \
+	do                                                                      \
+	{                                                                       \
+		int n = snprintf(&buf[pos], len - pos, __VA_ARGS__);                \
+		if (n < 0 || (size_t)n >= len - pos)                                \
+		{                                                                   \
+			return -ENOMEM;                                                 \
+		}                                                                   \
+		pos += n;                                                           \
+	} while (0)
+
+	METRICS_APPEND("{\"up\":%u,\"c\":{", (uint32_t)(k_uptime_get() / MSEC_PER_SEC));
+
+	for (int i = 0; i < METRIC_COUNTER_COUNT; i++)
+	{
+		METRICS_APPEND("%s\"%s\":%u", i ? "," : "", counter_names[i],
+					   metrics_counter_get(i));
+	}
+
+	METRICS_APPEND("},\"h\":{");
+
+	for (int i = 0; i < METRIC_HIST_COUNT; i++)
+	{
+		int last = METRICS_HIST_BUCKETS - 1;
+
+		metrics_hist_get(i, &h);
+
+		while (last >= 0 && h.buckets[last] == 0)
+		{
+			last--;
+		}
+
+		METRICS_APPEND("%s\"%s\":[%u,%llu,%u", i ? "," : "", hist_names[i],
+					   h.count, (unsigned long long)h.sum, h.max);
+
+		for (int b = 0; b <= last; b++)
+		{
+			METRICS_APPEND(",%u", h.buckets[b]);
+		}
+
+		METRICS_APPEND("]");
+	}
+
+	METRICS_APPEND("}");
+
+	mqtt_arena_stats_get(&arena);
+	METRICS_APPEND(",\"arena\":[%u,%u,%u]}", (uint32_t)arena.peak, (uint32_t)arena.size,
+				   arena.failures);
+
+#undef METRICS_APPEND
+
+	return pos;
+}
+
+/*
+Function : metrics_reset
+
+Description : Clears all counters and histograms.
+
+Parameter : void
+
+Return : void
+
+Example Call :
+				metrics_reset();
+*/
+void metrics_reset(void)
+{
+	for (int i = 0; i < METRIC_COUNTER_COUNT; i++)
+	{
+		atomic_clear(&counters[i]);
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&hist_lock);
+
+	memset(hists, 0, sizeof(hists));
+
+	k_spin_unlock(&hist_lock, key);
+}
+
+static void metrics_publish_work_fn(struct k_work *work)
+{
+	char topic[METRICS_TOPIC_MAX_LEN];
+	char *json;
+	int len;
+	int err;
+
+	k_work_schedule(&publish_work,
+					K_SECONDS(data_usage_interval_s(CONFIG_METRICS_PUBLISH_INTERVAL_S)));
+
+	if (!mqtt_is_connected())
+	{
+		return;
+	}
+
+	/* Staged in the MQTT arena only for the duration of the publish. */
+	json = mqtt_arena_alloc(METRICS_JSON_MAX_LEN);
+	if (json == NULL)
+	{
+		return;
+	}
+
+	len = metrics_encode(json, METRICS_JSON_MAX_LEN);
+	if (len < 0)
+	{
+		LOG_ERR("Failed to encode metrics: %d", len);
+		mqtt_arena_free(json);
+		return;
+	}
+
+	snprintf(topic, sizeof(topic), CONFIG_METRICS_TOPIC, DEVICE_ID);
+
+	err = mqtt_outbox_publish(MQTT_PRIO_TELEMETRY, topic, MQTT_QOS_0_AT_MOST_ONCE,
+							  (const uint8_t *)json, len);
+	if (err)
+	{
+		/* Counters are cumulative, the next publish carries them. */
+		LOG_DBG("Metrics publish skipped: %d", err);
+	}
+
+	mqtt_arena_free(json);
+}
+
+/*
+Function : metrics_init
+
+Description : Starts the periodic metrics publish. Disabled when
+			  CONFIG_METRICS_PUBLISH_INTERVAL_S is 0.
+
+Parameter : void
+
+Return :
+0 on success.
+
+Example Call :
+				metrics_init();
+*/
+int metrics_init(void)
+{
+	if (CONFIG_METRICS_PUBLISH_INTERVAL_S > 0)
+	{
+		k_work_schedule(&publish_work,
+						K_SECONDS(data_usage_interval_s(CONFIG_METRICS_PUBLISH_INTERVAL_S)));
+	}
+
+	return 0;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_metrics_show(const struct shell *sh, size_t argc, char **argv)
+{
+	struct metrics_hist h;
+
+	for (int i = 0; i < METRIC_COUNTER_COUNT; i++)
+	{
+		shell_print(sh, "%-10s %u", counter_names[i], metrics_counter_get(i));
+	}
+
+	for (int i = 0; i < METRIC_HIST_COUNT; i++)
+	{
+		char buckets[METRICS_HIST_BUCKETS * 6];
+		size_t pos = 0;
+
+		metrics_hist_get(i, &h);
+
+		for (int b = 0; b < METRICS_HIST_BUCKETS && pos < sizeof(buckets); b++)
+		{
+			pos += snprintf(&buckets[pos], sizeof(buckets) - pos, "%u ", h.buckets[b]);
+		}
+
+		shell_print(sh, "%-10s n %u mean %u max %u hist[log2] %s", hist_names[i], h.count,
+					h.count ? (uint32_t)(h.sum / h.count) : 0, h.max, buckets);
+	}
+
+	return 0;
+}
+
+static int cmd_metrics_json(const struct shell *sh, size_t argc, char **argv)
+{
+	char *json = mqtt_arena_alloc(METRICS_JSON_MAX_LEN);
+	int len;
+
+	if (json == NULL)
+	{
+		shell_error(sh, "No arena memory");
+		return -ENOMEM;
+	}
+
+	len = metrics_encode(json, METRICS_JSON_MAX_LEN);
+	if (len < 0)
+	{
+		shell_error(sh, "Encode failed: %d", len);
+	}
+	else
+	{
+		shell_print(sh, "%s", json);
+	}
+
+	mqtt_arena_free(json);
+
+	return len < 0 ? len : 0;
+}
+
+static int cmd_metrics_reset(const struct shell *sh, size_t argc, char **argv)
+{
+	metrics_reset();
+	shell_print(sh, "Metrics cleared");
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_metrics,
+							   SHELL_CMD(show, NULL, "Show counters and histograms", cmd_metrics_show),
+							   SHELL_CMD(json, NULL, "Print the MQTT metrics payload", cmd_metrics_json),
+							   SHELL_CMD(reset, NULL, "Clear all metrics", cmd_metrics_reset),
+							   SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(metrics, &sub_metrics, "Runtime metrics", NULL);
+#endif
\ No newline at end of file
@@ -0,0 +1,88 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : METRICS.h
+*/
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define METRICS_HIST_BUCKETS 16
+
+enum metric_counter
+{
+	METRIC_MQTT_PUBLISH,
+	METRIC_MQTT_PUBLISH_ERROR,
+	METRIC_MQTT_ACK,
+	METRIC_MQTT_RECONNECT,
+	METRIC_MQTT_POLL_ERROR,
+	METRIC_MQTT_RX_TRUNCATED,
+	METRIC_MQTT_RATE_LIMITED,
+	METRIC_MQTT_COALESCED,
+	METRIC_LTE_RRC_CONNECTED,
+	METRIC_LTE_CELL_UPDATE,
+	METRIC_LTE_LQ_SAMPLE_ERROR, /* Failed AT%CONEVAL samples */
+	METRIC_LTE_BULK_DEFERRED,	/* Bulk deferral windows started on a poor link */
+	METRIC_LTE_BULK_FORCED,		/* Bulk sent on a poor link after the deferral bound */
+	METRIC_AT_CMD_ERROR,		/* AT commands that failed or could not be parsed */
+	METRIC_COUNTER_COUNT
+};
+
+enum metric_hist
+{
+	METRIC_HIST_MQTT_CONNECT_MS,	  /* mqtt_connect() to CONNACK */
+	METRIC_HIST_MQTT_ACK_RTT_MS,	  /* Publish to PUBACK/PUBCOMP */
+	METRIC_HIST_MQTT_POLL_WAKE_US,	  /* poll() wake-up to input handled */
+	METRIC_HIST_LTE_RRC_CONNECTED_MS, /* RRC connected to idle */
+	METRIC_HIST_MQTT_OUTBOX_CMD_MS,	  /* Command response queued to sent */
+	METRIC_HIST_LTE_BULK_DEFERRAL_MS, /* Bulk deferral start to release */
+	METRIC_HIST_AT_CMD_MS,			  /* AT command sent to response, all commands */
+	METRIC_HIST_COUNT
+};
+
+struct metrics_hist
+{
+	uint32_t count;
+	uint32_t max;
+	uint64_t sum;
+	/* Bucket b counts values in [2^b, 2^(b+1)), bucket 0 also holds 0. */
+	uint32_t buckets[METRICS_HIST_BUCKETS];
+};
+
+#if defined(CONFIG_METRICS)
+
+void metrics_inc(enum metric_counter id);
+void metrics_hist_record(enum metric_hist id, uint32_t value);
+
+uint32_t metrics_counter_get(enum metric_counter id);
+void metrics_hist_get(enum metric_hist id, struct metrics_hist *hist);
+const char *metrics_counter_name(enum metric_counter id);
+const char *metrics_hist_name(enum metric_hist id);
+
+int metrics_encode(char *buf, size_t len);
+void metrics_reset(void);
+int metrics_init(void);
+
+#else
+
+static inline void metrics_inc(enum metric_counter id)
+{
+}
+
+static inline void metrics_hist_record(enum metric_hist id, uint32_t value)
+{
+}
+
+static inline int metrics_init(void)
+{
+	return 0;
+}
+
+#endif
+
+#endif
\ No newline at end of file
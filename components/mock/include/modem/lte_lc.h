@@ -0,0 +1,114 @@
+/*
+Name        : lte_lc.h (mock)
+
+Description : Subset of the nRF Connect SDK LTE link control API used by this
+              application, for the native_sim host build. Names and values match
+              the SDK header so the components compile unchanged.
+
+Developer   : Engr. Akbar Shah
+
+Date        : May 13, 2025
+*/
+
+#ifndef MOCK_LTE_LC_H_
+#define MOCK_LTE_LC_H_
+
+#include <stdint.h>
+
+enum lte_lc_nw_reg_status
+{
+    LTE_LC_NW_REG_NOT_REGISTERED = 0,
+    LTE_LC_NW_REG_REGISTERED_HOME = 1,
+    LTE_LC_NW_REG_SEARCHING = 2,
+    LTE_LC_NW_REG_REGISTRATION_DENIED = 3,
+    LTE_LC_NW_REG_UNKNOWN = 4,
+    LTE_LC_NW_REG_REGISTERED_ROAMING = 5,
+    LTE_LC_NW_REG_UICC_FAIL = 90
+};
+
+enum lte_lc_rrc_mode
+{
+    LTE_LC_RRC_MODE_IDLE = 0,
+    LTE_LC_RRC_MODE_CONNECTED = 1,
+};
+
+enum lte_lc_func_mode
+{
+    LTE_LC_FUNC_MODE_POWER_OFF = 0,
+    LTE_LC_FUNC_MODE_NORMAL = 1,
+    LTE_LC_FUNC_MODE_OFFLINE = 4,
+};
+
+enum lte_lc_energy_estimate
+{
+    LTE_LC_ENERGY_CONSUMPTION_EXCESSIVE = 5,
+    LTE_LC_ENERGY_CONSUMPTION_INCREASED = 6,
+    LTE_LC_ENERGY_CONSUMPTION_NORMAL = 7,
+    LTE_LC_ENERGY_CONSUMPTION_REDUCED = 8,
+    LTE_LC_ENERGY_CONSUMPTION_EFFICIENT = 9,
+};
+
+enum lte_lc_evt_type
+{
+    LTE_LC_EVT_NW_REG_STATUS,
+    LTE_LC_EVT_PSM_UPDATE,
+    LTE_LC_EVT_EDRX_UPDATE,
+    LTE_LC_EVT_RRC_UPDATE,
+    LTE_LC_EVT_CELL_UPDATE,
+    LTE_LC_EVT_LTE_MODE_UPDATE,
+    LTE_LC_EVT_TAU_PRE_WARNING,
+    LTE_LC_EVT_NEIGHBOR_CELL_MEAS,
+    LTE_LC_EVT_MODEM_SLEEP_EXIT_PRE_WARNING,
+    LTE_LC_EVT_MODEM_SLEEP_EXIT,
+    LTE_LC_EVT_MODEM_SLEEP_ENTER,
+    LTE_LC_EVT_MODEM_EVENT,
+};
+
+struct lte_lc_cell
+{
+    uint32_t mcc;
+    uint32_t mnc;
+    uint32_t id;
+    uint32_t tac;
+    uint32_t earfcn;
+    int16_t rsrp;
+    int16_t rsrq;
+};
+
+struct lte_lc_evt
+{
+    enum lte_lc_evt_type type;
+    union
+    {
+        enum lte_lc_nw_reg_status nw_reg_status;
+        enum lte_lc_rrc_mode rrc_mode;
+        struct lte_lc_cell cell;
+    };
+};
+
+struct lte_lc_conn_eval_params
+{
+    enum lte_lc_rrc_mode rrc_state;
+    enum lte_lc_energy_estimate energy_estimate;
+    uint32_t cell_id;
+    uint16_t tac;
+    int16_t rsrp;
+    int16_t rsrq;
+    int16_t snr;
+};
+
+typedef void (*lte_lc_evt_handler_t)(const struct lte_lc_evt *const evt);
+
+int lte_lc_init(void);
+int lte_lc_deinit(void);
+int lte_lc_connect_async(lte_lc_evt_handler_t handler);
+int lte_lc_power_off(void);
+int lte_lc_offline(void);
+int lte_lc_normal(void);
+int lte_lc_func_mode_get(enum lte_lc_func_mode *mode);
+int lte_lc_conn_eval_params_get(struct lte_lc_conn_eval_params *params);
+
+/* Mock control: inject an event into the registered handler. */
+void mock_lte_lc_emit(const struct lte_lc_evt *evt);
+
+#endif
\ No newline at end of file
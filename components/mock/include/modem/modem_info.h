@@ -0,0 +1,32 @@
+/*
+Name        : modem_info.h (mock)
+
+Description : Modem information API for the native_sim host build.
+
+Developer   : Engr. Akbar Shah
+
+Date        : May 13, 2025
+*/
+
+#ifndef MOCK_MODEM_INFO_H_
+#define MOCK_MODEM_INFO_H_
+
+#include <stddef.h>
+
+enum modem_info
+{
+    MODEM_INFO_FW_VERSION,
+    MODEM_INFO_IMEI,
+    MODEM_INFO_ICCID,
+};
+
+struct modem_param_info
+{
+    int unused;
+};
+
+int modem_info_init(void);
+int modem_info_params_init(struct modem_param_info *modem);
+int modem_info_string_get(enum modem_info info, char *buf, const size_t buf_size);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,40 @@
+/*
+Name        : modem_key_mgmt.h (mock)
+
+Description : Modem key management API for the native_sim host build. Credentials
+              are kept in RAM.
+
+Developer   : Engr. Akbar Shah
+
+Date        : May 13, 2025
+*/
+
+#ifndef MOCK_MODEM_KEY_MGMT_H_
+#define MOCK_MODEM_KEY_MGMT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t nrf_sec_tag_t;
+
+enum modem_key_mgmt_cred_type
+{
+    MODEM_KEY_MGMT_CRED_TYPE_CA_CHAIN,
+    MODEM_KEY_MGMT_CRED_TYPE_PUBLIC_CERT,
+    MODEM_KEY_MGMT_CRED_TYPE_PRIVATE_CERT,
+    MODEM_KEY_MGMT_CRED_TYPE_PSK,
+    MODEM_KEY_MGMT_CRED_TYPE_IDENTITY,
+};
+
+int modem_key_mgmt_write(nrf_sec_tag_t sec_tag, enum modem_key_mgmt_cred_type cred_type,
+                         const void *buf, size_t len);
+int modem_key_mgmt_delete(nrf_sec_tag_t sec_tag, enum modem_key_mgmt_cred_type cred_type);
+int modem_key_mgmt_read(nrf_sec_tag_t sec_tag, enum modem_key_mgmt_cred_type cred_type,
+                        void *buf, size_t *len);
+int modem_key_mgmt_cmp(nrf_sec_tag_t sec_tag, enum modem_key_mgmt_cred_type cred_type,
+                       const void *buf, size_t len);
+int modem_key_mgmt_exists(nrf_sec_tag_t sec_tag, enum modem_key_mgmt_cred_type cred_type,
+                          bool *exists);
+
+#endif
\ No newline at end of file
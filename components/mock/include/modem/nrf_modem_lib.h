@@ -0,0 +1,21 @@
+/*
+Name        : nrf_modem_lib.h (mock)
+
+Description : Modem library init/shutdown for the native_sim host build.
+
+Developer   : Engr. Akbar Shah
+
+Date        : May 13, 2025
+*/
+
+#ifndef MOCK_NRF_MODEM_LIB_H_
+#define MOCK_NRF_MODEM_LIB_H_
+
+int nrf_modem_lib_init(void);
+int nrf_modem_lib_shutdown(void);
+
+/* The host modem never runs a DFU, the hook is kept but never called. */
+#define NRF_MODEM_LIB_ON_DFU_RES(name, _callback, _context) \
+	static void (*const name)(int, void *) __attribute__((unused)) = _callback
+
+#endif
\ No newline at end of file
@@ -0,0 +1,138 @@
+/*
+Name        : mock_lte_lc.c
+
+Description : Mock LTE link control for the native_sim host build. The attach is
+              simulated with a delayed work item that reports searching, a cell
+              update, RRC connected and registration, in the order the modem does.
+              Connection evaluation returns configurable values.
+
+Developer   : Engr. Akbar Shah
+
+Date        : May 13, 2025
+*/
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <modem/lte_lc.h>
+
+LOG_MODULE_REGISTER(MOCK_LTE_LC);
+
+static lte_lc_evt_handler_t evt_handler;
+static enum lte_lc_func_mode func_mode = LTE_LC_FUNC_MODE_POWER_OFF;
+
+static void attach_work_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(attach_work, attach_work_fn);
+
+void mock_lte_lc_emit(const struct lte_lc_evt *evt)
+{
+    if (evt_handler)
+    {
+        evt_handler(evt);
+    }
+}
+
+static void attach_work_fn(struct k_work *work)
+{
+    struct lte_lc_evt evt = {0};
+
+    evt.type = LTE_LC_EVT_CELL_UPDATE;
+    evt.cell.id = 0x0123ABC;
+    evt.cell.tac = 0x1234;
+    mock_lte_lc_emit(&evt);
+
+    evt.type = LTE_LC_EVT_RRC_UPDATE;
+    evt.rrc_mode = LTE_LC_RRC_MODE_CONNECTED;
+    mock_lte_lc_emit(&evt);
+
+    evt.type = LTE_LC_EVT_NW_REG_STATUS;
+    evt.nw_reg_status = LTE_LC_NW_REG_REGISTERED_HOME;
+    mock_lte_lc_emit(&evt);
+}
+
+int lte_lc_init(void)
+{
+    return 0;
+}
+
+int lte_lc_deinit(void)
+{
+    evt_handler = NULL;
+    return 0;
+}
+
+int lte_lc_connect_async(lte_lc_evt_handler_t handler)
+{
+    struct lte_lc_evt evt = {
+        .type = LTE_LC_EVT_NW_REG_STATUS,
+        .nw_reg_status = LTE_LC_NW_REG_SEARCHING,
+    };
+
+    if (!handler)
+    {
+        return -EINVAL;
+    }
+
+    evt_handler = handler;
+    func_mode = LTE_LC_FUNC_MODE_NORMAL;
+
+    mock_lte_lc_emit(&evt);
+    k_work_reschedule(&attach_work, K_MSEC(CONFIG_MODEM_MOCK_ATTACH_DELAY_MS));
+    return 0;
+}
+
+int lte_lc_power_off(void)
+{
+    struct lte_lc_evt evt = {
+        .type = LTE_LC_EVT_NW_REG_STATUS,
+        .nw_reg_status = LTE_LC_NW_REG_NOT_REGISTERED,
+    };
+
+    k_work_cancel_delayable(&attach_work);
+    func_mode = LTE_LC_FUNC_MODE_POWER_OFF;
+    mock_lte_lc_emit(&evt);
+    return 0;
+}
+
+int lte_lc_offline(void)
+{
+    struct lte_lc_evt evt = {
+        .type = LTE_LC_EVT_NW_REG_STATUS,
+        .nw_reg_status = LTE_LC_NW_REG_NOT_REGISTERED,
+    };
+
+    k_work_cancel_delayable(&attach_work);
+    func_mode = LTE_LC_FUNC_MODE_OFFLINE;
+    mock_lte_lc_emit(&evt);
+    return 0;
+}
+
+int lte_lc_normal(void)
+{
+    return lte_lc_connect_async(evt_handler);
+}
+
+int lte_lc_func_mode_get(enum lte_lc_func_mode *mode)
+{
+    *mode = func_mode;
+    return 0;
+}
+
+int lte_lc_conn_eval_params_get(struct lte_lc_conn_eval_params *params)
+{
+    if (func_mode != LTE_LC_FUNC_MODE_NORMAL)
+    {
+        return -EOPNOTSUPP;
+    }
+
+    k_msleep(CONFIG_AT_CMD_MOCK_LATENCY_MS);
+
+    params->rrc_state = LTE_LC_RRC_MODE_CONNECTED;
+    params->energy_estimate = CONFIG_MODEM_MOCK_ENERGY_ESTIMATE;
+    params->cell_id = 0x0123ABC;
+    params->tac = 0x1234;
+    params->rsrp = CONFIG_MODEM_MOCK_RSRP_DBM;
+    params->rsrq = -10;
+    params->snr = 12;
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+/*
+Name        : mock_modem_key_mgmt.c
+
+Description : Mock modem credential storage for the native_sim host build. A small
+              table of heap copies stands in for the modem's credential store.
+
+Developer   : Engr. Akbar Shah
+
+Date        : May 13, 2025
+*/
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <modem/modem_key_mgmt.h>
+
+#define MOCK_CRED_SLOTS 8
+
+struct mock_cred
+{
+    nrf_sec_tag_t tag;
+    enum modem_key_mgmt_cred_type type;
+    uint8_t *data;
+    size_t len;
+};
+
+static struct mock_cred creds[MOCK_CRED_SLOTS];
+static K_MUTEX_DEFINE(creds_lock);
+
+static struct mock_cred *cred_find(nrf_sec_tag_t tag, enum modem_key_mgmt_cred_type type)
+{
+    for (int i = 0; i < MOCK_CRED_SLOTS; i++)
+    {
+        if (creds[i].data && creds[i].tag == tag && creds[i].type == type)
+        {
+            return &creds[i];
+        }
+    }
+    return NULL;
+}
+
+int modem_key_mgmt_write(nrf_sec_tag_t sec_tag, enum modem_key_mgmt_cred_type cred_type,
+                         const void *buf, size_t len)
+{
+    struct mock_cred *c;
+    uint8_t *copy = k_malloc(len);
+
+    if (!copy)
+    {
+        return -ENOMEM;
+    }
+    memcpy(copy, buf, len);
+
+    k_mutex_lock(&creds_lock, K_FOREVER);
+    c = cred_find(sec_tag, cred_type);
+    for (int i = 0; !c && i < MOCK_CRED_SLOTS; i++)
+    {
+        if (!creds[i].data)
+        {
+            c = &creds[i];
+        }
+    }
+    if (!c)
+    {
+        k_mutex_unlock(&creds_lock);
+        k_free(copy);
+        return -ENOMEM;
+    }
+
+    k_free(c->data);
+    c->tag = sec_tag;
+    c->type = cred_type;
+    c->data = copy;
+    c->len = len;
+    k_mutex_unlock(&creds_lock);
+    return 0;
+}
+
+int modem_key_mgmt_delete(nrf_sec_tag_t sec_tag, enum modem_key_mgmt_cred_type cred_type)
+{
+    struct mock_cred *c;
+
+    k_mutex_lock(&creds_lock, K_FOREVER);
+    c = cred_find(sec_tag, cred_type);
+    if (c)
+    {
+        k_free(c->data);
+        c->data = NULL;
+    }
+    k_mutex_unlock(&creds_lock);
+    return c ? 0 : -ENOENT;
+}
+
+int modem_key_mgmt_read(nrf_sec_tag_t sec_tag, enum modem_key_mgmt_cred_type cred_type,
+                        void *buf, size_t *len)
+{
+    struct mock_cred *c;
+    int err = 0;
+
+    if (cred_type == MODEM_KEY_MGMT_CRED_TYPE_PRIVATE_CERT)
+    {
+        /* Like the modem, private keys cannot be read back. */
+        return -EACCES;
+    }
+
+    k_mutex_lock(&creds_lock, K_FOREVER);
+    c = cred_find(sec_tag, cred_type);
+    if (!c)
+    {
+        err = -ENOENT;
+    }
+    else if (c->len > *len)
+    {
+        err = -ENOMEM;
+    }
+    else
+    {
+        memcpy(buf, c->data, c->len);
+        *len = c->len;
+    }
+    k_mutex_unlock(&creds_lock);
+    return err;
+}
+
+int modem_key_mgmt_cmp(nrf_sec_tag_t sec_tag, enum modem_key_mgmt_cred_type cred_type,
+                       const void *buf, size_t len)
+{
+    struct mock_cred *c;
+    int ret;
+
+    if (cred_type == MODEM_KEY_MGMT_CRED_TYPE_PRIVATE_CERT)
+    {
+        return -EACCES;
+    }
+
+    k_mutex_lock(&creds_lock, K_FOREVER);
+    c = cred_find(sec_tag, cred_type);
+    if (!c)
+    {
+        ret = -ENOENT;
+    }
+    else
+    {
+        ret = (c->len == len && memcmp(c->data, buf, len) == 0) ? 0 : 1;
+    }
+    k_mutex_unlock(&creds_lock);
+    return ret;
+}
+
+int modem_key_mgmt_exists(nrf_sec_tag_t sec_tag, enum modem_key_mgmt_cred_type cred_type,
+                          bool *exists)
+{
+    k_mutex_lock(&creds_lock, K_FOREVER);
+    *exists = (cred_find(sec_tag, cred_type) != NULL);
+    k_mutex_unlock(&creds_lock);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+/*
+Name        : mock_modem_lib.c
+
+Description : Mock modem library and modem information for the native_sim host build.
+
+Developer   : Engr. Akbar Shah
+
+Date        : May 13, 2025
+*/
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <modem/nrf_modem_lib.h>
+#include <modem/modem_info.h>
+
+LOG_MODULE_REGISTER(MOCK_MODEM);
+
+static bool initialized;
+
+int nrf_modem_lib_init(void)
+{
+    LOG_INF("Mock modem library initialized");
+    initialized = true;
+    return 0;
+}
+
+int nrf_modem_lib_shutdown(void)
+{
+    initialized = false;
+    return 0;
+}
+
+int modem_info_init(void)
+{
+    return initialized ? 0 : -EPERM;
+}
+
+int modem_info_params_init(struct modem_param_info *modem)
+{
+    return modem ? 0 : -EINVAL;
+}
+
+int modem_info_string_get(enum modem_info info, char *buf, const size_t buf_size)
+{
+    const char *value;
+
+    switch (info)
+    {
+    case MODEM_INFO_FW_VERSION:
+        value = "mfw_nrf9160_1.3.5";
+        break;
+    case MODEM_INFO_IMEI:
+        value = "352656100000001";
+        break;
+    case MODEM_INFO_ICCID:
+        value = "89882280666027595366";
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    strncpy(buf, value, buf_size - 1);
+    buf[buf_size - 1] = '\0';
+    return strlen(buf);
+}
\ No newline at end of file
@@ -11,23 +11,35 @@ Component : MQTT.c
 #include <ncs_version.h>
 #include <zephyr/kernel.h>
 #include <zephyr/net/socket.h>
-#include <nrf_modem_at.h>
 #include <zephyr/logging/log.h>
-#if NCS_VERSION_NUMBER < 0x20600
-#include <zephyr/random/rand32.h>
-#else
-#include <zephyr/random/random.h>
-#endif
 #include <modem/modem_key_mgmt.h>
 #include "mqtt.h"
 #include "lte.h"
-
-#define MAX_TOPICS 5		  // Maximum number of topics to store
-#define MAX_TOPICS_LENGTH 256 // Maximum length of each topics string
+#include "boot.h"
+#include "cred_rotate.h"
+#include "metrics.h"
+#include "mqtt_arena.h"
+#include "profiling.h"
+#include "airtime.h"
+#include "mqtt_topics.h"
+#include "mqtt_outbox.h"
+#include "mqtt_rate.h"
+#include "mqtt_stream.h"
+#include "mqtt_coalesce.h"
+#include "mqtt_sn_client.h"
+#include "mqtt_presence.h"
+#include "shadow.h"
+#include "data_usage.h"
+
+#define MAX_TOPICS_LENGTH 256 // Maximum length of a formatted topic (stored at exact length)
+#define MAX_RX_HANDLERS 8	  // Maximum number of topic receive handlers
+#define MAX_ACK_HANDLERS 2	  // Maximum number of publish acknowledgment observers
+#define MAX_RTT_SLOTS 8		  // In-flight publishes tracked for the ack RTT metric
+
+#define MAX_PRINT_LENGTH 128  // Longest payload text logged by data_print()
 
 #define MQTT_THREAD_PRIORITY 5
-#define MQTT_THREAD_STACKSIZE 4096
-K_THREAD_STACK_DEFINE(mqtt_stack, MQTT_THREAD_STACKSIZE);
+K_THREAD_STACK_DEFINE(mqtt_stack, CONFIG_MQTT_THREAD_STACK_SIZE);
 
 LOG_MODULE_REGISTER(MQTT);
 
@@ -35,16 +47,43 @@ char DEVICE_ID[DEVICE_ID_SIZE] = {'\0'};
 
 struct k_thread mqtt_thread_data;
 static struct sockaddr_storage broker;
+static bool broker_resolved;
+static struct mqtt_client client;
+static bool connected;
+static bool socket_open; /* From mqtt_connect() until MQTT_EVT_DISCONNECT */
+static bool reconnect_now;
+
+struct mqtt_rx_handler
+{
+	const char *topic;
+	mqtt_rx_cb_t cb;
+};
+
+static struct mqtt_rx_handler rx_handlers[MAX_RX_HANDLERS];
+static mqtt_ack_cb_t ack_handlers[MAX_ACK_HANDLERS];
+static atomic_t last_message_id;
+
+/* Publish timestamps for the ack RTT histogram, oldest entry is overwritten. */
+struct mqtt_rtt_slot
+{
+	uint16_t message_id;
+	uint32_t start_ms;
+};
 
-static uint8_t rx_buffer[CONFIG_MQTT_MESSAGE_BUFFER_SIZE];
-static uint8_t tx_buffer[CONFIG_MQTT_MESSAGE_BUFFER_SIZE];
-static uint8_t payload_buf[CONFIG_MQTT_PAYLOAD_BUFFER_SIZE];
+static struct mqtt_rtt_slot rtt_slots[MAX_RTT_SLOTS];
+static uint8_t rtt_next;
+static struct k_spinlock rtt_lock;
+static uint32_t connect_start_ms;
+static sec_tag_t sec_tag_list[] = {CONFIG_MQTT_TLS_SEC_TAG};
 
-char SUBSCRIBE_TOPICS[MAX_TOPICS][MAX_TOPICS_LENGTH];
-char PUBLISH_TOPICS[MAX_TOPICS][MAX_TOPICS_LENGTH];
+/* Client buffers, topic strings and received payloads live in the MQTT arena. */
+static uint8_t *rx_buffer;
+static uint8_t *tx_buffer;
 
-uint8_t NUM_SUBSCRIBE_TOPICS = 0;
-uint8_t NUM_PUBLISH_TOPICS = 0;
+/* Receive staging while the arena is busy, and scratch for discarding a payload.
+ * Used on the MQTT thread only.
+ */
+static uint8_t rx_fallback[CONFIG_MQTT_RX_FALLBACK_SIZE + 1];
 
 bool CONNECT_MQTT = true;
 bool RECONNECT_MQTT = true;
@@ -54,7 +93,8 @@ bool DISCONNECT_MQTT = false;
 Function : mqtt_create_topic_subscribe
 
 Description : Creates and stores a new MQTT topic string for subscribing. It formats the
-			  string with the given arguments and saves it to the subscribe list.
+			  string with the given arguments and saves it to the subscribe list with
+			  QoS 1.
 
 Parameter :
 - topic_name : Optional output buffer to receive the formatted topic.
@@ -69,26 +109,23 @@ Example Call :
 void mqtt_create_topic_subscribe(char *topic_name,
 								 const char *format, ...)
 {
+	char topic[MAX_TOPICS_LENGTH];
+	va_list args;
+	va_start(args, format);
 
-	if (NUM_SUBSCRIBE_TOPICS >= MAX_TOPICS)
+	vsnprintf(topic, sizeof(topic), format, args);
+
+	va_end(args);
+
+	if (mqtt_topics_add_subscribe(topic, MQTT_QOS_1_AT_LEAST_ONCE) == -ENOMEM)
 	{
-		LOG_ERR("Maximum number of SUBSCRIBE topics reached\n");
 		return;
 	}
-	va_list args;
-	va_start(args, format);
-
-	vsnprintf(SUBSCRIBE_TOPICS[NUM_SUBSCRIBE_TOPICS], MAX_TOPICS_LENGTH, format, args);
 
 	if (topic_name != NULL)
 	{
-		strncpy(topic_name, SUBSCRIBE_TOPICS[NUM_SUBSCRIBE_TOPICS], MAX_TOPICS_LENGTH);
+		strncpy(topic_name, topic, MAX_TOPICS_LENGTH);
 	}
-	va_end(args);
-
-	LOG_DBG("Subscribe topic added: %s", SUBSCRIBE_TOPICS[NUM_SUBSCRIBE_TOPICS]);
-
-	NUM_SUBSCRIBE_TOPICS++;
 }
 
 /*
@@ -110,89 +147,197 @@ Example Call :
 void mqtt_create_topic_publish(char *topic_name,
 							   const char *format, ...)
 {
-	if (NUM_PUBLISH_TOPICS >= MAX_TOPICS)
-	{
-		LOG_ERR("Maximum number of SUBSCRIBE topics reached\n");
-		return;
-	}
+	char topic[MAX_TOPICS_LENGTH];
 	va_list args;
 	va_start(args, format);
 
-	vsnprintf(PUBLISH_TOPICS[NUM_PUBLISH_TOPICS], MAX_TOPICS_LENGTH, format, args);
+	vsnprintf(topic, sizeof(topic), format, args);
+
+	va_end(args);
+
+	if (mqtt_topics_add_publish(topic) != 0)
+	{
+		return;
+	}
 
 	if (topic_name != NULL)
 	{
-		strncpy(topic_name, PUBLISH_TOPICS[NUM_PUBLISH_TOPICS], MAX_TOPICS_LENGTH);
+		strncpy(topic_name, topic, MAX_TOPICS_LENGTH);
 	}
+}
 
-	va_end(args);
+/*
+Function : mqtt_client_get
+
+Description : Returns the MQTT client, used by the topic registry to send batched
+			  SUBSCRIBE/UNSUBSCRIBE packets.
+
+Parameter : void
 
-	LOG_DBG("Publish topic added: %s", PUBLISH_TOPICS[NUM_PUBLISH_TOPICS]);
+Return :
+Pointer to the client.
 
-	NUM_PUBLISH_TOPICS++;
+Example Call :
+				mqtt_subscribe(mqtt_client_get(), &list);
+*/
+struct mqtt_client *mqtt_client_get(void)
+{
+	return &client;
 }
 
 /*
-Function : subscribe
+Function : data_print
 
-Description : Subscribes to all topics in the subscribe list using the MQTT client.
+Description : Prints received or published data to the logs with a prefix.
 
 Parameter :
-- c : Pointer to the MQTT client structure.
+- prefix : Text to prefix before the data.
+- data : The actual data buffer.
+- len : Length of the data.
 
-Return :
-0 on success, or negative error code on failure.
+Return : void
 
 Example Call :
-				subscribe(&client);
+				data_print("Received: ", payload, length);
 */
-static int subscribe(struct mqtt_client *const c)
+static void data_print(uint8_t *prefix,
+					   uint8_t *data,
+					   size_t len)
+{
+	char buf[MAX_PRINT_LENGTH + 1];
+	size_t n = MIN(len, MAX_PRINT_LENGTH);
+
+	memcpy(buf, data, n);
+	buf[n] = 0;
+	LOG_INF("%s%s%s", (char *)prefix, (char *)buf, (n < len) ? "..." : "");
+}
+
+static void rtt_start(uint16_t message_id)
 {
-	struct mqtt_topic subscribe_topics[NUM_SUBSCRIBE_TOPICS];
+	k_spinlock_key_t key = k_spin_lock(&rtt_lock);
 
-	for (int i = 0; i < NUM_SUBSCRIBE_TOPICS; i++)
+	rtt_slots[rtt_next].message_id = message_id;
+	rtt_slots[rtt_next].start_ms = k_uptime_get_32();
+	rtt_next = (rtt_next + 1) % MAX_RTT_SLOTS;
+
+	k_spin_unlock(&rtt_lock, key);
+}
+
+/* Returns the RTT in ms, or -1 if the publish was not tracked. */
+static int64_t rtt_stop(uint16_t message_id)
+{
+	int64_t rtt = -1;
+	k_spinlock_key_t key = k_spin_lock(&rtt_lock);
+
+	for (int i = 0; i < MAX_RTT_SLOTS; i++)
 	{
-		subscribe_topics[i].topic.utf8 = SUBSCRIBE_TOPICS[i];
-		subscribe_topics[i].topic.size = strlen(SUBSCRIBE_TOPICS[i]);
-		subscribe_topics[i].qos = MQTT_QOS_1_AT_LEAST_ONCE;
+		if (rtt_slots[i].message_id == message_id)
+		{
+			rtt = k_uptime_get_32() - rtt_slots[i].start_ms;
+			rtt_slots[i].message_id = 0;
+			break;
+		}
+	}
+
+	k_spin_unlock(&rtt_lock, key);
+
+	return rtt;
+}
+
+/*
+Function : mqtt_publish_begin
+
+Description : Checks the rate limiter for a publish about to be written and, for
+			  QoS 1 and 2, records the send time before anything is sent, so the
+			  acknowledgment handled on the MQTT thread always finds it. Every
+			  successful call is followed by mqtt_publish_end().
 
-		LOG_INF("Subscribing to: %s len %u", SUBSCRIBE_TOPICS[i],
-				(unsigned int)strlen(SUBSCRIBE_TOPICS[i]));
+Parameter :
+- param : Publish parameters with the packet identifier and payload length set.
+
+Return :
+0 if the publish may be sent, -EAGAIN above the rate limit (see mqtt_rate_wait_ms()).
+
+Example Call :
+				err = mqtt_publish_begin(&param);
+*/
+int mqtt_publish_begin(const struct mqtt_publish_param *param)
+{
+	if (mqtt_rate_take(param->message.topic.topic.size + param->message.payload.len) > 0)
+	{
+		metrics_inc(METRIC_MQTT_RATE_LIMITED);
+		return -EAGAIN;
 	}
 
-	const struct mqtt_subscription_list subscription_list = {
-		.list = subscribe_topics,
-		.list_count = NUM_SUBSCRIBE_TOPICS,
-		.message_id = sys_rand32_get(),
-	};
+	if (param->message.topic.qos != MQTT_QOS_0_AT_MOST_ONCE)
+	{
+		rtt_start(param->message_id);
+	}
 
-	return mqtt_subscribe(c, &subscription_list);
+	return 0;
 }
 
 /*
-Function : data_print
+Function : mqtt_publish_end
 
-Description : Prints received or published data to the logs with a prefix.
+Description : Updates the publish counters, airtime and data usage after a publish
+			  was written, or drops its RTT slot if it failed.
 
 Parameter :
-- prefix : Text to prefix before the data.
-- data : The actual data buffer.
-- len : Length of the data.
+- param : Publish parameters given to mqtt_publish_begin().
+- err : Result of the write.
 
 Return : void
 
 Example Call :
-				data_print("Received: ", payload_buf, length);
+				mqtt_publish_end(&param, err);
 */
-static void data_print(uint8_t *prefix,
-					   uint8_t *data,
-					   size_t len)
+void mqtt_publish_end(const struct mqtt_publish_param *param, int err)
 {
-	char buf[len + 1];
+	if (err)
+	{
+		metrics_inc(METRIC_MQTT_PUBLISH_ERROR);
+		rtt_stop(param->message_id);
+		return;
+	}
 
-	memcpy(buf, data, len);
-	buf[len] = 0;
-	LOG_INF("%s%s", (char *)prefix, (char *)buf);
+	metrics_inc(METRIC_MQTT_PUBLISH);
+	airtime_tx(param->message.topic.topic.utf8, param->message.topic.topic.size,
+			   param->message.payload.len);
+	data_usage_publish(param->message.topic.topic.utf8, param->message.topic.topic.size,
+					   param->message.payload.len, param->message.topic.qos);
+}
+
+/*
+Function : publish_tracked
+
+Description : Sends a publish between mqtt_publish_begin() and mqtt_publish_end().
+
+Parameter :
+- c : Pointer to the MQTT client.
+- param : Publish parameters with the packet identifier set.
+
+Return :
+Result of mqtt_publish(), or -EAGAIN above the rate limit (see mqtt_rate_wait_ms()).
+
+Example Call :
+				return publish_tracked(c, &param);
+*/
+static int publish_tracked(struct mqtt_client *c,
+						   const struct mqtt_publish_param *param)
+{
+	int err;
+
+	err = mqtt_publish_begin(param);
+	if (err)
+	{
+		return err;
+	}
+
+	err = mqtt_publish(c, param);
+	mqtt_publish_end(param, err);
+
+	return err;
 }
 
 /*
@@ -217,59 +362,370 @@ int data_publish(struct mqtt_client *c,
 				 uint8_t *data,
 				 size_t len)
 {
+	const char *topic = mqtt_topics_publish_first();
+
+	if (topic == NULL)
+	{
+		return -ENOENT;
+	}
+
+	data_print("Publishing: ", data, len);
+	LOG_INF("to topic: %s len: %u",
+			topic,
+			(unsigned int)strlen(topic));
+
+#if defined(CONFIG_MQTT_SN_TRANSPORT)
+	ARG_UNUSED(c);
+
+	return mqtt_sn_client_publish(topic, qos, data, len);
+#else
 	struct mqtt_publish_param param;
 
 	param.message.topic.qos = qos;
-	param.message.topic.topic.utf8 = PUBLISH_TOPICS[0];
-	param.message.topic.topic.size = strlen(PUBLISH_TOPICS[0]);
+	param.message.topic.topic.utf8 = topic;
+	param.message.topic.topic.size = strlen(topic);
 	param.message.payload.data = data;
 	param.message.payload.len = len;
-	param.message_id = sys_rand32_get();
+	param.message_id = mqtt_next_message_id();
 	param.dup_flag = 0;
-	param.retain_flag = 0;
+	param.retain_flag = mqtt_topics_retained(topic);
 
-	data_print("Publishing: ", data, len);
-	LOG_INF("to topic: %s len: %u",
-			PUBLISH_TOPICS[0],
-			(unsigned int)strlen(PUBLISH_TOPICS[0]));
+	return publish_tracked(c, &param);
+#endif
+}
+
+/*
+Function : mqtt_next_message_id
+
+Description : Returns the next MQTT packet identifier. Identifiers are sequential so
+			  that in-flight messages never collide, 0 is skipped as it is invalid.
+
+Parameter : void
+
+Return :
+Packet identifier in the range 1..65535.
+
+Example Call :
+				param.message_id = mqtt_next_message_id();
+*/
+uint16_t mqtt_next_message_id(void)
+{
+	uint16_t id;
+
+	do
+	{
+		id = (uint16_t)atomic_inc(&last_message_id) + 1;
+	} while (id == 0);
 
-	return mqtt_publish(c, &param);
+	return id;
+}
+
+static int topic_publish(const char *topic,
+						 enum mqtt_qos qos,
+						 const uint8_t *data,
+						 size_t len,
+						 uint16_t *message_id,
+						 bool dup)
+{
+#if defined(CONFIG_MQTT_SN_TRANSPORT)
+	ARG_UNUSED(dup);
+
+	if (message_id)
+	{
+		*message_id = 0;
+	}
+
+	return mqtt_sn_client_publish(topic, qos, data, len);
+#else
+	struct mqtt_publish_param param;
+
+	if (!connected)
+	{
+		return -ENOTCONN;
+	}
+
+	if (!data_usage_topic_allowed(topic))
+	{
+		return -ENOSPC;
+	}
+
+	param.message.topic.qos = qos;
+	param.message.topic.topic.utf8 = topic;
+	param.message.topic.topic.size = strlen(topic);
+	param.message.payload.data = (uint8_t *)data;
+	param.message.payload.len = len;
+	param.message_id = (message_id && *message_id) ? *message_id : mqtt_next_message_id();
+	param.dup_flag = dup;
+	param.retain_flag = mqtt_topics_retained(topic);
+
+	if (message_id)
+	{
+		*message_id = param.message_id;
+	}
+
+	LOG_DBG("Publishing %u bytes to topic: %s%s", (unsigned int)len, topic, dup ? " (DUP)" : "");
+
+	return publish_tracked(&client, &param);
+#endif
 }
 
 /*
-Function : get_received_payload
+Function : mqtt_publish_topic_id
 
-Description : Retrieves the full payload from an incoming MQTT message.
+Description : Publishes data to an arbitrary topic on the connected client and returns
+			  the packet identifier used, so the caller can match the PUBACK/PUBCOMP
+			  reported to handlers registered with mqtt_ack_handler_register().
+			  A non-zero *message_id (from mqtt_next_message_id()) is used as is, so
+			  the caller can record it before an acknowledgment can arrive.
 
 Parameter :
-- c : Pointer to the MQTT client.
-- length : Expected payload length.
+- topic : Topic string.
+- qos : Quality of Service level.
+- data : Data buffer to send.
+- len : Length of the data.
+- message_id : Optional in/out packet identifier, 0 to assign a new one.
 
 Return :
-0 on success, -EMSGSIZE if too large, or another negative error code.
+0 on success, -ENOTCONN if the client is not connected, -ENOSPC if the topic is
+dropped over the data budget, -EAGAIN above the publish rate limit, or a negative
+error code.
 
 Example Call :
-				get_received_payload(&client, evt->param.publish.payload.len);
+				uint16_t id = 0;
+				mqtt_publish_topic_id(topic, MQTT_QOS_1_AT_LEAST_ONCE, buf, len, &id);
 */
-static int get_received_payload(struct mqtt_client *c,
-								size_t length)
+int mqtt_publish_topic_id(const char *topic,
+						  enum mqtt_qos qos,
+						  const uint8_t *data,
+						  size_t len,
+						  uint16_t *message_id)
 {
-	int ret;
-	int err = 0;
+	return topic_publish(topic, qos, data, len, message_id, false);
+}
+
+/*
+Function : mqtt_publish_topic_dup
 
-	/* Return an error if the payload is larger than the payload buffer.
-	 * Note: To allow new messages, we have to read the payload before returning.
-	 */
-	if (length > sizeof(payload_buf))
+Description : Publishes a QoS 1 or 2 message again after a reconnect, with the DUP
+			  flag and the packet identifier of its first transmission, so the
+			  broker can recognise the retry. Used by the outbox.
+
+Parameter :
+- topic : Topic string.
+- qos : Quality of Service level.
+- data : Data buffer to send.
+- len : Length of the data.
+- message_id : Packet identifier of the first transmission.
+
+Return :
+Same as mqtt_publish_topic_id().
+
+Example Call :
+				mqtt_publish_topic_dup(topic, msg->qos, payload, len, msg->message_id);
+*/
+int mqtt_publish_topic_dup(const char *topic,
+						   enum mqtt_qos qos,
+						   const uint8_t *data,
+						   size_t len,
+						   uint16_t message_id)
+{
+	return topic_publish(topic, qos, data, len, &message_id, true);
+}
+
+/*
+Function : mqtt_publish_topic
+
+Description : Publishes data to an arbitrary topic on the connected client.
+
+Parameter :
+- topic : Topic string.
+- qos : Quality of Service level.
+- data : Data buffer to send.
+- len : Length of the data.
+
+Return :
+0 on success, -ENOTCONN if the client is not connected, or a negative error code.
+
+Example Call :
+				mqtt_publish_topic("devices/1234/status", MQTT_QOS_0_AT_MOST_ONCE, buf, len);
+*/
+int mqtt_publish_topic(const char *topic,
+					   enum mqtt_qos qos,
+					   const uint8_t *data,
+					   size_t len)
+{
+	return mqtt_publish_topic_id(topic, qos, data, len, NULL);
+}
+
+/*
+Function : mqtt_ack_handler_register
+
+Description : Registers an observer for completed QoS 1 (PUBACK) and QoS 2 (PUBCOMP)
+			  publishes. The callback runs on the MQTT thread.
+
+Parameter :
+- cb : Callback invoked with the packet identifier and the result.
+
+Return :
+0 on success, -ENOMEM if all observer slots are used.
+
+Example Call :
+				mqtt_ack_handler_register(on_ack);
+*/
+int mqtt_ack_handler_register(mqtt_ack_cb_t cb)
+{
+	for (int i = 0; i < MAX_ACK_HANDLERS; i++)
 	{
-		err = -EMSGSIZE;
+		if (ack_handlers[i] == NULL)
+		{
+			ack_handlers[i] = cb;
+			return 0;
+		}
 	}
 
-	/* Truncate payload until it fits in the payload buffer. */
-	while (length > sizeof(payload_buf))
+	return -ENOMEM;
+}
+
+static void ack_dispatch(uint16_t message_id, int result)
+{
+	int64_t rtt = rtt_stop(message_id);
+
+	mqtt_outbox_ack(message_id, result);
+
+	if (result == 0)
 	{
-		ret = mqtt_read_publish_payload_blocking(
-			c, payload_buf, (length - sizeof(payload_buf)));
+		metrics_inc(METRIC_MQTT_ACK);
+		if (rtt >= 0)
+		{
+			metrics_hist_record(METRIC_HIST_MQTT_ACK_RTT_MS, (uint32_t)rtt);
+		}
+	}
+
+	for (int i = 0; i < MAX_ACK_HANDLERS; i++)
+	{
+		if (ack_handlers[i])
+		{
+			ack_handlers[i](message_id, result);
+		}
+	}
+}
+
+/*
+Function : mqtt_is_connected
+
+Description : Returns whether the client has an accepted connection (CONNACK received).
+
+Parameter : void
+
+Return :
+true when connected.
+
+Example Call :
+				if (mqtt_is_connected()) { ... }
+*/
+bool mqtt_is_connected(void)
+{
+#if defined(CONFIG_MQTT_SN_TRANSPORT)
+	return mqtt_sn_client_connected();
+#else
+	return connected;
+#endif
+}
+
+/*
+Function : mqtt_rx_handler_register
+
+Description : Registers a callback for messages received on a topic. The topic must also
+			  be subscribed with mqtt_create_topic_subscribe(). The callback runs on the
+			  MQTT thread and the payload is only valid during the call.
+
+Parameter :
+- topic : Topic to match exactly, must stay valid.
+- cb : Callback invoked with the received payload.
+
+Return :
+0 on success, -ENOMEM if all handler slots are used.
+
+Example Call :
+				mqtt_rx_handler_register(rotate_topic, on_rotate);
+*/
+int mqtt_rx_handler_register(const char *topic, mqtt_rx_cb_t cb)
+{
+	for (int i = 0; i < MAX_RX_HANDLERS; i++)
+	{
+		if (rx_handlers[i].cb == NULL)
+		{
+			rx_handlers[i].topic = topic;
+			rx_handlers[i].cb = cb;
+			return 0;
+		}
+	}
+
+	LOG_ERR("Maximum number of RX handlers reached");
+	return -ENOMEM;
+}
+
+/*
+Function : mqtt_rx_dispatch
+
+Description : Passes a received message to the handlers registered for its topic.
+			  Also used by the MQTT-SN transport.
+
+Parameter :
+- topic : Topic of the message.
+- data : NUL terminated payload.
+- len : Payload length.
+
+Return : void
+
+Example Call :
+				mqtt_rx_dispatch(&p->message.topic.topic, payload, p->message.payload.len);
+*/
+void mqtt_rx_dispatch(const struct mqtt_utf8 *topic, const uint8_t *data, size_t len)
+{
+	for (int i = 0; i < MAX_RX_HANDLERS; i++)
+	{
+		if (rx_handlers[i].cb &&
+			strlen(rx_handlers[i].topic) == topic->size &&
+			memcmp(rx_handlers[i].topic, topic->utf8, topic->size) == 0)
+		{
+			rx_handlers[i].cb(rx_handlers[i].topic, data, len);
+		}
+	}
+}
+
+/*
+Function : mqtt_request_reconnect
+
+Description : Disconnects the client and reconnects without the reconnect delay, e.g.
+			  to pick up a new TLS security tag.
+
+Parameter : void
+
+Return : void
+
+Example Call :
+				mqtt_request_reconnect();
+*/
+void mqtt_request_reconnect(void)
+{
+	reconnect_now = true;
+	if (mqtt_is_connected())
+	{
+		DISCONNECT_MQTT = true;
+	}
+	mqtt_outbox_wake();
+}
+
+/* Reads and drops a payload so that the next message can be received. */
+static int discard_received_payload(struct mqtt_client *c, size_t length)
+{
+	int ret;
+
+	while (length > 0)
+	{
+		ret = mqtt_read_publish_payload_blocking(c, rx_fallback,
+												 MIN(length, sizeof(rx_fallback)));
 		if (ret == 0)
 		{
 			return -EIO;
@@ -282,13 +738,79 @@ static int get_received_payload(struct mqtt_client *c,
 		length -= ret;
 	}
 
-	ret = mqtt_readall_publish_payload(c, payload_buf, length);
+	return 0;
+}
+
+static void release_received_payload(uint8_t *payload)
+{
+	if (payload != rx_fallback)
+	{
+		mqtt_arena_free(payload);
+	}
+}
+
+/*
+Function : get_received_payload
+
+Description : Retrieves the full payload from an incoming MQTT message into a buffer
+			  taken from the MQTT arena at the exact payload length. While the arena is
+			  busy, payloads of up to CONFIG_MQTT_RX_FALLBACK_SIZE bytes are staged in a
+			  static fallback buffer instead. The buffer is only valid until the receive
+			  handlers return and is released with release_received_payload(). Payloads
+			  that cannot be staged are read and discarded so the next message can be
+			  received.
+
+Parameter :
+- c : Pointer to the MQTT client.
+- length : Expected payload length.
+- payload : Receives the payload buffer, NULL on error.
+
+Return :
+0 on success, -EMSGSIZE if larger than CONFIG_MQTT_PAYLOAD_BUFFER_SIZE, -ENOMEM if
+the arena is busy and the payload does not fit the fallback, or another negative
+error code.
+
+Example Call :
+				get_received_payload(&client, evt->param.publish.payload.len, &payload);
+*/
+static int get_received_payload(struct mqtt_client *c,
+								size_t length,
+								uint8_t **payload)
+{
+	uint8_t *buf;
+	int ret;
+
+	*payload = NULL;
+
+	if (length > CONFIG_MQTT_PAYLOAD_BUFFER_SIZE)
+	{
+		ret = discard_received_payload(c, length);
+		return ret ? ret : -EMSGSIZE;
+	}
+
+	/* One extra byte so that text payloads can be terminated. */
+	buf = mqtt_arena_alloc(length + 1);
+	if (buf == NULL)
+	{
+		if (length > CONFIG_MQTT_RX_FALLBACK_SIZE)
+		{
+			ret = discard_received_payload(c, length);
+			return ret ? ret : -ENOMEM;
+		}
+		buf = rx_fallback;
+	}
+
+	ret = mqtt_readall_publish_payload(c, buf, length);
 	if (ret)
 	{
+		release_received_payload(buf);
 		return ret;
 	}
 
-	return err;
+	buf[length] = '\0';
+	*payload = buf;
+
+	return 0;
 }
 
 /*
@@ -309,6 +831,7 @@ Example Call :
 static void mqtt_evt_handler(struct mqtt_client *const c,
 							 const struct mqtt_evt *evt)
 {
+	uint32_t prof_start = profiling_start();
 	int err;
 
 	switch (evt->type)
@@ -317,14 +840,36 @@ static void mqtt_evt_handler(struct mqtt_client *const c,
 		if (evt->result != 0)
 		{
 			LOG_ERR("MQTT connect failed: %d", evt->result);
+			cred_rotate_on_connect_result(evt->result);
 			break;
 		}
 
 		LOG_INF("MQTT client connected");
-		subscribe(c);
+		connected = true;
+		metrics_hist_record(METRIC_HIST_MQTT_CONNECT_MS,
+							k_uptime_get_32() - connect_start_ms);
+		boot_stage_end(BOOT_STAGE_MQTT_CONNECT, 0);
+		mqtt_topics_resubscribe(c);
+		mqtt_outbox_on_connect();
+		mqtt_presence_online();
+		shadow_on_connect();
+		cred_rotate_on_connect_result(0);
 		break;
 
 	case MQTT_EVT_DISCONNECT:
+		if (!connected)
+		{
+			/* Dropped before CONNACK, e.g. TLS handshake rejected. */
+			cred_rotate_on_connect_result(evt->result ? evt->result : -ECONNREFUSED);
+		}
+		else if (!DISCONNECT_MQTT)
+		{
+			/* Dropped by the broker, possibly for exceeding its limits. */
+			mqtt_rate_on_disconnect();
+		}
+		connected = false;
+		socket_open = false;
+
 		if (RECONNECT_MQTT)
 		{
 			LOG_INF("MQTT client disconnected Unexpectedly Reconnecting: %d", evt->result);
@@ -339,11 +884,16 @@ static void mqtt_evt_handler(struct mqtt_client *const c,
 	case MQTT_EVT_PUBLISH:
 	{
 		const struct mqtt_publish_param *p = &evt->param.publish;
+		uint8_t *payload;
 
 		LOG_INF("MQTT PUBLISH result=%d len=%d  TOPIC: %s",
 				evt->result, p->message.payload.len, p->message.topic.topic.utf8);
 
-		err = get_received_payload(c, p->message.payload.len);
+		err = get_received_payload(c, p->message.payload.len, &payload);
+		airtime_rx(p->message.topic.topic.utf8, p->message.topic.topic.size,
+				   p->message.payload.len);
+		data_usage_publish(p->message.topic.topic.utf8, p->message.topic.topic.size,
+						   p->message.payload.len, p->message.topic.qos);
 
 		if (p->message.topic.qos == MQTT_QOS_1_AT_LEAST_ONCE)
 		{
@@ -352,16 +902,30 @@ static void mqtt_evt_handler(struct mqtt_client *const c,
 
 			mqtt_publish_qos1_ack(c, &ack); /* Send acknowledgment. */
 		}
+		else if (p->message.topic.qos == MQTT_QOS_2_EXACTLY_ONCE)
+		{
+			const struct mqtt_pubrec_param rec = {
+				.message_id = p->message_id};
+
+			mqtt_publish_qos2_receive(c, &rec); /* First step of the QoS 2 handshake. */
+		}
 
 		if (err >= 0)
 		{
-			data_print("Received: ", payload_buf, p->message.payload.len);
+			data_print("Received: ", payload, p->message.payload.len);
+			mqtt_rx_dispatch(&p->message.topic.topic, payload, p->message.payload.len);
+			release_received_payload(payload);
 		}
 		else if (err == -EMSGSIZE)
 		{
-			LOG_ERR("Received payload (%d bytes) is larger than the payload buffer "
-					"size (%d bytes).",
-					p->message.payload.len, sizeof(payload_buf));
+			metrics_inc(METRIC_MQTT_RX_TRUNCATED);
+			LOG_ERR("Received payload (%d bytes) dropped, larger than the payload limit (%d bytes).",
+					p->message.payload.len, CONFIG_MQTT_PAYLOAD_BUFFER_SIZE);
+		}
+		else if (err == -ENOMEM)
+		{
+			metrics_inc(METRIC_MQTT_RX_TRUNCATED);
+			LOG_ERR("Received payload (%d bytes) dropped, arena busy.", p->message.payload.len);
 		}
 		else
 		{
@@ -381,10 +945,59 @@ static void mqtt_evt_handler(struct mqtt_client *const c,
 		if (evt->result != 0)
 		{
 			LOG_ERR("MQTT PUBACK error: %d", evt->result);
+		}
+		else
+		{
+			LOG_INF("PUBACK packet id: %u", evt->param.puback.message_id);
+		}
+
+		/* Failures are dispatched too, so waiters see them instead of timing out. */
+		ack_dispatch(evt->param.puback.message_id, evt->result);
+		break;
+
+	case MQTT_EVT_PUBREC:
+	{
+		/* Outgoing QoS 2: release the message. */
+		const struct mqtt_pubrel_param rel = {
+			.message_id = evt->param.pubrec.message_id};
+
+		if (evt->result != 0)
+		{
+			LOG_ERR("MQTT PUBREC error: %d", evt->result);
+			ack_dispatch(evt->param.pubrec.message_id, evt->result);
 			break;
 		}
 
-		LOG_INF("PUBACK packet id: %u", evt->param.puback.message_id);
+		err = mqtt_publish_qos2_release(c, &rel);
+		if (err)
+		{
+			LOG_ERR("Failed to send PUBREL: %d", err);
+		}
+	}
+	break;
+
+	case MQTT_EVT_PUBREL:
+	{
+		/* Incoming QoS 2: complete the handshake. */
+		const struct mqtt_pubcomp_param comp = {
+			.message_id = evt->param.pubrel.message_id};
+
+		err = mqtt_publish_qos2_complete(c, &comp);
+		if (err)
+		{
+			LOG_ERR("Failed to send PUBCOMP: %d", err);
+		}
+	}
+	break;
+
+	case MQTT_EVT_PUBCOMP:
+		if (evt->result != 0)
+		{
+			LOG_ERR("MQTT PUBCOMP error: %d", evt->result);
+		}
+
+		LOG_DBG("PUBCOMP packet id: %u", evt->param.pubcomp.message_id);
+		ack_dispatch(evt->param.pubcomp.message_id, evt->result);
 		break;
 
 	case MQTT_EVT_SUBACK:
@@ -395,19 +1008,43 @@ static void mqtt_evt_handler(struct mqtt_client *const c,
 		}
 
 		LOG_INF("SUBACK packet id: %u", evt->param.suback.message_id);
+
+		for (uint32_t i = 0; i < evt->param.suback.return_codes.len; i++)
+		{
+			if (evt->param.suback.return_codes.data[i] == MQTT_SUBACK_FAILURE)
+			{
+				LOG_ERR("Broker rejected topic %u of SUBACK packet id %u", i,
+						evt->param.suback.message_id);
+			}
+		}
+		break;
+
+	case MQTT_EVT_UNSUBACK:
+		if (evt->result != 0)
+		{
+			LOG_ERR("MQTT UNSUBACK error: %d", evt->result);
+			break;
+		}
+
+		LOG_INF("UNSUBACK packet id: %u", evt->param.unsuback.message_id);
 		break;
 
 	case MQTT_EVT_PINGRESP:
 		if (evt->result != 0)
 		{
 			LOG_ERR("MQTT PINGRESP error: %d", evt->result);
+			break;
 		}
+
+		data_usage_control(4, 2); /* PINGREQ and PINGRESP */
 		break;
 
 	default:
 		LOG_INF("Unhandled MQTT event type: %d", evt->type);
 		break;
 	}
+
+	profiling_evt_end(evt->type, prof_start);
 }
 
 /*
@@ -432,11 +1069,19 @@ static int fds_init(struct mqtt_client *c,
 	{
 		fds->fd = c->transport.tcp.sock;
 	}
+#if defined(CONFIG_MQTT_COALESCE)
+	else if (c->transport.type == MQTT_TRANSPORT_CUSTOM)
+	{
+		fds->fd = mqtt_coalesce_socket();
+	}
+#endif
+#if defined(CONFIG_MQTT_LIB_TLS)
 	else
 	{
 
 		fds->fd = c->transport.tls.sock;
 	}
+#endif
 
 	fds->events = POLLIN;
 
@@ -520,7 +1165,9 @@ static int broker_init(void)
 /*
 Function : client_init
 
-Description : Initializes the MQTT client structure and TLS configuration.
+Description : Initializes the MQTT client structure and TLS configuration. It does not
+			  touch the network, so it can run while LTE is still attaching. The broker
+			  address is resolved later by mqtt_connect_fds().
 
 Parameter : 
 - client : Pointer to the MQTT client.
@@ -533,17 +1180,10 @@ Example Call :
 */
 int client_init(struct mqtt_client *client)
 {
-	int err;
+	int err = 0;
 
 	mqtt_client_init(client);
 
-	err = broker_init();
-	if (err)
-	{
-		LOG_ERR("Failed to initialize broker connection");
-		return err;
-	}
-
 	client->broker = &broker;
 	client->evt_cb = mqtt_evt_handler;
 	client->client_id.utf8 = DEVICE_ID;
@@ -552,25 +1192,55 @@ int client_init(struct mqtt_client *client)
 	client->user_name = NULL;
 	client->protocol_version = MQTT_VERSION_3_1_1;
 
+	if (rx_buffer == NULL)
+	{
+		rx_buffer = mqtt_arena_alloc(CONFIG_MQTT_MESSAGE_BUFFER_SIZE);
+		tx_buffer = mqtt_arena_alloc(CONFIG_MQTT_MESSAGE_BUFFER_SIZE);
+		if (rx_buffer == NULL || tx_buffer == NULL)
+		{
+			LOG_ERR("No arena memory for the client buffers");
+			return -ENOMEM;
+		}
+	}
+
 	client->rx_buf = rx_buffer;
-	client->rx_buf_size = sizeof(rx_buffer);
+	client->rx_buf_size = CONFIG_MQTT_MESSAGE_BUFFER_SIZE;
 	client->tx_buf = tx_buffer;
-	client->tx_buf_size = sizeof(tx_buffer);
+	client->tx_buf_size = CONFIG_MQTT_MESSAGE_BUFFER_SIZE;
+
+#if defined(CONFIG_MQTT_LIB_TLS)
+	if (!IS_ENABLED(CONFIG_MQTT_BROKER_TLS))
+#endif
+	{
+		/* Plain TCP, e.g. the host build against a local broker. */
+		LOG_WRN("TLS disabled");
+		client->transport.type = MQTT_TRANSPORT_NON_SECURE;
+	}
+#if defined(CONFIG_MQTT_LIB_TLS)
+	else
+	{
+		struct mqtt_sec_config *tls_cfg = &(client->transport).tls.config;
 
-	struct mqtt_sec_config *tls_cfg = &(client->transport).tls.config;
-	static sec_tag_t sec_tag_list[] = {CONFIG_MQTT_TLS_SEC_TAG};
+		LOG_INF("TLS enabled");
+		client->transport.type = MQTT_TRANSPORT_SECURE;
 
-	LOG_INF("TLS enabled");
-	client->transport.type = MQTT_TRANSPORT_SECURE;
+		tls_cfg->peer_verify = CONFIG_MQTT_TLS_PEER_VERIFY;
+		tls_cfg->cipher_list = NULL;
+		tls_cfg->cipher_count = 0;
+		tls_cfg->sec_tag_count = ARRAY_SIZE(sec_tag_list);
+		tls_cfg->sec_tag_list = sec_tag_list;
+		tls_cfg->hostname = CONFIG_MQTT_BROKER_HOSTNAME;
 
-	tls_cfg->peer_verify = CONFIG_MQTT_TLS_PEER_VERIFY;
-	tls_cfg->cipher_list = NULL;
-	tls_cfg->cipher_count = 0;
-	tls_cfg->sec_tag_count = ARRAY_SIZE(sec_tag_list);
-	tls_cfg->sec_tag_list = sec_tag_list;
-	tls_cfg->hostname = CONFIG_MQTT_BROKER_HOSTNAME;
+		tls_cfg->session_cache = IS_ENABLED(CONFIG_MQTT_TLS_SESSION_CACHING) ? TLS_SESSION_CACHE_ENABLED : TLS_SESSION_CACHE_DISABLED;
+	}
+#endif
 
-	tls_cfg->session_cache = IS_ENABLED(CONFIG_MQTT_TLS_SESSION_CACHING) ? TLS_SESSION_CACHE_ENABLED : TLS_SESSION_CACHE_DISABLED;
+	mqtt_presence_will_set(client);
+
+#if defined(CONFIG_MQTT_COALESCE)
+	/* Same TCP or TLS socket, opened by the coalescing transport (mqtt_coalesce.c). */
+	client->transport.type = MQTT_TRANSPORT_CUSTOM;
+#endif
 
 	return err;
 }
@@ -578,7 +1248,10 @@ int client_init(struct mqtt_client *client)
 /*
 Function : mqtt_handle_disconnect
 
-Description : Gracefully disconnects the MQTT client.
+Description : Gracefully disconnects the MQTT client. The retained offline status is
+			  published first, as the broker discards the will on DISCONNECT. If it
+			  cannot be sent, the connection is aborted instead so the will is
+			  published by the broker.
 
 Parameter : 
 - client : Pointer to the MQTT client.
@@ -590,8 +1263,18 @@ Example Call :
 */
 static void mqtt_handle_disconnect(struct mqtt_client *client)
 {
+	int err;
+
 	LOG_INF("Disconnecting MQTT client");
-	int err = mqtt_disconnect(client);
+
+	if (IS_ENABLED(CONFIG_MQTT_PRESENCE) && connected && mqtt_presence_offline() != 0)
+	{
+		LOG_WRN("Offline status not sent, aborting so the will is published");
+		mqtt_abort(client);
+		return;
+	}
+
+	err = mqtt_disconnect(client);
 	if (err)
 	{
 		LOG_ERR("Could not disconnect MQTT client: %d", err);
@@ -602,54 +1285,99 @@ static void mqtt_handle_disconnect(struct mqtt_client *client)
 /*
 Function : mqtt_poll_events
 
-Description : Polls MQTT events, manages keepalive, and handles input.
+Description : Polls the broker socket and the outbox wakeup eventfd, manages
+			  keepalive, and handles input. The timeout is the keepalive, outbox or
+			  coalescing deadline, a queued message or reconnect request ends the
+			  poll early.
+			  Without a socket only a wakeup ends it.
 
 Parameter : 
 - client : Pointer to the MQTT client.
-- fds : Pointer to pollfd struct.
+- fds : Broker socket and outbox eventfd.
 
 Return : void
 
 Example Call : 
-				mqtt_poll_events(&client, &fds);
+				mqtt_poll_events(&client, fds);
 */
 static void mqtt_poll_events(struct mqtt_client *client,
 							 struct pollfd *fds)
 {
 	int err;
-	err = poll(fds, 1, mqtt_keepalive_time_left(client));
+	int timeout_ms;
+	uint32_t wake_cycles;
+
+	if (socket_open)
+	{
+		timeout_ms = mqtt_outbox_poll_timeout(mqtt_keepalive_time_left(client));
+		timeout_ms = mqtt_coalesce_poll_timeout(timeout_ms);
+	}
+	else
+	{
+		fds[0].fd = -1;
+		timeout_ms = fds[1].fd >= 0 ? -1 : CONFIG_MQTT_RECONNECT_DELAY_S * MSEC_PER_SEC;
+	}
+
+	err = poll(fds, 2, timeout_ms);
 	if (err < 0)
 	{
 		LOG_ERR("Error in poll(): %d", errno);
+		metrics_inc(METRIC_MQTT_POLL_ERROR);
 		return;
 	}
 
+	if ((fds[1].revents & POLLIN) == POLLIN)
+	{
+		mqtt_outbox_wake_clear();
+	}
+
+	if (!socket_open)
+	{
+		return;
+	}
+
+	/* Packets gathered for a coalesced send go out at their deadline. */
+	mqtt_coalesce_process(client);
+
+	wake_cycles = k_cycle_get_32();
+
 	err = mqtt_live(client);
+	profiling_section_end(PROFILING_MQTT_LIVE, wake_cycles);
 	if ((err != 0) && (err != -EAGAIN))
 	{
 		LOG_ERR("Error in mqtt_live: %d", err);
+		metrics_inc(METRIC_MQTT_POLL_ERROR);
 		return;
 	}
 
-	if ((fds->revents & POLLIN) == POLLIN)
+	if ((fds[0].revents & POLLIN) == POLLIN)
 	{
+		uint32_t input_start = profiling_start();
+
 		err = mqtt_input(client);
+		profiling_section_end(PROFILING_MQTT_INPUT, input_start);
 		if (err != 0)
 		{
 			LOG_ERR("Error in mqtt_input: %d", err);
+			metrics_inc(METRIC_MQTT_POLL_ERROR);
 			return;
 		}
+
+		metrics_hist_record(METRIC_HIST_MQTT_POLL_WAKE_US,
+							k_cyc_to_us_floor32(k_cycle_get_32() - wake_cycles));
 	}
 
-	if ((fds->revents & POLLERR) == POLLERR)
+	if ((fds[0].revents & POLLERR) == POLLERR)
 	{
 		LOG_ERR("POLLERR");
+		metrics_inc(METRIC_MQTT_POLL_ERROR);
 		return;
 	}
 
-	if ((fds->revents & POLLNVAL) == POLLNVAL)
+	if ((fds[0].revents & POLLNVAL) == POLLNVAL)
 	{
 		LOG_ERR("POLLNVAL");
+		metrics_inc(METRIC_MQTT_POLL_ERROR);
 		return;
 	}
 }
@@ -666,19 +1394,52 @@ Parameter :
 Return : void
 
 Example Call : 
-				mqtt_connect_fds(&client, &fds);
+				mqtt_connect_fds(&client, &fds[0]);
 */
 static void mqtt_connect_fds(struct mqtt_client *client,
 							 struct pollfd *fds)
 {
 	int err;
-	LOG_INF("Connection to broker using mqtt_connect");
+
+	while (lte_wait_connected(K_SECONDS(CONFIG_MQTT_LTE_WAIT_TIMEOUT_S)) != 0)
+	{
+		LOG_WRN("LTE not connected after %d s, still waiting",
+				CONFIG_MQTT_LTE_WAIT_TIMEOUT_S);
+	}
+
+	if (!broker_resolved)
+	{
+		err = broker_init();
+		if (err)
+		{
+			LOG_ERR("Failed to initialize broker connection: %d", err);
+			CONNECT_MQTT = true;
+			return;
+		}
+		broker_resolved = true;
+	}
+
+	boot_stage_begin(BOOT_STAGE_MQTT_CONNECT);
+
+	/* The tag can change between connections (credential rotation). */
+	sec_tag_list[0] = cred_rotate_sec_tag_for_connect();
+
+	LOG_INF("Connection to broker using mqtt_connect, sec tag %d", sec_tag_list[0]);
+	connect_start_ms = k_uptime_get_32();
 	err = mqtt_connect(client);
 	if (err)
 	{
 		LOG_ERR("Error in mqtt_connect: %d", err);
+		cred_rotate_on_connect_result(err);
+		/* Resolve again on the next attempt, the broker may have moved. */
+		broker_resolved = false;
+		CONNECT_MQTT = true;
+		return;
 	}
 
+	socket_open = true;
+	data_usage_connect(client->client_id.size);
+
 	err = fds_init(client, fds);
 	if (err)
 	{
@@ -703,8 +1464,7 @@ void mqtt__thread()
 {
 	int err;
 
-	static struct pollfd fds;
-	static struct mqtt_client client;
+	static struct pollfd fds[2];
 
 	uint32_t connect_attempt = 0;
 
@@ -715,30 +1475,56 @@ void mqtt__thread()
 		return;
 	}
 
+	fds[0].fd = -1;
+	fds[1].fd = mqtt_outbox_wake_fd();
+	fds[1].events = POLLIN;
+	if (fds[1].fd < 0)
+	{
+		LOG_ERR("No outbox wakeup, queued messages wait for the next poll timeout");
+	}
+
 	while (1)
 	{
 		if (CONNECT_MQTT == true)
 		{
-			if (connect_attempt++ > 0)
+			if (connect_attempt > 0)
+			{
+				metrics_inc(METRIC_MQTT_RECONNECT);
+			}
+
+			if (reconnect_now)
+			{
+				reconnect_now = false;
+			}
+			else if (connect_attempt++ > 0)
 			{
 				LOG_INF("Reconnecting in %d seconds...",
 						CONFIG_MQTT_RECONNECT_DELAY_S);
 				k_sleep(K_SECONDS(CONFIG_MQTT_RECONNECT_DELAY_S));
 			}
 
-			mqtt_connect_fds(&client, &fds);
-
 			CONNECT_MQTT = false;
+
+			mqtt_connect_fds(&client, &fds[0]);
+			if (CONNECT_MQTT)
+			{
+				continue;
+			}
 		}
 
-		mqtt_poll_events(&client, &fds);
+		mqtt_poll_events(&client, fds);
+
+		/* Queued messages go out between input handling, in priority order. */
+		if (connected)
+		{
+			mqtt_outbox_drain();
+		}
 
 		if (DISCONNECT_MQTT)
 		{
 			mqtt_handle_disconnect(&client);
 			DISCONNECT_MQTT = false;
 		}
-		k_msleep(100);
 	}
 }
 
@@ -756,8 +1542,12 @@ Example Call :
 */
 void MQTT_configure(void)
 {
-
-	k_thread_create(&mqtt_thread_data, mqtt_stack, MQTT_THREAD_STACKSIZE,
+#if defined(CONFIG_MQTT_SN_TRANSPORT)
+	mqtt_sn_client_start();
+#else
+	k_thread_create(&mqtt_thread_data, mqtt_stack, K_THREAD_STACK_SIZEOF(mqtt_stack),
 					(k_thread_entry_t)mqtt__thread, NULL, NULL, NULL,
 					MQTT_THREAD_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&mqtt_thread_data, "mqtt");
+#endif
 }
\ No newline at end of file
@@ -20,6 +20,29 @@ extern bool CONNECT_MQTT;
 extern bool RECONNECT_MQTT;
 extern bool DISCONNECT_MQTT;
 
+/* Receive callback for mqtt_rx_handler_register(), runs on the MQTT thread.
+ * data is NUL terminated and only valid during the call.
+ */
+typedef void (*mqtt_rx_cb_t)(const char *topic, const uint8_t *data, size_t len);
+
+/* Publish completion callback (PUBACK for QoS 1, PUBCOMP for QoS 2). */
+typedef void (*mqtt_ack_cb_t)(uint16_t message_id, int result);
+
+/* Payload source of a streamed publish: fills buf with up to len bytes from offset
+ * and returns the number of bytes, or a negative error code.
+ */
+typedef int (*mqtt_stream_read_cb_t)(void *ctx, size_t offset, uint8_t *buf, size_t len);
+
+/* Outbox priority classes, see mqtt_outbox_publish(). */
+enum mqtt_prio
+{
+	MQTT_PRIO_CRITICAL,	 /* Alarms and security events */
+	MQTT_PRIO_COMMAND,	 /* Responses to commands from the cloud */
+	MQTT_PRIO_TELEMETRY, /* Periodic data */
+	MQTT_PRIO_BULK,		 /* Large deferrable transfers, sent in chunks */
+	MQTT_PRIO_COUNT
+};
+
 void MQTT_configure(void);
 
 int data_publish(struct mqtt_client *c, enum mqtt_qos qos,
@@ -28,4 +51,33 @@ int data_publish(struct mqtt_client *c, enum mqtt_qos qos,
 void mqtt_create_topic_subscribe(char *topic_name, const char *format, ...); // void mqtt_create_topic_subscribe(const char *format, ...);
 void mqtt_create_topic_publish(char *topic_name, const char *format, ...);
 
+uint16_t mqtt_next_message_id(void);
+int mqtt_publish_topic(const char *topic, enum mqtt_qos qos,
+					   const uint8_t *data, size_t len);
+int mqtt_publish_topic_id(const char *topic, enum mqtt_qos qos,
+						  const uint8_t *data, size_t len, uint16_t *message_id);
+/* Queued publish, sent by the MQTT thread in priority order. */
+int mqtt_outbox_publish(enum mqtt_prio prio, const char *topic, enum mqtt_qos qos,
+						const uint8_t *data, size_t len);
+int mqtt_outbox_publish_wait(enum mqtt_prio prio, const char *topic, enum mqtt_qos qos,
+							 const uint8_t *data, size_t len, k_timeout_t timeout);
+/* One PUBLISH of total_len bytes pulled from read(), RAM use independent of the size.
+ * Holds the client lock until the last byte is sent, pings and other publishes wait.
+ */
+int mqtt_publish_stream(const char *topic, enum mqtt_qos qos, size_t total_len,
+						mqtt_stream_read_cb_t read, void *ctx, uint16_t *message_id);
+/* Publish rate limiter: direct publishes fail with -EAGAIN while it holds them. */
+int32_t mqtt_rate_wait_ms(size_t bytes);
+uint32_t mqtt_rate_pct(void);
+int mqtt_ack_handler_register(mqtt_ack_cb_t cb);
+bool mqtt_is_connected(void);
+int mqtt_rx_handler_register(const char *topic, mqtt_rx_cb_t cb);
+/* Runtime subscriptions, batched into one packet per CONFIG_MQTT_SUB_BATCH_DELAY_MS. */
+int mqtt_subscribe_topic(const char *topic, enum mqtt_qos qos);
+int mqtt_unsubscribe_topic(const char *topic);
+int mqtt_topic_get(bool publish, int index, char *buf, size_t len, uint8_t *qos);
+/* Publishes to the topic are retained by the broker. */
+int mqtt_topic_retain_set(const char *topic, bool retain);
+void mqtt_request_reconnect(void);
+
 #endif
\ No newline at end of file
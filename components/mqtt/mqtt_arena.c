@@ -0,0 +1,173 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_ARENA.c
+*/
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "mqtt_arena.h"
+
+LOG_MODULE_REGISTER(MQTT_ARENA);
+
+/* One heap for the client rx/tx buffers, topic strings, queued outbox messages,
+ * received payloads and outgoing staging, instead of a static buffer per use that
+ * is idle most of the time.
+ */
+
+/* Held for as long as the client runs. */
+#define ARENA_FIXED_SIZE                                                              \
+	(2 * CONFIG_MQTT_MESSAGE_BUFFER_SIZE +                                            \
+	 COND_CODE_1(CONFIG_MQTT_COALESCE, (CONFIG_MQTT_COALESCE_BUFFER_SIZE), (0)))
+
+/* The largest received payload, held while the receive handlers run. */
+#define ARENA_RX_SIZE (CONFIG_MQTT_PAYLOAD_BUFFER_SIZE + 1)
+
+/* The largest JSON staging buffers (airtime and metrics, about 2 KB each) plus topics and
+ * outbox messages.
+ */
+#define ARENA_HEADROOM 3072
+
+BUILD_ASSERT(CONFIG_MQTT_ARENA_SIZE >= ARENA_FIXED_SIZE + ARENA_RX_SIZE + ARENA_HEADROOM,
+			 "MQTT arena cannot hold the client buffers, a received payload and the staging headroom");
+
+K_HEAP_DEFINE(mqtt_arena, CONFIG_MQTT_ARENA_SIZE);
+
+static struct k_spinlock stats_lock;
+static size_t used;
+static size_t peak;
+static uint32_t failures;
+
+/* Allocations carry their size so that frees can be accounted without the
+ * heap runtime statistics.
+ */
+struct arena_hdr
+{
+	size_t size;
+} __aligned(sizeof(void *));
+
+/*
+Function : mqtt_arena_alloc
+
+Description : Allocates from the MQTT arena without blocking.
+
+Parameter :
+- size : Number of bytes.
+
+Return :
+Pointer to the memory, or NULL if the arena is exhausted.
+
+Example Call :
+				buf = mqtt_arena_alloc(len);
+*/
+void *mqtt_arena_alloc(size_t size)
+{
+	struct arena_hdr *hdr = k_heap_alloc(&mqtt_arena, sizeof(*hdr) + size, K_NO_WAIT);
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	if (hdr == NULL)
+	{
+		failures++;
+		k_spin_unlock(&stats_lock, key);
+		LOG_WRN("Arena exhausted, %u bytes requested, %u in use",
+				(unsigned int)size, (unsigned int)used);
+		return NULL;
+	}
+
+	hdr->size = size;
+	used += size;
+	peak = MAX(peak, used);
+
+	k_spin_unlock(&stats_lock, key);
+
+	return hdr + 1;
+}
+
+/*
+Function : mqtt_arena_free
+
+Description : Returns memory obtained from mqtt_arena_alloc(). NULL is ignored.
+
+Parameter :
+- ptr : Pointer to free.
+
+Return : void
+
+Example Call :
+				mqtt_arena_free(buf);
+*/
+void mqtt_arena_free(void *ptr)
+{
+	struct arena_hdr *hdr;
+
+	if (ptr == NULL)
+	{
+		return;
+	}
+
+	hdr = (struct arena_hdr *)ptr - 1;
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	used -= hdr->size;
+
+	k_spin_unlock(&stats_lock, key);
+
+	k_heap_free(&mqtt_arena, hdr);
+}
+
+/*
+Function : mqtt_arena_strdup
+
+Description : Copies a string into the arena at its exact length.
+
+Parameter :
+- str : String to copy.
+
+Return :
+Pointer to the copy, or NULL if the arena is exhausted.
+
+Example Call :
+				topic = mqtt_arena_strdup(buf);
+*/
+char *mqtt_arena_strdup(const char *str)
+{
+	size_t len = strlen(str) + 1;
+	char *copy = mqtt_arena_alloc(len);
+
+	if (copy)
+	{
+		memcpy(copy, str, len);
+	}
+
+	return copy;
+}
+
+/*
+Function : mqtt_arena_stats_get
+
+Description : Copies the arena size, current and peak usage and the number of failed
+			  allocations. Use the peak to size CONFIG_MQTT_ARENA_SIZE.
+
+Parameter :
+- stats : Destination.
+
+Return : void
+
+Example Call :
+				mqtt_arena_stats_get(&stats);
+*/
+void mqtt_arena_stats_get(struct mqtt_arena_stats *stats)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	stats->size = CONFIG_MQTT_ARENA_SIZE;
+	stats->used = used;
+	stats->peak = peak;
+	stats->failures = failures;
+
+	k_spin_unlock(&stats_lock, key);
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_ARENA.h
+*/
+
+#ifndef _MQTT_ARENA_H_
+#define _MQTT_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct mqtt_arena_stats
+{
+	size_t size;
+	size_t used;
+	size_t peak;
+	uint32_t failures;
+};
+
+void *mqtt_arena_alloc(size_t size);
+void mqtt_arena_free(void *ptr);
+char *mqtt_arena_strdup(const char *str);
+void mqtt_arena_stats_get(struct mqtt_arena_stats *stats);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,420 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_COALESCE.c
+*/
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/mutex.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/logging/log.h>
+#include "mqtt.h"
+#include "mqtt_arena.h"
+#include "mqtt_coalesce.h"
+#include "mqtt_outbox.h"
+#include "metrics.h"
+
+#define COALESCE_TYPE_CONNECT 0x10
+#define COALESCE_TYPE_DISCONNECT 0xE0
+#define COALESCE_IP_OVERHEAD 40	 // IPv4 and TCP headers of a segment
+#define COALESCE_TLS_OVERHEAD 29 // TLS 1.2 AES-GCM record header, explicit nonce and tag
+
+LOG_MODULE_REGISTER(MQTT_COALESCE);
+
+static int tx_sock = -1;
+static int tx_err;		  /* Error of a deadline flush, reported on the next write/read */
+static uint8_t *tx_buf;	  /* Gathered packets */
+static size_t tx_used;
+static uint32_t tx_pending; /* Packets in tx_buf */
+static atomic_t flush_at_ms; /* Uptime deadline of the gathered packets, 0 when none */
+
+/* Read by other threads through mqtt_coalesce_stats_get(). */
+static atomic_t stat_packets;
+static atomic_t stat_sends;
+static atomic_t stat_saved;
+
+static bool tls_enabled(void)
+{
+	return IS_ENABLED(CONFIG_MQTT_LIB_TLS) && IS_ENABLED(CONFIG_MQTT_BROKER_TLS);
+}
+
+static int send_all(const uint8_t *buf, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t n = send(tx_sock, buf, len, 0);
+
+		if (n < 0)
+		{
+			return -errno;
+		}
+
+		buf += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/*
+Function : mqtt_coalesce_flush
+
+Description : Sends the gathered packets with one send() and counts the framing
+			  the packets sharing it saved. The caller holds the client mutex, as
+			  the MQTT library does when it writes.
+
+Parameter :
+- c : Pointer to the MQTT client.
+
+Return :
+0 on success, or the send error.
+
+Example Call :
+				err = mqtt_coalesce_flush(c);
+*/
+int mqtt_coalesce_flush(struct mqtt_client *c)
+{
+	uint32_t shared;
+	int err;
+
+	ARG_UNUSED(c);
+
+	if (tx_used == 0 || tx_sock < 0)
+	{
+		return 0;
+	}
+
+	err = send_all(tx_buf, tx_used);
+
+	shared = tx_pending - 1;
+	atomic_inc(&stat_sends);
+	atomic_add(&stat_saved,
+			   shared * (COALESCE_IP_OVERHEAD + (tls_enabled() ? COALESCE_TLS_OVERHEAD : 0)));
+	for (uint32_t i = 0; i < shared; i++)
+	{
+		metrics_inc(METRIC_MQTT_COALESCED);
+	}
+
+	tx_used = 0;
+	tx_pending = 0;
+	atomic_clear(&flush_at_ms);
+
+	return err;
+}
+
+/*
+Function : mqtt_coalesce_poll_timeout
+
+Description : Shortens the socket poll timeout of the MQTT thread to the deadline
+			  of the gathered packets.
+
+Parameter :
+- timeout_ms : Poll timeout in milliseconds, -1 for none.
+
+Return :
+Timeout in milliseconds, -1 for none.
+
+Example Call :
+				timeout = mqtt_coalesce_poll_timeout(timeout);
+*/
+int mqtt_coalesce_poll_timeout(int timeout_ms)
+{
+	uint32_t deadline = atomic_get(&flush_at_ms);
+	int32_t left;
+
+	if (deadline == 0)
+	{
+		return timeout_ms;
+	}
+
+	left = MAX((int32_t)(deadline - k_uptime_get_32()), 0);
+
+	return (timeout_ms < 0 || left < timeout_ms) ? left : timeout_ms;
+}
+
+/*
+Function : mqtt_coalesce_process
+
+Description : Sends the gathered packets once their deadline has passed. Called on
+			  the MQTT thread after every poll, so the deadline flush does not need
+			  a work item of its own.
+
+Parameter :
+- c : Pointer to the MQTT client.
+
+Return : void
+
+Example Call :
+				mqtt_coalesce_process(&client);
+*/
+void mqtt_coalesce_process(struct mqtt_client *c)
+{
+	uint32_t deadline = atomic_get(&flush_at_ms);
+	int err;
+
+	if (deadline == 0 || (int32_t)(deadline - k_uptime_get_32()) > 0)
+	{
+		return;
+	}
+
+	sys_mutex_lock(&c->internal.mutex, K_FOREVER);
+
+	err = mqtt_coalesce_flush(c);
+	if (err)
+	{
+		/* The client is aborted on its next read or write. */
+		LOG_ERR("Coalesced send failed: %d", err);
+		tx_err = err;
+	}
+
+	sys_mutex_unlock(&c->internal.mutex);
+}
+
+/*
+Function : queue
+
+Description : Adds one packet, given as fragments, to the send buffer. Whatever is
+			  gathered is sent first when the packet does not fit, and a packet
+			  larger than the buffer is sent directly after it.
+
+Parameter :
+- c : Pointer to the MQTT client.
+- iov : Packet fragments.
+- iovcnt : Number of fragments.
+
+Return :
+0 on success, or the send error.
+
+Example Call :
+				return queue(client, &iov, 1);
+*/
+static int queue(struct mqtt_client *c, const struct iovec *iov, size_t iovcnt)
+{
+	const uint8_t *first = iov[0].iov_base;
+	size_t total = 0;
+	int err;
+
+	if (tx_err)
+	{
+		return tx_err;
+	}
+
+	for (size_t i = 0; i < iovcnt; i++)
+	{
+		total += iov[i].iov_len;
+	}
+
+	atomic_inc(&stat_packets);
+
+	if (tx_used + total > CONFIG_MQTT_COALESCE_BUFFER_SIZE)
+	{
+		err = mqtt_coalesce_flush(c);
+		if (err)
+		{
+			return err;
+		}
+	}
+
+	if (total > CONFIG_MQTT_COALESCE_BUFFER_SIZE)
+	{
+		atomic_inc(&stat_sends);
+		for (size_t i = 0; i < iovcnt; i++)
+		{
+			err = send_all(iov[i].iov_base, iov[i].iov_len);
+			if (err)
+			{
+				return err;
+			}
+		}
+
+		return 0;
+	}
+
+	for (size_t i = 0; i < iovcnt; i++)
+	{
+		memcpy(&tx_buf[tx_used], iov[i].iov_base, iov[i].iov_len);
+		tx_used += iov[i].iov_len;
+	}
+	tx_pending++;
+
+	if (CONFIG_MQTT_COALESCE_DELAY_MS == 0 || (first[0] & 0xF0) == COALESCE_TYPE_CONNECT ||
+		(first[0] & 0xF0) == COALESCE_TYPE_DISCONNECT)
+	{
+		return mqtt_coalesce_flush(c);
+	}
+
+	/* The deadline runs from the oldest gathered packet. The MQTT thread sends
+	 * the buffer then; a packet written by another thread wakes it to shorten
+	 * its poll.
+	 */
+	if (atomic_get(&flush_at_ms) == 0)
+	{
+		atomic_set(&flush_at_ms, MAX(k_uptime_get_32() + CONFIG_MQTT_COALESCE_DELAY_MS, 1));
+		mqtt_outbox_wake();
+	}
+
+	return 0;
+}
+
+int mqtt_client_custom_transport_connect(struct mqtt_client *client)
+{
+	const struct sockaddr *broker = client->broker;
+	socklen_t addrlen = (broker->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6)
+														: sizeof(struct sockaddr_in);
+	int sock;
+	int err;
+
+	if (tx_buf == NULL)
+	{
+		tx_buf = mqtt_arena_alloc(CONFIG_MQTT_COALESCE_BUFFER_SIZE);
+		if (tx_buf == NULL)
+		{
+			LOG_ERR("No arena memory for the coalescing buffer");
+			return -ENOMEM;
+		}
+	}
+
+	sock = socket(broker->sa_family, SOCK_STREAM,
+				  tls_enabled() ? IPPROTO_TLS_1_2 : IPPROTO_TCP);
+	if (sock < 0)
+	{
+		return -errno;
+	}
+
+#if defined(CONFIG_MQTT_LIB_TLS)
+	if (tls_enabled())
+	{
+		const struct mqtt_sec_config *tls_cfg = &client->transport.tls.config;
+		int session_cache = tls_cfg->session_cache;
+
+		if (setsockopt(sock, SOL_TLS, TLS_PEER_VERIFY, &tls_cfg->peer_verify,
+					   sizeof(tls_cfg->peer_verify)) ||
+			setsockopt(sock, SOL_TLS, TLS_SEC_TAG_LIST, tls_cfg->sec_tag_list,
+					   tls_cfg->sec_tag_count * sizeof(sec_tag_t)) ||
+			setsockopt(sock, SOL_TLS, TLS_HOSTNAME, tls_cfg->hostname,
+					   strlen(tls_cfg->hostname)) ||
+			setsockopt(sock, SOL_TLS, TLS_SESSION_CACHE, &session_cache, sizeof(session_cache)))
+		{
+			err = -errno;
+			close(sock);
+			return err;
+		}
+	}
+#endif
+
+	if (connect(sock, broker, addrlen) < 0)
+	{
+		err = -errno;
+		close(sock);
+		return err;
+	}
+
+	tx_sock = sock;
+	tx_err = 0;
+	tx_used = 0;
+	tx_pending = 0;
+	atomic_clear(&flush_at_ms);
+
+	return 0;
+}
+
+int mqtt_client_custom_transport_write(struct mqtt_client *client, const uint8_t *data,
+									   uint32_t datalen)
+{
+	struct iovec iov = {
+		.iov_base = (void *)data,
+		.iov_len = datalen,
+	};
+
+	return queue(client, &iov, 1);
+}
+
+int mqtt_client_custom_transport_write_msg(struct mqtt_client *client,
+										   const struct msghdr *message)
+{
+	return queue(client, message->msg_iov, message->msg_iovlen);
+}
+
+int mqtt_client_custom_transport_read(struct mqtt_client *client, uint8_t *data, uint32_t buflen,
+									  bool shall_block)
+{
+	ssize_t n;
+
+	if (tx_err)
+	{
+		return tx_err;
+	}
+
+	n = recv(tx_sock, data, buflen, shall_block ? 0 : MSG_DONTWAIT);
+	if (n < 0)
+	{
+		return -errno;
+	}
+
+	return n;
+}
+
+int mqtt_client_custom_transport_disconnect(struct mqtt_client *client)
+{
+	int err = 0;
+
+	if (tx_err == 0)
+	{
+		mqtt_coalesce_flush(client);
+	}
+
+	if (tx_sock >= 0 && close(tx_sock) < 0)
+	{
+		err = -errno;
+	}
+
+	tx_sock = -1;
+	tx_used = 0;
+	tx_pending = 0;
+	atomic_clear(&flush_at_ms);
+
+	return err;
+}
+
+/*
+Function : mqtt_coalesce_socket
+
+Description : Returns the socket of the connection, for polling.
+
+Parameter : void
+
+Return :
+Socket descriptor, -1 when not connected.
+
+Example Call :
+				fds->fd = mqtt_coalesce_socket();
+*/
+int mqtt_coalesce_socket(void)
+{
+	return tx_sock;
+}
+
+/*
+Function : mqtt_coalesce_stats_get
+
+Description : Returns the packets written, the sends they took and the estimated
+			  bytes saved since boot.
+
+Parameter :
+- out : Output statistics.
+
+Return : void
+
+Example Call :
+				mqtt_coalesce_stats_get(&stats);
+*/
+void mqtt_coalesce_stats_get(struct mqtt_coalesce_stats *out)
+{
+	out->packets = atomic_get(&stat_packets);
+	out->sends = atomic_get(&stat_sends);
+	out->saved = atomic_get(&stat_saved);
+}
\ No newline at end of file
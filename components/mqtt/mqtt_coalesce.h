@@ -0,0 +1,77 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_COALESCE.h
+*/
+
+#ifndef _MQTT_COALESCE_H_
+#define _MQTT_COALESCE_H_
+
+#include <stdint.h>
+#include <zephyr/net/mqtt.h>
+#include <zephyr/net/socket.h>
+
+/*
+ * Transmit coalescing of the MQTT component, a custom MQTT library transport.
+ * Packets the library writes (publishes, acks, pings, subscribes) are gathered
+ * in one CONFIG_MQTT_COALESCE_BUFFER_SIZE arena buffer and sent with a single
+ * send() once the oldest has waited CONFIG_MQTT_COALESCE_DELAY_MS, or earlier
+ * when the next packet does not fit. On the offloaded TLS socket every send()
+ * is a TLS record with its own header, nonce and tag, so packets sharing a send
+ * save that framing. CONNECT and DISCONNECT are sent right away. The deadline
+ * send runs on the MQTT thread, which shortens its poll to the deadline.
+ */
+
+struct mqtt_coalesce_stats
+{
+	uint32_t packets; /* Packets written by the library */
+	uint32_t sends;	  /* Socket sends they took */
+	uint32_t saved;	  /* Estimated TLS record and TCP/IP bytes saved */
+};
+
+#if defined(CONFIG_MQTT_COALESCE)
+
+/* Sends gathered packets now. Called with the client mutex held. */
+int mqtt_coalesce_flush(struct mqtt_client *c);
+int mqtt_coalesce_socket(void);
+/* Deadline handling on the MQTT thread, around its socket poll. */
+int mqtt_coalesce_poll_timeout(int timeout_ms);
+void mqtt_coalesce_process(struct mqtt_client *c);
+void mqtt_coalesce_stats_get(struct mqtt_coalesce_stats *stats);
+
+/* Transport of the MQTT library (CONFIG_MQTT_LIB_CUSTOM_TRANSPORTS). */
+int mqtt_client_custom_transport_connect(struct mqtt_client *client);
+int mqtt_client_custom_transport_write(struct mqtt_client *client, const uint8_t *data,
+									   uint32_t datalen);
+int mqtt_client_custom_transport_write_msg(struct mqtt_client *client,
+										   const struct msghdr *message);
+int mqtt_client_custom_transport_read(struct mqtt_client *client, uint8_t *data, uint32_t buflen,
+									  bool shall_block);
+int mqtt_client_custom_transport_disconnect(struct mqtt_client *client);
+
+#else
+
+static inline int mqtt_coalesce_flush(struct mqtt_client *c)
+{
+	return 0;
+}
+
+static inline int mqtt_coalesce_poll_timeout(int timeout_ms)
+{
+	return timeout_ms;
+}
+
+static inline void mqtt_coalesce_process(struct mqtt_client *c)
+{
+}
+
+static inline void mqtt_coalesce_stats_get(struct mqtt_coalesce_stats *stats)
+{
+	*stats = (struct mqtt_coalesce_stats){0};
+}
+
+#endif
+
+#endif
\ No newline at end of file
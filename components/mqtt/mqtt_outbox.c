@@ -0,0 +1,747 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_OUTBOX.c
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/slist.h>
+#include <zephyr/posix/sys/eventfd.h>
+#include "mqtt.h"
+#include "mqtt_arena.h"
+#include "mqtt_outbox.h"
+#include "metrics.h"
+#include "data_usage.h"
+#include "link_quality.h"
+
+#define OUTBOX_CHUNK_TOPIC_LEN 128	 // Longest "<topic>/<index>/<count>" of a chunked message
+#define OUTBOX_BULK_RECHECK_MS 1000 // Bulk hold after the link quality gate said no
+#define OUTBOX_STALL_RETRY_MS 1000	// Wait after a failed publish before the next try
+
+LOG_MODULE_REGISTER(MQTT_OUTBOX);
+
+struct outbox_msg
+{
+	sys_snode_t node;
+	uint32_t queued_ms;
+	uint32_t len;
+	uint32_t offset; /* Payload bytes already sent */
+	uint16_t chunk;		 /* Next chunk index */
+	uint16_t chunks;	 /* 0 when sent in one publish */
+	uint16_t message_id; /* Of the publish awaiting its acknowledgment, 0 when none */
+	uint8_t qos;
+	uint8_t prio;
+	bool dup; /* Sent before the connection dropped, resend with DUP */
+	char data[]; /* Topic, terminator, payload */
+};
+
+/* Free places per class, producers wait on them for backpressure. */
+static K_SEM_DEFINE(slots_critical, CONFIG_MQTT_OUTBOX_MAX_MSGS, CONFIG_MQTT_OUTBOX_MAX_MSGS);
+static K_SEM_DEFINE(slots_command, CONFIG_MQTT_OUTBOX_MAX_MSGS, CONFIG_MQTT_OUTBOX_MAX_MSGS);
+static K_SEM_DEFINE(slots_telemetry, CONFIG_MQTT_OUTBOX_MAX_MSGS, CONFIG_MQTT_OUTBOX_MAX_MSGS);
+static K_SEM_DEFINE(slots_bulk, CONFIG_MQTT_OUTBOX_MAX_MSGS, CONFIG_MQTT_OUTBOX_MAX_MSGS);
+
+static struct k_sem *const slots[MQTT_PRIO_COUNT] = {
+	[MQTT_PRIO_CRITICAL] = &slots_critical,
+	[MQTT_PRIO_COMMAND] = &slots_command,
+	[MQTT_PRIO_TELEMETRY] = &slots_telemetry,
+	[MQTT_PRIO_BULK] = &slots_bulk,
+};
+
+static sys_slist_t queues[MQTT_PRIO_COUNT];
+static sys_slist_t inflight; /* QoS 1 and 2 messages sent whole, awaiting their ack */
+static struct k_spinlock outbox_lock;
+
+static uint8_t telemetry_run; /* Telemetry messages sent since the last bulk chunk */
+static int64_t bulk_hold_until_ms;
+static int64_t stalled_until_ms;   /* The last publish failed, retry after this */
+static int64_t throttled_until_ms; /* Held by the publish rate limiter */
+static int wake_fd = -1;
+
+static struct outbox_msg *head_get(enum mqtt_prio prio)
+{
+	k_spinlock_key_t key = k_spin_lock(&outbox_lock);
+	struct outbox_msg *msg = SYS_SLIST_PEEK_HEAD_CONTAINER(&queues[prio], msg, node);
+
+	k_spin_unlock(&outbox_lock, key);
+
+	return msg;
+}
+
+static void msg_free(struct outbox_msg *msg)
+{
+	enum mqtt_prio prio = msg->prio;
+
+	mqtt_arena_free(msg);
+	k_sem_give(slots[prio]);
+}
+
+static struct outbox_msg *head_take(enum mqtt_prio prio)
+{
+	k_spinlock_key_t key = k_spin_lock(&outbox_lock);
+	sys_snode_t *node = sys_slist_get(&queues[prio]);
+
+	k_spin_unlock(&outbox_lock, key);
+
+	return CONTAINER_OF(node, struct outbox_msg, node);
+}
+
+static void head_remove(enum mqtt_prio prio)
+{
+	msg_free(head_take(prio));
+}
+
+static bool bulk_sendable(void)
+{
+	struct outbox_msg *msg = head_get(MQTT_PRIO_BULK);
+
+	if (msg == NULL || (msg->message_id != 0 && !msg->dup))
+	{
+		/* Chunks go one at a time, the next after the ack of the previous. */
+		return false;
+	}
+
+	/* A transfer in progress is never held. */
+	return msg->offset > 0 || k_uptime_get() >= bulk_hold_until_ms;
+}
+
+/*
+Function : pick
+
+Description : Chooses the class to send from. Critical and command messages have
+			  strict priority. When both telemetry and bulk are waiting, one bulk
+			  chunk goes out after CONFIG_MQTT_OUTBOX_TELEMETRY_WEIGHT telemetry
+			  messages, so neither starves.
+
+Parameter : void
+
+Return :
+Class to send from, or MQTT_PRIO_COUNT if nothing can be sent.
+
+Example Call :
+				prio = pick();
+*/
+static enum mqtt_prio pick(void)
+{
+	bool telemetry;
+	bool bulk;
+
+	for (enum mqtt_prio prio = MQTT_PRIO_CRITICAL; prio <= MQTT_PRIO_COMMAND; prio++)
+	{
+		if (head_get(prio) != NULL)
+		{
+			return prio;
+		}
+	}
+
+	telemetry = head_get(MQTT_PRIO_TELEMETRY) != NULL;
+	bulk = bulk_sendable();
+
+	if (telemetry && (!bulk || telemetry_run < CONFIG_MQTT_OUTBOX_TELEMETRY_WEIGHT))
+	{
+		telemetry_run++;
+		return MQTT_PRIO_TELEMETRY;
+	}
+
+	if (bulk)
+	{
+		telemetry_run = 0;
+		return MQTT_PRIO_BULK;
+	}
+
+	return MQTT_PRIO_COUNT;
+}
+
+/*
+Function : send_next
+
+Description : Publishes the next message, or the next chunk of a bulk message, of a
+			  class. A chunk goes to "<topic>/<index>/<count>". QoS 1 and 2 messages
+			  are kept until they are acknowledged: a whole message moves to the
+			  in-flight list, a chunk stays at the head of the bulk class. Either is
+			  sent again with DUP after a reconnect.
+
+Parameter :
+- prio : Class with a message at its head.
+- msg : Head message of the class.
+
+Return :
+0 on success, or the mqtt_publish_topic_id() error. On -EAGAIN the outbox is held
+until the rate limiter lets the message through.
+
+Example Call :
+				err = send_next(prio, msg);
+*/
+static int send_next(enum mqtt_prio prio, struct outbox_msg *msg)
+{
+	const char *topic = msg->data;
+	const uint8_t *payload = (const uint8_t *)&msg->data[strlen(topic) + 1];
+	char chunk_topic[OUTBOX_CHUNK_TOPIC_LEN];
+	uint32_t len = msg->len;
+	uint16_t message_id = msg->message_id;
+	k_spinlock_key_t key;
+	int err;
+
+	if (msg->chunks > 0)
+	{
+		snprintf(chunk_topic, sizeof(chunk_topic), "%s/%u/%u", topic, msg->chunk,
+				 msg->chunks);
+		topic = chunk_topic;
+		payload += msg->offset;
+		len = MIN(msg->len - msg->offset, CONFIG_MQTT_OUTBOX_CHUNK_SIZE);
+	}
+
+	if (msg->dup)
+	{
+		err = mqtt_publish_topic_dup(topic, msg->qos, payload, len, message_id);
+	}
+	else
+	{
+		err = mqtt_publish_topic_id(topic, msg->qos, payload, len, &message_id);
+	}
+
+	if (err == -EAGAIN)
+	{
+		throttled_until_ms = k_uptime_get() + mqtt_rate_wait_ms(strlen(topic) + len);
+	}
+	if (err)
+	{
+		return err;
+	}
+
+	if (prio == MQTT_PRIO_COMMAND && !msg->dup)
+	{
+		metrics_hist_record(METRIC_HIST_MQTT_OUTBOX_CMD_MS,
+							k_uptime_get_32() - msg->queued_ms);
+	}
+
+	msg->dup = false;
+
+	/* No identifier for QoS 0, nor from the MQTT-SN client, which retries itself. */
+	if (msg->qos != MQTT_QOS_0_AT_MOST_ONCE && message_id != 0)
+	{
+		msg->message_id = message_id;
+
+		if (msg->chunks == 0)
+		{
+			head_take(prio);
+
+			key = k_spin_lock(&outbox_lock);
+			sys_slist_append(&inflight, &msg->node);
+			k_spin_unlock(&outbox_lock, key);
+		}
+
+		return 0;
+	}
+
+	msg->offset += len;
+	msg->chunk++;
+
+	if (msg->offset >= msg->len)
+	{
+		head_remove(prio);
+	}
+
+	return 0;
+}
+
+/*
+Function : mqtt_outbox_ack
+
+Description : Completes the QoS 1 or 2 message with this packet identifier. A whole
+			  message is freed, a chunked one moves on to its next chunk. A failed
+			  acknowledgment drops the message. Identifiers of direct publishes are
+			  ignored. Called on the MQTT thread for every PUBACK and PUBCOMP.
+
+Parameter :
+- message_id : Packet identifier.
+- result : 0 on success, or the acknowledgment error.
+
+Return : void
+
+Example Call :
+				mqtt_outbox_ack(evt->param.puback.message_id, evt->result);
+*/
+void mqtt_outbox_ack(uint16_t message_id, int result)
+{
+	struct outbox_msg *bulk = head_get(MQTT_PRIO_BULK);
+	struct outbox_msg *msg;
+	struct outbox_msg *prev = NULL;
+	k_spinlock_key_t key;
+
+	if (message_id == 0)
+	{
+		return;
+	}
+
+	if (bulk != NULL && bulk->message_id == message_id)
+	{
+		if (result != 0)
+		{
+			LOG_WRN("Chunk %u of %s not acknowledged: %d", bulk->chunk, bulk->data, result);
+		}
+
+		bulk->message_id = 0;
+		bulk->offset += MIN(bulk->len - bulk->offset, CONFIG_MQTT_OUTBOX_CHUNK_SIZE);
+		bulk->chunk++;
+
+		if (result != 0 || bulk->offset >= bulk->len)
+		{
+			head_remove(MQTT_PRIO_BULK);
+		}
+
+		mqtt_outbox_wake();
+		return;
+	}
+
+	key = k_spin_lock(&outbox_lock);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&inflight, msg, node)
+	{
+		if (msg->message_id == message_id)
+		{
+			sys_slist_remove(&inflight, prev ? &prev->node : NULL, &msg->node);
+			break;
+		}
+		prev = msg;
+	}
+
+	k_spin_unlock(&outbox_lock, key);
+
+	if (msg == NULL)
+	{
+		return;
+	}
+
+	if (result != 0)
+	{
+		LOG_WRN("Publish to %s not acknowledged: %d", msg->data, result);
+	}
+
+	msg_free(msg);
+}
+
+/*
+Function : mqtt_outbox_on_connect
+
+Description : Puts the messages still awaiting an acknowledgment back at the front of
+			  their classes, in their original order, to be resent with DUP and
+			  their packet identifier. Called on the MQTT thread after CONNACK.
+
+Parameter : void
+
+Return : void
+
+Example Call :
+				mqtt_outbox_on_connect();
+*/
+void mqtt_outbox_on_connect(void)
+{
+	struct outbox_msg *bulk = head_get(MQTT_PRIO_BULK);
+	sys_slist_t resend[MQTT_PRIO_COUNT];
+	sys_snode_t *node;
+	k_spinlock_key_t key;
+
+	if (bulk != NULL && bulk->message_id != 0)
+	{
+		bulk->dup = true;
+	}
+
+	for (int prio = 0; prio < MQTT_PRIO_COUNT; prio++)
+	{
+		sys_slist_init(&resend[prio]);
+	}
+
+	key = k_spin_lock(&outbox_lock);
+
+	while ((node = sys_slist_get(&inflight)) != NULL)
+	{
+		struct outbox_msg *msg = CONTAINER_OF(node, struct outbox_msg, node);
+
+		msg->dup = true;
+		sys_slist_append(&resend[msg->prio], node);
+	}
+
+	for (int prio = 0; prio < MQTT_PRIO_COUNT; prio++)
+	{
+		if (!sys_slist_is_empty(&resend[prio]))
+		{
+			sys_slist_merge_slist(&resend[prio], &queues[prio]);
+			queues[prio] = resend[prio];
+		}
+	}
+
+	k_spin_unlock(&outbox_lock, key);
+
+	stalled_until_ms = 0;
+	throttled_until_ms = 0;
+}
+
+/*
+Function : mqtt_outbox_drain
+
+Description : Sends up to CONFIG_MQTT_OUTBOX_BURST messages or chunks, choosing the
+			  class again before each one. Called on the MQTT thread while connected.
+			  On a publish error the message stays queued and the outbox is not
+			  ready for OUTBOX_STALL_RETRY_MS.
+
+Parameter : void
+
+Return : void
+
+Example Call :
+				mqtt_outbox_drain();
+*/
+void mqtt_outbox_drain(void)
+{
+	for (int n = 0; n < CONFIG_MQTT_OUTBOX_BURST; n++)
+	{
+		enum mqtt_prio prio = pick();
+		struct outbox_msg *msg;
+		int err;
+
+		if (prio == MQTT_PRIO_COUNT)
+		{
+			break;
+		}
+
+		msg = head_get(prio);
+
+		if (prio == MQTT_PRIO_BULK && msg->offset == 0 && !link_quality_bulk_allowed())
+		{
+			bulk_hold_until_ms = k_uptime_get() + OUTBOX_BULK_RECHECK_MS;
+			continue;
+		}
+
+		err = send_next(prio, msg);
+		if (err == -ENOSPC)
+		{
+			/* Over the data budget, the message will not be sent. */
+			head_remove(prio);
+			continue;
+		}
+
+		if (err == -EAGAIN)
+		{
+			break;
+		}
+
+		if (err)
+		{
+			LOG_WRN("Outbox publish failed, class %d: %d", prio, err);
+			stalled_until_ms = k_uptime_get() + OUTBOX_STALL_RETRY_MS;
+			return;
+		}
+	}
+
+	stalled_until_ms = 0;
+}
+
+/*
+Function : mqtt_outbox_ready
+
+Description : Tells whether a drain would send something now.
+
+Parameter : void
+
+Return :
+true if connected and a message can be sent.
+
+Example Call :
+				timeout = mqtt_outbox_ready() ? 0 : keepalive_ms;
+*/
+bool mqtt_outbox_ready(void)
+{
+	int64_t now = k_uptime_get();
+
+	if (!mqtt_is_connected() || now < stalled_until_ms || now < throttled_until_ms)
+	{
+		return false;
+	}
+
+	for (enum mqtt_prio prio = MQTT_PRIO_CRITICAL; prio < MQTT_PRIO_BULK; prio++)
+	{
+		if (head_get(prio) != NULL)
+		{
+			return true;
+		}
+	}
+
+	return bulk_sendable();
+}
+
+/*
+Function : mqtt_outbox_pending
+
+Description : Tells whether any message is queued or awaits its acknowledgment, also
+			  while disconnected or held.
+
+Parameter : void
+
+Return :
+true if a class or the in-flight list holds a message.
+
+Example Call :
+				if (asleep && mqtt_outbox_pending()) { ... }
+*/
+bool mqtt_outbox_pending(void)
+{
+	for (enum mqtt_prio prio = MQTT_PRIO_CRITICAL; prio < MQTT_PRIO_COUNT; prio++)
+	{
+		if (head_get(prio) != NULL)
+		{
+			return true;
+		}
+	}
+
+	return !sys_slist_is_empty(&inflight);
+}
+
+/* Shortens timeout_ms to a deadline still ahead. */
+static int deadline_min(int timeout_ms, int64_t until_ms, int64_t now)
+{
+	int64_t left = until_ms - now;
+
+	if (left > 0 && (timeout_ms < 0 || left < timeout_ms))
+	{
+		return (int)left;
+	}
+
+	return timeout_ms;
+}
+
+/*
+Function : mqtt_outbox_poll_timeout
+
+Description : Returns the socket poll timeout of the MQTT thread: 0 while messages
+			  are ready, otherwise the keepalive time left, shortened to the end of
+			  a rate limiter, bulk or publish error hold. A message queued by
+			  another thread wakes the poll through mqtt_outbox_wake_fd(), so there
+			  is no periodic wakeup.
+
+Parameter :
+- keepalive_ms : Keepalive time left, -1 without keepalive.
+
+Return :
+Timeout in milliseconds, -1 to wait for input or a wakeup only.
+
+Example Call :
+				poll(fds, 2, mqtt_outbox_poll_timeout(mqtt_keepalive_time_left(c)));
+*/
+int mqtt_outbox_poll_timeout(int keepalive_ms)
+{
+	int64_t now = k_uptime_get();
+	int timeout_ms = keepalive_ms;
+
+	if (mqtt_outbox_ready())
+	{
+		return 0;
+	}
+
+	if (!mqtt_outbox_pending())
+	{
+		return timeout_ms;
+	}
+
+	timeout_ms = deadline_min(timeout_ms, throttled_until_ms, now);
+	timeout_ms = deadline_min(timeout_ms, stalled_until_ms, now);
+
+	if (head_get(MQTT_PRIO_BULK) != NULL)
+	{
+		timeout_ms = deadline_min(timeout_ms, bulk_hold_until_ms, now);
+	}
+
+	return timeout_ms;
+}
+
+/*
+Function : mqtt_outbox_wake_fd
+
+Description : Returns the eventfd that mqtt_outbox_wake() signals, created on the
+			  first call. The MQTT thread polls it next to the broker socket and
+			  clears it with mqtt_outbox_wake_clear().
+
+Parameter : void
+
+Return :
+File descriptor, or a negative error code.
+
+Example Call :
+				fds[1].fd = mqtt_outbox_wake_fd();
+*/
+int mqtt_outbox_wake_fd(void)
+{
+	if (wake_fd < 0)
+	{
+		wake_fd = eventfd(0, EFD_NONBLOCK);
+		if (wake_fd < 0)
+		{
+			LOG_ERR("Failed to create the outbox eventfd: %d", errno);
+			return -errno;
+		}
+	}
+
+	return wake_fd;
+}
+
+/*
+Function : mqtt_outbox_wake
+
+Description : Wakes the MQTT thread from its poll, e.g. after a message was queued or
+			  a reconnect was requested. Safe from any thread.
+
+Parameter : void
+
+Return : void
+
+Example Call :
+				mqtt_outbox_wake();
+*/
+void mqtt_outbox_wake(void)
+{
+	if (wake_fd >= 0)
+	{
+		(void)eventfd_write(wake_fd, 1);
+	}
+}
+
+/*
+Function : mqtt_outbox_wake_clear
+
+Description : Consumes pending wakeups after the poll returned.
+
+Parameter : void
+
+Return : void
+
+Example Call :
+				mqtt_outbox_wake_clear();
+*/
+void mqtt_outbox_wake_clear(void)
+{
+	eventfd_t value;
+
+	if (wake_fd >= 0)
+	{
+		(void)eventfd_read(wake_fd, &value);
+	}
+}
+
+/*
+Function : mqtt_outbox_publish_wait
+
+Description : Queues a publish in a priority class. The message is copied, the
+			  caller's buffers can be reused on return. Messages wait in the outbox
+			  while the client is disconnected. When the class is full the caller
+			  waits up to timeout for a message of that class to be sent, which
+			  paces producers to the publish rate limit. Bulk messages are refused
+			  while the data budget is used up.
+
+Parameter :
+- prio : Priority class.
+- topic : Topic string.
+- qos : Quality of Service level.
+- data : Payload.
+- len : Payload length.
+- timeout : Longest wait for a free place in the class.
+
+Return :
+0 on success, -ENOBUFS if the class stayed full (CONFIG_MQTT_OUTBOX_MAX_MSGS
+messages), -ENOMEM if the arena is exhausted, -ENOSPC if over the data budget, or
+-EINVAL for a bulk topic too long to chunk.
+
+Example Call :
+				mqtt_outbox_publish_wait(MQTT_PRIO_TELEMETRY, topic, MQTT_QOS_0_AT_MOST_ONCE,
+										 buf, len, K_SECONDS(5));
+*/
+int mqtt_outbox_publish_wait(enum mqtt_prio prio,
+							 const char *topic,
+							 enum mqtt_qos qos,
+							 const uint8_t *data,
+							 size_t len,
+							 k_timeout_t timeout)
+{
+	size_t topic_len = strlen(topic);
+	struct outbox_msg *msg;
+	k_spinlock_key_t key;
+	bool chunked = (prio == MQTT_PRIO_BULK && len > CONFIG_MQTT_OUTBOX_CHUNK_SIZE);
+
+	if (prio >= MQTT_PRIO_COUNT)
+	{
+		return -EINVAL;
+	}
+
+	if (chunked && topic_len + sizeof("/65535/65535") > OUTBOX_CHUNK_TOPIC_LEN)
+	{
+		return -EINVAL;
+	}
+
+	if (prio == MQTT_PRIO_BULK && data_usage_level_get() == DATA_USAGE_EXCEEDED)
+	{
+		return -ENOSPC;
+	}
+
+	if (k_sem_take(slots[prio], timeout) != 0)
+	{
+		return -ENOBUFS;
+	}
+
+	msg = mqtt_arena_alloc(sizeof(*msg) + topic_len + 1 + len);
+	if (msg == NULL)
+	{
+		k_sem_give(slots[prio]);
+		return -ENOMEM;
+	}
+
+	msg->queued_ms = k_uptime_get_32();
+	msg->len = len;
+	msg->offset = 0;
+	msg->chunk = 0;
+	msg->chunks = chunked ? DIV_ROUND_UP(len, CONFIG_MQTT_OUTBOX_CHUNK_SIZE) : 0;
+	msg->message_id = 0;
+	msg->qos = qos;
+	msg->prio = prio;
+	msg->dup = false;
+	memcpy(msg->data, topic, topic_len + 1);
+	memcpy(&msg->data[topic_len + 1], data, len);
+
+	key = k_spin_lock(&outbox_lock);
+	sys_slist_append(&queues[prio], &msg->node);
+	k_spin_unlock(&outbox_lock, key);
+
+	mqtt_outbox_wake();
+
+	return 0;
+}
+
+/*
+Function : mqtt_outbox_publish
+
+Description : Queues a publish without waiting, see mqtt_outbox_publish_wait().
+
+Parameter :
+- prio : Priority class.
+- topic : Topic string.
+- qos : Quality of Service level.
+- data : Payload.
+- len : Payload length.
+
+Return :
+0 on success, -ENOBUFS if the class is full, or a mqtt_outbox_publish_wait() error.
+
+Example Call :
+				mqtt_outbox_publish(MQTT_PRIO_COMMAND, topic, MQTT_QOS_1_AT_LEAST_ONCE, buf, len);
+*/
+int mqtt_outbox_publish(enum mqtt_prio prio,
+						const char *topic,
+						enum mqtt_qos qos,
+						const uint8_t *data,
+						size_t len)
+{
+	return mqtt_outbox_publish_wait(prio, topic, qos, data, len, K_NO_WAIT);
+}
\ No newline at end of file
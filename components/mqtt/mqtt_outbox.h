@@ -0,0 +1,63 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_OUTBOX.h
+*/
+
+#ifndef _MQTT_OUTBOX_H_
+#define _MQTT_OUTBOX_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "mqtt.h"
+
+/*
+ * Priority outbox of the MQTT component. mqtt_outbox_publish() (declared in
+ * mqtt.h) copies a message into the arena and queues it in its class; the MQTT
+ * thread sends at most CONFIG_MQTT_OUTBOX_BURST of them per loop before it
+ * handles input again. Critical and command messages are sent strictly first,
+ * telemetry and bulk share the rest CONFIG_MQTT_OUTBOX_TELEMETRY_WEIGHT to 1.
+ * Bulk messages go out in CONFIG_MQTT_OUTBOX_CHUNK_SIZE chunks, so a critical
+ * message waits for one chunk at most, and are held while the link is poor.
+ * The outbox is drained no faster than the publish rate limiter allows, and a
+ * full class makes mqtt_outbox_publish_wait() callers wait. QoS 1 and 2
+ * messages keep their place until acknowledged and are resent with DUP after a
+ * reconnect. Queuing a message signals an eventfd the MQTT thread polls next to
+ * its socket, so it wakes at once instead of on a timer.
+ */
+
+/* Sends queued messages, called on the MQTT thread while connected. */
+void mqtt_outbox_drain(void);
+
+/* Poll timeout of the MQTT thread given the keepalive time left (-1: none). */
+int mqtt_outbox_poll_timeout(int keepalive_ms);
+
+/* True when messages can be sent now. */
+bool mqtt_outbox_ready(void);
+
+/* True when messages are queued or await their ack, sendable or not. */
+bool mqtt_outbox_pending(void);
+
+/* Completes the outbox message acknowledged with message_id, called on PUBACK/PUBCOMP. */
+void mqtt_outbox_ack(uint16_t message_id, int result);
+
+/* Queues the unacknowledged messages again for a DUP resend, called on CONNACK. */
+void mqtt_outbox_on_connect(void);
+
+/* Eventfd signalled by mqtt_outbox_wake(), created on the first call. */
+int mqtt_outbox_wake_fd(void);
+
+/* Wakes the MQTT thread from its poll, safe from any thread. */
+void mqtt_outbox_wake(void);
+
+/* Consumes the pending wakeups. */
+void mqtt_outbox_wake_clear(void);
+
+/* Resends a publish with the DUP flag and its original packet identifier. */
+int mqtt_publish_topic_dup(const char *topic, enum mqtt_qos qos, const uint8_t *data,
+						   size_t len, uint16_t message_id);
+
+#endif
\ No newline at end of file
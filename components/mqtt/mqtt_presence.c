@@ -0,0 +1,153 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_PRESENCE.c
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "mqtt.h"
+#include "mqtt_presence.h"
+
+#define PRESENCE_TOPIC_LENGTH 128 // Maximum length of the formatted status topic
+
+LOG_MODULE_REGISTER(MQTT_PRESENCE);
+
+static char topic[PRESENCE_TOPIC_LENGTH];
+static struct mqtt_topic will_topic;
+static struct mqtt_utf8 will_message;
+
+/*
+Function : mqtt_presence_topic
+
+Description : Returns the status topic. The first call formats it with the device ID
+			  and marks it retained in the topic registry, so that the online and
+			  offline messages replace each other on the broker.
+
+Parameter : void
+
+Return :
+Status topic, or NULL if it could not be registered.
+
+Example Call :
+				const char *topic = mqtt_presence_topic();
+*/
+const char *mqtt_presence_topic(void)
+{
+	if (topic[0] != '\0')
+	{
+		return topic;
+	}
+
+	snprintf(topic, sizeof(topic), CONFIG_MQTT_PRESENCE_TOPIC, DEVICE_ID);
+
+	if (mqtt_topic_retain_set(topic, true) != 0)
+	{
+		LOG_ERR("Could not register the status topic: %s", topic);
+		topic[0] = '\0';
+		return NULL;
+	}
+
+	return topic;
+}
+
+/*
+Function : mqtt_presence_will_set
+
+Description : Sets the retained offline message as the Last Will of the next CONNECT.
+			  The broker publishes it when the connection drops without a DISCONNECT,
+			  at the latest 1.5 keepalive periods after the device went silent.
+
+Parameter :
+- c : Pointer to the MQTT client, after mqtt_client_init().
+
+Return : void
+
+Example Call :
+				mqtt_presence_will_set(client);
+*/
+void mqtt_presence_will_set(struct mqtt_client *c)
+{
+	const char *status = mqtt_presence_topic();
+
+	if (status == NULL)
+	{
+		return;
+	}
+
+	will_topic.topic.utf8 = (const uint8_t *)status;
+	will_topic.topic.size = strlen(status);
+	will_topic.qos = MQTT_QOS_1_AT_LEAST_ONCE;
+
+	will_message.utf8 = (const uint8_t *)CONFIG_MQTT_PRESENCE_OFFLINE;
+	will_message.size = strlen(CONFIG_MQTT_PRESENCE_OFFLINE);
+
+	c->will_topic = &will_topic;
+	c->will_message = &will_message;
+	c->will_retain = 1;
+}
+
+/*
+Function : mqtt_presence_online
+
+Description : Queues the retained online message as a critical outbox message. Called
+			  on CONNACK, the outbox sends it as soon as the rate limiter allows.
+
+Parameter : void
+
+Return : void
+
+Example Call :
+				mqtt_presence_online();
+*/
+void mqtt_presence_online(void)
+{
+	const char *status = mqtt_presence_topic();
+	int err;
+
+	if (status == NULL)
+	{
+		return;
+	}
+
+	err = mqtt_outbox_publish(MQTT_PRIO_CRITICAL, status, MQTT_QOS_1_AT_LEAST_ONCE,
+							  (const uint8_t *)CONFIG_MQTT_PRESENCE_ONLINE,
+							  strlen(CONFIG_MQTT_PRESENCE_ONLINE));
+	if (err)
+	{
+		LOG_ERR("Could not queue the online status: %d", err);
+	}
+}
+
+/*
+Function : mqtt_presence_offline
+
+Description : Publishes the retained offline message right away. Called before a
+			  graceful DISCONNECT, which discards the will.
+
+Parameter : void
+
+Return :
+0 on success, or the publish error.
+
+Example Call :
+				err = mqtt_presence_offline();
+*/
+int mqtt_presence_offline(void)
+{
+	const char *status = mqtt_presence_topic();
+
+	if (status == NULL)
+	{
+		return -ENOENT;
+	}
+
+	return mqtt_publish_topic(status, MQTT_QOS_1_AT_LEAST_ONCE,
+							  (const uint8_t *)CONFIG_MQTT_PRESENCE_OFFLINE,
+							  strlen(CONFIG_MQTT_PRESENCE_OFFLINE));
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_PRESENCE.h
+*/
+
+#ifndef _MQTT_PRESENCE_H_
+#define _MQTT_PRESENCE_H_
+
+#include <zephyr/net/mqtt.h>
+
+/*
+ * Presence of the MQTT component. Each connection carries a retained Last Will
+ * of CONFIG_MQTT_PRESENCE_OFFLINE on the CONFIG_MQTT_PRESENCE_TOPIC status
+ * topic, and a retained CONFIG_MQTT_PRESENCE_ONLINE is queued on CONNACK. A
+ * graceful disconnect publishes the offline message itself, since the broker
+ * drops the will on DISCONNECT. Subscribers read the current state from the
+ * retained message instead of watching for periodic publishes.
+ */
+
+#if defined(CONFIG_MQTT_PRESENCE)
+
+/* Status topic, formatted and registered as retained on the first call. */
+const char *mqtt_presence_topic(void);
+void mqtt_presence_will_set(struct mqtt_client *c);
+void mqtt_presence_online(void);
+int mqtt_presence_offline(void);
+
+#else
+
+static inline const char *mqtt_presence_topic(void)
+{
+	return NULL;
+}
+
+static inline void mqtt_presence_will_set(struct mqtt_client *c)
+{
+}
+
+static inline void mqtt_presence_online(void)
+{
+}
+
+static inline int mqtt_presence_offline(void)
+{
+	return 0;
+}
+
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,226 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_RATE.c
+*/
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "mqtt.h"
+#include "mqtt_rate.h"
+
+/* Tokens are kept in thousandths, so rates below 1 per millisecond refill evenly. */
+#define RATE_SCALE 1000
+#define RATE_PERMILLE_MAX 1000
+#define RATE_PERMILLE_STEP 100
+
+LOG_MODULE_REGISTER(MQTT_RATE);
+
+struct rate_bucket
+{
+	int64_t tokens; /* Scaled by RATE_SCALE, negative while in debt */
+	int64_t cap;
+	uint32_t rate;	/* Configured tokens per second, 0 when unlimited */
+};
+
+static struct rate_bucket msg_bucket = {
+	.tokens = (int64_t)CONFIG_MQTT_RATE_BURST_MSGS * RATE_SCALE,
+	.cap = (int64_t)CONFIG_MQTT_RATE_BURST_MSGS * RATE_SCALE,
+	.rate = CONFIG_MQTT_RATE_MSGS_PER_S,
+};
+
+static struct rate_bucket byte_bucket = {
+	.tokens = (int64_t)CONFIG_MQTT_RATE_BURST_BYTES * RATE_SCALE,
+	.cap = (int64_t)CONFIG_MQTT_RATE_BURST_BYTES * RATE_SCALE,
+	.rate = CONFIG_MQTT_RATE_BYTES_PER_S,
+};
+
+static uint32_t permille = RATE_PERMILLE_MAX; /* Share of the configured rates in use */
+static int64_t refill_ms;
+static int64_t change_ms;
+static K_MUTEX_DEFINE(rate_lock);
+
+/* Current rate in scaled tokens per millisecond. */
+static uint64_t bucket_rate(const struct rate_bucket *b)
+{
+	return MAX(((uint64_t)b->rate * permille) / RATE_PERMILLE_MAX, 1);
+}
+
+static void bucket_refill(struct rate_bucket *b, int64_t elapsed_ms)
+{
+	if (b->rate == 0)
+	{
+		return;
+	}
+
+	b->tokens = MIN(b->tokens + elapsed_ms * (int64_t)bucket_rate(b), b->cap);
+}
+
+/* Milliseconds until a publish costing cost scaled tokens may go. */
+static int32_t bucket_wait_ms(const struct rate_bucket *b, int64_t cost)
+{
+	int64_t need;
+
+	if (b->rate == 0)
+	{
+		return 0;
+	}
+
+	need = MIN(cost, b->cap);
+	if (b->tokens >= need)
+	{
+		return 0;
+	}
+
+	return (int32_t)DIV_ROUND_UP(need - b->tokens, bucket_rate(b));
+}
+
+/* Called with rate_lock held. */
+static void refill(void)
+{
+	int64_t now = k_uptime_get();
+	int64_t elapsed = now - refill_ms;
+
+	refill_ms = now;
+	bucket_refill(&msg_bucket, elapsed);
+	bucket_refill(&byte_bucket, elapsed);
+
+	/* Additive increase after a quiet period. */
+	if (permille < RATE_PERMILLE_MAX &&
+		now - change_ms >= CONFIG_MQTT_RATE_RECOVER_S * MSEC_PER_SEC)
+	{
+		permille = MIN(permille + RATE_PERMILLE_STEP, RATE_PERMILLE_MAX);
+		change_ms = now;
+		LOG_INF("Publish rate raised to %u%%", permille / 10);
+	}
+}
+
+static int32_t wait_ms(size_t bytes)
+{
+	return MAX(bucket_wait_ms(&msg_bucket, RATE_SCALE),
+			   bucket_wait_ms(&byte_bucket, (int64_t)bytes * RATE_SCALE));
+}
+
+/*
+Function : mqtt_rate_take
+
+Description : Takes one message and the given bytes from the buckets if both have
+			  enough tokens, otherwise takes nothing.
+
+Parameter :
+- bytes : Topic plus payload length.
+
+Return :
+0 if the publish may go now, otherwise the milliseconds until it may.
+
+Example Call :
+				if (mqtt_rate_take(topic_len + len) > 0) { return -EAGAIN; }
+*/
+int32_t mqtt_rate_take(size_t bytes)
+{
+	int32_t wait;
+
+	k_mutex_lock(&rate_lock, K_FOREVER);
+
+	refill();
+
+	wait = wait_ms(bytes);
+	if (wait == 0)
+	{
+		msg_bucket.tokens -= RATE_SCALE;
+		byte_bucket.tokens -= (int64_t)bytes * RATE_SCALE;
+	}
+
+	k_mutex_unlock(&rate_lock);
+
+	return wait;
+}
+
+/*
+Function : mqtt_rate_wait_ms
+
+Description : Tells how long a producer has to wait before a publish of the given
+			  size passes the rate limiter, without taking any tokens.
+
+Parameter :
+- bytes : Topic plus payload length.
+
+Return :
+Milliseconds to wait, 0 if the publish may go now.
+
+Example Call :
+				k_msleep(mqtt_rate_wait_ms(strlen(topic) + len));
+*/
+int32_t mqtt_rate_wait_ms(size_t bytes)
+{
+	int32_t wait;
+
+	k_mutex_lock(&rate_lock, K_FOREVER);
+
+	refill();
+	wait = wait_ms(bytes);
+
+	k_mutex_unlock(&rate_lock);
+
+	return wait;
+}
+
+/*
+Function : mqtt_rate_pct
+
+Description : Returns the share of the configured rates currently in use.
+
+Parameter : void
+
+Return :
+Percentage, 100 unless throttling was detected.
+
+Example Call :
+				shell_print(sh, "rate %u%%", mqtt_rate_pct());
+*/
+uint32_t mqtt_rate_pct(void)
+{
+	return permille / 10;
+}
+
+/*
+Function : mqtt_rate_on_disconnect
+
+Description : Halves the rates if the broker dropped the connection while either
+			  bucket was below half its burst, i.e. the client was sending close to
+			  the limit.
+
+Parameter : void
+
+Return : void
+
+Example Call :
+				mqtt_rate_on_disconnect();
+*/
+void mqtt_rate_on_disconnect(void)
+{
+	bool busy;
+
+	k_mutex_lock(&rate_lock, K_FOREVER);
+
+	refill();
+
+	busy = (msg_bucket.rate && msg_bucket.tokens < msg_bucket.cap / 2) ||
+		   (byte_bucket.rate && byte_bucket.tokens < byte_bucket.cap / 2);
+
+	if (busy)
+	{
+		permille = MAX(permille / 2, CONFIG_MQTT_RATE_MIN_PCT * 10);
+		change_ms = k_uptime_get();
+	}
+
+	k_mutex_unlock(&rate_lock);
+
+	if (busy)
+	{
+		LOG_WRN("Disconnected while sending at the limit, publish rate lowered to %u%%",
+				mqtt_rate_pct());
+	}
+}
\ No newline at end of file
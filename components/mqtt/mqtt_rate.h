@@ -0,0 +1,35 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_RATE.h
+*/
+
+#ifndef _MQTT_RATE_H_
+#define _MQTT_RATE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Token bucket rate limiter of the MQTT publish path. One bucket holds
+ * messages (CONFIG_MQTT_RATE_MSGS_PER_S), one bytes of topic and payload
+ * (CONFIG_MQTT_RATE_BYTES_PER_S), each allowing a burst of its
+ * CONFIG_MQTT_RATE_BURST_* size. A message larger than the byte burst is let
+ * through once the bucket is full and leaves it in debt.
+ *
+ * A disconnect while the buckets were being drained is taken as the broker
+ * throttling the client: both rates are halved, down to
+ * CONFIG_MQTT_RATE_MIN_PCT, and raised again by 10% of the configured rate
+ * every CONFIG_MQTT_RATE_RECOVER_S without another one.
+ * mqtt_rate_wait_ms() and mqtt_rate_pct() are declared in mqtt.h.
+ */
+
+/* Takes the tokens of one publish. Returns 0, or the milliseconds to wait. */
+int32_t mqtt_rate_take(size_t bytes);
+
+/* Called on a disconnect the client did not ask for. */
+void mqtt_rate_on_disconnect(void);
+
+#endif
\ No newline at end of file
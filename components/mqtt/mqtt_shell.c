@@ -0,0 +1,406 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_SHELL.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include "mqtt.h"
+#include "mqtt_arena.h"
+#include "mqtt_coalesce.h"
+#include "metrics.h"
+#include "link_quality.h"
+
+#define SHELL_TOPIC_MAX_LEN 128
+#define LOAD_MAX_BURST 16 // Publishes per work run when the rate exceeds the tick rate
+
+LOG_MODULE_REGISTER(MQTT_SHELL);
+
+/* Synthetic load, driven by a work item on its own queue so that blocking
+ * socket sends do not stall the system workqueue or the shell.
+ */
+struct mqtt_load
+{
+	bool running;
+	uint32_t rate;
+	uint32_t size;
+	uint8_t qos;
+	uint32_t duration_ms;
+	int64_t start_ms;
+	int64_t end_ms;
+	uint32_t sent;
+	uint32_t errors;
+	uint8_t *payload;
+	char topic[SHELL_TOPIC_MAX_LEN];
+};
+
+static struct mqtt_load load;
+static K_MUTEX_DEFINE(load_lock);
+
+static K_THREAD_STACK_DEFINE(load_stack, CONFIG_MQTT_SHELL_LOAD_STACK_SIZE);
+static struct k_work_q load_work_q;
+static bool load_work_q_started;
+
+static void load_work_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(load_work, load_work_fn);
+
+static void load_finish(void)
+{
+	int64_t elapsed = MAX(load.end_ms - load.start_ms, 1);
+
+	load.running = false;
+	mqtt_arena_free(load.payload);
+	load.payload = NULL;
+
+	LOG_INF("Load done: %u sent, %u errors, %u msg/s", load.sent, load.errors,
+			(uint32_t)((load.sent * 1000LL) / elapsed));
+}
+
+static void load_work_fn(struct k_work *work)
+{
+	int64_t now;
+	uint64_t due;
+	int burst = 0;
+
+	k_mutex_lock(&load_lock, K_FOREVER);
+
+	if (!load.running)
+	{
+		k_mutex_unlock(&load_lock);
+		return;
+	}
+
+	now = k_uptime_get();
+	due = ((uint64_t)MIN(now - load.start_ms, load.duration_ms) * load.rate) / MSEC_PER_SEC;
+
+	while (load.sent + load.errors < due && burst++ < LOAD_MAX_BURST)
+	{
+		int err;
+
+		memcpy(load.payload, &load.sent, MIN(sizeof(load.sent), load.size));
+
+		err = mqtt_publish_topic(load.topic, load.qos, load.payload, load.size);
+		if (err == -EAGAIN)
+		{
+			/* Held by the rate limiter, the load runs at the limit. */
+			break;
+		}
+
+		if (err == 0)
+		{
+			load.sent++;
+		}
+		else
+		{
+			load.errors++;
+		}
+	}
+
+	if (now - load.start_ms >= load.duration_ms)
+	{
+		load.end_ms = now;
+		load_finish();
+	}
+	else
+	{
+		k_work_reschedule_for_queue(&load_work_q, &load_work,
+									K_MSEC(MAX(MSEC_PER_SEC / load.rate, 1)));
+	}
+
+	k_mutex_unlock(&load_lock);
+}
+
+static int parse_qos(const struct shell *sh, const char *arg, uint8_t *qos)
+{
+	char *end;
+	long v = strtol(arg, &end, 10);
+
+	if (*end != '\0' || v < MQTT_QOS_0_AT_MOST_ONCE || v > MQTT_QOS_2_EXACTLY_ONCE)
+	{
+		shell_error(sh, "Invalid QoS: %s", arg);
+		return -EINVAL;
+	}
+
+	*qos = (uint8_t)v;
+	return 0;
+}
+
+/* "#<n>" selects publish topic n, anything else is used as the topic. */
+static int resolve_topic(const struct shell *sh, const char *arg, char *topic, size_t len)
+{
+	if (arg[0] == '#')
+	{
+		if (mqtt_topic_get(true, atoi(&arg[1]), topic, len, NULL) != 0)
+		{
+			shell_error(sh, "No publish topic %s", arg);
+			return -ENOENT;
+		}
+		return 0;
+	}
+
+	snprintf(topic, len, "%s", arg);
+	return 0;
+}
+
+static int cmd_mqtt_status(const struct shell *sh, size_t argc, char **argv)
+{
+	struct mqtt_arena_stats arena;
+
+	shell_print(sh, "Client ID : %s", DEVICE_ID);
+	shell_print(sh, "Broker    : %s:%d", CONFIG_MQTT_BROKER_HOSTNAME, CONFIG_MQTT_BROKER_PORT);
+	shell_print(sh, "State     : %s", mqtt_is_connected() ? "connected" : "disconnected");
+
+	mqtt_arena_stats_get(&arena);
+	shell_print(sh, "Arena     : %u used, %u peak of %u, %u failed", (uint32_t)arena.used,
+				(uint32_t)arena.peak, (uint32_t)arena.size, arena.failures);
+	shell_print(sh, "Rate      : %u%% of %d msg/s, %d B/s", mqtt_rate_pct(),
+				CONFIG_MQTT_RATE_MSGS_PER_S, CONFIG_MQTT_RATE_BYTES_PER_S);
+
+	struct link_quality_sample lq;
+	struct link_quality_stats lq_stats;
+
+	link_quality_last(&lq);
+	link_quality_stats_get(&lq_stats);
+	if (lq.valid)
+	{
+		shell_print(sh, "Link      : RSRP %d dBm, RSRQ %d dB, energy estimate %u", lq.rsrp_dbm,
+					lq.rsrq_db, lq.energy_estimate);
+	}
+	else
+	{
+		shell_print(sh, "Link      : no sample");
+	}
+	shell_print(sh, "Bulk gate : %u allowed, %u deferral windows, %u forced, %u/%u samples failed",
+				lq_stats.bulk_allowed, lq_stats.bulk_deferred, lq_stats.bulk_forced,
+				lq_stats.sample_errors, lq_stats.samples + lq_stats.sample_errors);
+
+#if defined(CONFIG_MQTT_COALESCE)
+	struct mqtt_coalesce_stats tx;
+
+	mqtt_coalesce_stats_get(&tx);
+	shell_print(sh, "Coalesce  : %u packets in %u sends, %u bytes saved", tx.packets, tx.sends,
+				tx.saved);
+#endif
+
+#if defined(CONFIG_METRICS)
+	for (int i = 0; i < METRIC_COUNTER_COUNT; i++)
+	{
+		shell_print(sh, "%-10s: %u", metrics_counter_name(i), metrics_counter_get(i));
+	}
+#endif
+
+	k_mutex_lock(&load_lock, K_FOREVER);
+	shell_print(sh, "Load      : %s, %u sent, %u errors", load.running ? "running" : "idle",
+				load.sent, load.errors);
+	k_mutex_unlock(&load_lock);
+
+	return 0;
+}
+
+static int cmd_mqtt_topics(const struct shell *sh, size_t argc, char **argv)
+{
+	char topic[SHELL_TOPIC_MAX_LEN];
+	uint8_t qos;
+
+	for (int i = 0; mqtt_topic_get(false, i, topic, sizeof(topic), &qos) == 0; i++)
+	{
+		shell_print(sh, "sub    qos %u  %s", qos, topic);
+	}
+
+	for (int i = 0; mqtt_topic_get(true, i, topic, sizeof(topic), NULL) == 0; i++)
+	{
+		shell_print(sh, "pub #%d        %s", i, topic);
+	}
+
+	return 0;
+}
+
+static int cmd_mqtt_pub(const struct shell *sh, size_t argc, char **argv)
+{
+	char topic[SHELL_TOPIC_MAX_LEN];
+	uint8_t qos;
+	int err;
+
+	if (resolve_topic(sh, argv[1], topic, sizeof(topic)) || parse_qos(sh, argv[2], &qos))
+	{
+		return -EINVAL;
+	}
+
+	err = mqtt_publish_topic(topic, qos, (const uint8_t *)argv[3], strlen(argv[3]));
+	if (err)
+	{
+		shell_error(sh, "Publish failed: %d", err);
+		return err;
+	}
+
+	shell_print(sh, "Published %u bytes to %s", (uint32_t)strlen(argv[3]), topic);
+
+	return 0;
+}
+
+static int cmd_mqtt_sub(const struct shell *sh, size_t argc, char **argv)
+{
+	uint8_t qos = MQTT_QOS_1_AT_LEAST_ONCE;
+	int err;
+
+	if (argc > 2 && parse_qos(sh, argv[2], &qos))
+	{
+		return -EINVAL;
+	}
+
+	err = mqtt_subscribe_topic(argv[1], qos);
+	if (err)
+	{
+		shell_error(sh, "Subscribe failed: %d", err);
+		return err;
+	}
+
+	shell_print(sh, "Subscribed to %s (QoS %u)", argv[1], qos);
+
+	return 0;
+}
+
+static int cmd_mqtt_unsub(const struct shell *sh, size_t argc, char **argv)
+{
+	int err = mqtt_unsubscribe_topic(argv[1]);
+
+	if (err)
+	{
+		shell_error(sh, "Unsubscribe failed: %d", err);
+		return err;
+	}
+
+	shell_print(sh, "Unsubscribed from %s", argv[1]);
+
+	return 0;
+}
+
+static int cmd_mqtt_reconnect(const struct shell *sh, size_t argc, char **argv)
+{
+	mqtt_request_reconnect();
+	shell_print(sh, "Reconnect requested");
+
+	return 0;
+}
+
+static int cmd_load_start(const struct shell *sh, size_t argc, char **argv)
+{
+	uint32_t rate = strtoul(argv[1], NULL, 10);
+	uint32_t size = strtoul(argv[2], NULL, 10);
+	uint32_t duration_s = strtoul(argv[4], NULL, 10);
+	uint8_t qos;
+
+	if (parse_qos(sh, argv[3], &qos))
+	{
+		return -EINVAL;
+	}
+
+	if (rate == 0 || duration_s == 0 || size == 0 || size > CONFIG_MQTT_PAYLOAD_BUFFER_SIZE)
+	{
+		shell_error(sh, "Rate and duration must be > 0, size 1..%d",
+					CONFIG_MQTT_PAYLOAD_BUFFER_SIZE);
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&load_lock, K_FOREVER);
+
+	if (load.running)
+	{
+		k_mutex_unlock(&load_lock);
+		shell_error(sh, "Load already running");
+		return -EBUSY;
+	}
+
+	if (argc > 5)
+	{
+		if (resolve_topic(sh, argv[5], load.topic, sizeof(load.topic)))
+		{
+			k_mutex_unlock(&load_lock);
+			return -EINVAL;
+		}
+	}
+	else
+	{
+		snprintf(load.topic, sizeof(load.topic), "mqtt/%s/load", DEVICE_ID);
+	}
+
+	load.payload = mqtt_arena_alloc(size);
+	if (load.payload == NULL)
+	{
+		k_mutex_unlock(&load_lock);
+		shell_error(sh, "No arena memory for a %u byte payload", size);
+		return -ENOMEM;
+	}
+
+	memset(load.payload, 'L', size);
+	load.rate = rate;
+	load.size = size;
+	load.qos = qos;
+	load.duration_ms = duration_s * MSEC_PER_SEC;
+	load.sent = 0;
+	load.errors = 0;
+	load.start_ms = k_uptime_get();
+	load.running = true;
+
+	if (!load_work_q_started)
+	{
+		k_work_queue_start(&load_work_q, load_stack, K_THREAD_STACK_SIZEOF(load_stack),
+						   CONFIG_MQTT_SHELL_LOAD_PRIORITY, NULL);
+		k_thread_name_set(&load_work_q.thread, "mqtt_load");
+		load_work_q_started = true;
+	}
+
+	k_work_reschedule_for_queue(&load_work_q, &load_work, K_NO_WAIT);
+
+	k_mutex_unlock(&load_lock);
+
+	shell_print(sh, "Load: %u msg/s, %u bytes, QoS %u for %u s on %s", rate, size, qos,
+				duration_s, load.topic);
+
+	return 0;
+}
+
+static int cmd_load_stop(const struct shell *sh, size_t argc, char **argv)
+{
+	k_mutex_lock(&load_lock, K_FOREVER);
+
+	if (load.running)
+	{
+		load.end_ms = k_uptime_get();
+		load_finish();
+	}
+
+	k_mutex_unlock(&load_lock);
+
+	k_work_cancel_delayable(&load_work);
+	shell_print(sh, "Load stopped: %u sent, %u errors", load.sent, load.errors);
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_mqtt_load,
+							   SHELL_CMD_ARG(start, NULL,
+											 "<msg/s> <size> <qos> <duration s> [topic|#n]",
+											 cmd_load_start, 5, 1),
+							   SHELL_CMD(stop, NULL, "Stop the synthetic load", cmd_load_stop),
+							   SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_mqtt,
+							   SHELL_CMD(status, NULL, "Connection, arena, metrics and load state", cmd_mqtt_status),
+							   SHELL_CMD(topics, NULL, "List subscribe and publish topics", cmd_mqtt_topics),
+							   SHELL_CMD_ARG(pub, NULL, "<topic|#n> <qos> <message>", cmd_mqtt_pub, 4, 0),
+							   SHELL_CMD_ARG(sub, NULL, "<topic> [qos]", cmd_mqtt_sub, 2, 1),
+							   SHELL_CMD_ARG(unsub, NULL, "<topic>", cmd_mqtt_unsub, 2, 0),
+							   SHELL_CMD(load, &sub_mqtt_load, "Synthetic publish load", NULL),
+							   SHELL_CMD(reconnect, NULL, "Reconnect to the broker", cmd_mqtt_reconnect),
+							   SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(mqtt, &sub_mqtt, "MQTT client control", NULL);
\ No newline at end of file
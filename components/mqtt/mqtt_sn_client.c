@@ -0,0 +1,738 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_SN_CLIENT.c
+*/
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/mqtt_sn.h>
+#include <zephyr/logging/log.h>
+#include "mqtt.h"
+#include "mqtt_arena.h"
+#include "mqtt_outbox.h"
+#include "mqtt_sn_client.h"
+#include "mqtt_stream.h"
+#include "mqtt_topics.h"
+#include "mqtt_presence.h"
+#include "shadow.h"
+#include "lte.h"
+#include "boot.h"
+#include "metrics.h"
+#include "airtime.h"
+#include "data_usage.h"
+
+#define MQTT_SN_THREAD_PRIORITY 5
+
+LOG_MODULE_REGISTER(MQTT_SN);
+
+K_THREAD_STACK_DEFINE(mqtt_sn_stack, CONFIG_MQTT_THREAD_STACK_SIZE);
+static struct k_thread mqtt_sn_thread_data;
+
+static struct mqtt_sn_client client;
+static struct mqtt_sn_transport transport;
+static struct sockaddr_storage gateway;
+static int sock = -1;
+static uint8_t *tx_buffer;
+static uint8_t *rx_buffer;
+static bool transport_open;
+static bool connecting;
+static bool connected;
+static bool asleep;
+static int64_t reconnect_at_ms;
+static int64_t last_activity_ms;
+static uint32_t connect_start_ms;
+static bool resubscribe;
+static sys_slist_t rx_queue = SYS_SLIST_STATIC_INIT(&rx_queue);
+static K_MUTEX_DEFINE(sn_lock); /* The MQTT-SN library is not thread safe */
+
+struct rx_msg
+{
+	sys_snode_t node;
+	uint16_t topic_len;
+	uint16_t len;
+	uint8_t data[]; /* Topic, payload, terminator */
+};
+
+static int gateway_resolve(void)
+{
+	struct addrinfo *result;
+	struct addrinfo hints = {
+		.ai_family = AF_INET,
+		.ai_socktype = SOCK_DGRAM,
+	};
+	struct sockaddr_in *gateway4 = (struct sockaddr_in *)&gateway;
+	int err;
+
+	err = getaddrinfo(CONFIG_MQTT_SN_GATEWAY_HOSTNAME, NULL, &hints, &result);
+	if (err)
+	{
+		LOG_ERR("getaddrinfo failed: %d", err);
+		return -EHOSTUNREACH;
+	}
+
+	gateway4->sin_family = AF_INET;
+	gateway4->sin_port = htons(CONFIG_MQTT_SN_GATEWAY_PORT);
+	gateway4->sin_addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
+
+	freeaddrinfo(result);
+
+	return 0;
+}
+
+static int transport_init(struct mqtt_sn_transport *tp)
+{
+	int proto = IS_ENABLED(CONFIG_MQTT_SN_DTLS) ? IPPROTO_DTLS_1_2 : IPPROTO_UDP;
+	int err;
+
+	sock = socket(AF_INET, SOCK_DGRAM, proto);
+	if (sock < 0)
+	{
+		return -errno;
+	}
+
+#if defined(CONFIG_MQTT_SN_DTLS)
+	sec_tag_t sec_tag_list[] = {CONFIG_MQTT_SN_DTLS_SEC_TAG};
+	int verify = CONFIG_MQTT_TLS_PEER_VERIFY;
+
+	if (setsockopt(sock, SOL_TLS, TLS_PEER_VERIFY, &verify, sizeof(verify)) ||
+		setsockopt(sock, SOL_TLS, TLS_SEC_TAG_LIST, sec_tag_list, sizeof(sec_tag_list)) ||
+		setsockopt(sock, SOL_TLS, TLS_HOSTNAME, CONFIG_MQTT_SN_GATEWAY_HOSTNAME,
+				   strlen(CONFIG_MQTT_SN_GATEWAY_HOSTNAME)))
+	{
+		err = -errno;
+		goto fail;
+	}
+
+#if defined(TLS_DTLS_CID)
+	/* Keeps the DTLS session across NAT rebinding while the modem sleeps. */
+	int cid = TLS_DTLS_CID_SUPPORTED;
+
+	setsockopt(sock, SOL_TLS, TLS_DTLS_CID, &cid, sizeof(cid));
+#endif
+#endif
+
+	/* Connected datagram socket, the DTLS handshake runs here. */
+	if (connect(sock, (struct sockaddr *)&gateway, sizeof(struct sockaddr_in)) < 0)
+	{
+		err = -errno;
+		goto fail;
+	}
+
+	return 0;
+
+fail:
+	close(sock);
+	sock = -1;
+	return err;
+}
+
+static void transport_deinit(struct mqtt_sn_transport *tp)
+{
+	if (sock >= 0)
+	{
+		close(sock);
+		sock = -1;
+	}
+}
+
+static int transport_send(struct mqtt_sn_client *c, void *buf, size_t sz)
+{
+	if (send(sock, buf, sz, 0) < 0)
+	{
+		return -errno;
+	}
+
+	return 0;
+}
+
+static ssize_t transport_recv(struct mqtt_sn_client *c, void *buf, size_t sz)
+{
+	ssize_t n = recv(sock, buf, sz, MSG_DONTWAIT);
+
+	if (n < 0)
+	{
+		return -errno;
+	}
+
+	return n;
+}
+
+static int transport_poll(struct mqtt_sn_client *c)
+{
+	struct pollfd fds = {
+		.fd = sock,
+		.events = POLLIN,
+	};
+
+	return poll(&fds, 1, 0);
+}
+
+/*
+Function : rx_publish
+
+Description : Resolves the topic ID of a received publish and queues a copy of the
+			  topic and the NUL terminated payload. The receive handlers run from
+			  rx_deliver() once sn_lock is released, so they may publish and
+			  subscribe.
+
+Parameter :
+- p : Publish event parameters.
+
+Return : void
+
+Example Call :
+				rx_publish(&evt->param.publish);
+*/
+static void rx_publish(const struct mqtt_sn_evt_publish *p)
+{
+	struct mqtt_sn_data name;
+	struct rx_msg *msg;
+
+	if (mqtt_sn_get_topic_name(&client, p->topic_id, &name) != 0)
+	{
+		LOG_WRN("Publish on unknown topic ID %u dropped", p->topic_id);
+		return;
+	}
+
+	airtime_rx((const char *)name.data, name.size, p->data.size);
+	data_usage_publish((const char *)name.data, name.size, p->data.size, MQTT_QOS_0_AT_MOST_ONCE);
+
+	msg = mqtt_arena_alloc(sizeof(*msg) + name.size + p->data.size + 1);
+	if (msg == NULL)
+	{
+		metrics_inc(METRIC_MQTT_RX_TRUNCATED);
+		LOG_ERR("Received payload (%u bytes) dropped, arena exhausted", p->data.size);
+		return;
+	}
+
+	msg->topic_len = name.size;
+	msg->len = p->data.size;
+	memcpy(msg->data, name.data, name.size);
+	memcpy(&msg->data[name.size], p->data.data, p->data.size);
+	msg->data[name.size + p->data.size] = '\0';
+
+	sys_slist_append(&rx_queue, &msg->node);
+}
+
+static void rx_deliver(void)
+{
+	sys_snode_t *node;
+
+	while ((node = sys_slist_get(&rx_queue)) != NULL)
+	{
+		struct rx_msg *msg = CONTAINER_OF(node, struct rx_msg, node);
+		struct mqtt_utf8 topic = {
+			.utf8 = msg->data,
+			.size = msg->topic_len,
+		};
+
+		mqtt_rx_dispatch(&topic, &msg->data[msg->topic_len], msg->len);
+		mqtt_arena_free(msg);
+	}
+}
+
+static void evt_handler(struct mqtt_sn_client *c, const struct mqtt_sn_evt *evt)
+{
+	switch (evt->type)
+	{
+	case MQTT_SN_EVT_CONNECTED:
+		LOG_INF("MQTT-SN client connected");
+		connecting = false;
+		last_activity_ms = k_uptime_get();
+		if (asleep)
+		{
+			/* Woken up, the session and its subscriptions are kept. */
+			asleep = false;
+			connected = true;
+			break;
+		}
+		connected = true;
+		metrics_hist_record(METRIC_HIST_MQTT_CONNECT_MS,
+							k_uptime_get_32() - connect_start_ms);
+		boot_stage_end(BOOT_STAGE_MQTT_CONNECT, 0);
+		resubscribe = true;
+		break;
+
+	case MQTT_SN_EVT_DISCONNECTED:
+		LOG_INF("MQTT-SN client disconnected");
+		connecting = false;
+		connected = false;
+		asleep = false;
+		if (RECONNECT_MQTT)
+		{
+			metrics_inc(METRIC_MQTT_RECONNECT);
+			reconnect_at_ms = k_uptime_get() + CONFIG_MQTT_RECONNECT_DELAY_S * MSEC_PER_SEC;
+		}
+		break;
+
+	case MQTT_SN_EVT_ASLEEP:
+		LOG_INF("MQTT-SN client asleep");
+		connected = false;
+		asleep = true;
+		break;
+
+	case MQTT_SN_EVT_AWAKE:
+		LOG_DBG("MQTT-SN client awake, receiving buffered messages");
+		break;
+
+	case MQTT_SN_EVT_PUBLISH:
+		last_activity_ms = k_uptime_get();
+		rx_publish(&evt->param.publish);
+		break;
+
+	default:
+		break;
+	}
+}
+
+static int client_open(void)
+{
+	struct mqtt_sn_data client_id = {
+		.data = (const uint8_t *)DEVICE_ID,
+		.size = strlen(DEVICE_ID),
+	};
+	int err;
+
+	if (tx_buffer == NULL)
+	{
+		tx_buffer = mqtt_arena_alloc(CONFIG_MQTT_SN_BUFFER_SIZE);
+		rx_buffer = mqtt_arena_alloc(CONFIG_MQTT_SN_BUFFER_SIZE);
+		if (tx_buffer == NULL || rx_buffer == NULL)
+		{
+			LOG_ERR("No arena memory for the MQTT-SN buffers");
+			return -ENOMEM;
+		}
+	}
+
+	err = gateway_resolve();
+	if (err)
+	{
+		return err;
+	}
+
+	transport.init = transport_init;
+	transport.deinit = transport_deinit;
+	transport.msg_send = transport_send;
+	transport.recv = transport_recv;
+	transport.poll = transport_poll;
+
+	err = mqtt_sn_client_init(&client, &client_id, &transport, evt_handler, tx_buffer,
+							  CONFIG_MQTT_SN_BUFFER_SIZE, rx_buffer, CONFIG_MQTT_SN_BUFFER_SIZE);
+	if (err)
+	{
+		LOG_ERR("mqtt_sn_client_init failed: %d", err);
+		return err;
+	}
+
+#if defined(CONFIG_MQTT_PRESENCE)
+	const char *status = mqtt_presence_topic();
+
+	if (status != NULL)
+	{
+		/* Sent when the gateway asks for it with WILLTOPICREQ/WILLMSGREQ. */
+		client.will_topic.data = (const uint8_t *)status;
+		client.will_topic.size = strlen(status);
+		client.will_msg.data = (const uint8_t *)CONFIG_MQTT_PRESENCE_OFFLINE;
+		client.will_msg.size = strlen(CONFIG_MQTT_PRESENCE_OFFLINE);
+		client.will_qos = MQTT_SN_QOS_1;
+		client.will_retain = true;
+	}
+#endif
+
+	transport_open = true;
+
+	return 0;
+}
+
+static void client_close(void)
+{
+	mqtt_sn_client_deinit(&client);
+	transport_open = false;
+	connecting = false;
+	connected = false;
+	asleep = false;
+}
+
+/* Sends CONNECT. A clean session only for the first connection of a transport. */
+static void client_connect(bool clean_session)
+{
+	int err;
+
+	connect_start_ms = k_uptime_get_32();
+	connecting = true;
+
+	err = mqtt_sn_connect(&client, client.will_topic.size > 0, clean_session);
+	if (err)
+	{
+		LOG_ERR("mqtt_sn_connect failed: %d", err);
+		connecting = false;
+		reconnect_at_ms = k_uptime_get() + CONFIG_MQTT_RECONNECT_DELAY_S * MSEC_PER_SEC;
+		return;
+	}
+
+	if (clean_session)
+	{
+		/* The first CONNECT of a transport follows its DTLS handshake. */
+		data_usage_connect(strlen(DEVICE_ID));
+	}
+}
+
+/* Shortens timeout_ms to the deadline at_ms, -1 meaning no timeout. */
+static int deadline_min(int timeout_ms, int64_t at_ms, int64_t now)
+{
+	int64_t left = MAX(at_ms - now, 0);
+
+	return (timeout_ms < 0 || left < timeout_ms) ? (int)left : timeout_ms;
+}
+
+/*
+Function : step_timeout
+
+Description : Returns how long the MQTT-SN thread may block after a pass: until the
+			  keepalive (or, asleep, the sleep duration) comes round, the idle client
+			  is due to sleep, a reconnect is due, or the outbox has something to
+			  send. A message queued meanwhile wakes the poll through the outbox
+			  eventfd, so there is no periodic wakeup.
+
+Parameter :
+- now : Uptime at the start of the pass.
+
+Return :
+Poll timeout in milliseconds.
+
+Example Call :
+				return step_timeout(now);
+*/
+static int step_timeout(int64_t now)
+{
+	int period_s = asleep ? CONFIG_MQTT_SN_SLEEP_S : CONFIG_MQTT_SN_KEEPALIVE;
+	int timeout_ms = period_s > 0 ? period_s * MSEC_PER_SEC : -1;
+
+	if (connected && CONFIG_MQTT_SN_SLEEP_S > 0)
+	{
+		timeout_ms = deadline_min(timeout_ms,
+								  last_activity_ms + CONFIG_MQTT_SN_IDLE_S * MSEC_PER_SEC, now);
+	}
+	else if (!connected && !connecting && !asleep && CONNECT_MQTT)
+	{
+		timeout_ms = deadline_min(timeout_ms, reconnect_at_ms, now);
+	}
+
+	return mqtt_outbox_poll_timeout(timeout_ms);
+}
+
+/*
+Function : mqtt_sn_step
+
+Description : One pass of the MQTT-SN thread: opens the transport once LTE is up,
+			  (re)connects, handles input, drains the outbox and puts an idle client
+			  to sleep. sn_lock is only held around the library calls, the receive
+			  handlers, the topic registry and the outbox run without it.
+
+Parameter : void
+
+Return :
+Poll timeout for the next pass in milliseconds, see step_timeout().
+
+Example Call :
+				timeout = mqtt_sn_step();
+*/
+static int mqtt_sn_step(void)
+{
+	int64_t now = k_uptime_get();
+	int err = 0;
+
+	if (DISCONNECT_MQTT && connected)
+	{
+		/* The gateway drops the will on DISCONNECT. Sent before sn_lock, as the
+		 * publish looks up the topic registry.
+		 */
+		mqtt_presence_offline();
+	}
+
+	k_mutex_lock(&sn_lock, K_FOREVER);
+
+	if (!transport_open)
+	{
+		boot_stage_begin(BOOT_STAGE_MQTT_CONNECT);
+
+		err = client_open();
+		if (err == 0)
+		{
+			client_connect(true);
+		}
+	}
+	else if (!connected && !connecting && !asleep && CONNECT_MQTT && now >= reconnect_at_ms)
+	{
+		client_connect(false);
+	}
+
+	if (transport_open)
+	{
+		err = mqtt_sn_input(&client);
+		if (err < 0 && err != -EAGAIN)
+		{
+			/* DTLS session lost, e.g. after a long sleep: handshake again. */
+			LOG_WRN("MQTT-SN input failed: %d, reopening the transport", err);
+			client_close();
+		}
+	}
+
+	if (DISCONNECT_MQTT && connected)
+	{
+		DISCONNECT_MQTT = false;
+		mqtt_sn_disconnect(&client);
+	}
+
+	k_mutex_unlock(&sn_lock);
+
+	if (!transport_open)
+	{
+		return CONFIG_MQTT_RECONNECT_DELAY_S * MSEC_PER_SEC;
+	}
+
+	rx_deliver();
+
+	if (resubscribe)
+	{
+		resubscribe = false;
+		mqtt_topics_resubscribe(NULL);
+		mqtt_presence_online();
+		shadow_on_connect();
+	}
+
+	if (asleep && !connecting && mqtt_outbox_pending())
+	{
+		LOG_DBG("Waking up for queued messages");
+		k_mutex_lock(&sn_lock, K_FOREVER);
+		client_connect(false);
+		k_mutex_unlock(&sn_lock);
+	}
+
+	if (connected)
+	{
+		mqtt_outbox_drain();
+
+		if (CONFIG_MQTT_SN_SLEEP_S > 0 &&
+			now - last_activity_ms >= CONFIG_MQTT_SN_IDLE_S * MSEC_PER_SEC)
+		{
+			k_mutex_lock(&sn_lock, K_FOREVER);
+			err = mqtt_sn_sleep(&client, CONFIG_MQTT_SN_SLEEP_S);
+			k_mutex_unlock(&sn_lock);
+			if (err)
+			{
+				LOG_WRN("mqtt_sn_sleep failed: %d", err);
+				last_activity_ms = now;
+			}
+		}
+	}
+
+	return step_timeout(now);
+}
+
+static void mqtt_sn_thread(void)
+{
+	struct pollfd fds[2] = {
+		{.events = POLLIN},
+		{.fd = mqtt_outbox_wake_fd(), .events = POLLIN},
+	};
+
+	while (lte_wait_connected(K_SECONDS(CONFIG_MQTT_LTE_WAIT_TIMEOUT_S)) != 0)
+	{
+		LOG_WRN("LTE not connected after %d s, still waiting",
+				CONFIG_MQTT_LTE_WAIT_TIMEOUT_S);
+	}
+
+	while (1)
+	{
+		int timeout = mqtt_sn_step();
+
+		fds[0].fd = sock;
+		if (fds[0].fd < 0)
+		{
+			k_msleep(timeout);
+			continue;
+		}
+
+		if (poll(fds, 2, timeout) < 0)
+		{
+			LOG_ERR("Error in poll(): %d", errno);
+			metrics_inc(METRIC_MQTT_POLL_ERROR);
+			k_msleep(100);
+			continue;
+		}
+
+		if ((fds[1].revents & POLLIN) == POLLIN)
+		{
+			mqtt_outbox_wake_clear();
+		}
+	}
+}
+
+/*
+Function : mqtt_sn_client_start
+
+Description : Starts the MQTT-SN thread. Called by MQTT_configure() in place of the
+			  MQTT thread.
+
+Parameter : void
+
+Return : void
+
+Example Call :
+				mqtt_sn_client_start();
+*/
+void mqtt_sn_client_start(void)
+{
+	/* Registers the status topic now, client_open() runs with sn_lock held. */
+	(void)mqtt_presence_topic();
+
+	k_thread_create(&mqtt_sn_thread_data, mqtt_sn_stack, K_THREAD_STACK_SIZEOF(mqtt_sn_stack),
+					(k_thread_entry_t)mqtt_sn_thread, NULL, NULL, NULL, MQTT_SN_THREAD_PRIORITY,
+					0, K_NO_WAIT);
+	k_thread_name_set(&mqtt_sn_thread_data, "mqtt_sn");
+}
+
+/*
+Function : mqtt_sn_client_connected
+
+Description : Returns whether the client is connected and awake.
+
+Parameter : void
+
+Return :
+true when connected.
+
+Example Call :
+				return mqtt_sn_client_connected();
+*/
+bool mqtt_sn_client_connected(void)
+{
+	return connected;
+}
+
+/*
+Function : mqtt_sn_client_publish
+
+Description : Publishes through the gateway. The topic is registered on first use
+			  in a session, later publishes carry its 2 byte ID. A sleeping client is
+			  woken up and the publish refused with -EAGAIN until it is awake.
+
+Parameter :
+- topic : Topic string.
+- qos : Quality of Service level.
+- data : Data buffer to send, copied by the MQTT-SN library.
+- len : Length of the data.
+
+Return :
+0 on success, -ENOTCONN if not connected, -EAGAIN while waking up or above the rate
+limit, -ENOSPC if the topic is dropped over the data budget, or the library error.
+
+Example Call :
+				mqtt_sn_client_publish(topic, MQTT_QOS_1_AT_LEAST_ONCE, buf, len);
+*/
+int mqtt_sn_client_publish(const char *topic, enum mqtt_qos qos, const uint8_t *data,
+						   size_t len)
+{
+	struct mqtt_publish_param param = {0};
+	struct mqtt_sn_data topic_name = {
+		.data = (const uint8_t *)topic,
+		.size = strlen(topic),
+	};
+	struct mqtt_sn_data payload = {
+		.data = data,
+		.size = len,
+	};
+	/* Looked up before sn_lock, the registry calls in here with topics_lock held. */
+	bool retain = mqtt_topics_retained(topic);
+	int err;
+
+	k_mutex_lock(&sn_lock, K_FOREVER);
+
+	if (!connected)
+	{
+		err = -ENOTCONN;
+		if (asleep)
+		{
+			if (!connecting)
+			{
+				client_connect(false);
+			}
+			err = -EAGAIN;
+		}
+		goto out;
+	}
+
+	if (!data_usage_topic_allowed(topic))
+	{
+		err = -ENOSPC;
+		goto out;
+	}
+
+	param.message.topic.qos = qos;
+	param.message.topic.topic.utf8 = topic;
+	param.message.topic.topic.size = topic_name.size;
+	param.message.payload.len = len;
+
+	err = mqtt_publish_begin(&param);
+	if (err)
+	{
+		goto out;
+	}
+
+	err = mqtt_sn_publish(&client, (enum mqtt_sn_qos)qos, &topic_name, retain, &payload);
+	mqtt_publish_end(&param, err);
+
+	last_activity_ms = k_uptime_get();
+
+out:
+	k_mutex_unlock(&sn_lock);
+
+	return err;
+}
+
+/*
+Function : mqtt_sn_client_subscribe
+
+Description : Subscribes to or unsubscribes from a list of topics, one MQTT-SN
+			  packet per topic. Used by the topic registry in place of a batched
+			  SUBSCRIBE or UNSUBSCRIBE.
+
+Parameter :
+- list : Topics and QoS.
+- count : Number of topics.
+- subscribe : true to subscribe, false to unsubscribe.
+
+Return :
+0 on success, or the first library error.
+
+Example Call :
+				err = mqtt_sn_client_subscribe(list, n, true);
+*/
+int mqtt_sn_client_subscribe(const struct mqtt_topic *list, size_t count, bool subscribe)
+{
+	int err = 0;
+
+	k_mutex_lock(&sn_lock, K_FOREVER);
+
+	for (size_t i = 0; i < count && err == 0; i++)
+	{
+		struct mqtt_sn_data name = {
+			.data = list[i].topic.utf8,
+			.size = list[i].topic.size,
+		};
+		enum mqtt_sn_qos qos = (enum mqtt_sn_qos)list[i].qos;
+
+		err = subscribe ? mqtt_sn_subscribe(&client, qos, &name)
+						: mqtt_sn_unsubscribe(&client, qos, &name);
+	}
+
+	k_mutex_unlock(&sn_lock);
+
+	return err;
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_SN_CLIENT.h
+*/
+
+#ifndef _MQTT_SN_CLIENT_H_
+#define _MQTT_SN_CLIENT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/net/mqtt.h>
+
+/*
+ * MQTT-SN transport of the MQTT component (CONFIG_MQTT_SN_TRANSPORT). The
+ * client talks to an MQTT-SN gateway over UDP, or DTLS on the nRF91 modem,
+ * instead of to the broker over TCP/TLS. The public API of mqtt.h stays the
+ * same: publishes, the outbox, the topic registry and the receive handlers are
+ * routed here. Topic names are registered with the gateway once per session
+ * and then sent as 2 byte topic IDs.
+ *
+ * With CONFIG_MQTT_SN_SLEEP_S set, the client goes to sleep after
+ * CONFIG_MQTT_SN_IDLE_S without traffic. The gateway then buffers messages for
+ * it, and a publish or a queued outbox message wakes it up again.
+ *
+ * Acknowledgments are handled inside the MQTT-SN library, so there are no
+ * packet identifiers and ack handlers are not called. Streamed publishes are
+ * not supported.
+ */
+
+#if defined(CONFIG_MQTT_SN_TRANSPORT)
+
+void mqtt_sn_client_start(void);
+bool mqtt_sn_client_connected(void);
+int mqtt_sn_client_publish(const char *topic, enum mqtt_qos qos, const uint8_t *data,
+						   size_t len);
+int mqtt_sn_client_subscribe(const struct mqtt_topic *list, size_t count, bool subscribe);
+
+#endif
+
+/* Provided by mqtt.c. */
+void mqtt_rx_dispatch(const struct mqtt_utf8 *topic, const uint8_t *data, size_t len);
+
+#endif
\ No newline at end of file
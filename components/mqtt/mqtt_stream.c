@@ -0,0 +1,271 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_STREAM.c
+*/
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/mutex.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/logging/log.h>
+#include "mqtt.h"
+#include "mqtt_arena.h"
+#include "mqtt_coalesce.h"
+#include "mqtt_stream.h"
+#include "mqtt_topics.h"
+#include "data_usage.h"
+
+#define STREAM_PUBLISH_TYPE 0x30 // PUBLISH packet type, QoS in bits 1-2, RETAIN in bit 0
+#define STREAM_HEADER_MAX 9		 // Fixed header, topic length and packet id besides the topic
+#define STREAM_TOPIC_MAX 128	 // Longest topic of a streamed publish
+
+LOG_MODULE_REGISTER(MQTT_STREAM);
+
+static int client_socket(const struct mqtt_client *c)
+{
+#if defined(CONFIG_MQTT_COALESCE)
+	if (c->transport.type == MQTT_TRANSPORT_CUSTOM)
+	{
+		return mqtt_coalesce_socket();
+	}
+#endif
+#if defined(CONFIG_MQTT_LIB_TLS)
+	if (c->transport.type == MQTT_TRANSPORT_SECURE)
+	{
+		return c->transport.tls.sock;
+	}
+#endif
+	return c->transport.tcp.sock;
+}
+
+static int send_all(int sock, const uint8_t *buf, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t n = send(sock, buf, len, 0);
+
+		if (n < 0)
+		{
+			return -errno;
+		}
+
+		buf += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/*
+Function : header_encode
+
+Description : Encodes the PUBLISH fixed header, topic and packet identifier for a
+			  payload of the given total length.
+
+Parameter :
+- buf : Output buffer of at least STREAM_HEADER_MAX plus the topic length.
+- param : Publish parameters, payload.len is the total length.
+
+Return :
+Length of the encoded header.
+
+Example Call :
+				len = header_encode(buf, &param);
+*/
+static size_t header_encode(uint8_t *buf, const struct mqtt_publish_param *param)
+{
+	const struct mqtt_topic *topic = &param->message.topic;
+	uint32_t remaining = 2 + topic->topic.size + param->message.payload.len;
+	size_t pos = 0;
+
+	if (topic->qos != MQTT_QOS_0_AT_MOST_ONCE)
+	{
+		remaining += 2;
+	}
+
+	buf[pos++] = STREAM_PUBLISH_TYPE | (topic->qos << 1) | (param->retain_flag ? 1 : 0);
+
+	do
+	{
+		uint8_t digit = remaining % 128;
+
+		remaining /= 128;
+		buf[pos++] = remaining ? (digit | 0x80) : digit;
+	} while (remaining);
+
+	sys_put_be16(topic->topic.size, &buf[pos]);
+	pos += 2;
+	memcpy(&buf[pos], topic->topic.utf8, topic->topic.size);
+	pos += topic->topic.size;
+
+	if (topic->qos != MQTT_QOS_0_AT_MOST_ONCE)
+	{
+		sys_put_be16(param->message_id, &buf[pos]);
+		pos += 2;
+	}
+
+	return pos;
+}
+
+/*
+Function : mqtt_publish_stream
+
+Description : Publishes one message of total_len bytes without holding the payload
+			  in RAM. The payload is pulled from read() in pieces of at most
+			  CONFIG_MQTT_STREAM_CHUNK_SIZE bytes and written straight to the socket,
+			  so the RAM used does not depend on the message size. Input is not
+			  handled while the message is sent; send large files with the chunked
+			  upload (mqtt_upload.h) when commands must get through in between.
+			  The first piece is read before the header is sent, so a failing
+			  source sends nothing. A later read error or a send error leaves the
+			  packet the header announced incomplete: the connection is aborted
+			  and the error returned, the client reconnects as after any drop.
+			  The client mutex is held from the header to the last byte, reads
+			  included. Keepalive pings, acks and every other publish wait that
+			  long, so keep total_len well below what the uplink sends in
+			  CONFIG_MQTT_KEEPALIVE seconds.
+
+Parameter :
+- topic : Topic string.
+- qos : Quality of Service level.
+- total_len : Payload length, at most 268435455 bytes.
+- read : Callback filling buf with payload bytes from offset, returns the count.
+- ctx : Argument for read.
+- message_id : Optional in/out packet identifier, as for mqtt_publish_topic_id().
+
+Return :
+0 on success, -ENOTSUP over MQTT-SN, -ENOTCONN if not connected, -EAGAIN above the rate limit, -ENOMEM if
+the arena is exhausted, -EINVAL for a topic longer than 128 bytes, or the read/send
+error. A read error other than on the first piece also aborts the connection.
+
+Example Call :
+				mqtt_publish_stream(topic, MQTT_QOS_1_AT_LEAST_ONCE, size, read_flash, &area, NULL);
+*/
+int mqtt_publish_stream(const char *topic,
+						enum mqtt_qos qos,
+						size_t total_len,
+						mqtt_stream_read_cb_t read,
+						void *ctx,
+						uint16_t *message_id)
+{
+	struct mqtt_client *c = mqtt_client_get();
+	struct mqtt_publish_param param = {0};
+	uint8_t hdr[STREAM_HEADER_MAX + STREAM_TOPIC_MAX];
+	size_t hdr_len;
+	size_t offset = 0;
+	size_t len;
+	uint8_t *buf;
+	int sock;
+	int err;
+	int n;
+
+	if (IS_ENABLED(CONFIG_MQTT_SN_TRANSPORT))
+	{
+		return -ENOTSUP;
+	}
+
+	if (!mqtt_is_connected())
+	{
+		return -ENOTCONN;
+	}
+
+	if (!data_usage_topic_allowed(topic))
+	{
+		return -ENOSPC;
+	}
+
+	param.message.topic.qos = qos;
+	param.message.topic.topic.utf8 = topic;
+	param.message.topic.topic.size = strlen(topic);
+	param.message.payload.len = total_len;
+	param.retain_flag = mqtt_topics_retained(topic);
+	param.message_id = (message_id && *message_id) ? *message_id : mqtt_next_message_id();
+
+	if (message_id)
+	{
+		*message_id = param.message_id;
+	}
+
+	if (total_len > 268435455 || param.message.topic.topic.size > STREAM_TOPIC_MAX)
+	{
+		return -EINVAL;
+	}
+
+	buf = mqtt_arena_alloc(CONFIG_MQTT_STREAM_CHUNK_SIZE);
+	if (buf == NULL)
+	{
+		return -ENOMEM;
+	}
+
+	/* The first piece is read before anything is sent, so a source that cannot
+	 * be read leaves the connection untouched.
+	 */
+	n = total_len > 0 ? read(ctx, 0, buf, MIN(total_len, CONFIG_MQTT_STREAM_CHUNK_SIZE)) : 0;
+	if (total_len > 0 && n <= 0)
+	{
+		mqtt_arena_free(buf);
+		return n < 0 ? n : -EIO;
+	}
+
+	err = mqtt_publish_begin(&param);
+	if (err)
+	{
+		mqtt_arena_free(buf);
+		return err;
+	}
+
+	LOG_INF("Streaming %u bytes to topic: %s", (unsigned int)total_len, topic);
+
+	/* Keeps every other writer, including the MQTT thread, off the socket. */
+	sys_mutex_lock(&c->internal.mutex, K_FOREVER);
+
+	sock = client_socket(c);
+	hdr_len = header_encode(hdr, &param);
+
+	/* Packets gathered for a coalesced send go first. */
+	err = mqtt_coalesce_flush(c);
+	if (err == 0)
+	{
+		err = send_all(sock, hdr, hdr_len);
+	}
+
+	while (err == 0 && offset < total_len)
+	{
+		err = send_all(sock, buf, n);
+		offset += n;
+
+		if (err || offset == total_len)
+		{
+			break;
+		}
+
+		len = MIN(total_len - offset, CONFIG_MQTT_STREAM_CHUNK_SIZE);
+		n = read(ctx, offset, buf, len);
+		if (n <= 0)
+		{
+			err = n < 0 ? n : -EIO;
+		}
+	}
+
+	c->internal.last_activity = k_uptime_get_32();
+
+	sys_mutex_unlock(&c->internal.mutex);
+
+	if (err)
+	{
+		/* The packet the header announced is incomplete, nothing can follow it. */
+		LOG_ERR("Streamed publish failed after %u of %u bytes: %d", (unsigned int)offset,
+				(unsigned int)total_len, err);
+		mqtt_abort(c);
+	}
+
+	mqtt_publish_end(&param, err);
+	mqtt_arena_free(buf);
+
+	return err;
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_STREAM.h
+*/
+
+#ifndef _MQTT_STREAM_H_
+#define _MQTT_STREAM_H_
+
+#include <zephyr/net/mqtt.h>
+
+/*
+ * Streamed publish of the MQTT component. mqtt_publish_stream() (declared in
+ * mqtt.h) writes the PUBLISH header with the total length and then pulls the
+ * payload from a read callback into one CONFIG_MQTT_STREAM_CHUNK_SIZE arena
+ * buffer and onto the socket, piece by piece. The packet must reach the socket
+ * in one piece, so the client mutex is held from the header to the last byte,
+ * reads included. Meanwhile the MQTT thread cannot send keepalive pings or acks
+ * and every other publish blocks: a message that takes longer than the
+ * keepalive to send gets the connection dropped by the broker. Use the chunked
+ * upload (mqtt_upload.h) for anything that slow. A read error after the header
+ * aborts the connection.
+ */
+
+/* Provided by mqtt.c, shared with publishes sent through mqtt_publish(). */
+int mqtt_publish_begin(const struct mqtt_publish_param *param);
+void mqtt_publish_end(const struct mqtt_publish_param *param, int err);
+
+#endif
\ No newline at end of file
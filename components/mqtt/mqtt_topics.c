@@ -0,0 +1,552 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_TOPICS.c
+*/
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/slist.h>
+#include "mqtt.h"
+#include "mqtt_arena.h"
+#include "mqtt_topics.h"
+#include "mqtt_sn_client.h"
+#include "data_usage.h"
+
+/* SUBSCRIBE/UNSUBSCRIBE fixed header, packet id and per-topic length/QoS bytes. */
+#define PACKET_OVERHEAD 7
+#define TOPIC_OVERHEAD 3
+#define ACK_OVERHEAD 4 // SUBACK/UNSUBACK without the per-topic return codes
+
+LOG_MODULE_REGISTER(MQTT_TOPICS);
+
+enum topic_state
+{
+	TOPIC_SUB_PENDING,	 /* Not yet subscribed in this session */
+	TOPIC_SUBSCRIBED,	 /* SUBSCRIBE sent */
+	TOPIC_UNSUB_PENDING, /* Subscribed, UNSUBSCRIBE not yet sent */
+};
+
+struct topic_entry
+{
+	sys_snode_t node;
+	uint8_t qos;
+	uint8_t state;
+	uint8_t retain; /* Publish topics: send with the RETAIN flag */
+	uint16_t len;
+	char topic[]; /* Exact length plus terminator */
+};
+
+static sys_slist_t sub_list = SYS_SLIST_STATIC_INIT(&sub_list);
+static sys_slist_t pub_list = SYS_SLIST_STATIC_INIT(&pub_list);
+static K_MUTEX_DEFINE(topics_lock);
+
+static void flush_work_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(flush_work, flush_work_fn);
+
+static struct topic_entry *entry_new(const char *topic)
+{
+	size_t len = strlen(topic);
+	struct topic_entry *e = mqtt_arena_alloc(sizeof(*e) + len + 1);
+
+	if (e)
+	{
+		e->retain = 0;
+		e->len = len;
+		memcpy(e->topic, topic, len + 1);
+	}
+
+	return e;
+}
+
+static struct topic_entry *entry_find(sys_slist_t *list, const char *topic)
+{
+	struct topic_entry *e;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(list, e, node)
+	{
+		if (strcmp(e->topic, topic) == 0)
+		{
+			return e;
+		}
+	}
+
+	return NULL;
+}
+
+static void entry_remove(sys_slist_t *list, struct topic_entry *e)
+{
+	sys_slist_find_and_remove(list, &e->node);
+	mqtt_arena_free(e);
+}
+
+/*
+Function : send_batches
+
+Description : Sends every entry in the given state in as few SUBSCRIBE or UNSUBSCRIBE
+			  packets as the tx buffer allows and advances their state. Called with
+			  topics_lock held.
+
+Parameter :
+- c : Pointer to the MQTT client.
+- state : TOPIC_SUB_PENDING or TOPIC_UNSUB_PENDING.
+
+Return :
+0 on success, or the first mqtt_subscribe()/mqtt_unsubscribe() error.
+
+Example Call :
+				send_batches(c, TOPIC_SUB_PENDING);
+*/
+static int send_batches(struct mqtt_client *c, enum topic_state state)
+{
+	bool subscribe = (state == TOPIC_SUB_PENDING);
+	struct mqtt_topic *list;
+	struct topic_entry *e;
+	struct topic_entry *tmp;
+	size_t count = 0;
+	int err = 0;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&sub_list, e, node)
+	{
+		count += (e->state == state);
+	}
+
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	list = mqtt_arena_alloc(count * sizeof(*list));
+	if (list == NULL)
+	{
+		return -ENOMEM;
+	}
+
+	e = SYS_SLIST_PEEK_HEAD_CONTAINER(&sub_list, e, node);
+
+	while (e != NULL && err == 0)
+	{
+		struct topic_entry *first = e;
+		size_t bytes = PACKET_OVERHEAD;
+		size_t n = 0;
+
+		/* Fill one packet. */
+		for (; e != NULL; e = SYS_SLIST_PEEK_NEXT_CONTAINER(e, node))
+		{
+			if (e->state != state)
+			{
+				continue;
+			}
+
+			if (n > 0 && bytes + e->len + TOPIC_OVERHEAD > CONFIG_MQTT_MESSAGE_BUFFER_SIZE)
+			{
+				break;
+			}
+
+			list[n].topic.utf8 = e->topic;
+			list[n].topic.size = e->len;
+			list[n].qos = e->qos;
+			bytes += e->len + TOPIC_OVERHEAD;
+			n++;
+		}
+
+		if (n == 0)
+		{
+			break;
+		}
+
+		const struct mqtt_subscription_list packet = {
+			.list = list,
+			.list_count = n,
+			.message_id = mqtt_next_message_id(),
+		};
+
+#if defined(CONFIG_MQTT_SN_TRANSPORT)
+		/* MQTT-SN has one topic per (UN)SUBSCRIBE. */
+		err = mqtt_sn_client_subscribe(packet.list, n, subscribe);
+#else
+		err = subscribe ? mqtt_subscribe(c, &packet) : mqtt_unsubscribe(c, &packet);
+#endif
+		if (err)
+		{
+			LOG_ERR("%s of %u topics failed: %d", subscribe ? "SUBSCRIBE" : "UNSUBSCRIBE",
+					(unsigned int)n, err);
+			break;
+		}
+
+		LOG_INF("%s %u topics, packet id %u", subscribe ? "SUBSCRIBE" : "UNSUBSCRIBE",
+				(unsigned int)n, packet.message_id);
+		data_usage_control(bytes + ACK_OVERHEAD + (subscribe ? n : 0), 2);
+
+		/* Advance the state of the entries that went into this packet. */
+		for (struct topic_entry *s = first; s != e; s = tmp)
+		{
+			tmp = SYS_SLIST_PEEK_NEXT_CONTAINER(s, node);
+
+			if (s->state != state)
+			{
+				continue;
+			}
+
+			if (subscribe)
+			{
+				s->state = TOPIC_SUBSCRIBED;
+			}
+			else
+			{
+				entry_remove(&sub_list, s);
+			}
+		}
+	}
+
+	mqtt_arena_free(list);
+
+	return err;
+}
+
+static void flush_work_fn(struct k_work *work)
+{
+	struct mqtt_client *c = mqtt_client_get();
+
+	if (!mqtt_is_connected())
+	{
+		/* Everything is subscribed again after CONNACK. */
+		return;
+	}
+
+	k_mutex_lock(&topics_lock, K_FOREVER);
+
+	send_batches(c, TOPIC_UNSUB_PENDING);
+	send_batches(c, TOPIC_SUB_PENDING);
+
+	k_mutex_unlock(&topics_lock);
+}
+
+/*
+Function : mqtt_topics_add_subscribe
+
+Description : Adds a topic to the subscribe list. Used at boot and by
+			  mqtt_subscribe_topic().
+
+Parameter :
+- topic : Topic filter.
+- qos : Requested QoS.
+
+Return :
+0 on success, -EALREADY if already subscribed with this QoS, -ENOMEM if the arena is
+exhausted.
+
+Example Call :
+				mqtt_topics_add_subscribe("devices/1234/cmd", MQTT_QOS_1_AT_LEAST_ONCE);
+*/
+int mqtt_topics_add_subscribe(const char *topic, enum mqtt_qos qos)
+{
+	struct topic_entry *e;
+
+	k_mutex_lock(&topics_lock, K_FOREVER);
+
+	e = entry_find(&sub_list, topic);
+	if (e)
+	{
+		if (e->qos == qos && e->state != TOPIC_UNSUB_PENDING)
+		{
+			k_mutex_unlock(&topics_lock);
+			return -EALREADY;
+		}
+
+		/* A pending unsubscribe is cancelled, a new QoS needs a new SUBSCRIBE. */
+		e->state = (e->qos == qos) ? TOPIC_SUBSCRIBED : TOPIC_SUB_PENDING;
+		e->qos = qos;
+	}
+	else
+	{
+		e = entry_new(topic);
+		if (e == NULL)
+		{
+			k_mutex_unlock(&topics_lock);
+			LOG_ERR("No arena memory for topic: %s", topic);
+			return -ENOMEM;
+		}
+
+		e->qos = qos;
+		e->state = TOPIC_SUB_PENDING;
+		sys_slist_append(&sub_list, &e->node);
+	}
+
+	k_mutex_unlock(&topics_lock);
+
+	k_work_schedule(&flush_work, K_MSEC(CONFIG_MQTT_SUB_BATCH_DELAY_MS));
+
+	LOG_DBG("Subscribe topic added: %s", topic);
+
+	return 0;
+}
+
+/*
+Function : mqtt_topics_add_publish
+
+Description : Adds a topic to the publish list.
+
+Parameter :
+- topic : Topic.
+
+Return :
+0 on success, -ENOMEM if the arena is exhausted.
+
+Example Call :
+				mqtt_topics_add_publish("devices/1234/data");
+*/
+int mqtt_topics_add_publish(const char *topic)
+{
+	struct topic_entry *e = entry_new(topic);
+
+	if (e == NULL)
+	{
+		LOG_ERR("No arena memory for topic: %s", topic);
+		return -ENOMEM;
+	}
+
+	k_mutex_lock(&topics_lock, K_FOREVER);
+	sys_slist_append(&pub_list, &e->node);
+	k_mutex_unlock(&topics_lock);
+
+	LOG_DBG("Publish topic added: %s", topic);
+
+	return 0;
+}
+
+/*
+Function : mqtt_topic_retain_set
+
+Description : Sets whether publishes to a topic are retained by the broker, e.g. for
+			  status topics whose last value new subscribers should get right away.
+			  The topic is added to the publish list if it is not in it yet.
+
+Parameter :
+- topic : Topic.
+- retain : true to publish with the RETAIN flag.
+
+Return :
+0 on success, -ENOMEM if the arena is exhausted.
+
+Example Call :
+				mqtt_topic_retain_set("devices/1234/config", true);
+*/
+int mqtt_topic_retain_set(const char *topic, bool retain)
+{
+	struct topic_entry *e;
+
+	k_mutex_lock(&topics_lock, K_FOREVER);
+
+	e = entry_find(&pub_list, topic);
+	if (e == NULL)
+	{
+		e = entry_new(topic);
+		if (e == NULL)
+		{
+			k_mutex_unlock(&topics_lock);
+			LOG_ERR("No arena memory for topic: %s", topic);
+			return -ENOMEM;
+		}
+
+		sys_slist_append(&pub_list, &e->node);
+	}
+
+	e->retain = retain;
+
+	k_mutex_unlock(&topics_lock);
+
+	LOG_DBG("Topic %s retain: %d", topic, retain);
+
+	return 0;
+}
+
+/* Topics not in the publish list are not retained. */
+bool mqtt_topics_retained(const char *topic)
+{
+	struct topic_entry *e;
+	bool retain;
+
+	k_mutex_lock(&topics_lock, K_FOREVER);
+	e = entry_find(&pub_list, topic);
+	retain = (e != NULL && e->retain);
+	k_mutex_unlock(&topics_lock);
+
+	return retain;
+}
+
+/* Publish topics are never removed, so the pointer stays valid. */
+const char *mqtt_topics_publish_first(void)
+{
+	struct topic_entry *e;
+
+	k_mutex_lock(&topics_lock, K_FOREVER);
+	e = SYS_SLIST_PEEK_HEAD_CONTAINER(&pub_list, e, node);
+	k_mutex_unlock(&topics_lock);
+
+	return e ? e->topic : NULL;
+}
+
+/*
+Function : mqtt_topics_resubscribe
+
+Description : Drops pending unsubscribes and subscribes to the whole list again. Called
+			  on CONNACK, the broker holds no subscriptions for a clean session.
+
+Parameter :
+- c : Pointer to the MQTT client.
+
+Return :
+0 on success, or a negative error code.
+
+Example Call :
+				mqtt_topics_resubscribe(c);
+*/
+int mqtt_topics_resubscribe(struct mqtt_client *c)
+{
+	struct topic_entry *e;
+	struct topic_entry *tmp;
+	int err;
+
+	k_mutex_lock(&topics_lock, K_FOREVER);
+
+	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&sub_list, e, tmp, node)
+	{
+		if (e->state == TOPIC_UNSUB_PENDING)
+		{
+			entry_remove(&sub_list, e);
+		}
+		else
+		{
+			e->state = TOPIC_SUB_PENDING;
+		}
+	}
+
+	err = send_batches(c, TOPIC_SUB_PENDING);
+
+	k_mutex_unlock(&topics_lock);
+
+	return err;
+}
+
+/*
+Function : mqtt_subscribe_topic
+
+Description : Subscribes to a topic at runtime, or changes its QoS. Changes made within
+			  CONFIG_MQTT_SUB_BATCH_DELAY_MS are sent in one SUBSCRIBE packet. The
+			  topic is subscribed again after every reconnect.
+
+Parameter :
+- topic : Topic filter.
+- qos : Requested QoS.
+
+Return :
+0 on success, -EALREADY if already subscribed with this QoS, -ENOMEM if the arena is
+exhausted.
+
+Example Call :
+				mqtt_subscribe_topic("devices/1234/debug", MQTT_QOS_0_AT_MOST_ONCE);
+*/
+int mqtt_subscribe_topic(const char *topic, enum mqtt_qos qos)
+{
+	return mqtt_topics_add_subscribe(topic, qos);
+}
+
+/*
+Function : mqtt_unsubscribe_topic
+
+Description : Unsubscribes from a topic at runtime. Changes made within
+			  CONFIG_MQTT_SUB_BATCH_DELAY_MS are sent in one UNSUBSCRIBE packet.
+
+Parameter :
+- topic : Topic filter as subscribed.
+
+Return :
+0 on success, -ENOENT if not subscribed.
+
+Example Call :
+				mqtt_unsubscribe_topic("devices/1234/debug");
+*/
+int mqtt_unsubscribe_topic(const char *topic)
+{
+	struct topic_entry *e;
+
+	k_mutex_lock(&topics_lock, K_FOREVER);
+
+	e = entry_find(&sub_list, topic);
+	if (e == NULL || e->state == TOPIC_UNSUB_PENDING)
+	{
+		k_mutex_unlock(&topics_lock);
+		return -ENOENT;
+	}
+
+	if (e->state == TOPIC_SUB_PENDING)
+	{
+		/* Never reached the broker. */
+		entry_remove(&sub_list, e);
+	}
+	else
+	{
+		e->state = TOPIC_UNSUB_PENDING;
+		k_work_schedule(&flush_work, K_MSEC(CONFIG_MQTT_SUB_BATCH_DELAY_MS));
+	}
+
+	k_mutex_unlock(&topics_lock);
+
+	return 0;
+}
+
+/*
+Function : mqtt_topic_get
+
+Description : Copies a subscribe or publish topic by index, e.g. to list them. Topics
+			  with a pending unsubscribe are skipped.
+
+Parameter :
+- publish : true for the publish list, false for the subscribe list.
+- index : Index in the list.
+- buf : Destination buffer.
+- len : Size of the destination buffer.
+- qos : Optional output for the subscribe QoS.
+
+Return :
+0 on success, -ENOENT if index is past the end of the list.
+
+Example Call :
+				for (int i = 0; mqtt_topic_get(false, i, buf, sizeof(buf), &qos) == 0; i++)
+*/
+int mqtt_topic_get(bool publish, int index, char *buf, size_t len, uint8_t *qos)
+{
+	struct topic_entry *e;
+	int err = -ENOENT;
+
+	k_mutex_lock(&topics_lock, K_FOREVER);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(publish ? &pub_list : &sub_list, e, node)
+	{
+		if (!publish && e->state == TOPIC_UNSUB_PENDING)
+		{
+			continue;
+		}
+
+		if (index-- == 0)
+		{
+			strncpy(buf, e->topic, len - 1);
+			buf[len - 1] = '\0';
+			if (qos)
+			{
+				*qos = e->qos;
+			}
+			err = 0;
+			break;
+		}
+	}
+
+	k_mutex_unlock(&topics_lock);
+
+	return err;
+}
\ No newline at end of file
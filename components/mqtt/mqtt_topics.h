@@ -0,0 +1,37 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_TOPICS.h
+*/
+
+#ifndef _MQTT_TOPICS_H_
+#define _MQTT_TOPICS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/net/mqtt.h>
+
+/*
+ * Subscribe and publish topic registry of the MQTT component. Topics are kept
+ * in lists of arena nodes at their exact length. Runtime subscription changes
+ * are collected for CONFIG_MQTT_SUB_BATCH_DELAY_MS and sent as one SUBSCRIBE
+ * and one UNSUBSCRIBE packet (split only when larger than the tx buffer).
+ * The public API (mqtt_subscribe_topic() etc.) is declared in mqtt.h.
+ */
+
+int mqtt_topics_add_subscribe(const char *topic, enum mqtt_qos qos);
+int mqtt_topics_add_publish(const char *topic);
+const char *mqtt_topics_publish_first(void);
+
+/* RETAIN flag of publishes to the topic, see mqtt_topic_retain_set(). */
+bool mqtt_topics_retained(const char *topic);
+
+/* Subscribes to the whole list again after CONNACK (clean session). */
+int mqtt_topics_resubscribe(struct mqtt_client *c);
+
+/* Provided by mqtt.c. */
+struct mqtt_client *mqtt_client_get(void);
+
+#endif
\ No newline at end of file
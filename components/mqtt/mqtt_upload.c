@@ -0,0 +1,481 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_UPLOAD.c
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/crc.h>
+#include "mqtt.h"
+#include "mqtt_upload.h"
+#include "data_usage.h"
+#include "link_quality.h"
+
+#define UPLOAD_TOPIC_LEN 128		// Longest base topic
+#define UPLOAD_CHUNK_TOPIC_LEN 160	// Longest "<topic>/<id>/<offset>"
+#define UPLOAD_RETRY_MS 1000		// Hold while disconnected or the link is poor
+#define UPLOAD_BUDGET_HOLD_MS 60000 // Hold while over the data budget
+#define UPLOAD_SETTINGS_ROOT "mqtt_up"
+
+#define ACK_NONE 0
+#define ACK_OK 1
+#define ACK_FAILED 2
+
+LOG_MODULE_REGISTER(MQTT_UPLOAD);
+
+struct upload_store
+{
+	uint32_t id;
+	uint32_t total;
+	uint32_t offset; /* Acknowledged bytes */
+	uint32_t crc;	 /* CRC-32 of the acknowledged bytes */
+};
+
+static struct
+{
+	char topic[UPLOAD_TOPIC_LEN];
+	struct upload_store state;
+	mqtt_stream_read_cb_t read;
+	void *ctx;
+	mqtt_upload_done_cb_t done;
+	uint32_t crc_pending; /* CRC-32 including the chunk in flight */
+	uint32_t sending;	  /* Length of the chunk in flight */
+	uint32_t chunks;	  /* Chunks acknowledged since the last save */
+	int64_t sent_ms;
+	int read_err;
+	bool active;
+	bool finishing; /* The done message is in flight */
+	bool gated;		/* Link quality gate passed */
+} upload;
+
+static struct upload_store saved;
+static atomic_t pending_id;
+static atomic_t ack_result;
+static bool ack_registered;
+static K_MUTEX_DEFINE(upload_lock);
+
+static K_THREAD_STACK_DEFINE(upload_stack, CONFIG_MQTT_UPLOAD_STACK_SIZE);
+static struct k_work_q upload_work_q;
+static bool upload_work_q_started;
+
+static void upload_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(upload_work, upload_work_fn);
+
+#if defined(CONFIG_SETTINGS)
+static int upload_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+							   void *cb_arg)
+{
+	ssize_t rc;
+
+	if (strcmp(name, "state") != 0)
+	{
+		return -ENOENT;
+	}
+
+	if (len != sizeof(saved))
+	{
+		return 0;
+	}
+
+	rc = read_cb(cb_arg, &saved, sizeof(saved));
+
+	return rc < 0 ? rc : 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(mqtt_up, UPLOAD_SETTINGS_ROOT, NULL, upload_settings_set, NULL,
+							   NULL);
+#endif
+
+static void state_save(void)
+{
+#if defined(CONFIG_SETTINGS)
+	int err = settings_save_one(UPLOAD_SETTINGS_ROOT "/state", &upload.state,
+								sizeof(upload.state));
+
+	if (err)
+	{
+		LOG_WRN("Failed to save upload progress: %d", err);
+	}
+#endif
+}
+
+static void state_delete(void)
+{
+#if defined(CONFIG_SETTINGS)
+	settings_delete(UPLOAD_SETTINGS_ROOT "/state");
+#endif
+}
+
+/* Called on the MQTT thread for every PUBACK. */
+static void upload_ack_handler(uint16_t message_id, int result)
+{
+	if (message_id != 0 && atomic_cas(&pending_id, message_id, 0))
+	{
+		atomic_set(&ack_result, result == 0 ? ACK_OK : ACK_FAILED);
+		k_work_reschedule_for_queue(&upload_work_q, &upload_work, K_NO_WAIT);
+	}
+}
+
+/* Stream source of one chunk, offsets relative to the chunk. */
+static int chunk_read(void *ctx, size_t offset, uint8_t *buf, size_t len)
+{
+	int n = upload.read(upload.ctx, upload.state.offset + offset, buf, len);
+
+	if (n < 0)
+	{
+		upload.read_err = n;
+		return n;
+	}
+
+	upload.crc_pending = crc32_ieee_update(upload.crc_pending, buf, n);
+
+	return n;
+}
+
+/* Called with upload_lock held. Returns the callback to run once it is released. */
+static mqtt_upload_done_cb_t upload_finish(void)
+{
+	upload.active = false;
+	atomic_set(&pending_id, 0);
+	state_delete();
+
+	return upload.done;
+}
+
+/* Called with upload_lock held. Returns the delay before the next step. */
+static int32_t send_next(void)
+{
+	char topic[UPLOAD_CHUNK_TOPIC_LEN];
+	uint16_t message_id = mqtt_next_message_id();
+	int err;
+
+	if (!upload.gated && !link_quality_bulk_allowed())
+	{
+		return UPLOAD_RETRY_MS;
+	}
+	upload.gated = true;
+
+	if (data_usage_level_get() == DATA_USAGE_EXCEEDED)
+	{
+		return UPLOAD_BUDGET_HOLD_MS;
+	}
+
+	atomic_set(&pending_id, message_id);
+
+	if (upload.state.offset == upload.state.total)
+	{
+		char json[48];
+		int len = snprintf(json, sizeof(json), "{\"len\":%u,\"crc\":\"%08x\"}",
+						   upload.state.total, upload.state.crc);
+
+		snprintf(topic, sizeof(topic), "%s/%u/done", upload.topic, upload.state.id);
+		upload.sending = len;
+		upload.finishing = true;
+		err = mqtt_publish_topic_id(topic, MQTT_QOS_1_AT_LEAST_ONCE, (const uint8_t *)json,
+									len, &message_id);
+	}
+	else
+	{
+		snprintf(topic, sizeof(topic), "%s/%u/%u", upload.topic, upload.state.id,
+				 upload.state.offset);
+		upload.sending = MIN(upload.state.total - upload.state.offset,
+							 CONFIG_MQTT_UPLOAD_CHUNK_SIZE);
+		upload.crc_pending = upload.state.crc;
+		upload.read_err = 0;
+		err = mqtt_publish_stream(topic, MQTT_QOS_1_AT_LEAST_ONCE, upload.sending, chunk_read,
+								  NULL, &message_id);
+	}
+
+	if (err)
+	{
+		atomic_set(&pending_id, 0);
+		upload.finishing = false;
+
+		if (err == -EAGAIN)
+		{
+			return MAX(mqtt_rate_wait_ms(strlen(topic) + upload.sending), 1);
+		}
+
+		return err == -ENOSPC ? UPLOAD_BUDGET_HOLD_MS : UPLOAD_RETRY_MS;
+	}
+
+	upload.sent_ms = k_uptime_get();
+
+	return CONFIG_MQTT_UPLOAD_ACK_TIMEOUT_S * MSEC_PER_SEC;
+}
+
+static void upload_work_fn(struct k_work *work)
+{
+	mqtt_upload_done_cb_t done = NULL;
+	uint32_t id;
+	int result = 0;
+	int32_t delay_ms;
+
+	k_mutex_lock(&upload_lock, K_FOREVER);
+
+	if (!upload.active)
+	{
+		k_mutex_unlock(&upload_lock);
+		return;
+	}
+
+	id = upload.state.id;
+
+	switch (atomic_set(&ack_result, ACK_NONE))
+	{
+	case ACK_OK:
+		if (upload.finishing)
+		{
+			LOG_INF("Upload %u complete, %u bytes", upload.state.id, upload.state.total);
+			done = upload_finish();
+			goto out;
+		}
+
+		upload.state.offset += upload.sending;
+		upload.state.crc = upload.crc_pending;
+		if (++upload.chunks >= CONFIG_MQTT_UPLOAD_SAVE_EVERY)
+		{
+			upload.chunks = 0;
+			state_save();
+		}
+		break;
+	case ACK_FAILED:
+		LOG_WRN("Upload %u chunk at %u rejected, resending", upload.state.id,
+				upload.state.offset);
+		upload.finishing = false;
+		break;
+	default:
+		if (atomic_get(&pending_id) != 0)
+		{
+			int64_t left = CONFIG_MQTT_UPLOAD_ACK_TIMEOUT_S * MSEC_PER_SEC -
+						   (k_uptime_get() - upload.sent_ms);
+
+			if (mqtt_is_connected() && left > 0)
+			{
+				k_work_reschedule_for_queue(&upload_work_q, &upload_work, K_MSEC(left));
+				goto out;
+			}
+
+			LOG_WRN("Upload %u chunk at %u not acknowledged, resending", upload.state.id,
+					upload.state.offset);
+			atomic_set(&pending_id, 0);
+			upload.finishing = false;
+		}
+		break;
+	}
+
+	if (!mqtt_is_connected())
+	{
+		k_work_reschedule_for_queue(&upload_work_q, &upload_work, K_MSEC(UPLOAD_RETRY_MS));
+		goto out;
+	}
+
+	delay_ms = send_next();
+
+	if (upload.read_err)
+	{
+		LOG_ERR("Upload %u stopped, read error at %u: %d", upload.state.id,
+				upload.state.offset, upload.read_err);
+		result = upload.read_err;
+		done = upload_finish();
+		goto out;
+	}
+
+	k_work_reschedule_for_queue(&upload_work_q, &upload_work, K_MSEC(delay_ms));
+
+out:
+	k_mutex_unlock(&upload_lock);
+
+	if (done)
+	{
+		done(id, result);
+	}
+}
+
+/*
+Function : mqtt_upload_start
+
+Description : Starts a chunked upload of total_len bytes read through read(). If the
+			  saved progress belongs to the same id and length, the upload continues
+			  from the last saved offset instead of the start. Only one upload runs at
+			  a time; the chunks are read and sent on the upload work queue, so a
+			  slow flash read or a long streamed send does not hold up the system
+			  workqueue.
+
+Parameter :
+- topic : Base topic, chunks go to "<topic>/<id>/<offset>".
+- id : Upload identifier chosen by the caller, e.g. a file number.
+- total_len : File length in bytes.
+- read : Callback filling buf with file bytes from an absolute offset.
+- ctx : Argument for read.
+- done : Optional callback run when the upload ends.
+
+Return :
+0 on success, -EBUSY if an upload is running, -EINVAL for bad arguments, or the
+error of mqtt_ack_handler_register().
+
+Example Call :
+				mqtt_upload_start("dev/logs", 7, size, read_flash, &area, on_upload_done);
+*/
+int mqtt_upload_start(const char *topic, uint32_t id, size_t total_len,
+					  mqtt_stream_read_cb_t read, void *ctx, mqtt_upload_done_cb_t done)
+{
+	int err = 0;
+
+	if (topic == NULL || read == NULL || strlen(topic) >= UPLOAD_TOPIC_LEN ||
+		total_len > UINT32_MAX)
+	{
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&upload_lock, K_FOREVER);
+
+	if (upload.active)
+	{
+		err = -EBUSY;
+		goto out;
+	}
+
+	if (!ack_registered)
+	{
+		err = mqtt_ack_handler_register(upload_ack_handler);
+		if (err)
+		{
+			goto out;
+		}
+		ack_registered = true;
+	}
+
+#if defined(CONFIG_SETTINGS)
+	memset(&saved, 0, sizeof(saved));
+	if (settings_subsys_init() == 0)
+	{
+		settings_load_subtree(UPLOAD_SETTINGS_ROOT);
+	}
+#endif
+
+	memset(&upload, 0, sizeof(upload));
+	strcpy(upload.topic, topic);
+	upload.read = read;
+	upload.ctx = ctx;
+	upload.done = done;
+	upload.state.id = id;
+	upload.state.total = total_len;
+
+	if (saved.id == id && saved.total == total_len && saved.offset <= total_len)
+	{
+		upload.state = saved;
+		LOG_INF("Resuming upload %u at %u of %u bytes", id, saved.offset, saved.total);
+	}
+	else
+	{
+		LOG_INF("Starting upload %u, %u bytes", id, (unsigned int)total_len);
+	}
+
+	upload.active = true;
+	atomic_set(&pending_id, 0);
+	atomic_set(&ack_result, ACK_NONE);
+
+	if (!upload_work_q_started)
+	{
+		k_work_queue_start(&upload_work_q, upload_stack, K_THREAD_STACK_SIZEOF(upload_stack),
+						   CONFIG_MQTT_UPLOAD_PRIORITY, NULL);
+		k_thread_name_set(&upload_work_q.thread, "mqtt_upload");
+		upload_work_q_started = true;
+	}
+
+	k_work_reschedule_for_queue(&upload_work_q, &upload_work, K_NO_WAIT);
+
+out:
+	k_mutex_unlock(&upload_lock);
+
+	return err;
+}
+
+/*
+Function : mqtt_upload_cancel
+
+Description : Stops the running upload and forgets its saved progress. The done
+			  callback is called with -ECANCELED.
+
+Parameter : void
+
+Return :
+0 on success, -ENOENT if no upload is running.
+
+Example Call :
+				mqtt_upload_cancel();
+*/
+int mqtt_upload_cancel(void)
+{
+	mqtt_upload_done_cb_t done;
+	uint32_t id;
+
+	k_mutex_lock(&upload_lock, K_FOREVER);
+
+	if (!upload.active)
+	{
+		k_mutex_unlock(&upload_lock);
+		return -ENOENT;
+	}
+
+	k_work_cancel_delayable(&upload_work);
+	id = upload.state.id;
+	done = upload_finish();
+
+	k_mutex_unlock(&upload_lock);
+
+	LOG_INF("Upload %u cancelled", id);
+
+	if (done)
+	{
+		done(id, -ECANCELED);
+	}
+
+	return 0;
+}
+
+/*
+Function : mqtt_upload_progress
+
+Description : Reports the running upload and how much of it was acknowledged.
+
+Parameter :
+- id : Output, upload identifier.
+- offset : Output, acknowledged bytes.
+- total_len : Output, file length.
+
+Return :
+0 on success, -ENOENT if no upload is running.
+
+Example Call :
+				mqtt_upload_progress(&id, &offset, &total);
+*/
+int mqtt_upload_progress(uint32_t *id, size_t *offset, size_t *total_len)
+{
+	int err = 0;
+
+	k_mutex_lock(&upload_lock, K_FOREVER);
+
+	if (upload.active)
+	{
+		*id = upload.state.id;
+		*offset = upload.state.offset;
+		*total_len = upload.state.total;
+	}
+	else
+	{
+		err = -ENOENT;
+	}
+
+	k_mutex_unlock(&upload_lock);
+
+	return err;
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : MQTT_UPLOAD.h
+*/
+
+#ifndef _MQTT_UPLOAD_H_
+#define _MQTT_UPLOAD_H_
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "mqtt.h"
+
+/*
+ * Chunked upload of large files with resume. The file is read through a
+ * callback and sent as QoS 1 messages of CONFIG_MQTT_UPLOAD_CHUNK_SIZE bytes to
+ * "<topic>/<id>/<offset>", one at a time, each streamed with
+ * mqtt_publish_stream() so RAM use does not depend on the file size. Once all
+ * chunks are acknowledged, {"len":N,"crc":"xxxxxxxx"} (CRC-32/IEEE of the file)
+ * goes to "<topic>/<id>/done" and the receiver can reassemble the file by
+ * offset; a chunk sent twice carries the same bytes.
+ *
+ * A chunk without PUBACK within CONFIG_MQTT_UPLOAD_ACK_TIMEOUT_S, or lost to a
+ * disconnect, is sent again. The acknowledged offset is saved to settings every
+ * CONFIG_MQTT_UPLOAD_SAVE_EVERY chunks, so calling mqtt_upload_start() with the
+ * same id and length after a reboot continues where the upload stopped.
+ */
+
+/* Upload completion callback: 0 when done, -ECANCELED or a read error otherwise. */
+typedef void (*mqtt_upload_done_cb_t)(uint32_t id, int result);
+
+#if defined(CONFIG_MQTT_UPLOAD)
+
+int mqtt_upload_start(const char *topic, uint32_t id, size_t total_len,
+					  mqtt_stream_read_cb_t read, void *ctx, mqtt_upload_done_cb_t done);
+int mqtt_upload_cancel(void);
+int mqtt_upload_progress(uint32_t *id, size_t *offset, size_t *total_len);
+
+#else
+
+static inline int mqtt_upload_start(const char *topic, uint32_t id, size_t total_len,
+									mqtt_stream_read_cb_t read, void *ctx,
+									mqtt_upload_done_cb_t done)
+{
+	return -ENOTSUP;
+}
+
+static inline int mqtt_upload_cancel(void)
+{
+	return -ENOTSUP;
+}
+
+static inline int mqtt_upload_progress(uint32_t *id, size_t *offset, size_t *total_len)
+{
+	return -ENOTSUP;
+}
+
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,310 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : PROFILING.c
+*/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <ncs_version.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/debug/thread_analyzer.h>
+#include <zephyr/net/mqtt.h>
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+#include "profiling.h"
+#include "mqtt.h"
+#include "mqtt_arena.h"
+
+#define PROFILING_EVT_TYPES 16
+#define PROFILING_JSON_MAX_LEN 1536
+#define PROFILING_TOPIC_MAX_LEN 64
+
+LOG_MODULE_REGISTER(PROFILING);
+
+struct profiling_acc
+{
+	uint32_t count;
+	uint32_t max_cycles;
+	uint64_t total_cycles;
+};
+
+static const char *const evt_names[PROFILING_EVT_TYPES] = {
+	[MQTT_EVT_CONNACK] = "connack",
+	[MQTT_EVT_DISCONNECT] = "disconnect",
+	[MQTT_EVT_PUBLISH] = "publish",
+	[MQTT_EVT_PUBACK] = "puback",
+	[MQTT_EVT_PUBREC] = "pubrec",
+	[MQTT_EVT_PUBREL] = "pubrel",
+	[MQTT_EVT_PUBCOMP] = "pubcomp",
+	[MQTT_EVT_SUBACK] = "suback",
+	[MQTT_EVT_UNSUBACK] = "unsuback",
+	[MQTT_EVT_PINGRESP] = "pingresp",
+};
+
+static const char *const section_names[PROFILING_SECTION_COUNT] = {
+	[PROFILING_MQTT_INPUT] = "mqtt_input",
+	[PROFILING_MQTT_LIVE] = "mqtt_live",
+};
+
+static struct profiling_acc evt_acc[PROFILING_EVT_TYPES];
+static struct profiling_acc section_acc[PROFILING_SECTION_COUNT];
+static struct k_spinlock acc_lock;
+
+static char request_topic[PROFILING_TOPIC_MAX_LEN];
+static char report_topic[PROFILING_TOPIC_MAX_LEN];
+
+/* Report under construction, only touched from the report work item. */
+static char *report;
+static size_t report_pos;
+static bool report_first_thread;
+
+static void profiling_report_work_fn(struct k_work *work);
+
+static K_WORK_DEFINE(report_work, profiling_report_work_fn);
+
+static void acc_add(struct profiling_acc *acc, uint32_t start)
+{
+	uint32_t cycles = k_cycle_get_32() - start;
+	k_spinlock_key_t key = k_spin_lock(&acc_lock);
+
+	acc->count++;
+	acc->total_cycles += cycles;
+	acc->max_cycles = MAX(acc->max_cycles, cycles);
+
+	k_spin_unlock(&acc_lock, key);
+}
+
+/*
+Function : profiling_evt_end
+
+Description : Accounts the cycles spent in mqtt_evt_handler() for one event type.
+
+Parameter :
+- evt_type : enum mqtt_evt_type of the handled event.
+- start : Value returned by profiling_start() on entry.
+
+Return : void
+
+Example Call :
+				profiling_evt_end(evt->type, start);
+*/
+void profiling_evt_end(int evt_type, uint32_t start)
+{
+	if (evt_type >= 0 && evt_type < PROFILING_EVT_TYPES)
+	{
+		acc_add(&evt_acc[evt_type], start);
+	}
+}
+
+/*
+Function : profiling_section_end
+
+Description : Accounts the cycles spent in a section of the MQTT thread loop.
+
+Parameter :
+- section : Timed section.
+- start : Value returned by profiling_start() before the section.
+
+Return : void
+
+Example Call :
+				profiling_section_end(PROFILING_MQTT_INPUT, start);
+*/
+void profiling_section_end(enum profiling_section section, uint32_t start)
+{
+	acc_add(&section_acc[section], start);
+}
+
+static void report_append(const char *format, ...)
+{
+	va_list args;
+	int n;
+
+	if (report_pos >= PROFILING_JSON_MAX_LEN)
+	{
+		return;
+	}
+
+	va_start(args, format);
+	n = vsnprintf(&report[report_pos], PROFILING_JSON_MAX_LEN - report_pos, format, args);
+	va_end(args);
+
+	/* On overflow report_pos moves past the end and the report is dropped. */
+	report_pos += (n < 0) ? PROFILING_JSON_MAX_LEN : n;
+}
+
+static void report_acc(const char *name, const struct profiling_acc *acc, bool first)
+{
+	report_append("%s\"%s\":[%u,%u,%u]", first ? "" : ",", name, acc->count,
+				  (uint32_t)k_cyc_to_us_floor64(acc->total_cycles),
+				  k_cyc_to_us_floor32(acc->max_cycles));
+}
+
+static void report_thread_cb(struct thread_analyzer_info *info)
+{
+	uint32_t cpu = 0;
+
+#if defined(CONFIG_THREAD_RUNTIME_STATS)
+	cpu = info->utilization;
+#endif
+
+	report_append("%s\"%s\":[%u,%u,%u]", report_first_thread ? "" : ",", info->name,
+				  (uint32_t)info->stack_used, (uint32_t)info->stack_size, cpu);
+	report_first_thread = false;
+}
+
+/*
+Function : profiling_report_work_fn
+
+Description : Builds and publishes the profile on the system workqueue:
+
+			  {"up":120,"threads":{"mqtt":[1480,4096,3],...},
+			   "evt":{"publish":[12,8410,2210],...},"loop":{"mqtt_input":[40,9120,2300],...}}
+
+			  Threads are [stack used, stack size, CPU %], events and loop sections
+			  [count, total us, max us].
+
+Parameter :
+- work : Work item.
+
+Return : void
+
+Example Call :
+				k_work_submit(&report_work);
+*/
+static void profiling_report_work_fn(struct k_work *work)
+{
+	struct profiling_acc evt_copy[PROFILING_EVT_TYPES];
+	struct profiling_acc section_copy[PROFILING_SECTION_COUNT];
+	bool first = true;
+	int err;
+
+	report = mqtt_arena_alloc(PROFILING_JSON_MAX_LEN);
+	if (report == NULL)
+	{
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&acc_lock);
+
+	memcpy(evt_copy, evt_acc, sizeof(evt_copy));
+	memcpy(section_copy, section_acc, sizeof(section_copy));
+
+	k_spin_unlock(&acc_lock, key);
+
+	report_pos = 0;
+	report_first_thread = true;
+
+	report_append("{\"up\":%u,\"threads\":{", (uint32_t)(k_uptime_get() / MSEC_PER_SEC));
+
+#if NCS_VERSION_NUMBER < 0x20600
+	thread_analyzer_run(report_thread_cb);
+#else
+	thread_analyzer_run(report_thread_cb, 0);
+#endif
+
+	report_append("},\"evt\":{");
+
+	for (int i = 0; i < PROFILING_EVT_TYPES; i++)
+	{
+		if (evt_names[i] && evt_copy[i].count)
+		{
+			report_acc(evt_names[i], &evt_copy[i], first);
+			first = false;
+		}
+	}
+
+	report_append("},\"loop\":{");
+
+	for (int i = 0; i < PROFILING_SECTION_COUNT; i++)
+	{
+		report_acc(section_names[i], &section_copy[i], i == 0);
+	}
+
+	report_append("}}");
+
+	if (report_pos >= PROFILING_JSON_MAX_LEN)
+	{
+		LOG_ERR("Profile report exceeds %d bytes", PROFILING_JSON_MAX_LEN);
+	}
+	else
+	{
+		LOG_DBG("Profile report %u bytes", (unsigned int)report_pos);
+
+		err = mqtt_outbox_publish(MQTT_PRIO_COMMAND, report_topic, MQTT_QOS_1_AT_LEAST_ONCE,
+								  (const uint8_t *)report, report_pos);
+		if (err)
+		{
+			LOG_WRN("Profile publish failed: %d", err);
+		}
+	}
+
+	mqtt_arena_free(report);
+	report = NULL;
+}
+
+static void on_profile_request(const char *topic, const uint8_t *data, size_t len)
+{
+	k_work_submit(&report_work);
+}
+
+/*
+Function : profiling_init
+
+Description : Subscribes to the profile request topic. Any message on it publishes the
+			  current profile on the report topic.
+
+Parameter : void
+
+Return :
+0 on success, or a negative error code.
+
+Example Call :
+				profiling_init();
+*/
+int profiling_init(void)
+{
+	snprintf(report_topic, sizeof(report_topic), CONFIG_MQTT_PROFILING_TOPIC, DEVICE_ID);
+	snprintf(request_topic, sizeof(request_topic), "%s/request", report_topic);
+
+	mqtt_create_topic_subscribe(NULL, "%s", request_topic);
+
+	return mqtt_rx_handler_register(request_topic, on_profile_request);
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_profile_publish(const struct shell *sh, size_t argc, char **argv)
+{
+	k_work_submit(&report_work);
+	shell_print(sh, "Profile report queued for %s", report_topic);
+
+	return 0;
+}
+
+static int cmd_profile_reset(const struct shell *sh, size_t argc, char **argv)
+{
+	k_spinlock_key_t key = k_spin_lock(&acc_lock);
+
+	memset(evt_acc, 0, sizeof(evt_acc));
+	memset(section_acc, 0, sizeof(section_acc));
+
+	k_spin_unlock(&acc_lock, key);
+
+	shell_print(sh, "Profile cleared");
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_profile,
+							   SHELL_CMD(publish, NULL, "Log and publish the profile", cmd_profile_publish),
+							   SHELL_CMD(reset, NULL, "Clear the cycle accounting", cmd_profile_reset),
+							   SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(profile, &sub_profile, "MQTT thread profiling", NULL);
+#endif
\ No newline at end of file
@@ -0,0 +1,56 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : PROFILING.h
+*/
+
+#ifndef _PROFILING_H_
+#define _PROFILING_H_
+
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+/* Sections of the MQTT thread loop timed in addition to the event handler. */
+enum profiling_section
+{
+	PROFILING_MQTT_INPUT,
+	PROFILING_MQTT_LIVE,
+	PROFILING_SECTION_COUNT
+};
+
+#if defined(CONFIG_MQTT_PROFILING)
+
+static inline uint32_t profiling_start(void)
+{
+	return k_cycle_get_32();
+}
+
+void profiling_evt_end(int evt_type, uint32_t start);
+void profiling_section_end(enum profiling_section section, uint32_t start);
+int profiling_init(void);
+
+#else
+
+static inline uint32_t profiling_start(void)
+{
+	return 0;
+}
+
+static inline void profiling_evt_end(int evt_type, uint32_t start)
+{
+}
+
+static inline void profiling_section_end(enum profiling_section section, uint32_t start)
+{
+}
+
+static inline int profiling_init(void)
+{
+	return 0;
+}
+
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,524 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : SAMPLING.c
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/logging/log.h>
+#if defined(CONFIG_DATE_TIME)
+#include <date_time.h>
+#endif
+#include "sampling.h"
+#include "mqtt.h"
+#include "data_usage.h"
+
+#define SAMPLING_FORMAT_VERSION 1
+#define SAMPLING_FLAG_UNIX_TIME BIT(7)
+#define SAMPLING_AGG_ALL (SAMPLING_AGG_MIN | SAMPLING_AGG_MAX | SAMPLING_AGG_MEAN | SAMPLING_AGG_COUNT)
+#define SAMPLING_MAX_FIELDS 4
+#define SAMPLING_HEADER_MAX 12 // Version, flags and a 64 bit varint base time
+#define SAMPLING_POINT_MAX (5 + SAMPLING_MAX_FIELDS * 5) // 32 bit deltas take 5 varint bytes at most
+#define SAMPLING_TOPIC_LENGTH 64
+
+BUILD_ASSERT((CONFIG_SAMPLING_RING_SIZE & (CONFIG_SAMPLING_RING_SIZE - 1)) == 0,
+			 "CONFIG_SAMPLING_RING_SIZE must be a power of two");
+BUILD_ASSERT(CONFIG_SAMPLING_BATCH_SIZE >= SAMPLING_HEADER_MAX + SAMPLING_POINT_MAX);
+
+LOG_MODULE_REGISTER(SAMPLING);
+
+struct sampling_sample
+{
+	uint32_t ts_ms;
+	int32_t value;
+};
+
+struct sampling_channel
+{
+	char topic[SAMPLING_TOPIC_LENGTH];
+	uint32_t window_ms; /* 0: every sample is a point */
+	uint8_t aggregates;
+
+	/* Ring, indices run freely and are masked on access. */
+	atomic_t head; /* Written by the producer only */
+	atomic_t tail; /* Written by the processing work only */
+	atomic_t dropped;
+	struct sampling_sample ring[CONFIG_SAMPLING_RING_SIZE];
+
+	/* Open aggregation window */
+	bool window_open;
+	uint32_t window_start;
+	uint32_t count;
+	int32_t min;
+	int32_t max;
+	int64_t sum;
+
+	/* Batch, points are encoded after room for the header. */
+	uint8_t batch[CONFIG_SAMPLING_BATCH_SIZE];
+	size_t batch_len;
+	uint32_t first_ts;
+	uint32_t last_ts;
+	int32_t last[SAMPLING_MAX_FIELDS];
+
+	struct sampling_stats stats;
+};
+
+static struct sampling_channel channels[CONFIG_SAMPLING_MAX_CHANNELS];
+static atomic_t channel_count;
+static int64_t publish_at_ms;
+static atomic_t flush_requested;
+
+static void process_work_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(process_work, process_work_fn);
+
+static size_t varint_put(uint8_t *buf, uint64_t value)
+{
+	size_t n = 0;
+
+	while (value >= 0x80)
+	{
+		buf[n++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	buf[n++] = (uint8_t)value;
+
+	return n;
+}
+
+static uint64_t zigzag(int64_t value)
+{
+	return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static void batch_reset(struct sampling_channel *ch)
+{
+	ch->batch_len = SAMPLING_HEADER_MAX;
+	memset(ch->last, 0, sizeof(ch->last));
+}
+
+/*
+Function : batch_publish
+
+Description : Writes the header in front of the encoded points and queues the batch in
+			  the outbox, which copies it. The base time is the first point in unix
+			  time when network time is known, otherwise in uptime.
+
+Parameter :
+- ch : Channel.
+
+Return : void
+
+Example Call :
+				batch_publish(ch);
+*/
+static void batch_publish(struct sampling_channel *ch)
+{
+	uint8_t header[SAMPLING_HEADER_MAX];
+	uint64_t base = ch->first_ts;
+	size_t start;
+	size_t len;
+	int err;
+
+	if (ch->batch_len == SAMPLING_HEADER_MAX)
+	{
+		return;
+	}
+
+	header[0] = SAMPLING_FORMAT_VERSION;
+	header[1] = (ch->window_ms > 0) ? ch->aggregates : 0;
+
+#if defined(CONFIG_DATE_TIME)
+	int64_t now_ms;
+
+	if (date_time_now(&now_ms) == 0)
+	{
+		base = now_ms - (uint32_t)(k_uptime_get_32() - ch->first_ts);
+		header[1] |= SAMPLING_FLAG_UNIX_TIME;
+	}
+#endif
+
+	len = 2 + varint_put(&header[2], base);
+	start = SAMPLING_HEADER_MAX - len;
+	memcpy(&ch->batch[start], header, len);
+
+	len = ch->batch_len - start;
+	err = mqtt_outbox_publish(MQTT_PRIO_TELEMETRY, ch->topic, MQTT_QOS_1_AT_LEAST_ONCE,
+							  &ch->batch[start], len);
+	if (err)
+	{
+		LOG_WRN("Batch of %s dropped: %d", ch->topic, err);
+	}
+	else
+	{
+		ch->stats.batches++;
+		ch->stats.bytes += len;
+	}
+
+	batch_reset(ch);
+}
+
+/*
+Function : point_put
+
+Description : Appends one point to the batch, publishing the batch first when a point
+			  of the worst case size might not fit.
+
+Parameter :
+- ch : Channel.
+- ts : Point time (uptime ms).
+- values : Field values.
+- n : Number of fields.
+
+Return : void
+
+Example Call :
+				point_put(ch, s->ts_ms, &s->value, 1);
+*/
+static void point_put(struct sampling_channel *ch, uint32_t ts, const int32_t *values, int n)
+{
+	if (ch->batch_len + SAMPLING_POINT_MAX > CONFIG_SAMPLING_BATCH_SIZE)
+	{
+		batch_publish(ch);
+	}
+
+	if (ch->batch_len == SAMPLING_HEADER_MAX)
+	{
+		ch->first_ts = ts;
+		ch->last_ts = ts;
+	}
+
+	ch->batch_len += varint_put(&ch->batch[ch->batch_len], ts - ch->last_ts);
+	ch->last_ts = ts;
+
+	for (int i = 0; i < n; i++)
+	{
+		ch->batch_len += varint_put(&ch->batch[ch->batch_len],
+									zigzag((int64_t)values[i] - ch->last[i]));
+		ch->last[i] = values[i];
+	}
+
+	ch->stats.points++;
+}
+
+static void window_close(struct sampling_channel *ch)
+{
+	int32_t values[SAMPLING_MAX_FIELDS];
+	int n = 0;
+
+	if (ch->aggregates & SAMPLING_AGG_MIN)
+	{
+		values[n++] = ch->min;
+	}
+	if (ch->aggregates & SAMPLING_AGG_MAX)
+	{
+		values[n++] = ch->max;
+	}
+	if (ch->aggregates & SAMPLING_AGG_MEAN)
+	{
+		values[n++] = (int32_t)(ch->sum / ch->count);
+	}
+	if (ch->aggregates & SAMPLING_AGG_COUNT)
+	{
+		values[n++] = (int32_t)ch->count;
+	}
+
+	point_put(ch, ch->window_start, values, n);
+	ch->window_open = false;
+}
+
+static void window_add(struct sampling_channel *ch, const struct sampling_sample *s)
+{
+	if (ch->window_open && (uint32_t)(s->ts_ms - ch->window_start) >= ch->window_ms)
+	{
+		window_close(ch);
+	}
+
+	if (!ch->window_open)
+	{
+		ch->window_open = true;
+		ch->window_start = s->ts_ms - (s->ts_ms % ch->window_ms);
+		ch->count = 0;
+		ch->min = INT32_MAX;
+		ch->max = INT32_MIN;
+		ch->sum = 0;
+	}
+
+	ch->count++;
+	ch->min = MIN(ch->min, s->value);
+	ch->max = MAX(ch->max, s->value);
+	ch->sum += s->value;
+}
+
+/*
+Function : channel_drain
+
+Description : Moves every sample in the ring into the open window, or straight into
+			  the batch for raw channels. On publish the window is closed once its
+			  time is over and the batch is queued.
+
+Parameter :
+- ch : Channel.
+- publish : true when the publish interval is due.
+- now : Uptime in ms.
+
+Return : void
+
+Example Call :
+				channel_drain(ch, true, k_uptime_get_32());
+*/
+static void channel_drain(struct sampling_channel *ch, bool publish, uint32_t now)
+{
+	uint32_t head = (uint32_t)atomic_get(&ch->head);
+	uint32_t tail = (uint32_t)atomic_get(&ch->tail);
+
+	while (tail != head)
+	{
+		const struct sampling_sample *s = &ch->ring[tail & (CONFIG_SAMPLING_RING_SIZE - 1)];
+
+		if (ch->window_ms == 0)
+		{
+			point_put(ch, s->ts_ms, &s->value, 1);
+		}
+		else
+		{
+			window_add(ch, s);
+		}
+
+		tail++;
+		ch->stats.samples++;
+	}
+
+	/* Frees the slots for the producer once the samples are consumed. */
+	atomic_set(&ch->tail, (atomic_val_t)tail);
+
+	if (!publish)
+	{
+		return;
+	}
+
+	if (ch->window_open && (uint32_t)(now - ch->window_start) >= ch->window_ms)
+	{
+		window_close(ch);
+	}
+
+	batch_publish(ch);
+}
+
+static void process_work_fn(struct k_work *work)
+{
+	int64_t now = k_uptime_get();
+	bool publish = atomic_clear(&flush_requested) || (now >= publish_at_ms);
+	int count = (int)atomic_get(&channel_count);
+
+	for (int i = 0; i < count; i++)
+	{
+		channel_drain(&channels[i], publish, (uint32_t)now);
+	}
+
+	if (publish)
+	{
+		publish_at_ms = now + (int64_t)data_usage_interval_s(CONFIG_SAMPLING_PUBLISH_INTERVAL_S) *
+								  MSEC_PER_SEC;
+	}
+
+	k_work_reschedule(&process_work, K_MSEC(publish_at_ms - now));
+}
+
+/*
+Function : sampling_channel_add
+
+Description : Adds a channel published to CONFIG_SAMPLING_TOPIC with the given name.
+			  Channels are added at startup, before samples are pushed to them.
+
+Parameter :
+- name : Channel name, part of the topic.
+- window_ms : Aggregation window in ms, 0 to send every sample.
+- aggregates : SAMPLING_AGG_* fields sent per window, ignored for raw channels.
+
+Return :
+Channel number on success, -EINVAL for an invalid window or aggregate mask, -ENOMEM
+if all CONFIG_SAMPLING_MAX_CHANNELS are in use.
+
+Example Call :
+				ch = sampling_channel_add("temp", 60000, SAMPLING_AGG_MIN | SAMPLING_AGG_MAX);
+*/
+int sampling_channel_add(const char *name, uint32_t window_ms, uint8_t aggregates)
+{
+	int index = (int)atomic_get(&channel_count);
+	struct sampling_channel *ch;
+
+	if (window_ms > 0 && (aggregates == 0 || (aggregates & ~SAMPLING_AGG_ALL)))
+	{
+		return -EINVAL;
+	}
+
+	if (index >= CONFIG_SAMPLING_MAX_CHANNELS)
+	{
+		LOG_ERR("No free sampling channel for %s", name);
+		return -ENOMEM;
+	}
+
+	ch = &channels[index];
+	snprintf(ch->topic, sizeof(ch->topic), CONFIG_SAMPLING_TOPIC, DEVICE_ID, name);
+	ch->window_ms = window_ms;
+	ch->aggregates = aggregates;
+	batch_reset(ch);
+
+	/* The processing work sees the channel only once it is set up. */
+	atomic_set(&channel_count, index + 1);
+
+	LOG_INF("Sampling channel %d: %s window %u ms", index, ch->topic, window_ms);
+
+	return index;
+}
+
+/*
+Function : sampling_push_ts
+
+Description : Adds a sample to a channel's ring. Lock free and allocation free, safe
+			  from an ISR, as long as each channel is fed by one producer in time
+			  order. The ring is drained early once it is half full.
+
+Parameter :
+- channel : Channel number from sampling_channel_add().
+- ts_ms : Sample time (uptime ms, k_uptime_get_32()).
+- value : Sample value, scaled to an integer by the caller.
+
+Return :
+0 on success, -EINVAL for an unknown channel, -ENOBUFS if the ring is full.
+
+Example Call :
+				sampling_push_ts(ch, k_uptime_get_32(), millidegrees);
+*/
+int sampling_push_ts(int channel, uint32_t ts_ms, int32_t value)
+{
+	struct sampling_channel *ch;
+	uint32_t head;
+	uint32_t used;
+
+	if (channel < 0 || channel >= (int)atomic_get(&channel_count))
+	{
+		return -EINVAL;
+	}
+
+	ch = &channels[channel];
+	head = (uint32_t)atomic_get(&ch->head);
+	used = head - (uint32_t)atomic_get(&ch->tail);
+
+	if (used >= CONFIG_SAMPLING_RING_SIZE)
+	{
+		atomic_inc(&ch->dropped);
+		return -ENOBUFS;
+	}
+
+	ch->ring[head & (CONFIG_SAMPLING_RING_SIZE - 1)] = (struct sampling_sample){
+		.ts_ms = ts_ms,
+		.value = value,
+	};
+
+	/* Publishes the slot to the consumer after it is written. */
+	atomic_set(&ch->head, (atomic_val_t)(head + 1));
+
+	if (used + 1 == CONFIG_SAMPLING_RING_SIZE / 2)
+	{
+		k_work_reschedule(&process_work, K_NO_WAIT);
+	}
+
+	return 0;
+}
+
+/*
+Function : sampling_push
+
+Description : Adds a sample taken now to a channel, see sampling_push_ts().
+
+Parameter :
+- channel : Channel number from sampling_channel_add().
+- value : Sample value.
+
+Return :
+0 on success, -EINVAL for an unknown channel, -ENOBUFS if the ring is full.
+
+Example Call :
+				sampling_push(ch, millidegrees);
+*/
+int sampling_push(int channel, int32_t value)
+{
+	return sampling_push_ts(channel, k_uptime_get_32(), value);
+}
+
+/*
+Function : sampling_flush
+
+Description : Drains all channels and publishes their batches now, e.g. before the
+			  modem goes to sleep. Windows still open are sent with the next batch.
+
+Parameter : void
+
+Return : void
+
+Example Call :
+				sampling_flush();
+*/
+void sampling_flush(void)
+{
+	atomic_set(&flush_requested, 1);
+	k_work_reschedule(&process_work, K_NO_WAIT);
+}
+
+/*
+Function : sampling_stats_get
+
+Description : Returns the counters of a channel. The drop count is read from the
+			  producer side, the rest as of the last processing run.
+
+Parameter :
+- channel : Channel number.
+- stats : Output statistics.
+
+Return :
+0 on success, -EINVAL for an unknown channel.
+
+Example Call :
+				sampling_stats_get(ch, &stats);
+*/
+int sampling_stats_get(int channel, struct sampling_stats *stats)
+{
+	if (channel < 0 || channel >= (int)atomic_get(&channel_count))
+	{
+		return -EINVAL;
+	}
+
+	*stats = channels[channel].stats;
+	stats->dropped = (uint32_t)atomic_get(&channels[channel].dropped);
+
+	return 0;
+}
+
+/*
+Function : sampling_init
+
+Description : Starts the periodic processing that publishes the channel batches every
+			  CONFIG_SAMPLING_PUBLISH_INTERVAL_S.
+
+Parameter : void
+
+Return :
+0 on success.
+
+Example Call :
+				sampling_init();
+*/
+int sampling_init(void)
+{
+	publish_at_ms = k_uptime_get() + (int64_t)CONFIG_SAMPLING_PUBLISH_INTERVAL_S * MSEC_PER_SEC;
+	k_work_schedule(&process_work, K_SECONDS(CONFIG_SAMPLING_PUBLISH_INTERVAL_S));
+
+	return 0;
+}
\ No newline at end of file
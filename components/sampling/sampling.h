@@ -0,0 +1,91 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : SAMPLING.h
+*/
+
+#ifndef _SAMPLING_H_
+#define _SAMPLING_H_
+
+#include <errno.h>
+#include <stdint.h>
+#include <zephyr/sys/util.h>
+
+/*
+ * Time-series sampling pipeline. Sensor threads or ISRs push timestamped
+ * int32 samples into a lock-free single-producer ring per channel, without
+ * locks or allocation. A work item drains the rings, reduces each window of
+ * window_ms to the configured aggregates (or keeps every sample when
+ * window_ms is 0) and appends the points to the channel's batch, with the
+ * timestamps and values delta and varint encoded. Batches are published
+ * through the outbox (telemetry class) when full and every
+ * CONFIG_SAMPLING_PUBLISH_INTERVAL_S.
+ *
+ * Batch format, all integers LEB128 varints, deltas zigzag encoded:
+ *   version (1 byte), flags (1 byte: aggregate mask, bit 7 unix time base),
+ *   base time in ms (unix time, or uptime when network time is unknown),
+ *   per point: time delta to the previous point in ms, then one value delta
+ *   to the same field of the previous point per field (min, max, mean, count
+ *   in that order, or the sample value for raw channels).
+ */
+
+#define SAMPLING_AGG_MIN BIT(0)
+#define SAMPLING_AGG_MAX BIT(1)
+#define SAMPLING_AGG_MEAN BIT(2)
+#define SAMPLING_AGG_COUNT BIT(3)
+
+struct sampling_stats
+{
+	uint32_t samples; /* Samples taken from the ring */
+	uint32_t dropped; /* Samples lost to a full ring */
+	uint32_t points;  /* Raw samples or window aggregates encoded */
+	uint32_t batches; /* Batches queued in the outbox */
+	uint32_t bytes;	  /* Encoded bytes queued */
+};
+
+#if defined(CONFIG_SAMPLING)
+
+int sampling_channel_add(const char *name, uint32_t window_ms, uint8_t aggregates);
+/* Lock free, one producer (thread or ISR) per channel. */
+int sampling_push(int channel, int32_t value);
+int sampling_push_ts(int channel, uint32_t ts_ms, int32_t value);
+void sampling_flush(void);
+int sampling_stats_get(int channel, struct sampling_stats *stats);
+int sampling_init(void);
+
+#else
+
+static inline int sampling_channel_add(const char *name, uint32_t window_ms, uint8_t aggregates)
+{
+	return -ENOTSUP;
+}
+
+static inline int sampling_push(int channel, int32_t value)
+{
+	return -ENOTSUP;
+}
+
+static inline int sampling_push_ts(int channel, uint32_t ts_ms, int32_t value)
+{
+	return -ENOTSUP;
+}
+
+static inline void sampling_flush(void)
+{
+}
+
+static inline int sampling_stats_get(int channel, struct sampling_stats *stats)
+{
+	return -ENOTSUP;
+}
+
+static inline int sampling_init(void)
+{
+	return 0;
+}
+
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,1114 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : SHADOW.c
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "shadow.h"
+#include "shadow_json.h"
+#include "mqtt.h"
+#include "mqtt_arena.h"
+
+#define SHADOW_TOPIC_LENGTH 96
+#define SHADOW_DOC_HEAD "{\"state\":{\"reported\":{"
+#define SHADOW_DOC_TAIL "}},\"clientToken\":\"%u\"}"
+#define SHADOW_DOC_TAIL_MAX (sizeof(SHADOW_DOC_TAIL) + 8) // %u printed as up to 10 digits
+#define SHADOW_TOKEN_LENGTH 11
+#define SHADOW_RESPONSE_TIMEOUT_MS 30000 // Update without a response counts as lost
+
+BUILD_ASSERT(CONFIG_SHADOW_MAX_FIELDS <= 32, "Fields are tracked in a 32 bit mask");
+
+LOG_MODULE_REGISTER(SHADOW);
+
+struct shadow_field
+{
+	const char *key;
+	enum shadow_type type;
+	shadow_delta_cb_t cb;
+
+	bool value_set;		 /* Reported by the application at least once */
+	bool reported_valid; /* The cloud holds reported */
+	uint32_t gen;		 /* Counts local changes */
+	uint32_t sent_gen;	 /* gen of the value in the update in flight */
+	int32_t value;
+	int32_t reported;
+	char str[CONFIG_SHADOW_STR_MAX_LEN];
+	char reported_str[CONFIG_SHADOW_STR_MAX_LEN];
+};
+
+static struct shadow_field fields[CONFIG_SHADOW_MAX_FIELDS];
+static int field_count;
+static K_MUTEX_DEFINE(shadow_lock);
+
+static char update_topic[SHADOW_TOPIC_LENGTH];
+static char delta_topic[SHADOW_TOPIC_LENGTH];
+static char get_topic[SHADOW_TOPIC_LENGTH];
+static char get_accepted_topic[SHADOW_TOPIC_LENGTH];
+static char update_accepted_topic[SHADOW_TOPIC_LENGTH];
+static char update_rejected_topic[SHADOW_TOPIC_LENGTH];
+
+static bool version_known;
+static int32_t last_version;
+
+/* The update in flight: its fields count as reported once /update/accepted echoes
+ * its clientToken. One update is in flight at a time.
+ */
+static uint32_t inflight_mask;
+static char inflight_token[SHADOW_TOKEN_LENGTH];
+static int64_t inflight_at_ms;
+static uint32_t next_token;
+static bool started;
+
+static void report_work_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(report_work, report_work_fn);
+
+static int field_find(const char *key, size_t len)
+{
+	for (int i = 0; i < field_count; i++)
+	{
+		if (json_scan_key_is(key, len, fields[i].key))
+		{
+			return i;
+		}
+	}
+
+	return -ENOENT;
+}
+
+/*
+Function : value_parse
+
+Description : Parses the value of a field member. A value of the wrong type is
+			  skipped.
+
+Parameter :
+- s : Scanner positioned before the value.
+- f : Field.
+- value : Output value, value->str points to buf for strings.
+- buf : String buffer of CONFIG_SHADOW_STR_MAX_LEN bytes.
+
+Return :
+1 when a value was parsed, 0 when it was skipped, -EBADMSG on malformed input.
+
+Example Call :
+				ret = value_parse(s, f, &desired, buf);
+*/
+static int value_parse(struct json_scan *s, const struct shadow_field *f,
+					   struct shadow_value *value, char *buf)
+{
+	const char *str;
+	size_t len;
+
+	value->num = 0;
+	value->str = NULL;
+
+	switch (f->type)
+	{
+	case SHADOW_INT:
+		if (json_scan_is_number(s))
+		{
+			return json_scan_number(s, &value->num) ? 1 : -EBADMSG;
+		}
+		break;
+
+	case SHADOW_BOOL:
+		if (json_scan_literal(s, "true"))
+		{
+			value->num = 1;
+			return 1;
+		}
+		if (json_scan_literal(s, "false"))
+		{
+			return 1;
+		}
+		break;
+
+	case SHADOW_STR:
+		if (json_scan_peek(s, '"'))
+		{
+			if (!json_scan_string(s, &str, &len))
+			{
+				return -EBADMSG;
+			}
+			json_scan_string_copy(buf, CONFIG_SHADOW_STR_MAX_LEN, str, len);
+			value->str = buf;
+			return 1;
+		}
+		break;
+	}
+
+	LOG_WRN("Wrong type for field %s, ignored", f->key);
+
+	return json_scan_skip(s) ? 0 : -EBADMSG;
+}
+
+static bool field_dirty(const struct shadow_field *f)
+{
+	if (!f->value_set)
+	{
+		return false;
+	}
+
+	if (!f->reported_valid)
+	{
+		return true;
+	}
+
+	return (f->type == SHADOW_STR) ? strcmp(f->str, f->reported_str) != 0
+								   : f->value != f->reported;
+}
+
+static bool any_dirty(void)
+{
+	for (int i = 0; i < field_count; i++)
+	{
+		if (field_dirty(&fields[i]))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void field_store(int field, const struct shadow_value *value)
+{
+	struct shadow_field *f = &fields[field];
+
+	k_mutex_lock(&shadow_lock, K_FOREVER);
+
+	if (f->type == SHADOW_STR)
+	{
+		strncpy(f->str, value->str, sizeof(f->str) - 1);
+	}
+	else
+	{
+		f->value = value->num;
+	}
+	f->value_set = true;
+	f->gen++;
+
+	if (field_dirty(f))
+	{
+		k_work_schedule(&report_work, K_MSEC(CONFIG_SHADOW_REPORT_DELAY_MS));
+	}
+
+	k_mutex_unlock(&shadow_lock);
+}
+
+/*
+Function : members_apply
+
+Description : Walks the members of an object and handles each known field as soon as
+			  its value is scanned. Unknown keys and nested objects are skipped. With
+			  reported set, values only update what the cloud holds (the reported
+			  section of a /get response); otherwise they are desired values passed
+			  to the field callbacks.
+
+Parameter :
+- s : Scanner positioned before the object.
+- reported : true for a reported section, false for a delta.
+
+Return :
+true on success, false on malformed input.
+
+Example Call :
+				members_apply(s, false);
+*/
+static bool members_apply(struct json_scan *s, bool reported)
+{
+	char buf[CONFIG_SHADOW_STR_MAX_LEN];
+
+	if (!json_scan_expect(s, '{'))
+	{
+		return false;
+	}
+
+	if (json_scan_expect(s, '}'))
+	{
+		return true;
+	}
+
+	do
+	{
+		struct shadow_value value;
+		const char *key;
+		size_t len;
+		int field;
+		int ret;
+
+		if (!json_scan_string(s, &key, &len) || !json_scan_expect(s, ':'))
+		{
+			return false;
+		}
+
+		field = field_find(key, len);
+		if (field < 0)
+		{
+			if (!json_scan_skip(s))
+			{
+				return false;
+			}
+			continue;
+		}
+
+		ret = value_parse(s, &fields[field], &value, buf);
+		if (ret < 0)
+		{
+			return false;
+		}
+		if (ret == 0)
+		{
+			continue;
+		}
+
+		if (reported)
+		{
+			struct shadow_field *f = &fields[field];
+
+			k_mutex_lock(&shadow_lock, K_FOREVER);
+			if (f->type == SHADOW_STR)
+			{
+				strncpy(f->reported_str, value.str, sizeof(f->reported_str) - 1);
+			}
+			else
+			{
+				f->reported = value.num;
+			}
+			f->reported_valid = true;
+			k_mutex_unlock(&shadow_lock);
+		}
+		else if (fields[field].cb == NULL || fields[field].cb(field, &value) == 0)
+		{
+			LOG_DBG("Delta applied to %s", fields[field].key);
+			field_store(field, &value);
+		}
+	} while (json_scan_expect(s, ','));
+
+	return json_scan_expect(s, '}');
+}
+
+/* "state" of a /get response: its delta and reported sections, the rest is skipped. */
+static bool get_state_apply(struct json_scan *s)
+{
+	if (!json_scan_expect(s, '{'))
+	{
+		return false;
+	}
+
+	if (json_scan_expect(s, '}'))
+	{
+		return true;
+	}
+
+	do
+	{
+		const char *key;
+		size_t len;
+		bool ok;
+
+		if (!json_scan_string(s, &key, &len) || !json_scan_expect(s, ':'))
+		{
+			return false;
+		}
+
+		if (json_scan_key_is(key, len, "delta"))
+		{
+			ok = members_apply(s, false);
+		}
+		else if (json_scan_key_is(key, len, "reported"))
+		{
+			ok = members_apply(s, true);
+		}
+		else
+		{
+			ok = json_scan_skip(s);
+		}
+
+		if (!ok)
+		{
+			return false;
+		}
+	} while (json_scan_expect(s, ','));
+
+	return json_scan_expect(s, '}');
+}
+
+static bool version_stale(int32_t version)
+{
+	return version_known && version <= last_version;
+}
+
+/*
+Function : document_apply
+
+Description : Handles a /update/delta message or a /get response in one pass. "state"
+			  is applied as soon as it is reached when "version" came first, as AWS
+			  sends it; otherwise its position is kept and it is applied once the
+			  version is known. Messages not newer than the last version are dropped.
+
+Parameter :
+- data : Payload.
+- len : Payload length.
+- get : true for a /get response, false for a delta.
+
+Return : void
+
+Example Call :
+				document_apply(data, len, false);
+*/
+static void document_apply(const char *data, size_t len, bool get)
+{
+	struct json_scan s = {
+		.p = data,
+		.end = data + len,
+	};
+	struct json_scan state = {0};
+	bool version_seen = false;
+	bool applied = false;
+	int32_t version = 0;
+	bool ok = true;
+
+	if (!json_scan_expect(&s, '{'))
+	{
+		goto malformed;
+	}
+
+	if (!json_scan_expect(&s, '}'))
+	{
+		do
+		{
+			const char *key;
+			size_t key_len;
+
+			if (!json_scan_string(&s, &key, &key_len) || !json_scan_expect(&s, ':'))
+			{
+				goto malformed;
+			}
+
+			if (json_scan_key_is(key, key_len, "version"))
+			{
+				version_seen = json_scan_number(&s, &version);
+				ok = version_seen;
+			}
+			else if (json_scan_key_is(key, key_len, "state") && version_seen)
+			{
+				if (version_stale(version))
+				{
+					LOG_DBG("Stale shadow version %d dropped", version);
+					return;
+				}
+				ok = get ? get_state_apply(&s) : members_apply(&s, false);
+				applied = true;
+			}
+			else if (json_scan_key_is(key, key_len, "state"))
+			{
+				state = s;
+				ok = json_scan_skip(&s);
+			}
+			else
+			{
+				ok = json_scan_skip(&s);
+			}
+
+			if (!ok)
+			{
+				goto malformed;
+			}
+		} while (json_scan_expect(&s, ','));
+	}
+
+	if (!applied && state.p != NULL)
+	{
+		if (version_seen && version_stale(version))
+		{
+			LOG_DBG("Stale shadow version %d dropped", version);
+			return;
+		}
+		if (!(get ? get_state_apply(&state) : members_apply(&state, false)))
+		{
+			goto malformed;
+		}
+	}
+
+	if (version_seen && !version_stale(version))
+	{
+		version_known = true;
+		last_version = version;
+	}
+
+	return;
+
+malformed:
+	LOG_ERR("Malformed shadow document at offset %d", (int)(s.p - data));
+}
+
+static void on_delta(const char *topic, const uint8_t *data, size_t len)
+{
+	document_apply((const char *)data, len, false);
+}
+
+static void on_get_accepted(const char *topic, const uint8_t *data, size_t len)
+{
+	document_apply((const char *)data, len, true);
+}
+
+/*
+Function : token_matches
+
+Description : Scans the top level of an /update/accepted or /update/rejected message
+			  for its clientToken and compares it with the update in flight. The
+			  echoed state and the other members are skipped. Responses to updates
+			  of other clients carry their own token, or none. Called with
+			  shadow_lock held.
+
+Parameter :
+- data : Payload.
+- len : Payload length.
+
+Return :
+true when the message answers the update in flight.
+
+Example Call :
+				if (token_matches((const char *)data, len))
+*/
+static bool token_matches(const char *data, size_t len)
+{
+	struct json_scan s = {
+		.p = data,
+		.end = data + len,
+	};
+
+	if (inflight_token[0] == '\0' || !json_scan_expect(&s, '{') || json_scan_expect(&s, '}'))
+	{
+		return false;
+	}
+
+	do
+	{
+		const char *key;
+		const char *token;
+		size_t key_len;
+		size_t token_len;
+
+		if (!json_scan_string(&s, &key, &key_len) || !json_scan_expect(&s, ':'))
+		{
+			return false;
+		}
+
+		if (json_scan_key_is(key, key_len, "clientToken"))
+		{
+			return json_scan_string(&s, &token, &token_len) &&
+				   json_scan_key_is(token, token_len, inflight_token);
+		}
+
+		if (!json_scan_skip(&s))
+		{
+			return false;
+		}
+	} while (json_scan_expect(&s, ','));
+
+	return false;
+}
+
+/*
+Function : update_end
+
+Description : Ends the update in flight. Accepted fields count as reported, unless
+			  they changed after the update was built: the cloud then holds an older
+			  value, so they are reported again. Fields of a rejected or lost update
+			  keep their last reported value and stay dirty. Called with shadow_lock
+			  held.
+
+Parameter :
+- accepted : true for /update/accepted, false for a rejection, a timeout or a
+			 reconnect.
+
+Return :
+true when fields are left to report.
+
+Example Call :
+				more = update_end(true);
+*/
+static bool update_end(bool accepted)
+{
+	for (int i = 0; i < field_count && accepted; i++)
+	{
+		struct shadow_field *f = &fields[i];
+
+		if (inflight_mask & BIT(i))
+		{
+			if (f->gen == f->sent_gen)
+			{
+				f->reported = f->value;
+				memcpy(f->reported_str, f->str, sizeof(f->str));
+				f->reported_valid = true;
+			}
+			else
+			{
+				f->reported_valid = false;
+			}
+		}
+	}
+
+	inflight_mask = 0;
+	inflight_token[0] = '\0';
+
+	return any_dirty();
+}
+
+static void on_update_accepted(const char *topic, const uint8_t *data, size_t len)
+{
+	k_mutex_lock(&shadow_lock, K_FOREVER);
+
+	if (!token_matches((const char *)data, len))
+	{
+		k_mutex_unlock(&shadow_lock);
+		return;
+	}
+
+	LOG_DBG("Shadow update %s accepted", inflight_token);
+
+	/* Also replaces the response timeout, which would hold back later changes. Done
+	 * under shadow_lock, so a change stored meanwhile is not cancelled.
+	 */
+	if (update_end(true))
+	{
+		k_work_reschedule(&report_work, K_MSEC(CONFIG_SHADOW_REPORT_DELAY_MS));
+	}
+	else
+	{
+		k_work_cancel_delayable(&report_work);
+	}
+
+	k_mutex_unlock(&shadow_lock);
+}
+
+static void on_update_rejected(const char *topic, const uint8_t *data, size_t len)
+{
+	k_mutex_lock(&shadow_lock, K_FOREVER);
+
+	if (!token_matches((const char *)data, len))
+	{
+		k_mutex_unlock(&shadow_lock);
+		return;
+	}
+
+	LOG_WRN("Shadow update %s rejected: %.*s", inflight_token, (int)MIN(len, 80),
+			(const char *)data);
+
+	/* Not retried right away, the same document would be rejected again. */
+	if (update_end(false))
+	{
+		k_work_reschedule(&report_work, K_MSEC(SHADOW_RESPONSE_TIMEOUT_MS));
+	}
+
+	k_mutex_unlock(&shadow_lock);
+}
+
+static int get_request(void)
+{
+	return mqtt_outbox_publish(MQTT_PRIO_COMMAND, get_topic, MQTT_QOS_1_AT_LEAST_ONCE,
+							   (const uint8_t *)"{}", 2);
+}
+
+/* Appends a JSON string, escaped. */
+static int json_str_append(char *buf, size_t size, size_t *pos, const char *str)
+{
+	size_t n = *pos;
+
+	if (n >= size)
+	{
+		return -ENOMEM;
+	}
+	buf[n++] = '"';
+
+	for (; *str != '\0'; str++)
+	{
+		unsigned char c = (unsigned char)*str;
+
+		if (c == '"' || c == '\\')
+		{
+			if (n + 2 > size)
+			{
+				return -ENOMEM;
+			}
+			buf[n++] = '\\';
+			buf[n++] = c;
+		}
+		else if (c < 0x20)
+		{
+			if (n + 6 > size)
+			{
+				return -ENOMEM;
+			}
+			n += snprintf(&buf[n], size - n, "\\u%04x", c);
+		}
+		else
+		{
+			if (n + 1 > size)
+			{
+				return -ENOMEM;
+			}
+			buf[n++] = c;
+		}
+	}
+
+	if (n + 1 > size)
+	{
+		return -ENOMEM;
+	}
+	buf[n++] = '"';
+	*pos = n;
+
+	return 0;
+}
+
+/* Appends one "key":value member, leaving pos unchanged when it does not fit. */
+static int member_append(char *buf, size_t size, size_t *pos, const struct shadow_field *f,
+						 bool first)
+{
+	size_t n = *pos;
+	int len;
+
+	len = snprintf(&buf[n], size - n, "%s\"%s\":", first ? "" : ",", f->key);
+	if (len < 0 || (size_t)len >= size - n)
+	{
+		return -ENOMEM;
+	}
+	n += len;
+
+	switch (f->type)
+	{
+	case SHADOW_INT:
+		len = snprintf(&buf[n], size - n, "%d", f->value);
+		break;
+	case SHADOW_BOOL:
+		len = snprintf(&buf[n], size - n, "%s", f->value ? "true" : "false");
+		break;
+	case SHADOW_STR:
+		if (json_str_append(buf, size, &n, f->str) != 0)
+		{
+			return -ENOMEM;
+		}
+		len = 0;
+		break;
+	}
+
+	if (len < 0 || (size_t)len >= size - n)
+	{
+		return -ENOMEM;
+	}
+	*pos = n + len;
+
+	return 0;
+}
+
+/*
+Function : report_work_fn
+
+Description : Publishes the fields that differ from the last reported state as one
+			  update, through the outbox, tagged with a new clientToken. They count
+			  as reported only once /update/accepted echoes the token. Until then,
+			  or for SHADOW_RESPONSE_TIMEOUT_MS, no further update is sent. Fields
+			  that do not fit in CONFIG_SHADOW_DOC_MAX_LEN go in the next update.
+
+Parameter :
+- work : Work item.
+
+Return : void
+
+Example Call :
+				Runs on the system work queue.
+*/
+static void report_work_fn(struct k_work *work)
+{
+	size_t size = CONFIG_SHADOW_DOC_MAX_LEN - SHADOW_DOC_TAIL_MAX;
+	uint32_t sending = 0;
+	bool more = false;
+	uint32_t token;
+	int64_t left;
+	size_t pos;
+	char *doc;
+	int err;
+
+	k_mutex_lock(&shadow_lock, K_FOREVER);
+
+	if (inflight_mask != 0)
+	{
+		left = inflight_at_ms + SHADOW_RESPONSE_TIMEOUT_MS - k_uptime_get();
+		if (left > 0)
+		{
+			k_mutex_unlock(&shadow_lock);
+			k_work_schedule(&report_work, K_MSEC(left));
+			return;
+		}
+
+		LOG_WRN("No response to shadow update %s", inflight_token);
+		update_end(false);
+	}
+
+	if (!any_dirty())
+	{
+		k_mutex_unlock(&shadow_lock);
+		return;
+	}
+
+	k_mutex_unlock(&shadow_lock);
+
+	doc = mqtt_arena_alloc(CONFIG_SHADOW_DOC_MAX_LEN);
+	if (doc == NULL)
+	{
+		LOG_ERR("No arena memory for the shadow update");
+		k_work_schedule(&report_work, K_MSEC(CONFIG_SHADOW_REPORT_DELAY_MS));
+		return;
+	}
+
+	k_mutex_lock(&shadow_lock, K_FOREVER);
+
+	memcpy(doc, SHADOW_DOC_HEAD, sizeof(SHADOW_DOC_HEAD) - 1);
+	pos = sizeof(SHADOW_DOC_HEAD) - 1;
+
+	for (int i = 0; i < field_count; i++)
+	{
+		if (!field_dirty(&fields[i]))
+		{
+			continue;
+		}
+
+		if (member_append(doc, size, &pos, &fields[i], sending == 0) != 0)
+		{
+			more = true;
+			continue;
+		}
+
+		sending |= BIT(i);
+	}
+
+	if (sending == 0)
+	{
+		k_mutex_unlock(&shadow_lock);
+		mqtt_arena_free(doc);
+		if (more)
+		{
+			LOG_ERR("Shadow field larger than CONFIG_SHADOW_DOC_MAX_LEN");
+		}
+		return;
+	}
+
+	token = ++next_token;
+	pos += snprintf(&doc[pos], CONFIG_SHADOW_DOC_MAX_LEN - pos, SHADOW_DOC_TAIL, token);
+
+	err = mqtt_outbox_publish(MQTT_PRIO_TELEMETRY, update_topic, MQTT_QOS_1_AT_LEAST_ONCE,
+							  (const uint8_t *)doc, pos);
+	if (err == 0)
+	{
+		for (int i = 0; i < field_count; i++)
+		{
+			if (sending & BIT(i))
+			{
+				fields[i].sent_gen = fields[i].gen;
+			}
+		}
+		inflight_mask = sending;
+		inflight_at_ms = k_uptime_get();
+		snprintf(inflight_token, sizeof(inflight_token), "%u", token);
+		LOG_DBG("Shadow update %u of %u bytes queued", token, (unsigned int)pos);
+	}
+	else
+	{
+		LOG_WRN("Shadow update not queued: %d", err);
+	}
+
+	k_mutex_unlock(&shadow_lock);
+	mqtt_arena_free(doc);
+
+	/* Retries a failed queue, or checks for the response to this update. */
+	k_work_schedule(&report_work, K_MSEC(err ? CONFIG_SHADOW_REPORT_DELAY_MS
+											 : SHADOW_RESPONSE_TIMEOUT_MS));
+}
+
+/*
+Function : shadow_field_add
+
+Description : Adds a field to the reported state. Fields are added at startup, before
+			  shadow_init(), so a /get response at boot can be applied to them.
+
+Parameter :
+- key : JSON key in the shadow "state" object, must stay valid.
+- type : Value type.
+- cb : Optional delta callback, NULL to accept every desired value.
+
+Return :
+Field number on success, -ENOMEM if all CONFIG_SHADOW_MAX_FIELDS are in use.
+
+Example Call :
+				interval = shadow_field_add("interval", SHADOW_INT, on_interval);
+*/
+int shadow_field_add(const char *key, enum shadow_type type, shadow_delta_cb_t cb)
+{
+	int field;
+
+	k_mutex_lock(&shadow_lock, K_FOREVER);
+
+	if (field_count >= CONFIG_SHADOW_MAX_FIELDS)
+	{
+		k_mutex_unlock(&shadow_lock);
+		LOG_ERR("No free shadow field for %s", key);
+		return -ENOMEM;
+	}
+
+	field = field_count;
+	fields[field].key = key;
+	fields[field].type = type;
+	fields[field].cb = cb;
+	field_count++;
+
+	k_mutex_unlock(&shadow_lock);
+
+	return field;
+}
+
+/*
+Function : shadow_report_int
+
+Description : Sets the local value of an int field. It is reported only when it
+			  differs from the last reported value, together with other changes made
+			  within CONFIG_SHADOW_REPORT_DELAY_MS.
+
+Parameter :
+- field : Field number.
+- value : New value.
+
+Return :
+0 on success, -EINVAL for an unknown field or a field of another type.
+
+Example Call :
+				shadow_report_int(interval, 300);
+*/
+int shadow_report_int(int field, int32_t value)
+{
+	struct shadow_value v = {
+		.num = value,
+	};
+
+	if (field < 0 || field >= field_count || fields[field].type != SHADOW_INT)
+	{
+		return -EINVAL;
+	}
+
+	field_store(field, &v);
+
+	return 0;
+}
+
+/*
+Function : shadow_report_bool
+
+Description : Sets the local value of a bool field, see shadow_report_int().
+
+Parameter :
+- field : Field number.
+- value : New value.
+
+Return :
+0 on success, -EINVAL for an unknown field or a field of another type.
+
+Example Call :
+				shadow_report_bool(led, true);
+*/
+int shadow_report_bool(int field, bool value)
+{
+	struct shadow_value v = {
+		.num = value ? 1 : 0,
+	};
+
+	if (field < 0 || field >= field_count || fields[field].type != SHADOW_BOOL)
+	{
+		return -EINVAL;
+	}
+
+	field_store(field, &v);
+
+	return 0;
+}
+
+/*
+Function : shadow_report_str
+
+Description : Sets the local value of a string field, see shadow_report_int(). Longer
+			  strings are truncated to CONFIG_SHADOW_STR_MAX_LEN - 1 bytes.
+
+Parameter :
+- field : Field number.
+- value : New value.
+
+Return :
+0 on success, -EINVAL for an unknown field or a field of another type.
+
+Example Call :
+				shadow_report_str(fw, "1.4.2");
+*/
+int shadow_report_str(int field, const char *value)
+{
+	struct shadow_value v = {
+		.str = value,
+	};
+
+	if (field < 0 || field >= field_count || fields[field].type != SHADOW_STR || value == NULL)
+	{
+		return -EINVAL;
+	}
+
+	field_store(field, &v);
+
+	return 0;
+}
+
+/*
+Function : shadow_report_all
+
+Description : Reports every set field again, e.g. after the shadow was deleted in the
+			  cloud.
+
+Parameter : void
+
+Return : void
+
+Example Call :
+				shadow_report_all();
+*/
+void shadow_report_all(void)
+{
+	k_mutex_lock(&shadow_lock, K_FOREVER);
+
+	for (int i = 0; i < field_count; i++)
+	{
+		fields[i].reported_valid = false;
+	}
+
+	k_mutex_unlock(&shadow_lock);
+
+	k_work_reschedule(&report_work, K_NO_WAIT);
+}
+
+/*
+Function : shadow_on_connect
+
+Description : Called on every CONNACK, after the subscriptions are queued again. The
+			  response to an update in flight may have been lost with the connection,
+			  so its fields stay dirty. With CONFIG_SHADOW_GET_ON_CONNECT a /get is
+			  queued. Its response delivers deltas made while the device was offline
+			  and the reported state the cloud holds, so fields the cloud already
+			  has are not sent again.
+
+Parameter : void
+
+Return : void
+
+Example Call :
+				shadow_on_connect();
+*/
+void shadow_on_connect(void)
+{
+	int err;
+
+	if (!started)
+	{
+		return;
+	}
+
+	k_mutex_lock(&shadow_lock, K_FOREVER);
+
+	if (inflight_mask != 0 && update_end(false))
+	{
+		/* Leaves time for the /get response first. */
+		k_work_reschedule(&report_work, K_MSEC(CONFIG_SHADOW_REPORT_DELAY_MS));
+	}
+
+	k_mutex_unlock(&shadow_lock);
+
+	if (IS_ENABLED(CONFIG_SHADOW_GET_ON_CONNECT))
+	{
+		err = get_request();
+		if (err)
+		{
+			LOG_WRN("Shadow /get not queued: %d", err);
+		}
+	}
+}
+
+/*
+Function : shadow_init
+
+Description : Subscribes to the shadow delta topic and the responses to updates and,
+			  with CONFIG_SHADOW_GET_ON_CONNECT, to /get. The /get itself is queued
+			  on every CONNACK by shadow_on_connect(), or here when the client is
+			  already connected.
+
+Parameter : void
+
+Return :
+0 on success, or a negative error code.
+
+Example Call :
+				shadow_init();
+*/
+int shadow_init(void)
+{
+	static const struct
+	{
+		char *topic;
+		const char *suffix;
+		mqtt_rx_cb_t cb;
+	} subs[] = {
+		{delta_topic, "/update/delta", on_delta},
+		{update_accepted_topic, "/update/accepted", on_update_accepted},
+		{update_rejected_topic, "/update/rejected", on_update_rejected},
+		{get_accepted_topic, "/get/accepted", on_get_accepted},
+	};
+	int err;
+
+	snprintf(update_topic, sizeof(update_topic), CONFIG_SHADOW_TOPIC "/update", DEVICE_ID);
+	snprintf(get_topic, sizeof(get_topic), CONFIG_SHADOW_TOPIC "/get", DEVICE_ID);
+
+	for (int i = 0; i < ARRAY_SIZE(subs); i++)
+	{
+		if (subs[i].cb == on_get_accepted && !IS_ENABLED(CONFIG_SHADOW_GET_ON_CONNECT))
+		{
+			continue;
+		}
+
+		snprintf(subs[i].topic, SHADOW_TOPIC_LENGTH, CONFIG_SHADOW_TOPIC "%s", DEVICE_ID,
+				 subs[i].suffix);
+		mqtt_create_topic_subscribe(NULL, "%s", subs[i].topic);
+
+		err = mqtt_rx_handler_register(subs[i].topic, subs[i].cb);
+		if (err)
+		{
+			return err;
+		}
+	}
+
+	started = true;
+
+	if (IS_ENABLED(CONFIG_SHADOW_GET_ON_CONNECT) && mqtt_is_connected())
+	{
+		err = get_request();
+		if (err)
+		{
+			return err;
+		}
+	}
+
+	LOG_INF("Shadow sync on %s, %d fields", update_topic, field_count);
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : SHADOW.h
+*/
+
+#ifndef _SHADOW_H_
+#define _SHADOW_H_
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Device shadow sync on top of the MQTT component (AWS IoT classic or named
+ * shadow under CONFIG_SHADOW_TOPIC). The reported state is a fixed table of
+ * flat fields kept locally. A report changes the local value only, and after
+ * CONFIG_SHADOW_REPORT_DELAY_MS the fields that differ from what was last
+ * reported go out together in one update, instead of the whole document.
+ * They count as reported once /update/accepted echoes the update's
+ * clientToken. After a rejection, a timeout or a reconnect they stay dirty
+ * and are sent again.
+ *
+ * Incoming /update/delta messages are scanned in place (shadow_json.h),
+ * without a parse tree or allocation. Each member of "state" is handed to its
+ * field's callback as it is found. Accepted values become the local state and
+ * are reported back, which clears the delta in the cloud. Deltas older than
+ * the last version seen are dropped. Pending deltas and the reported state are
+ * fetched with /get on every connect.
+ */
+
+enum shadow_type
+{
+	SHADOW_INT,	 /* int32, JSON number (fractions are truncated) */
+	SHADOW_BOOL, /* JSON true/false */
+	SHADOW_STR,	 /* JSON string, up to CONFIG_SHADOW_STR_MAX_LEN - 1 bytes */
+};
+
+/* Desired value of a delta. str is NUL terminated for SHADOW_STR, else NULL. */
+struct shadow_value
+{
+	int32_t num;
+	const char *str;
+};
+
+/* Delta callback, runs on the MQTT thread. Return 0 to accept the value, which
+ * is then stored and reported, or a negative error code to keep the current one.
+ */
+typedef int (*shadow_delta_cb_t)(int field, const struct shadow_value *desired);
+
+#if defined(CONFIG_SHADOW)
+
+int shadow_field_add(const char *key, enum shadow_type type, shadow_delta_cb_t cb);
+int shadow_report_int(int field, int32_t value);
+int shadow_report_bool(int field, bool value);
+int shadow_report_str(int field, const char *value);
+void shadow_report_all(void);
+void shadow_on_connect(void);
+int shadow_init(void);
+
+#else
+
+static inline int shadow_field_add(const char *key, enum shadow_type type, shadow_delta_cb_t cb)
+{
+	return -ENOTSUP;
+}
+
+static inline int shadow_report_int(int field, int32_t value)
+{
+	return -ENOTSUP;
+}
+
+static inline int shadow_report_bool(int field, bool value)
+{
+	return -ENOTSUP;
+}
+
+static inline int shadow_report_str(int field, const char *value)
+{
+	return -ENOTSUP;
+}
+
+static inline void shadow_report_all(void)
+{
+}
+
+static inline void shadow_on_connect(void)
+{
+}
+
+static inline int shadow_init(void)
+{
+	return 0;
+}
+
+#endif
+
+#endif
\ No newline at end of file
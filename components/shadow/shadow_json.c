@@ -0,0 +1,262 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : SHADOW_JSON.c
+*/
+
+#include <string.h>
+#include <zephyr/sys/util.h>
+#include "shadow_json.h"
+
+static void ws_skip(struct json_scan *s)
+{
+	while (s->p < s->end && (*s->p == ' ' || *s->p == '\t' || *s->p == '\r' || *s->p == '\n'))
+	{
+		s->p++;
+	}
+}
+
+bool json_scan_expect(struct json_scan *s, char c)
+{
+	ws_skip(s);
+	if (s->p < s->end && *s->p == c)
+	{
+		s->p++;
+		return true;
+	}
+
+	return false;
+}
+
+bool json_scan_peek(struct json_scan *s, char c)
+{
+	ws_skip(s);
+	return s->p < s->end && *s->p == c;
+}
+
+/* true when a number follows, without consuming it. */
+bool json_scan_is_number(struct json_scan *s)
+{
+	ws_skip(s);
+	return s->p < s->end && (*s->p == '-' || (*s->p >= '0' && *s->p <= '9'));
+}
+
+/* Scans a string. str/len cover the raw bytes between the quotes, still escaped. */
+bool json_scan_string(struct json_scan *s, const char **str, size_t *len)
+{
+	if (!json_scan_expect(s, '"'))
+	{
+		return false;
+	}
+
+	*str = s->p;
+	while (s->p < s->end && *s->p != '"')
+	{
+		if (*s->p == '\\')
+		{
+			if (s->end - s->p < 2)
+			{
+				/* Truncated after the backslash */
+				s->p = s->end;
+				return false;
+			}
+			s->p++;
+		}
+		s->p++;
+	}
+
+	if (s->p >= s->end)
+	{
+		return false;
+	}
+
+	*len = s->p - *str;
+	s->p++;
+
+	return true;
+}
+
+/* Integer part of a number, clamped to int32. Fraction and exponent are dropped. */
+bool json_scan_number(struct json_scan *s, int32_t *out)
+{
+	bool neg = false;
+	bool digits = false;
+	int64_t v = 0;
+
+	ws_skip(s);
+
+	if (s->p < s->end && *s->p == '-')
+	{
+		neg = true;
+		s->p++;
+	}
+
+	while (s->p < s->end && *s->p >= '0' && *s->p <= '9')
+	{
+		v = MIN(v * 10 + (*s->p - '0'), (int64_t)INT32_MAX + 1);
+		digits = true;
+		s->p++;
+	}
+
+	while (s->p < s->end && ((*s->p >= '0' && *s->p <= '9') || *s->p == '.' || *s->p == 'e' ||
+							 *s->p == 'E' || *s->p == '+' || *s->p == '-'))
+	{
+		s->p++;
+	}
+
+	v = neg ? -v : MIN(v, (int64_t)INT32_MAX);
+	*out = (int32_t)v;
+
+	return digits;
+}
+
+bool json_scan_literal(struct json_scan *s, const char *literal)
+{
+	size_t len = strlen(literal);
+
+	ws_skip(s);
+
+	if ((size_t)(s->end - s->p) < len || memcmp(s->p, literal, len) != 0)
+	{
+		return false;
+	}
+
+	s->p += len;
+
+	return true;
+}
+
+/*
+Function : json_scan_skip
+
+Description : Skips one value of any type. Nested objects and arrays are skipped by
+			  counting brackets outside of strings, without looking at their members.
+			  The scan stops before the ',' or closing bracket that follows the value.
+
+Parameter :
+- s : Scanner positioned before the value.
+
+Return :
+true on success, false on malformed or truncated input.
+
+Example Call :
+				if (!json_scan_skip(s))
+*/
+bool json_scan_skip(struct json_scan *s)
+{
+	int depth = 0;
+
+	ws_skip(s);
+
+	while (s->p < s->end)
+	{
+		const char *str;
+		size_t len;
+		char c = *s->p;
+
+		if (c == '"')
+		{
+			if (!json_scan_string(s, &str, &len))
+			{
+				return false;
+			}
+			if (depth == 0)
+			{
+				return true;
+			}
+			continue;
+		}
+
+		if (c == '{' || c == '[')
+		{
+			depth++;
+		}
+		else if (c == '}' || c == ']')
+		{
+			if (depth == 0)
+			{
+				return true;
+			}
+			if (--depth == 0)
+			{
+				s->p++;
+				return true;
+			}
+		}
+		else if (c == ',' && depth == 0)
+		{
+			return true;
+		}
+
+		s->p++;
+	}
+
+	return false;
+}
+
+bool json_scan_key_is(const char *key, size_t len, const char *name)
+{
+	return strlen(name) == len && memcmp(key, name, len) == 0;
+}
+
+/*
+Function : json_scan_string_copy
+
+Description : Copies a raw string from json_scan_string(), resolving escapes. \uXXXX
+			  becomes '?'. A longer string is truncated to size - 1 bytes.
+
+Parameter :
+- dst : Destination, always NUL terminated.
+- size : Size of dst, at least 1.
+- src : Raw string bytes.
+- len : Length of src.
+
+Return : void
+
+Example Call :
+				json_scan_string_copy(buf, sizeof(buf), str, len);
+*/
+void json_scan_string_copy(char *dst, size_t size, const char *src, size_t len)
+{
+	size_t n = 0;
+
+	for (size_t i = 0; i < len && n < size - 1; i++)
+	{
+		char c = src[i];
+
+		if (c == '\\' && i + 1 < len)
+		{
+			c = src[++i];
+			switch (c)
+			{
+			case 'n':
+				c = '\n';
+				break;
+			case 'r':
+				c = '\r';
+				break;
+			case 't':
+				c = '\t';
+				break;
+			case 'b':
+				c = '\b';
+				break;
+			case 'f':
+				c = '\f';
+				break;
+			case 'u':
+				i = MIN(i + 4, len - 1);
+				c = '?';
+				break;
+			default: /* \" \\ \/ */
+				break;
+			}
+		}
+
+		dst[n++] = c;
+	}
+
+	dst[n] = '\0';
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : SHADOW_JSON.h
+*/
+
+#ifndef _SHADOW_JSON_H_
+#define _SHADOW_JSON_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * In-place JSON scanner of the shadow component. A scan moves p through
+ * [p, end) and nothing is copied or allocated: strings are returned as the
+ * raw bytes between their quotes and resolved with json_scan_string_copy()
+ * only when kept. Every function skips leading whitespace and returns false
+ * on malformed or truncated input, without reading past end.
+ */
+
+struct json_scan
+{
+	const char *p;
+	const char *end;
+};
+
+bool json_scan_expect(struct json_scan *s, char c);
+bool json_scan_peek(struct json_scan *s, char c);
+bool json_scan_is_number(struct json_scan *s);
+bool json_scan_string(struct json_scan *s, const char **str, size_t *len);
+bool json_scan_number(struct json_scan *s, int32_t *out);
+bool json_scan_literal(struct json_scan *s, const char *literal);
+bool json_scan_skip(struct json_scan *s);
+bool json_scan_key_is(const char *key, size_t len, const char *name);
+void json_scan_string_copy(char *dst, size_t size, const char *src, size_t len);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,1012 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : DATA_USAGE.c
+*/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#if defined(CONFIG_SETTINGS)
+#include <zephyr/settings/settings.h>
+#endif
+#if defined(CONFIG_DATE_TIME)
+#include <date_time.h>
+#endif
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+#include "data_usage.h"
+#include "mqtt.h"
+#include "mqtt_arena.h"
+
+#define USAGE_SETTINGS_ROOT "usage"
+#define USAGE_STORE_VERSION 1
+
+#if defined(CONFIG_DATA_USAGE_TRANSPORT_UDP)
+#define USAGE_IP_OVERHEAD 28	   // IPv4 and UDP headers per datagram
+#define USAGE_TLS_OVERHEAD 37	   // DTLS 1.2 AES-GCM record header, explicit nonce and tag
+#define USAGE_TLS_ENABLED IS_ENABLED(CONFIG_MQTT_SN_DTLS)
+#define USAGE_PUBLISH_LEN 7		   // MQTT-SN PUBLISH headers with a 2 byte topic ID
+#define USAGE_LONG_PUBLISH_LEN 9   // The same with the 3 byte length field
+#define USAGE_PUBACK_LEN 7		   // Topic ID, message ID and return code
+#define USAGE_QOS2_ACKS_LEN 12	   // PUBREC, PUBREL and PUBCOMP
+#define USAGE_CONNECT_LEN 6		   // CONNECT headers without the client ID
+#define USAGE_CONNACK_LEN 3
+#else
+#define USAGE_IP_OVERHEAD 40  // IPv4 and TCP headers per packet
+#define USAGE_TLS_OVERHEAD 29 // TLS 1.2 AES-GCM record header, explicit nonce and tag
+#define USAGE_TLS_ENABLED IS_ENABLED(CONFIG_MQTT_BROKER_TLS)
+#define USAGE_ACK_LEN 4		  // PUBACK, PUBREC, PUBREL and PUBCOMP
+#define USAGE_CONNECT_LEN 14  // CONNECT headers without the client ID
+#define USAGE_CONNACK_LEN 4
+#endif
+#define USAGE_TOPIC_LEN 40 // Stored topic prefix, longer topics are truncated
+
+#define USAGE_JSON_MAX_LEN 1024
+#define USAGE_TOPIC_MAX_LEN 64
+#define USAGE_SECONDS_PER_DAY 86400
+
+LOG_MODULE_REGISTER(DATA_USAGE);
+
+struct usage_topic
+{
+	char topic[USAGE_TOPIC_LEN]; /* Empty for the overflow entry */
+	uint32_t month_bytes;
+};
+
+/* Counters and windows, persisted as "usage/totals". A different size or version is
+ * discarded.
+ */
+struct usage_totals
+{
+	uint32_t version;
+	uint32_t day;	/* Days since 1970, 0 until the network time is known */
+	uint32_t month; /* Billing months since year 0, 0 until the network time is known */
+	uint32_t day_bytes[DATA_USAGE_CATEGORY_COUNT];
+	uint32_t month_bytes[DATA_USAGE_CATEGORY_COUNT];
+	uint64_t total_bytes[DATA_USAGE_CATEGORY_COUNT];
+};
+
+/* Per-topic table, persisted as "usage/topics" so that control traffic, which only
+ * changes the totals, does not rewrite it.
+ */
+struct usage_topic_table
+{
+	uint32_t version;
+	/* The last entry collects the topics that did not fit. */
+	struct usage_topic entries[CONFIG_DATA_USAGE_MAX_TOPICS + 1];
+};
+
+static const char *const category_names[DATA_USAGE_CATEGORY_COUNT] = {
+	[DATA_USAGE_PAYLOAD] = "payload",
+	[DATA_USAGE_MQTT] = "mqtt",
+	[DATA_USAGE_TLS] = "tls",
+	[DATA_USAGE_IP] = "ip",
+	[DATA_USAGE_RECONNECT] = "reconnect",
+};
+
+static const char *const level_names[] = {
+	[DATA_USAGE_NORMAL] = "normal",
+	[DATA_USAGE_CONSTRAINED] = "constrained",
+	[DATA_USAGE_EXCEEDED] = "exceeded",
+};
+
+static struct usage_totals totals = {.version = USAGE_STORE_VERSION};
+static struct usage_topic_table topics = {.version = USAGE_STORE_VERSION};
+static bool totals_dirty; /* Changed since the last save, under usage_lock */
+static bool topics_dirty;
+static K_MUTEX_DEFINE(usage_lock);
+static enum data_usage_level level;
+
+#if defined(CONFIG_SETTINGS)
+/* Copy written to flash outside the lock, one record at a time. */
+static union
+{
+	struct usage_totals totals;
+	struct usage_topic_table topics;
+} snapshot;
+#endif
+
+static void usage_save_work_fn(struct k_work *work);
+static void usage_publish_work_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(save_work, usage_save_work_fn);
+static K_WORK_DELAYABLE_DEFINE(publish_work, usage_publish_work_fn);
+
+static uint32_t budget_bytes(uint32_t kb)
+{
+	return kb * 1024U;
+}
+
+static uint32_t sum(const uint32_t *bytes)
+{
+	uint32_t total = 0;
+
+	for (int i = 0; i < DATA_USAGE_CATEGORY_COUNT; i++)
+	{
+		total += bytes[i];
+	}
+
+	return total;
+}
+
+static void budget_fill(struct data_usage_budget *b, uint32_t used, uint32_t budget)
+{
+	b->used = used;
+	b->budget = budget;
+
+	if (budget == 0)
+	{
+		b->remaining = UINT32_MAX;
+	}
+	else
+	{
+		b->remaining = used < budget ? budget - used : 0;
+	}
+}
+
+static enum data_usage_level level_of(uint32_t used, uint32_t budget)
+{
+	if (budget == 0)
+	{
+		return DATA_USAGE_NORMAL;
+	}
+
+	if (used >= budget)
+	{
+		return DATA_USAGE_EXCEEDED;
+	}
+
+	if ((uint64_t)used * 100 >= (uint64_t)budget * CONFIG_DATA_USAGE_CONSTRAINED_PCT)
+	{
+		return DATA_USAGE_CONSTRAINED;
+	}
+
+	return DATA_USAGE_NORMAL;
+}
+
+/* Called with usage_lock held. Returns true when the level changed. */
+static bool level_update(void)
+{
+	uint32_t day_used = sum(totals.day_bytes);
+	uint32_t month_used = sum(totals.month_bytes);
+	enum data_usage_level next;
+
+	next = MAX(level_of(day_used, budget_bytes(CONFIG_DATA_USAGE_DAILY_BUDGET_KB)),
+			   level_of(month_used, budget_bytes(CONFIG_DATA_USAGE_MONTHLY_BUDGET_KB)));
+
+	if (next == level)
+	{
+		return false;
+	}
+
+	LOG_WRN("Data usage %s: day %u of %u bytes, month %u of %u bytes", level_names[next],
+			day_used, budget_bytes(CONFIG_DATA_USAGE_DAILY_BUDGET_KB), month_used,
+			budget_bytes(CONFIG_DATA_USAGE_MONTHLY_BUDGET_KB));
+	level = next;
+
+	return true;
+}
+
+#if defined(CONFIG_DATA_USAGE_MOCK_TIME)
+static int64_t mock_now_ms;
+
+/*
+Function : data_usage_mock_time_set
+
+Description : Sets the network time seen by the usage windows, for tests.
+
+Parameter :
+- now_ms : Milliseconds since 1970, 0 while the time is unknown.
+
+Return : void
+
+Example Call :
+				data_usage_mock_time_set(1717200000000LL);
+*/
+void data_usage_mock_time_set(int64_t now_ms)
+{
+	k_mutex_lock(&usage_lock, K_FOREVER);
+	mock_now_ms = now_ms;
+	k_mutex_unlock(&usage_lock);
+}
+#endif
+
+/* Network time in milliseconds since 1970. */
+static int usage_time_now(int64_t *now_ms)
+{
+#if defined(CONFIG_DATA_USAGE_MOCK_TIME)
+	*now_ms = mock_now_ms;
+	return mock_now_ms > 0 ? 0 : -ENODATA;
+#elif defined(CONFIG_DATE_TIME)
+	return date_time_now(now_ms);
+#else
+	return -ENOTSUP;
+#endif
+}
+
+/*
+Function : period_update
+
+Description : Starts a new daily or monthly window when the network time has moved
+			  past the current one. The month starts on CONFIG_DATA_USAGE_BILLING_DAY.
+			  Without network time the windows are left as they are. Called with
+			  usage_lock held.
+
+Parameter : void
+
+Return :
+true when a window was reset.
+
+Example Call :
+				changed = period_update();
+*/
+static bool period_update(void)
+{
+	int64_t now_ms;
+	time_t now;
+	struct tm tm;
+	uint32_t day;
+	uint32_t month;
+	bool changed = false;
+
+	if (usage_time_now(&now_ms) != 0)
+	{
+		return false;
+	}
+
+	now = (time_t)(now_ms / MSEC_PER_SEC);
+	gmtime_r(&now, &tm);
+
+	day = (uint32_t)(now / USAGE_SECONDS_PER_DAY);
+	month = (uint32_t)(tm.tm_year + 1900) * 12 + tm.tm_mon;
+	if (tm.tm_mday < CONFIG_DATA_USAGE_BILLING_DAY)
+	{
+		month--;
+	}
+
+	if (totals.day != day)
+	{
+		/* Traffic before the first network time belongs to the current window. */
+		if (totals.day != 0)
+		{
+			memset(totals.day_bytes, 0, sizeof(totals.day_bytes));
+		}
+		totals.day = day;
+		changed = true;
+	}
+
+	if (totals.month != month)
+	{
+		if (totals.month != 0)
+		{
+			memset(totals.month_bytes, 0, sizeof(totals.month_bytes));
+			memset(topics.entries, 0, sizeof(topics.entries));
+			topics_dirty = true;
+		}
+		totals.month = month;
+		changed = true;
+	}
+
+	return changed;
+}
+
+static struct usage_topic *topic_get(const char *topic, size_t topic_len)
+{
+	size_t len = MIN(topic_len, USAGE_TOPIC_LEN - 1);
+
+	for (int i = 0; i < CONFIG_DATA_USAGE_MAX_TOPICS; i++)
+	{
+		struct usage_topic *t = &topics.entries[i];
+
+		if (t->topic[0] == '\0')
+		{
+			memcpy(t->topic, topic, len);
+			t->topic[len] = '\0';
+			return t;
+		}
+
+		if (strlen(t->topic) == len && memcmp(t->topic, topic, len) == 0)
+		{
+			return t;
+		}
+	}
+
+	return &topics.entries[CONFIG_DATA_USAGE_MAX_TOPICS];
+}
+
+static void overhead_add(uint32_t *bytes, int packets)
+{
+	bytes[DATA_USAGE_IP] += packets * USAGE_IP_OVERHEAD;
+
+	if (USAGE_TLS_ENABLED)
+	{
+		bytes[DATA_USAGE_TLS] += packets * USAGE_TLS_OVERHEAD;
+	}
+}
+
+/*
+Function : account
+
+Description : Adds bytes per category to the daily, monthly and total counters and,
+			  for a publish, to its topic. The changed records are saved at most
+			  every CONFIG_DATA_USAGE_SAVE_INTERVAL_S, or right away on a new window
+			  or budget level.
+
+Parameter :
+- bytes : Bytes per category.
+- topic : Topic of a publish, or NULL.
+- topic_len : Topic length.
+
+Return : void
+
+Example Call :
+				account(bytes, topic, topic_len);
+*/
+static void account(const uint32_t *bytes, const char *topic, size_t topic_len)
+{
+	bool changed;
+
+	k_mutex_lock(&usage_lock, K_FOREVER);
+
+	changed = period_update();
+
+	for (int i = 0; i < DATA_USAGE_CATEGORY_COUNT; i++)
+	{
+		totals.day_bytes[i] += bytes[i];
+		totals.month_bytes[i] += bytes[i];
+		totals.total_bytes[i] += bytes[i];
+	}
+
+	totals_dirty = true;
+
+	if (topic != NULL)
+	{
+		topic_get(topic, topic_len)->month_bytes += sum(bytes);
+		topics_dirty = true;
+	}
+
+	changed |= level_update();
+
+	k_mutex_unlock(&usage_lock);
+
+	if (changed)
+	{
+		k_work_reschedule(&save_work, K_NO_WAIT);
+	}
+	else
+	{
+		k_work_schedule(&save_work, K_SECONDS(CONFIG_DATA_USAGE_SAVE_INTERVAL_S));
+	}
+}
+
+#if !defined(CONFIG_DATA_USAGE_TRANSPORT_UDP)
+static size_t varint_len(size_t value)
+{
+	size_t n = 1;
+
+	while (value >= 128)
+	{
+		value /= 128;
+		n++;
+	}
+
+	return n;
+}
+#endif
+
+/*
+Function : data_usage_publish
+
+Description : Accounts a sent or received publish with its acknowledgments. Called by
+			  the MQTT component.
+
+Parameter :
+- topic : Topic, not necessarily NUL terminated.
+- topic_len : Topic length.
+- payload_len : Payload length.
+- qos : QoS of the publish.
+
+Return : void
+
+Example Call :
+				data_usage_publish(topic, strlen(topic), len, MQTT_QOS_1_AT_LEAST_ONCE);
+*/
+void data_usage_publish(const char *topic, size_t topic_len, size_t payload_len,
+						enum mqtt_qos qos)
+{
+	uint32_t bytes[DATA_USAGE_CATEGORY_COUNT] = {0};
+	int acks = 0;
+
+	if (qos == MQTT_QOS_1_AT_LEAST_ONCE)
+	{
+		acks = 1;
+	}
+	else if (qos == MQTT_QOS_2_EXACTLY_ONCE)
+	{
+		acks = 3;
+	}
+
+	bytes[DATA_USAGE_PAYLOAD] = payload_len;
+
+#if defined(CONFIG_DATA_USAGE_TRANSPORT_UDP)
+	/* The topic travels as its registered ID. */
+	bytes[DATA_USAGE_MQTT] =
+		(payload_len + USAGE_PUBLISH_LEN > 255 ? USAGE_LONG_PUBLISH_LEN : USAGE_PUBLISH_LEN) +
+		(acks == 1 ? USAGE_PUBACK_LEN : 0) + (acks == 3 ? USAGE_QOS2_ACKS_LEN : 0);
+#else
+	size_t remaining_len = 2 + topic_len + payload_len;
+
+	if (acks)
+	{
+		remaining_len += 2; /* Packet identifier */
+	}
+
+	bytes[DATA_USAGE_MQTT] = 1 + varint_len(remaining_len) + remaining_len - payload_len +
+							 acks * USAGE_ACK_LEN;
+#endif
+	overhead_add(bytes, 1 + acks);
+
+	account(bytes, topic, topic_len);
+}
+
+/*
+Function : data_usage_control
+
+Description : Accounts MQTT control traffic, such as pings and (un)subscribes.
+
+Parameter :
+- mqtt_bytes : MQTT bytes in both directions.
+- packets : Number of packets they were sent in.
+
+Return : void
+
+Example Call :
+				data_usage_control(4, 2);
+*/
+void data_usage_control(size_t mqtt_bytes, int packets)
+{
+	uint32_t bytes[DATA_USAGE_CATEGORY_COUNT] = {0};
+
+	bytes[DATA_USAGE_MQTT] = mqtt_bytes;
+	overhead_add(bytes, packets);
+
+	account(bytes, NULL, 0);
+}
+
+/*
+Function : data_usage_connect
+
+Description : Accounts a connection to the broker or MQTT-SN gateway: the TCP and
+			  TLS or the DTLS handshake (CONFIG_DATA_USAGE_HANDSHAKE_BYTES) and
+			  CONNECT/CONNACK, all under the reconnect category.
+
+Parameter :
+- client_id_len : Length of the MQTT client ID.
+
+Return : void
+
+Example Call :
+				data_usage_connect(client.client_id.size);
+*/
+void data_usage_connect(size_t client_id_len)
+{
+	uint32_t bytes[DATA_USAGE_CATEGORY_COUNT] = {0};
+
+	bytes[DATA_USAGE_RECONNECT] = CONFIG_DATA_USAGE_HANDSHAKE_BYTES + USAGE_CONNECT_LEN +
+								  client_id_len + USAGE_CONNACK_LEN;
+	overhead_add(bytes, 2);
+	bytes[DATA_USAGE_RECONNECT] += bytes[DATA_USAGE_IP] + bytes[DATA_USAGE_TLS];
+	bytes[DATA_USAGE_IP] = 0;
+	bytes[DATA_USAGE_TLS] = 0;
+
+	account(bytes, NULL, 0);
+}
+
+/*
+Function : data_usage_topic_allowed
+
+Description : Tells whether a publish may be sent. Once a budget is used up, topics
+			  ending in one of the comma separated CONFIG_DATA_USAGE_LOW_PRIORITY_TOPICS
+			  suffixes are dropped.
+
+Parameter :
+- topic : Topic string.
+
+Return :
+false if the publish must be dropped.
+
+Example Call :
+				if (!data_usage_topic_allowed(topic)) { return -ENOSPC; }
+*/
+bool data_usage_topic_allowed(const char *topic)
+{
+	const char *list = CONFIG_DATA_USAGE_LOW_PRIORITY_TOPICS;
+	size_t topic_len;
+
+	if (level != DATA_USAGE_EXCEEDED)
+	{
+		return true;
+	}
+
+	topic_len = strlen(topic);
+
+	while (*list != '\0')
+	{
+		const char *end = strchr(list, ',');
+		size_t len = end ? (size_t)(end - list) : strlen(list);
+
+		if (len > 0 && len <= topic_len && memcmp(&topic[topic_len - len], list, len) == 0)
+		{
+			LOG_DBG("Over budget, dropped publish to %s", topic);
+			return false;
+		}
+
+		list += len;
+		if (*list == ',')
+		{
+			list++;
+		}
+	}
+
+	return true;
+}
+
+/*
+Function : data_usage_interval_s
+
+Description : Scales the interval of a periodic report by
+			  CONFIG_DATA_USAGE_BATCH_FACTOR while usage is constrained or over budget,
+			  so the same data goes out in fewer, larger publishes.
+
+Parameter :
+- interval_s : Interval within budget.
+
+Return :
+Interval to use now.
+
+Example Call :
+				k_work_schedule(&publish_work, K_SECONDS(data_usage_interval_s(60)));
+*/
+uint32_t data_usage_interval_s(uint32_t interval_s)
+{
+	return level == DATA_USAGE_NORMAL ? interval_s : interval_s * CONFIG_DATA_USAGE_BATCH_FACTOR;
+}
+
+enum data_usage_level data_usage_level_get(void)
+{
+	return level;
+}
+
+/*
+Function : data_usage_budget_get
+
+Description : Returns the usage and the remaining bytes of the daily and monthly
+			  budgets.
+
+Parameter :
+- day : Daily window.
+- month : Monthly window.
+
+Return : void
+
+Example Call :
+				data_usage_budget_get(&day, &month);
+*/
+void data_usage_budget_get(struct data_usage_budget *day, struct data_usage_budget *month)
+{
+	k_mutex_lock(&usage_lock, K_FOREVER);
+
+	budget_fill(day, sum(totals.day_bytes), budget_bytes(CONFIG_DATA_USAGE_DAILY_BUDGET_KB));
+	budget_fill(month, sum(totals.month_bytes),
+				budget_bytes(CONFIG_DATA_USAGE_MONTHLY_BUDGET_KB));
+
+	k_mutex_unlock(&usage_lock);
+}
+
+static int json_append(char *buf, size_t *pos, const char *format, ...)
+{
+	va_list args;
+	int n;
+
+	va_start(args, format);
+	n = vsnprintf(&buf[*pos], USAGE_JSON_MAX_LEN - *pos, format, args);
+	va_end(args);
+
+	if (n < 0 || (size_t)n >= USAGE_JSON_MAX_LEN - *pos)
+	{
+		return -ENOMEM;
+	}
+
+	*pos += n;
+	return 0;
+}
+
+static int json_budget(char *buf, size_t *pos, const char *name,
+					   const struct data_usage_budget *b)
+{
+	if (b->budget == 0)
+	{
+		return json_append(buf, pos, "\"%s\":[%u,0,null]", name, b->used);
+	}
+
+	return json_append(buf, pos, "\"%s\":[%u,%u,%u]", name, b->used, b->budget, b->remaining);
+}
+
+/*
+Function : data_usage_encode
+
+Description : Encodes the usage as JSON. "day" and "month" are [used, budget,
+			  remaining] in bytes, remaining is null without a budget. Categories are
+			  [day bytes, month bytes, total kB], topics are bytes this month.
+
+			  {"lvl":"normal","day":[81234,1048576,967342],"month":[912345,0,null],
+			   "cat":{"payload":[40210,480100,2210],...},"t":{"mqtt/123/telemetry":402100,...}}
+
+Parameter :
+- buf : Output buffer of USAGE_JSON_MAX_LEN bytes.
+
+Return :
+Length of the encoded string, or -ENOMEM if it does not fit.
+
+Example Call :
+				len = data_usage_encode(json);
+*/
+static int data_usage_encode(char *buf)
+{
+	struct data_usage_budget day;
+	struct data_usage_budget month;
+	size_t pos = 0;
+	bool first = true;
+	int err;
+
+	data_usage_budget_get(&day, &month);
+
+	err = json_append(buf, &pos, "{\"lvl\":\"%s\",", level_names[level]);
+	if (!err)
+	{
+		err = json_budget(buf, &pos, "day", &day);
+	}
+	if (!err)
+	{
+		err = json_append(buf, &pos, ",");
+	}
+	if (!err)
+	{
+		err = json_budget(buf, &pos, "month", &month);
+	}
+	if (!err)
+	{
+		err = json_append(buf, &pos, ",\"cat\":{");
+	}
+
+	k_mutex_lock(&usage_lock, K_FOREVER);
+
+	for (int i = 0; i < DATA_USAGE_CATEGORY_COUNT && !err; i++)
+	{
+		err = json_append(buf, &pos, "%s\"%s\":[%u,%u,%u]", i ? "," : "", category_names[i],
+						  totals.day_bytes[i], totals.month_bytes[i],
+						  (uint32_t)(totals.total_bytes[i] / 1024));
+	}
+
+	if (!err)
+	{
+		err = json_append(buf, &pos, "},\"t\":{");
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(topics.entries) && !err; i++)
+	{
+		const struct usage_topic *t = &topics.entries[i];
+
+		if (t->month_bytes == 0)
+		{
+			continue;
+		}
+
+		err = json_append(buf, &pos, "%s\"%s\":%u", first ? "" : ",",
+						  t->topic[0] ? t->topic : "other", t->month_bytes);
+		first = false;
+	}
+
+	k_mutex_unlock(&usage_lock);
+
+	if (!err)
+	{
+		err = json_append(buf, &pos, "}}");
+	}
+
+	return err ? err : (int)pos;
+}
+
+static void usage_publish_work_fn(struct k_work *work)
+{
+	char topic[USAGE_TOPIC_MAX_LEN];
+	char *json;
+	int len;
+	int err;
+
+	k_work_schedule(&publish_work,
+					K_SECONDS(data_usage_interval_s(CONFIG_DATA_USAGE_PUBLISH_INTERVAL_S)));
+
+	k_mutex_lock(&usage_lock, K_FOREVER);
+	if (period_update() | level_update())
+	{
+		k_work_reschedule(&save_work, K_NO_WAIT);
+	}
+	k_mutex_unlock(&usage_lock);
+
+	if (!mqtt_is_connected())
+	{
+		return;
+	}
+
+	json = mqtt_arena_alloc(USAGE_JSON_MAX_LEN);
+	if (json == NULL)
+	{
+		return;
+	}
+
+	len = data_usage_encode(json);
+	if (len < 0)
+	{
+		LOG_ERR("Failed to encode data usage: %d", len);
+	}
+	else
+	{
+		snprintf(topic, sizeof(topic), CONFIG_DATA_USAGE_TOPIC, DEVICE_ID);
+
+		err = mqtt_outbox_publish(MQTT_PRIO_TELEMETRY, topic, MQTT_QOS_0_AT_MOST_ONCE,
+								  (const uint8_t *)json, len);
+		if (err)
+		{
+			LOG_DBG("Data usage publish skipped: %d", err);
+		}
+	}
+
+	mqtt_arena_free(json);
+}
+
+#if defined(CONFIG_SETTINGS)
+/*
+Function : usage_settings_set
+
+Description : Settings handler restoring the usage counters and the topic table.
+
+Parameter :
+- name : Key relative to the "usage" subtree.
+- len : Length of the stored value.
+- read_cb : Callback reading the value.
+- cb_arg : Argument for read_cb.
+
+Return :
+0 on success, negative error code on failure.
+
+Example Call :
+				Called by settings_load_subtree().
+*/
+static int usage_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+							  void *cb_arg)
+{
+	ssize_t rc;
+
+	if (strcmp(name, "totals") == 0 && len == sizeof(snapshot.totals))
+	{
+		rc = read_cb(cb_arg, &snapshot.totals, sizeof(snapshot.totals));
+		if (rc >= 0 && snapshot.totals.version == USAGE_STORE_VERSION)
+		{
+			k_mutex_lock(&usage_lock, K_FOREVER);
+			totals = snapshot.totals;
+			k_mutex_unlock(&usage_lock);
+		}
+	}
+	else if (strcmp(name, "topics") == 0 && len == sizeof(snapshot.topics))
+	{
+		rc = read_cb(cb_arg, &snapshot.topics, sizeof(snapshot.topics));
+		if (rc >= 0 && snapshot.topics.version == USAGE_STORE_VERSION)
+		{
+			k_mutex_lock(&usage_lock, K_FOREVER);
+			topics = snapshot.topics;
+			k_mutex_unlock(&usage_lock);
+		}
+	}
+	else if (strcmp(name, "totals") == 0 || strcmp(name, "topics") == 0)
+	{
+		LOG_WRN("Stored data usage has a different layout, starting from zero");
+		return 0;
+	}
+	else
+	{
+		return -ENOENT;
+	}
+
+	return rc < 0 ? (int)rc : 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(usage, USAGE_SETTINGS_ROOT, NULL, usage_settings_set, NULL,
+							   NULL);
+
+/* Writes one record, marking it dirty again on failure. */
+static void usage_save_one(const char *key, const void *value, size_t len, bool *dirty)
+{
+	int err = settings_save_one(key, value, len);
+
+	if (err)
+	{
+		LOG_WRN("Failed to persist %s: %d", key, err);
+
+		k_mutex_lock(&usage_lock, K_FOREVER);
+		*dirty = true;
+		k_mutex_unlock(&usage_lock);
+	}
+}
+#endif
+
+/*
+Function : usage_save_work_fn
+
+Description : Saves the records that changed since the last save. Nothing is written
+			  while the usage is unchanged.
+
+Parameter :
+- work : Work item.
+
+Return : void
+
+Example Call :
+				Runs on the system work queue.
+*/
+static void usage_save_work_fn(struct k_work *work)
+{
+#if defined(CONFIG_SETTINGS)
+	bool save;
+
+	k_mutex_lock(&usage_lock, K_FOREVER);
+	save = totals_dirty;
+	if (save)
+	{
+		snapshot.totals = totals;
+		totals_dirty = false;
+	}
+	k_mutex_unlock(&usage_lock);
+
+	if (save)
+	{
+		usage_save_one(USAGE_SETTINGS_ROOT "/totals", &snapshot.totals,
+					   sizeof(snapshot.totals), &totals_dirty);
+	}
+
+	k_mutex_lock(&usage_lock, K_FOREVER);
+	save = topics_dirty;
+	if (save)
+	{
+		snapshot.topics = topics;
+		topics_dirty = false;
+	}
+	k_mutex_unlock(&usage_lock);
+
+	if (save)
+	{
+		usage_save_one(USAGE_SETTINGS_ROOT "/topics", &snapshot.topics,
+					   sizeof(snapshot.topics), &topics_dirty);
+	}
+#endif
+}
+
+/*
+Function : data_usage_init
+
+Description : Restores the persisted counters and starts the periodic usage publish.
+			  The publish is disabled when CONFIG_DATA_USAGE_PUBLISH_INTERVAL_S is 0.
+
+Parameter : void
+
+Return :
+0 on success.
+
+Example Call :
+				data_usage_init();
+*/
+int data_usage_init(void)
+{
+#if defined(CONFIG_SETTINGS)
+	int err;
+
+	err = settings_subsys_init();
+	if (!err)
+	{
+		err = settings_load_subtree(USAGE_SETTINGS_ROOT);
+	}
+	if (err)
+	{
+		LOG_WRN("Persisted data usage unavailable, error: %d", err);
+	}
+#endif
+
+	k_mutex_lock(&usage_lock, K_FOREVER);
+	level_update();
+	k_mutex_unlock(&usage_lock);
+
+	if (CONFIG_DATA_USAGE_PUBLISH_INTERVAL_S > 0)
+	{
+		k_work_schedule(&publish_work,
+						K_SECONDS(data_usage_interval_s(CONFIG_DATA_USAGE_PUBLISH_INTERVAL_S)));
+	}
+
+	return 0;
+}
+
+#if defined(CONFIG_SHELL)
+static void usage_reset(void)
+{
+	k_mutex_lock(&usage_lock, K_FOREVER);
+
+	memset(&totals, 0, sizeof(totals));
+	memset(&topics, 0, sizeof(topics));
+	totals.version = USAGE_STORE_VERSION;
+	topics.version = USAGE_STORE_VERSION;
+	totals_dirty = true;
+	topics_dirty = true;
+	period_update();
+	level_update();
+
+	k_mutex_unlock(&usage_lock);
+
+	k_work_reschedule(&save_work, K_NO_WAIT);
+}
+
+static int cmd_usage_show(const struct shell *sh, size_t argc, char **argv)
+{
+	struct data_usage_budget day;
+	struct data_usage_budget month;
+
+	data_usage_budget_get(&day, &month);
+
+	shell_print(sh, "level    %s", level_names[level]);
+	shell_print(sh, "day      %u of %u bytes", day.used, day.budget);
+	shell_print(sh, "month    %u of %u bytes", month.used, month.budget);
+
+	k_mutex_lock(&usage_lock, K_FOREVER);
+
+	for (int i = 0; i < DATA_USAGE_CATEGORY_COUNT; i++)
+	{
+		shell_print(sh, "%-10s day %u month %u total %u kB", category_names[i],
+					totals.day_bytes[i], totals.month_bytes[i],
+					(uint32_t)(totals.total_bytes[i] / 1024));
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(topics.entries); i++)
+	{
+		const struct usage_topic *t = &topics.entries[i];
+
+		if (t->month_bytes)
+		{
+			shell_print(sh, "%-40s %u", t->topic[0] ? t->topic : "other", t->month_bytes);
+		}
+	}
+
+	k_mutex_unlock(&usage_lock);
+
+	return 0;
+}
+
+static int cmd_usage_reset(const struct shell *sh, size_t argc, char **argv)
+{
+	usage_reset();
+	shell_print(sh, "Data usage cleared");
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_usage,
+							   SHELL_CMD(show, NULL, "Show usage, budgets and top topics", cmd_usage_show),
+							   SHELL_CMD(reset, NULL, "Clear all usage counters", cmd_usage_reset),
+							   SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(usage, &sub_usage, "Cellular data usage", NULL);
+#endif
\ No newline at end of file
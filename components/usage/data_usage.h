@@ -0,0 +1,115 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : DATA_USAGE.h
+*/
+
+#ifndef _DATA_USAGE_H_
+#define _DATA_USAGE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/net/mqtt.h>
+
+/*
+ * Cellular data usage per category and per topic, persisted across reboots.
+ *
+ * Bytes are estimated from the packets the client sends and receives: the
+ * payload, the MQTT framing and acknowledgments, the TLS record overhead, the
+ * TCP/IP headers and the handshake of every (re)connection. The daily and
+ * monthly windows follow the network time, so they start counting once the
+ * modem has provided it.
+ *
+ * With a budget set, usage above CONFIG_DATA_USAGE_CONSTRAINED_PCT stretches
+ * the periodic reports (data_usage_interval_s()), and usage above the budget
+ * also drops publishes to CONFIG_DATA_USAGE_LOW_PRIORITY_TOPICS.
+ */
+
+enum data_usage_category
+{
+	DATA_USAGE_PAYLOAD,	  /* Application payload */
+	DATA_USAGE_MQTT,	  /* MQTT headers, topics, acks, pings, (un)subscribes */
+	DATA_USAGE_TLS,		  /* TLS record headers and MACs */
+	DATA_USAGE_IP,		  /* TCP/IP headers */
+	DATA_USAGE_RECONNECT, /* TCP and TLS handshakes, CONNECT/CONNACK */
+	DATA_USAGE_CATEGORY_COUNT
+};
+
+enum data_usage_level
+{
+	DATA_USAGE_NORMAL,
+	DATA_USAGE_CONSTRAINED, /* Above CONFIG_DATA_USAGE_CONSTRAINED_PCT of a budget */
+	DATA_USAGE_EXCEEDED,	/* A budget is used up */
+};
+
+struct data_usage_budget
+{
+	uint32_t used;		/* Bytes in the current window */
+	uint32_t budget;	/* Bytes, 0 when unlimited */
+	uint32_t remaining; /* Bytes, UINT32_MAX when unlimited */
+};
+
+#if defined(CONFIG_DATA_USAGE)
+
+void data_usage_publish(const char *topic, size_t topic_len, size_t payload_len,
+						enum mqtt_qos qos);
+void data_usage_control(size_t mqtt_bytes, int packets);
+void data_usage_connect(size_t client_id_len);
+bool data_usage_topic_allowed(const char *topic);
+uint32_t data_usage_interval_s(uint32_t interval_s);
+enum data_usage_level data_usage_level_get(void);
+void data_usage_budget_get(struct data_usage_budget *day, struct data_usage_budget *month);
+int data_usage_init(void);
+
+#if defined(CONFIG_DATA_USAGE_MOCK_TIME)
+void data_usage_mock_time_set(int64_t now_ms);
+#endif
+
+#else
+
+static inline void data_usage_publish(const char *topic, size_t topic_len, size_t payload_len,
+									  enum mqtt_qos qos)
+{
+}
+
+static inline void data_usage_control(size_t mqtt_bytes, int packets)
+{
+}
+
+static inline void data_usage_connect(size_t client_id_len)
+{
+}
+
+static inline bool data_usage_topic_allowed(const char *topic)
+{
+	return true;
+}
+
+static inline uint32_t data_usage_interval_s(uint32_t interval_s)
+{
+	return interval_s;
+}
+
+static inline enum data_usage_level data_usage_level_get(void)
+{
+	return DATA_USAGE_NORMAL;
+}
+
+static inline void data_usage_budget_get(struct data_usage_budget *day,
+										 struct data_usage_budget *month)
+{
+	*day = (struct data_usage_budget){.remaining = UINT32_MAX};
+	*month = (struct data_usage_budget){.remaining = UINT32_MAX};
+}
+
+static inline int data_usage_init(void)
+{
+	return 0;
+}
+
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,120 @@
+import argparse
+import os
+import struct
+import sys
+
+# Batch header written by components/log_mqtt/log_backend_mqtt.c
+FORMAT_VERSION = 1
+HEADER = struct.Struct("<BH")  # version, records lost since the previous batch
+
+
+def load_parser(database_path, zephyr_base):
+    """Dictionary log parser of the Zephyr tree the firmware was built with."""
+    scripts = os.path.join(zephyr_base, "scripts", "logging", "dictionary")
+    if not os.path.isdir(scripts):
+        print(f"❌ Zephyr dictionary logging scripts not found: {scripts}")
+        sys.exit(1)
+    sys.path.insert(0, scripts)
+
+    import dictionary_parser
+    from dictionary_parser.log_database import LogDatabase
+
+    database = LogDatabase.read_json_database(database_path)
+    if database is None:
+        print(f"❌ Could not read the log database: {database_path}")
+        sys.exit(1)
+
+    parser = dictionary_parser.get_parser(database)
+    if parser is None:
+        print("❌ Unsupported log database version")
+        sys.exit(1)
+
+    return parser
+
+
+def decode_batch(parser, payload, name=""):
+    """Prints the records of one batch. Returns False if it is not a log batch."""
+    if len(payload) < HEADER.size:
+        print(f"⚠️  {name}: batch too short ({len(payload)} bytes)")
+        return False
+
+    version, lost = HEADER.unpack_from(payload)
+    if version != FORMAT_VERSION:
+        print(f"⚠️  {name}: unknown batch version {version}")
+        return False
+
+    if lost:
+        print(f"--- {lost} log records lost before this batch ---")
+
+    records = payload[HEADER.size:]
+    if records:
+        parser.parse_log_data(records)
+    return True
+
+
+def decode_files(parser, paths):
+    for path in paths:
+        with open(path, "rb") as f:
+            decode_batch(parser, f.read(), path)
+
+
+def decode_live(parser, args):
+    """Subscribes to the log topic and decodes batches as they arrive."""
+    try:
+        import paho.mqtt.client as mqtt
+    except ImportError:
+        print("❌ Live decoding needs paho-mqtt: pip install paho-mqtt")
+        sys.exit(1)
+
+    def on_connect(client, userdata, flags, rc, *extra):
+        print(f"✅ Connected to {args.host}:{args.port}, subscribing to {args.topic}")
+        client.subscribe(args.topic, qos=1)
+
+    def on_message(client, userdata, msg):
+        decode_batch(parser, msg.payload, msg.topic)
+
+    client = mqtt.Client()
+    client.on_connect = on_connect
+    client.on_message = on_message
+    if args.cafile:
+        client.tls_set(ca_certs=args.cafile, certfile=args.cert, keyfile=args.key)
+    client.connect(args.host, args.port)
+    client.loop_forever()
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Decode dictionary log batches published by the MQTT log backend")
+    parser.add_argument("--db", required=True,
+                        help="log_dictionary.json from the build directory (build/zephyr)")
+    parser.add_argument("--zephyr-base", default=os.environ.get("ZEPHYR_BASE"),
+                        help="Zephyr tree the firmware was built with (default: $ZEPHYR_BASE)")
+    parser.add_argument("batches", nargs="*", help="files holding one batch payload each")
+    parser.add_argument("--host", help="broker to subscribe to instead of reading files")
+    parser.add_argument("--port", type=int, default=8883)
+    parser.add_argument("--topic", default="mqtt/+/log", help="log topic (default: mqtt/+/log)")
+    parser.add_argument("--cafile", help="broker CA certificate, enables TLS")
+    parser.add_argument("--cert", help="client certificate")
+    parser.add_argument("--key", help="client private key")
+    args = parser.parse_args()
+
+    if not args.zephyr_base:
+        print("❌ Set ZEPHYR_BASE or pass --zephyr-base")
+        sys.exit(1)
+
+    if not os.path.exists(args.db):
+        print(f"❌ Log database not found: {args.db}")
+        sys.exit(1)
+
+    log_parser = load_parser(args.db, args.zephyr_base)
+
+    if args.host:
+        decode_live(log_parser, args)
+    elif args.batches:
+        decode_files(log_parser, args.batches)
+    else:
+        parser.error("pass batch files or --host")
+
+
+if __name__ == "__main__":
+    main()
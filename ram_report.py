@@ -0,0 +1,205 @@
+import argparse
+import json
+import os
+import re
+import sys
+
+# Path setup
+BASE_DIR = os.path.dirname(os.path.abspath(__file__))
+COMPONENTS_DIR = os.path.join(BASE_DIR, "components")
+SRC_DIR = os.path.join(BASE_DIR, "src")
+
+# Used when the map has no writable memory region (native_sim)
+RAM_SECTION_PREFIXES = (".bss", ".data", ".noinit", "COMMON", ".tbss", ".tdata")
+
+MEMORY_RE = re.compile(r"^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(?:\s+(\S+))?\s*$")
+INPUT_RE = re.compile(r"^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+CONT_RE = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+NAME_RE = re.compile(r"^ (\S+)\s*$")
+OBJECT_RE = re.compile(r"(?:^|/)([^/(]+?)\.a\(([^)]+?)(?:\.obj|\.o)\)$")
+
+# Stacks and heaps the map only attributes to the kernel or a library
+CONFIG_SIZE_RE = re.compile(r"^(CONFIG_\w*?(?:_STACK_SIZE|_HEAP_SIZE|HEAP_MEM_POOL_SIZE|_ARENA_SIZE))=(\d+)$")
+
+
+def application_sources():
+    """Map source file names of the application to their component."""
+    sources = {}
+    for root, _, files in os.walk(COMPONENTS_DIR):
+        component = os.path.relpath(root, COMPONENTS_DIR).split(os.sep)[0]
+        for name in files:
+            if name.endswith(".c"):
+                sources[name] = component
+    for name in os.listdir(SRC_DIR):
+        if name.endswith(".c"):
+            sources[name] = "main"
+    return sources
+
+
+def parse_ram_regions(lines):
+    regions = []
+    in_memory = False
+    for line in lines:
+        if line.startswith("Memory Configuration"):
+            in_memory = True
+            continue
+        if line.startswith("Linker script and memory map"):
+            break
+        if not in_memory:
+            continue
+        m = MEMORY_RE.match(line)
+        if not m or m.group(1) in ("Name", "*default*"):
+            continue
+        attrs = m.group(4) or ""
+        if "w" in attrs and "!w" not in attrs:
+            start = int(m.group(2), 16)
+            regions.append((start, start + int(m.group(3), 16)))
+    return regions
+
+
+def parse_input_sections(lines):
+    """Yield (section, address, size, object) for every input section."""
+    pending = None
+    started = False
+    for line in lines:
+        if line.startswith("Linker script and memory map"):
+            started = True
+            continue
+        if not started:
+            continue
+
+        m = INPUT_RE.match(line)
+        if m:
+            pending = None
+            yield m.group(1), int(m.group(2), 16), int(m.group(3), 16), m.group(4).strip()
+            continue
+
+        m = CONT_RE.match(line)
+        if m and pending:
+            yield pending, int(m.group(1), 16), int(m.group(2), 16), m.group(3).strip()
+            pending = None
+            continue
+
+        m = NAME_RE.match(line)
+        pending = m.group(1) if m else None
+
+
+def component_of(obj, sources):
+    m = OBJECT_RE.search(obj)
+    if not m:
+        return os.path.basename(obj) or "other"
+    archive, source = m.group(1), m.group(2)
+    if archive == "libapp" and source in sources:
+        return sources[source]
+    return archive[3:] if archive.startswith("lib") else archive
+
+
+def is_ram(section, address, regions):
+    if regions:
+        return any(start <= address < end for start, end in regions)
+    return section.startswith(RAM_SECTION_PREFIXES)
+
+
+def ram_usage(map_path):
+    with open(map_path, "r", errors="replace") as f:
+        lines = f.read().splitlines()
+
+    sources = application_sources()
+    regions = parse_ram_regions(lines)
+    usage = {}
+
+    for section, address, size, obj in parse_input_sections(lines):
+        if size == 0 or section == "*fill*" or not is_ram(section, address, regions):
+            continue
+        component = component_of(obj, sources)
+        usage[component] = usage.get(component, 0) + size
+
+    return usage
+
+
+def configured_sizes(config_path):
+    """Stack, heap and arena sizes set in the build's .config."""
+    sizes = {}
+    with open(config_path) as f:
+        for line in f:
+            m = CONFIG_SIZE_RE.match(line.strip())
+            if m and int(m.group(2)) > 0:
+                sizes[m.group(1)] = int(m.group(2))
+    return sizes
+
+
+def print_components(usage, baseline):
+    app = set(application_sources().values())
+    names = sorted(set(usage) | set(baseline), key=lambda n: (n not in app, -usage.get(n, 0), n))
+
+    print(f"   {'component':<28} {'RAM':>8}" + (f" {'delta':>8}" if baseline else ""))
+    for name in names:
+        size = usage.get(name, 0)
+        line = f"   {name:<28} {size:>8}"
+        if baseline:
+            line += f" {size - baseline.get(name, 0):>+8}"
+        print(line)
+
+    app_total = sum(size for name, size in usage.items() if name in app)
+    total = sum(usage.values())
+    summary = f"✅ RAM: application {app_total} bytes, total {total} bytes"
+    if baseline:
+        summary += f" ({total - sum(baseline.values()):+} bytes vs baseline)"
+    print(summary)
+
+
+def print_configured(sizes, baseline, included):
+    print("   Stacks and heaps" + (" (included above):" if included else ":"))
+    names = sorted(set(sizes) | set(baseline), key=lambda n: (-sizes.get(n, 0), n))
+    for name in names:
+        size = sizes.get(name, 0)
+        line = f"     {name:<46} {size:>8}"
+        if baseline:
+            line += f" {size - baseline.get(name, 0):>+8}"
+        print(line)
+    if baseline:
+        delta = sum(sizes.values()) - sum(baseline.values())
+        print(f"✅ Stacks and heaps: {sum(sizes.values())} bytes ({delta:+} bytes vs baseline)")
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Report RAM (data, bss, noinit, stacks, heaps) per component from the linker map")
+    parser.add_argument("--map", help="zephyr.map from the build directory")
+    parser.add_argument("--json", help="write the report as JSON to this file")
+    parser.add_argument("--baseline", help="previous JSON report to compare against")
+    parser.add_argument("--config", help="zephyr/.config or prj.conf, lists the stack and heap sizes")
+    args = parser.parse_args()
+
+    if not args.map and not args.config:
+        parser.error("--map or --config is required")
+
+    if args.map and not os.path.exists(args.map):
+        print(f"❌ Map file not found: {args.map}")
+        sys.exit(1)
+
+    usage = ram_usage(args.map) if args.map else {}
+    sizes = configured_sizes(args.config) if args.config and os.path.exists(args.config) else {}
+
+    baseline = {}
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    baseline_sizes = baseline.pop("config", {})
+
+    if args.map:
+        print_components(usage, baseline)
+
+    if sizes:
+        print_configured(sizes, baseline_sizes, bool(args.map))
+
+    if args.json:
+        report = dict(usage)
+        if sizes:
+            report["config"] = sizes
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=2, sort_keys=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,71 @@
+import argparse
+import base64
+import hashlib
+import json
+import struct
+import sys
+
+from cryptography.hazmat.primitives import hashes, serialization
+from cryptography.hazmat.primitives.asymmetric import ec
+from cryptography.hazmat.primitives.asymmetric.utils import Prehashed, decode_dss_signature
+
+# Covered by the signature, in this order after the device ID (components/certs/cred_rotate.c)
+SIGNED_FIELDS = ("id", "ca", "cert", "key")
+
+
+def request_digest(device_id, request):
+    h = hashlib.sha256()
+    for value in [device_id] + [request.get(name, "") for name in SIGNED_FIELDS]:
+        data = value.encode()
+        h.update(struct.pack(">I", len(data)) + data)
+    return h.digest()
+
+
+def sign(private_key, digest):
+    der = private_key.sign(digest, ec.ECDSA(Prehashed(hashes.SHA256())))
+    r, s = decode_dss_signature(der)
+    return base64.b64encode(r.to_bytes(32, "big") + s.to_bytes(32, "big")).decode()
+
+
+def read_text(path):
+    with open(path) as f:
+        return f.read()
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Build a signed credential rotation request for CONFIG_CERTS_ROTATE")
+    parser.add_argument("--key", required=True, help="PEM P-256 private key that signs requests")
+    parser.add_argument("--device", help="device ID (IMEI) the request is for")
+    parser.add_argument("--id", help="rotation ID, echoed in the result")
+    parser.add_argument("--cert", help="new device certificate (PEM)")
+    parser.add_argument("--key-file", help="new device private key (PEM)")
+    parser.add_argument("--ca", help="new CA chain (PEM), the active one is kept without it")
+    parser.add_argument("--pubkey", action="store_true",
+                        help="print CONFIG_CERTS_ROTATE_PUBKEY for --key and exit")
+    args = parser.parse_args()
+
+    private_key = serialization.load_pem_private_key(open(args.key, "rb").read(), password=None)
+    if not isinstance(private_key, ec.EllipticCurvePrivateKey) or private_key.curve.name != "secp256r1":
+        print("❌ The signing key must be a P-256 (secp256r1) key.", file=sys.stderr)
+        sys.exit(1)
+
+    if args.pubkey:
+        point = private_key.public_key().public_bytes(serialization.Encoding.X962,
+                                                      serialization.PublicFormat.UncompressedPoint)
+        print(f'CONFIG_CERTS_ROTATE_PUBKEY="{point.hex()}"')
+        return
+
+    if not (args.device and args.id and args.cert and args.key_file):
+        parser.error("--device, --id, --cert and --key-file are required")
+
+    request = {"id": args.id, "cert": read_text(args.cert), "key": read_text(args.key_file)}
+    if args.ca:
+        request["ca"] = read_text(args.ca)
+
+    request["sig"] = sign(private_key, request_digest(args.device, request))
+    print(json.dumps(request))
+
+
+if __name__ == "__main__":
+    main()
@@ -1,11 +1,20 @@
-
 #include <stdio.h>
+#include <string.h>
 #include <ncs_version.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include "mqtt.h"
 #include "lte.h"
 #include "certs.h"
+#include "boot.h"
+#include "modem_identity.h"
+#include "cred_rotate.h"
+#include "metrics.h"
+#include "profiling.h"
+#include "airtime.h"
+#include "data_usage.h"
+#include "sampling.h"
+#include "shadow.h"
 
 LOG_MODULE_REGISTER(MQTT_MAIN);
 
@@ -16,36 +25,79 @@ int main(void)
 	char *MQTT_TEST_SUB_TOPIC = NULL;
 	char *MQTT_TEST_PUB_TOPIC = NULL;
 
-	err = write_device_certs_to_modem();
+	/* Provision certs, init the modem and start the LTE attach without
+	 * waiting for registration.
+	 */
+	err = boot_run();
 	if (err != 0)
 	{
-		LOG_ERR("Failed to write certs to modem err [%d]", err);
+		LOG_ERR("Boot pipeline failed err [%d]", err);
 	}
 
-	err = modem_init();
+	boot_stage_begin(BOOT_STAGE_MQTT_PREPARE);
+
+	strncpy(DEVICE_ID, modem_identity_get()->imei, DEVICE_ID_SIZE - 1);
+	if (DEVICE_ID[0] == '\0')
+	{
+		LOG_ERR("Failed to get device id IMEI\n\r");
+	}
+	LOG_INF("MQTT Device ID IMEI [ %s ]", DEVICE_ID);
+
+	mqtt_create_topic_subscribe(MQTT_TEST_SUB_TOPIC, "mqtt/subscribe/telemetry/%s", DEVICE_ID);
+	mqtt_create_topic_subscribe(MQTT_TEST_SUB_TOPIC, "mqtt/subscribe/ota/%s", DEVICE_ID);
+	mqtt_create_topic_subscribe(MQTT_TEST_SUB_TOPIC, "mqtt/subscribe/command/%s", DEVICE_ID);
+
+	mqtt_create_topic_publish(MQTT_TEST_PUB_TOPIC, "mqtt/%s/publish/test_topic", DEVICE_ID);
+
+	err = cred_rotate_init();
 	if (err != 0)
 	{
-		LOG_ERR("Failed to init modem err [%d]", err);
+		LOG_ERR("Failed to init credential rotation err [%d]", err);
 	}
 
-	err = lte_init();
+	err = metrics_init();
 	if (err != 0)
 	{
-		LOG_ERR("Failed to init LTE err [%d]", err);
+		LOG_ERR("Failed to init metrics err [%d]", err);
 	}
 
-	err = get_modem_info_imei(DEVICE_ID, DEVICE_ID_SIZE);
+	err = airtime_init();
 	if (err != 0)
 	{
-		LOG_ERR("Failed to get device id IMEI\n\r");
+		LOG_ERR("Failed to init airtime accounting err [%d]", err);
 	}
-	LOG_INF("MQTT Device ID IMEI [ %s ]", DEVICE_ID);
 
-	mqtt_create_topic_subscribe(MQTT_TEST_SUB_TOPIC, "mqtt/subscribe/telemetry/%s", DEVICE_ID);
-	mqtt_create_topic_subscribe(MQTT_TEST_SUB_TOPIC, "mqtt/subscribe/ota/%s", DEVICE_ID);
-	mqtt_create_topic_subscribe(MQTT_TEST_SUB_TOPIC, "mqtt/subscribe/command/%s", DEVICE_ID);
+	err = data_usage_init();
+	if (err != 0)
+	{
+		LOG_ERR("Failed to init data usage accounting err [%d]", err);
+	}
 
-	mqtt_create_topic_publish(MQTT_TEST_PUB_TOPIC, "mqtt/%s/publish/test_topic", DEVICE_ID);
+	err = sampling_init();
+	if (err != 0)
+	{
+		LOG_ERR("Failed to init sampling err [%d]", err);
+	}
+
+	/* Shadow fields are added before this, see shadow_field_add(). */
+	err = shadow_init();
+	if (err != 0)
+	{
+		LOG_ERR("Failed to init shadow sync err [%d]", err);
+	}
 
+	err = profiling_init();
+	if (err != 0)
+	{
+		LOG_ERR("Failed to init profiling err [%d]", err);
+	}
+
+	/* The MQTT thread prepares the client now and connects once LTE is up. */
 	MQTT_configure();
+
+	boot_stage_end(BOOT_STAGE_MQTT_PREPARE, 0);
+
+	boot_wait_network();
+
+	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,197 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : TEST_AT_CMD.c
+*/
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include "at_cmd.h"
+
+#define AT_TEST_TIMEOUT K_MSEC(CONFIG_AT_CMD_MOCK_LATENCY_MS * 10)
+
+struct async_result
+{
+	struct k_sem done;
+	enum at_cmd_id id;
+	int err;
+	char value[AT_CMD_VALUE_MAX_LEN];
+	void *user_data;
+};
+
+static void async_cb(enum at_cmd_id id, int err, const char *value, void *user_data)
+{
+	struct async_result *r = user_data;
+
+	r->id = id;
+	r->err = err;
+	r->user_data = user_data;
+	if (value)
+	{
+		strncpy(r->value, value, sizeof(r->value) - 1);
+	}
+	k_sem_give(&r->done);
+}
+
+static void reset_mocks(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	for (int id = 0; id < AT_CMD_COUNT; id++)
+	{
+		at_cmd_mock_set(id, NULL, 0);
+	}
+}
+
+ZTEST(at_cmd, test_digits)
+{
+	char value[AT_CMD_VALUE_MAX_LEN];
+
+	zassert_ok(at_cmd_exec(AT_CMD_IMEI, value, sizeof(value), AT_TEST_TIMEOUT));
+	zassert_str_equal(value, "352656100000001");
+
+	at_cmd_mock_set(AT_CMD_IMEI, "ERROR\r\n", 0);
+	zassert_equal(at_cmd_exec(AT_CMD_IMEI, value, sizeof(value), AT_TEST_TIMEOUT), -EBADMSG);
+}
+
+ZTEST(at_cmd, test_after_colon)
+{
+	char value[AT_CMD_VALUE_MAX_LEN];
+
+	zassert_ok(at_cmd_exec(AT_CMD_ICCID, value, sizeof(value), AT_TEST_TIMEOUT));
+	zassert_str_equal(value, "89882280666027595366");
+
+	/* Leading blanks are skipped, the value ends at the line break. */
+	at_cmd_mock_set(AT_CMD_FUNC_MODE, "+CFUN:   4\r\nOK\r\n", 0);
+	zassert_ok(at_cmd_exec(AT_CMD_FUNC_MODE, value, sizeof(value), AT_TEST_TIMEOUT));
+	zassert_str_equal(value, "4");
+
+	at_cmd_mock_set(AT_CMD_ICCID, "OK\r\n", 0);
+	zassert_equal(at_cmd_exec(AT_CMD_ICCID, value, sizeof(value), AT_TEST_TIMEOUT), -EBADMSG);
+
+	at_cmd_mock_set(AT_CMD_ICCID, "%XICCID: \r\nOK\r\n", 0);
+	zassert_equal(at_cmd_exec(AT_CMD_ICCID, value, sizeof(value), AT_TEST_TIMEOUT), -EBADMSG);
+}
+
+ZTEST(at_cmd, test_line)
+{
+	char value[AT_CMD_VALUE_MAX_LEN];
+
+	zassert_ok(at_cmd_exec(AT_CMD_FW_VERSION, value, sizeof(value), AT_TEST_TIMEOUT));
+	zassert_str_equal(value, "mfw_nrf9160_1.3.5");
+
+	at_cmd_mock_set(AT_CMD_FW_VERSION, "\r\nOK\r\n", 0);
+	zassert_equal(at_cmd_exec(AT_CMD_FW_VERSION, value, sizeof(value), AT_TEST_TIMEOUT),
+				  -EBADMSG);
+}
+
+ZTEST(at_cmd, test_value_too_long)
+{
+	char value[AT_CMD_VALUE_MAX_LEN];
+	char small[8];
+
+	/* Longer than the service value buffer */
+	at_cmd_mock_set(AT_CMD_FW_VERSION,
+					"mfw_nrf9160_1.3.5_with_a_version_string_longer_than_the_buffer\r\nOK\r\n",
+					0);
+	zassert_equal(at_cmd_exec(AT_CMD_FW_VERSION, value, sizeof(value), AT_TEST_TIMEOUT),
+				  -EBADMSG);
+
+	/* A short caller buffer gets a terminated prefix. */
+	zassert_ok(at_cmd_exec(AT_CMD_IMEI, small, sizeof(small), AT_TEST_TIMEOUT));
+	zassert_str_equal(small, "3526561");
+}
+
+ZTEST(at_cmd, test_modem_error)
+{
+	char value[AT_CMD_VALUE_MAX_LEN];
+
+	at_cmd_mock_set(AT_CMD_ICCID, NULL, 10);
+	zassert_equal(at_cmd_exec(AT_CMD_ICCID, value, sizeof(value), AT_TEST_TIMEOUT), -EIO);
+
+	at_cmd_mock_set(AT_CMD_ICCID, NULL, -ENOEXEC);
+	zassert_equal(at_cmd_exec(AT_CMD_ICCID, value, sizeof(value), AT_TEST_TIMEOUT), -ENOEXEC);
+}
+
+ZTEST(at_cmd, test_timeout_does_not_write_late)
+{
+	char value[AT_CMD_VALUE_MAX_LEN];
+	char canary[AT_CMD_VALUE_MAX_LEN];
+
+	memset(value, 'x', sizeof(value));
+	memcpy(canary, value, sizeof(canary));
+
+	zassert_equal(at_cmd_exec(AT_CMD_IMEI, value, sizeof(value), K_MSEC(1)), -ETIMEDOUT);
+
+	/* The late completion must leave the buffer alone ... */
+	k_msleep(CONFIG_AT_CMD_MOCK_LATENCY_MS * 3);
+	zassert_mem_equal(value, canary, sizeof(value));
+
+	/* ... and must not complete the next request. */
+	zassert_ok(at_cmd_exec(AT_CMD_FW_VERSION, value, sizeof(value), AT_TEST_TIMEOUT));
+	zassert_str_equal(value, "mfw_nrf9160_1.3.5");
+}
+
+ZTEST(at_cmd, test_async)
+{
+	static struct async_result r;
+
+	k_sem_init(&r.done, 0, 1);
+	memset(r.value, 0, sizeof(r.value));
+
+	zassert_ok(at_cmd_submit(AT_CMD_ICCID, async_cb, &r));
+	zassert_ok(k_sem_take(&r.done, AT_TEST_TIMEOUT));
+	zassert_equal(r.id, AT_CMD_ICCID);
+	zassert_ok(r.err);
+	zassert_equal(r.user_data, &r);
+	zassert_str_equal(r.value, "89882280666027595366");
+
+	zassert_equal(at_cmd_submit(AT_CMD_COUNT, async_cb, &r), -EINVAL);
+}
+
+ZTEST(at_cmd, test_queue_full)
+{
+	int queued = 0;
+	int err = 0;
+
+	/* The thread takes one request at a time, so the queue fills up. */
+	for (int i = 0; i < CONFIG_AT_CMD_QUEUE_SIZE + 2; i++)
+	{
+		err = at_cmd_submit(AT_CMD_FUNC_MODE, NULL, NULL);
+		if (err)
+		{
+			break;
+		}
+		queued++;
+	}
+
+	zassert_equal(err, -ENOBUFS);
+	zassert_true(queued >= CONFIG_AT_CMD_QUEUE_SIZE);
+
+	/* Drain before the next test. */
+	k_msleep(CONFIG_AT_CMD_MOCK_LATENCY_MS * (queued + 2));
+}
+
+ZTEST(at_cmd, test_stats)
+{
+	struct at_cmd_stats before;
+	struct at_cmd_stats after;
+	char value[AT_CMD_VALUE_MAX_LEN];
+
+	at_cmd_stats_get(AT_CMD_IMEI, &before);
+
+	zassert_ok(at_cmd_exec(AT_CMD_IMEI, value, sizeof(value), AT_TEST_TIMEOUT));
+	at_cmd_mock_set(AT_CMD_IMEI, "ERROR\r\n", 0);
+	zassert_equal(at_cmd_exec(AT_CMD_IMEI, value, sizeof(value), AT_TEST_TIMEOUT), -EBADMSG);
+
+	at_cmd_stats_get(AT_CMD_IMEI, &after);
+	zassert_equal(after.count, before.count + 2);
+	zassert_equal(after.errors, before.errors + 1);
+	zassert_true(after.max_us >= CONFIG_AT_CMD_MOCK_LATENCY_MS * 1000);
+	zassert_str_equal(at_cmd_name(AT_CMD_IMEI), "imei");
+}
+
+ZTEST_SUITE(at_cmd, NULL, NULL, reset_mocks, NULL, NULL);
\ No newline at end of file
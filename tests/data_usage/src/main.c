@@ -0,0 +1,243 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : TEST_DATA_USAGE.c
+*/
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include "data_usage.h"
+#include "mqtt.h"
+#include "mqtt_arena.h"
+
+#define MS_PER_DAY (86400LL * MSEC_PER_SEC)
+
+#if defined(CONFIG_DATA_USAGE_TRANSPORT_UDP)
+/* Bytes of a publish to "a/b" with 100 payload bytes, without DTLS */
+#define PACKET_OVERHEAD 28 /* IPv4 and UDP headers */
+#define PUBLISH_QOS0 135   /* 100 payload, 7 MQTT-SN, 28 UDP/IP */
+#define PUBLISH_QOS1 170   /* Plus PUBACK and its UDP/IP headers */
+#define PUBLISH_QOS2 231   /* Plus PUBREC, PUBREL and PUBCOMP */
+#define CONNECT_LEN 9	   /* CONNECT and CONNACK without the client ID */
+#else
+/* Bytes of a publish to "a/b" with 100 payload bytes, without TLS */
+#define PACKET_OVERHEAD 40 /* IPv4 and TCP headers */
+#define PUBLISH_QOS0 147   /* 100 payload, 7 MQTT, 40 TCP/IP */
+#define PUBLISH_QOS1 193   /* Plus packet id, PUBACK and its TCP/IP headers */
+#define PUBLISH_QOS2 281   /* Plus PUBREC, PUBREL and PUBCOMP */
+#define CONNECT_LEN 18	   /* CONNECT and CONNACK without the client ID */
+#endif
+
+/* June 16 12:00 UTC of successive years, one per test, so every test starts with
+ * new daily and monthly windows.
+ */
+static const int64_t fresh_start_s[] = {
+	1718539200, 1750075200, 1781611200, 1813147200,
+	1844769600, 1876305600, 1907841600, 1939377600,
+};
+
+static int fresh_index;
+static int64_t start_ms;
+
+/* The MQTT component is not linked, the usage publish is disabled. */
+char DEVICE_ID[DEVICE_ID_SIZE] = "test";
+
+bool mqtt_is_connected(void)
+{
+	return false;
+}
+
+int mqtt_outbox_publish(enum mqtt_prio prio, const char *topic, enum mqtt_qos qos,
+						const uint8_t *data, size_t len)
+{
+	return -ENOTCONN;
+}
+
+void *mqtt_arena_alloc(size_t size)
+{
+	return NULL;
+}
+
+void mqtt_arena_free(void *ptr)
+{
+}
+
+static void publish(enum mqtt_qos qos)
+{
+	data_usage_publish("a/b", 3, 100, qos);
+}
+
+/* Accounts one control packet of this many bytes in total. */
+static void control_total(uint32_t bytes)
+{
+	data_usage_control(bytes - PACKET_OVERHEAD, 1);
+}
+
+static void day_used(uint32_t expected)
+{
+	struct data_usage_budget day;
+	struct data_usage_budget month;
+
+	data_usage_budget_get(&day, &month);
+	zassert_equal(day.used, expected, "day used %u, expected %u", day.used, expected);
+}
+
+static void month_used(uint32_t expected)
+{
+	struct data_usage_budget day;
+	struct data_usage_budget month;
+
+	data_usage_budget_get(&day, &month);
+	zassert_equal(month.used, expected, "month used %u, expected %u", month.used, expected);
+}
+
+static void fresh_windows(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	zassert_true(fresh_index < ARRAY_SIZE(fresh_start_s), "add a start time");
+
+	start_ms = fresh_start_s[fresh_index++] * MSEC_PER_SEC;
+	data_usage_mock_time_set(start_ms);
+
+	/* Accounting nothing moves the windows to the new time. */
+	data_usage_control(0, 0);
+	day_used(0);
+	month_used(0);
+	zassert_equal(data_usage_level_get(), DATA_USAGE_NORMAL);
+}
+
+ZTEST(data_usage, test_publish)
+{
+	publish(MQTT_QOS_0_AT_MOST_ONCE);
+	day_used(PUBLISH_QOS0);
+
+	publish(MQTT_QOS_1_AT_LEAST_ONCE);
+	day_used(PUBLISH_QOS0 + PUBLISH_QOS1);
+
+	publish(MQTT_QOS_2_EXACTLY_ONCE);
+	day_used(PUBLISH_QOS0 + PUBLISH_QOS1 + PUBLISH_QOS2);
+	month_used(PUBLISH_QOS0 + PUBLISH_QOS1 + PUBLISH_QOS2);
+}
+
+ZTEST(data_usage, test_connect_and_control)
+{
+	const uint32_t connect = 400 + CONNECT_LEN + 10 + 2 * PACKET_OVERHEAD;
+
+	/* Handshake, CONNECT with a 10 byte client ID, CONNACK, two IP headers */
+	data_usage_connect(10);
+	day_used(connect);
+
+	/* PINGREQ and PINGRESP */
+	data_usage_control(4, 2);
+	day_used(connect + 4 + 2 * PACKET_OVERHEAD);
+}
+
+ZTEST(data_usage, test_day_rollover)
+{
+	publish(MQTT_QOS_0_AT_MOST_ONCE);
+
+	/* Later the same day */
+	data_usage_mock_time_set(start_ms + MS_PER_DAY / 3);
+	publish(MQTT_QOS_0_AT_MOST_ONCE);
+	day_used(2 * PUBLISH_QOS0);
+
+	/* The next day starts a new daily window, the month goes on. */
+	data_usage_mock_time_set(start_ms + MS_PER_DAY);
+	publish(MQTT_QOS_0_AT_MOST_ONCE);
+	day_used(PUBLISH_QOS0);
+	month_used(3 * PUBLISH_QOS0);
+}
+
+ZTEST(data_usage, test_billing_day)
+{
+	publish(MQTT_QOS_0_AT_MOST_ONCE);
+
+	/* July 14 still belongs to the month that started on June 15. */
+	data_usage_mock_time_set(start_ms + 28 * MS_PER_DAY);
+	publish(MQTT_QOS_0_AT_MOST_ONCE);
+	day_used(PUBLISH_QOS0);
+	month_used(2 * PUBLISH_QOS0);
+
+	/* July 15 00:00 starts the next one. */
+	data_usage_mock_time_set(start_ms + 28 * MS_PER_DAY + MS_PER_DAY / 2);
+	data_usage_control(0, 0);
+	day_used(0);
+	month_used(0);
+}
+
+ZTEST(data_usage, test_no_network_time)
+{
+	publish(MQTT_QOS_0_AT_MOST_ONCE);
+
+	/* Without network time the windows stay as they are. */
+	data_usage_mock_time_set(0);
+	publish(MQTT_QOS_0_AT_MOST_ONCE);
+	day_used(2 * PUBLISH_QOS0);
+
+	data_usage_mock_time_set(start_ms);
+	publish(MQTT_QOS_0_AT_MOST_ONCE);
+	day_used(3 * PUBLISH_QOS0);
+}
+
+ZTEST(data_usage, test_daily_budget)
+{
+	struct data_usage_budget day;
+	struct data_usage_budget month;
+
+	/* 780 of 1024 bytes, below 80 % */
+	control_total(780);
+	zassert_equal(data_usage_level_get(), DATA_USAGE_NORMAL);
+	zassert_equal(data_usage_interval_s(10), 10);
+
+	/* 820 bytes */
+	control_total(40);
+	zassert_equal(data_usage_level_get(), DATA_USAGE_CONSTRAINED);
+	zassert_equal(data_usage_interval_s(10), 40);
+	zassert_true(data_usage_topic_allowed("mqtt/test/metrics"));
+
+	/* 1024 bytes */
+	control_total(204);
+	zassert_equal(data_usage_level_get(), DATA_USAGE_EXCEEDED);
+	zassert_false(data_usage_topic_allowed("mqtt/test/metrics"));
+	zassert_false(data_usage_topic_allowed("mqtt/test/profile"));
+	zassert_true(data_usage_topic_allowed("mqtt/test/telemetry"));
+	zassert_true(data_usage_topic_allowed("mqtt/test/metrics/raw"));
+
+	data_usage_budget_get(&day, &month);
+	zassert_equal(day.remaining, 0);
+	zassert_equal(month.remaining, 4096 - 1024);
+
+	/* A new day lifts the daily limit. */
+	data_usage_mock_time_set(start_ms + MS_PER_DAY);
+	data_usage_control(0, 0);
+	zassert_equal(data_usage_level_get(), DATA_USAGE_NORMAL);
+	zassert_true(data_usage_topic_allowed("mqtt/test/metrics"));
+}
+
+ZTEST(data_usage, test_monthly_budget)
+{
+	struct data_usage_budget day;
+	struct data_usage_budget month;
+
+	/* 1000 bytes a day stays within the daily budget. */
+	for (int i = 0; i < 4; i++)
+	{
+		data_usage_mock_time_set(start_ms + i * MS_PER_DAY);
+		control_total(1000);
+	}
+
+	data_usage_mock_time_set(start_ms + 4 * MS_PER_DAY);
+	control_total(96);
+
+	data_usage_budget_get(&day, &month);
+	zassert_equal(day.used, 96);
+	zassert_equal(day.remaining, 1024 - 96);
+	zassert_equal(month.used, 4096);
+	zassert_equal(month.remaining, 0);
+	zassert_equal(data_usage_level_get(), DATA_USAGE_EXCEEDED);
+}
+
+ZTEST_SUITE(data_usage, NULL, NULL, fresh_windows, NULL, NULL);
\ No newline at end of file
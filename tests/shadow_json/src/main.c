@@ -0,0 +1,208 @@
+/*
+Auhtor : Engr Akbar Shah
+
+Date : 21-05-2025
+
+Component : TEST_SHADOW_JSON.c
+*/
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include "shadow_json.h"
+
+static struct json_scan scan(const char *text)
+{
+	struct json_scan s = {
+		.p = text,
+		.end = text + strlen(text),
+	};
+
+	return s;
+}
+
+/* Scans one string and copies it into buf of the given size. */
+static void string_get(const char *text, char *buf, size_t size)
+{
+	struct json_scan s = scan(text);
+	const char *str;
+	size_t len;
+
+	zassert_true(json_scan_string(&s, &str, &len), "%s", text);
+	json_scan_string_copy(buf, size, str, len);
+}
+
+ZTEST(shadow_json, test_strings)
+{
+	struct json_scan s = scan("  \"key\" : \"a\\\"b\"");
+	const char *str;
+	size_t len;
+
+	zassert_true(json_scan_string(&s, &str, &len));
+	zassert_true(json_scan_key_is(str, len, "key"));
+	zassert_false(json_scan_key_is(str, len, "ke"));
+	zassert_false(json_scan_key_is(str, len, "keys"));
+	zassert_true(json_scan_expect(&s, ':'));
+
+	/* The escaped quote does not end the string, the raw bytes stay escaped. */
+	zassert_true(json_scan_string(&s, &str, &len));
+	zassert_equal(len, 4);
+	zassert_mem_equal(str, "a\\\"b", 4);
+	zassert_equal(s.p, s.end);
+
+	s = scan("42");
+	zassert_false(json_scan_string(&s, &str, &len));
+}
+
+ZTEST(shadow_json, test_escapes)
+{
+	char buf[32];
+
+	string_get("\"a\\nb\\tc\\r\\\\\\/\\\"\"", buf, sizeof(buf));
+	zassert_str_equal(buf, "a\nb\tc\r\\/\"");
+
+	/* \uXXXX is replaced, not decoded. */
+	string_get("\"caf\\u00e9!\"", buf, sizeof(buf));
+	zassert_str_equal(buf, "caf?!");
+
+	/* A \u cut short by the closing quote */
+	string_get("\"ab\\u00\"", buf, sizeof(buf));
+	zassert_str_equal(buf, "ab?");
+}
+
+ZTEST(shadow_json, test_numbers)
+{
+	struct json_scan s;
+	int32_t v;
+
+	s = scan(" -17,");
+	zassert_true(json_scan_is_number(&s));
+	zassert_true(json_scan_number(&s, &v));
+	zassert_equal(v, -17);
+	zassert_true(json_scan_peek(&s, ','));
+
+	/* Fraction and exponent are dropped. */
+	s = scan("3.9e2}");
+	zassert_true(json_scan_number(&s, &v));
+	zassert_equal(v, 3);
+	zassert_true(json_scan_peek(&s, '}'));
+
+	s = scan("-");
+	zassert_false(json_scan_number(&s, &v));
+
+	s = scan("\"1\"");
+	zassert_false(json_scan_is_number(&s));
+
+	s = scan(" true,");
+	zassert_true(json_scan_literal(&s, "true"));
+	zassert_true(json_scan_peek(&s, ','));
+
+	s = scan("tru");
+	zassert_false(json_scan_literal(&s, "true"));
+}
+
+ZTEST(shadow_json, test_nested_skip)
+{
+	struct json_scan s =
+		scan("{\"a\":{\"b\":[1,{\"c\":\"}]\\\"\"}],\"d\":{}}, \"e\" : [ ], \"f\":\"x\",\"g\":true}");
+	const char *key;
+	size_t len;
+
+	zassert_true(json_scan_expect(&s, '{'));
+
+	/* Brackets inside strings do not count. */
+	zassert_true(json_scan_string(&s, &key, &len));
+	zassert_true(json_scan_key_is(key, len, "a"));
+	zassert_true(json_scan_expect(&s, ':'));
+	zassert_true(json_scan_skip(&s));
+	zassert_true(json_scan_expect(&s, ','));
+
+	zassert_true(json_scan_string(&s, &key, &len));
+	zassert_true(json_scan_key_is(key, len, "e"));
+	zassert_true(json_scan_expect(&s, ':'));
+	zassert_true(json_scan_skip(&s));
+	zassert_true(json_scan_expect(&s, ','));
+
+	/* Scalars stop before the separator or the closing bracket. */
+	zassert_true(json_scan_string(&s, &key, &len));
+	zassert_true(json_scan_expect(&s, ':'));
+	zassert_true(json_scan_skip(&s));
+	zassert_true(json_scan_expect(&s, ','));
+
+	zassert_true(json_scan_string(&s, &key, &len));
+	zassert_true(json_scan_key_is(key, len, "g"));
+	zassert_true(json_scan_expect(&s, ':'));
+	zassert_true(json_scan_skip(&s));
+	zassert_true(json_scan_expect(&s, '}'));
+	zassert_equal(s.p, s.end);
+}
+
+ZTEST(shadow_json, test_truncated)
+{
+	static const char doc[] = "{\"state\":{\"s\":\"a\\\"b\",\"n\":[1,{\"x\":-2}]},\"version\":7}";
+	struct json_scan s;
+	const char *str;
+	size_t len;
+	int32_t v;
+
+	/* No prefix of a document is a complete value, and none is read past its end. */
+	for (size_t n = 0; n < sizeof(doc) - 1; n++)
+	{
+		s.p = doc;
+		s.end = doc + n;
+
+		zassert_false(json_scan_skip(&s), "prefix of %u bytes", (unsigned int)n);
+		zassert_true(s.p <= s.end, "read past %u bytes", (unsigned int)n);
+	}
+
+	/* Cut inside and right after an escape */
+	s = scan("\"ab\\");
+
+	zassert_false(json_scan_string(&s, &str, &len));
+	zassert_true(s.p <= s.end);
+
+	s = scan("\"ab\\\"");
+	zassert_false(json_scan_string(&s, &str, &len));
+	zassert_true(s.p <= s.end);
+
+	s = scan("   ");
+	zassert_false(json_scan_expect(&s, '{'));
+	zassert_false(json_scan_number(&s, &v));
+	zassert_equal(s.p, s.end);
+}
+
+ZTEST(shadow_json, test_oversize)
+{
+	struct json_scan s;
+	char small[8];
+	char one[1];
+	int32_t v;
+
+	/* Numbers beyond int32 are clamped. */
+	s = scan("99999999999");
+	zassert_true(json_scan_number(&s, &v));
+	zassert_equal(v, INT32_MAX);
+
+	s = scan("-99999999999");
+	zassert_true(json_scan_number(&s, &v));
+	zassert_equal(v, INT32_MIN);
+
+	s = scan("2147483647");
+	zassert_true(json_scan_number(&s, &v));
+	zassert_equal(v, INT32_MAX);
+
+	/* Strings are truncated to the buffer, always terminated. */
+	string_get("\"0123456789abcdef\"", small, sizeof(small));
+	zassert_str_equal(small, "0123456");
+
+	string_get("\"012345\\n789\"", small, sizeof(small));
+	zassert_str_equal(small, "012345\n");
+
+	string_get("\"0123456\\n\"", small, sizeof(small));
+	zassert_str_equal(small, "0123456");
+
+	string_get("\"abc\"", one, sizeof(one));
+	zassert_str_equal(one, "");
+}
+
+ZTEST_SUITE(shadow_json, NULL, NULL, NULL, NULL, NULL);
\ No newline at end of file
@@ -1,11 +1,20 @@
+import argparse
+import base64
+import hashlib
 import os
 import re
+import struct
 import sys
 
 # Path setup
 BASE_DIR = os.path.dirname(os.path.abspath(__file__))
 CERTS_DIR = os.path.join(BASE_DIR, "components", "certs")
-CERTS_H_PATH = os.path.join(CERTS_DIR, "certs.h")
+
+# Credential files are recognised by extension
+CERT_EXTENSIONS = (".pem", ".crt", ".key")
+
+# Sub directories named sec_tag_<N> hold the credentials of security tag N
+SEC_TAG_DIR_RE = re.compile(r"^sec_tag_(\d+)$")
 
 # Match rules based on filename
 MATCH_RULES = {
@@ -14,23 +23,44 @@ MATCH_RULES = {
     "root_ca": ["root"]
 }
 
+# enum modem_key_mgmt_cred_type
+CRED_TYPES = {
+    "root_ca": 0,       # MODEM_KEY_MGMT_CRED_TYPE_CA_CHAIN
+    "device_cert": 1,   # MODEM_KEY_MGMT_CRED_TYPE_PUBLIC_CERT
+    "private_key": 2,   # MODEM_KEY_MGMT_CRED_TYPE_PRIVATE_CERT
+}
+
+# enum cred_bundle_pem_label (components/certs/cred_bundle.h)
+PEM_LABELS = {
+    "CERTIFICATE": 0,
+    "RSA PRIVATE KEY": 1,
+    "PRIVATE KEY": 2,
+    "EC PRIVATE KEY": 3,
+}
+
+# Bundle layout (components/certs/cred_bundle.h)
+BUNDLE_MAGIC = 0x42445243
+BUNDLE_VERSION = 1
+HEADER_FMT = "<IHHI"
+ENTRY_FMT = "<IBBHII32s"
+
+PEM_RE = re.compile(r"-----BEGIN ([A-Z ]+)-----(.*?)-----END \1-----", re.S)
+
+
 def match_cert_type(filename):
     name = filename.lower()
+    if not name.endswith(CERT_EXTENSIONS):
+        return None
     for cert_type, keywords in MATCH_RULES.items():
         if any(keyword in name for keyword in keywords):
             return cert_type
     return None
 
-def convert_cert_to_c_format(file_path, var_name):
-    with open(file_path, "r") as f:
-        lines = [line.strip() for line in f if line.strip()]
-    lines = ['"{}\\n"'.format(line.replace('"', '\\"')) for line in lines]
-    return f'static const char {var_name}[] =\n' + '\n'.join(lines) + ';\n\n'
 
-def find_cert_files():
+def find_cert_files(directory):
     found = {key: [] for key in MATCH_RULES}
-    for fname in os.listdir(CERTS_DIR):
-        fpath = os.path.join(CERTS_DIR, fname)
+    for fname in sorted(os.listdir(directory)):
+        fpath = os.path.join(directory, fname)
         if not os.path.isfile(fpath):
             continue
         cert_type = match_cert_type(fname)
@@ -38,43 +68,146 @@ def find_cert_files():
             found[cert_type].append(fpath)
     return found
 
-def main():
-    cert_files = find_cert_files()
 
-    # Check for duplicates
+def find_sec_tags(default_tag):
+    tags = {default_tag: CERTS_DIR}
+    for fname in sorted(os.listdir(CERTS_DIR)):
+        match = SEC_TAG_DIR_RE.match(fname)
+        if match and os.path.isdir(os.path.join(CERTS_DIR, fname)):
+            tags[int(match.group(1))] = os.path.join(CERTS_DIR, fname)
+    return tags
+
+
+def pem_to_der(file_path):
+    with open(file_path, "r") as f:
+        text = f.read()
+    match = PEM_RE.search(text)
+    if not match:
+        raise ValueError(f"{os.path.basename(file_path)} is not a PEM file")
+    label = match.group(1)
+    if label not in PEM_LABELS:
+        raise ValueError(f"{os.path.basename(file_path)}: unsupported PEM type '{label}'")
+    der = base64.b64decode("".join(match.group(2).split()))
+    return label, der
+
+
+def pem_c_string_size(file_path):
+    """Flash used by the same credential as a static const char[] in certs.h."""
+    with open(file_path, "r") as f:
+        lines = [line.strip() for line in f if line.strip()]
+    return sum(len(line) + 1 for line in lines) + 1
+
+
+def collect_entries(default_tag):
+    entries = []
     has_duplicates = False
-    for key, files in cert_files.items():
-        if len(files) > 1:
-            print(f"⚠️  Multiple matches for '{key}':")
-            for f in files:
-                print(f"   - {os.path.basename(f)}")
-            has_duplicates = True
+
+    for tag, directory in find_sec_tags(default_tag).items():
+        cert_files = find_cert_files(directory)
+
+        # Check for duplicates
+        for key, files in cert_files.items():
+            if len(files) > 1:
+                print(f"⚠️  Multiple matches for '{key}' (sec tag {tag}):")
+                for f in files:
+                    print(f"   - {os.path.basename(f)}")
+                has_duplicates = True
+
+        for cert_type, files in cert_files.items():
+            if not files:
+                print(f"⚠️  Warning: No file matched for '{cert_type}' (sec tag {tag})")
+                continue
+            label, der = pem_to_der(files[0])
+            entries.append({
+                "tag": tag,
+                "type": CRED_TYPES[cert_type],
+                "name": cert_type,
+                "label": PEM_LABELS[label],
+                "der": der,
+                "pem_size": pem_c_string_size(files[0]),
+            })
 
     if has_duplicates:
         print("\n❌ Please remove duplicates and re-run the script.")
         sys.exit(1)
 
-    # Generate certificate blocks
-    cert_blocks = {}
-    for cert_type, files in cert_files.items():
-        if files:
-            cert_blocks[cert_type] = convert_cert_to_c_format(files[0], cert_type)
-        else:
-            print(f"⚠️  Warning: No file matched for '{cert_type}'")
+    return entries
+
+
+def build_bundle(entries):
+    header_len = struct.calcsize(HEADER_FMT) + len(entries) * struct.calcsize(ENTRY_FMT)
+    table = b""
+    data = b""
+
+    for e in entries:
+        offset = header_len + len(data)
+        table += struct.pack(ENTRY_FMT, e["tag"], e["type"], e["label"], 0,
+                             offset, len(e["der"]), hashlib.sha256(e["der"]).digest())
+        data += e["der"]
+
+    total_len = header_len + len(data)
+    header = struct.pack(HEADER_FMT, BUNDLE_MAGIC, BUNDLE_VERSION, len(entries), total_len)
+    return header + table + data
+
 
-    # Generate the header file
-    header = "#ifndef _CERTIFICATES_H\n#define _CERTIFICATES_H\n\n"
-    header += "int write_device_certs_to_modem(void);\n\n"
+def write_intel_hex(path, data, address):
+    def record(rec_type, addr, payload):
+        raw = bytes([len(payload), (addr >> 8) & 0xFF, addr & 0xFF, rec_type]) + payload
+        checksum = (-sum(raw)) & 0xFF
+        return ":" + raw.hex().upper() + f"{checksum:02X}\n"
 
-    for block in cert_blocks.values():
-        header += block
+    lines = []
+    upper = None
+    for pos in range(0, len(data), 16):
+        addr = address + pos
+        if upper != addr >> 16:
+            upper = addr >> 16
+            lines.append(record(0x04, 0, struct.pack(">H", upper)))
+        lines.append(record(0x00, addr & 0xFFFF, data[pos:pos + 16]))
+    lines.append(record(0x01, 0, b""))
+
+    with open(path, "w") as f:
+        f.writelines(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Build the DER credential bundle from the PEM files in components/certs")
+    parser.add_argument("--sec-tag", type=int, default=30,
+                        help="security tag of the files directly in components/certs")
+    parser.add_argument("--bundle", help="write the binary bundle to this file")
+    parser.add_argument("--hex", help="write the bundle as Intel HEX to this file")
+    parser.add_argument("--address", type=lambda v: int(v, 0), default=0,
+                        help="flash address of the cred_bundle partition (for --hex)")
+    parser.add_argument("--max-size", type=lambda v: int(v, 0), default=0,
+                        help="size of the cred_bundle partition")
+    args = parser.parse_args()
+
+    try:
+        entries = collect_entries(args.sec_tag)
+    except ValueError as err:
+        print(f"❌ {err}")
+        sys.exit(1)
+
+    bundle = build_bundle(entries)
+
+    if args.max_size and len(bundle) > args.max_size:
+        print(f"❌ Bundle is {len(bundle)} bytes, partition holds {args.max_size}.")
+        sys.exit(1)
 
-    header += "#endif\n"
+    if args.bundle:
+        with open(args.bundle, "wb") as f:
+            f.write(bundle)
+    if args.hex:
+        write_intel_hex(args.hex, bundle, args.address)
 
-    with open(CERTS_H_PATH, "w") as f:
-        f.write(header)
+    # Flash report
+    pem_total = sum(e["pem_size"] for e in entries)
+    for e in entries:
+        print(f"   tag {e['tag']:<5} {e['name']:<12} PEM {e['pem_size']:5} B -> DER {len(e['der']):5} B")
+    print(f"✅ Credential bundle: {len(entries)} entries, {len(bundle)} bytes "
+          f"(PEM strings: {pem_total} bytes per including file, saved {pem_total - len(bundle)} bytes)")
 
-    print("✅ certificates.h has been generated successfully.")
 
 if __name__ == "__main__":
     main()